@@ -0,0 +1,364 @@
+/* オーディオコマンドチャネル(shared/hostapi_acmd.h)の検証と、ロック共有との比較。
+ *
+ * check: 次を検証する(失敗で終了コード 1)。
+ *   - SPSC リング: 2 スレッドで大量に流し、順序・破れ読み・件数が合う
+ *   - ヒストグラムの区間分け
+ *   - 予約キューの写し(hostapi_sdl.c と同じ手順): wasm スレッド役が
+ *     enqueue / 取り消し / legacy 置き換えを写しに適用してコマンドで送り、
+ *     コールバック役が発火させて「キューを出た」通知を返す。止めて通知を
+ *     取り込んだ後、写しと本体の予約(seq の集合)が一致する
+ * compare: コールバック役(周期的に 8 声を描く)の所要時間ヒストグラムを
+ *   - mutex: 従来どおり予約キューを 1 つのロックで共有(SDL_LockAudioDevice
+ *     相当。コールバックは全体でロックを持つ)
+ *   - channel: コマンドチャネル
+ *   で比べる。wasm スレッド役はときどきロックを持ったまま(channel では
+ *   ロック無しで)数 ms 止まる(プリエンプション・優先度逆転の模擬)。
+ *
+ *   ./build/bench/bench_acmd [比較 1 回の秒数]
+ */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "hostapi_acmd.h"
+#include "hostapi_voice.h"
+
+#define RATE 44100
+#define PERIOD_FRAMES 256 /* コールバック役の周期(5.8ms) */
+
+static double now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static void sleep_us(long us)
+{
+    const struct timespec ts = {us / 1000000, (us % 1000000) * 1000};
+    nanosleep(&ts, NULL);
+}
+
+/* ---- SPSC リング ---- */
+
+typedef struct {
+    hostapi_acmd_ring_t q;
+    uint32_t n;
+    uint32_t errors;
+} Ring;
+
+static void* ring_producer(void* arg)
+{
+    Ring* r = arg;
+    for (uint32_t i = 0; i < r->n; i++) {
+        hostapi_acmd_t c;
+        memset(&c, 0, sizeof(c));
+        c.kind = (int32_t)(i % 7);
+        c.arg = (int32_t)i;
+        c.e.time_us = (int64_t)i * 3000;
+        c.e.seq = ~i;
+        while (!hostapi_acmd_push(&r->q, &c)) sched_yield();
+    }
+    return NULL;
+}
+
+static int check_ring(void)
+{
+    static Ring r;
+    hostapi_acmd_init(&r.q);
+    r.n = 200000;
+    pthread_t th;
+    pthread_create(&th, NULL, ring_producer, &r);
+    uint32_t expect = 0;
+    const double t0 = now_us();
+    while (expect < r.n) {
+        hostapi_acmd_t c;
+        if (!hostapi_acmd_pop(&r.q, &c)) {
+            if ((expect & 1023) == 0) sched_yield();
+            continue;
+        }
+        const uint32_t i = (uint32_t)c.arg;
+        if (i != expect || c.kind != (int32_t)(i % 7) || c.e.time_us != (int64_t)i * 3000 ||
+            c.e.seq != ~i) {
+            r.errors++;
+        }
+        expect = i + 1;
+    }
+    const double dt = now_us() - t0;
+    pthread_join(th, NULL);
+    hostapi_acmd_t c;
+    const int ok = r.errors == 0 && !hostapi_acmd_pop(&r.q, &c);
+    printf("check ring: %s (%u commands, %u errors, full %u, %.1f ns/command)\n",
+           ok ? "OK" : "NG", (unsigned)r.n, (unsigned)r.errors, (unsigned)r.q.full,
+           dt * 1000 / r.n);
+    return ok ? 0 : 1;
+}
+
+static int check_hist(void)
+{
+    hostapi_lathist_t h;
+    hostapi_lathist_init(&h, 100);
+    static const uint32_t kUs[] = {0, 1, 2, 3, 4, 100, 101, 1000000};
+    static const int kBucket[] = {0, 1, 2, 2, 3, 7, 7, HOSTAPI_LATHIST_BUCKETS - 1};
+    int ok = 1;
+    for (int i = 0; i < 8; i++) {
+        hostapi_lathist_t one;
+        hostapi_lathist_init(&one, 0);
+        hostapi_lathist_add(&one, kUs[i]);
+        if (one.b[kBucket[i]] != 1) ok = 0;
+        hostapi_lathist_add(&h, kUs[i]);
+    }
+    ok = ok && h.count == 8 && h.over == 2 && h.max_us == 1000000 &&
+         hostapi_lathist_quantile(&h, 0.5) == 4;
+    printf("check hist: %s\n", ok ? "OK" : "NG");
+    return ok ? 0 : 1;
+}
+
+/* ---- wasm スレッド役 / コールバック役 ---- */
+
+typedef struct {
+    int use_lock;              /* 1 = mutex で共有、0 = コマンドチャネル */
+    /* 共有 */
+    pthread_mutex_t lock;
+    uint32_t now_ms;           /* コールバック役が進める時計(atomic) */
+    int stop_ui;               /* atomic */
+    int stop_cb;               /* atomic */
+    hostapi_acmd_ring_t cmd;
+    hostapi_acmd_ring_t gone;
+    /* コールバック役 */
+    hostapi_tsched_t real;
+    uint32_t last_fired;
+    hostapi_voices_t voices;
+    hostapi_lathist_t hist;
+    uint32_t fired;
+    /* wasm スレッド役 */
+    hostapi_tsched_t ui;
+    uint32_t ui_last_fired;
+    uint32_t ops;
+} Sim;
+
+static void sim_send(Sim* s, int32_t kind, int32_t arg, const hostapi_tsched_entry_t* e)
+{
+    hostapi_acmd_t c;
+    memset(&c, 0, sizeof(c));
+    c.kind = kind;
+    c.arg = arg;
+    if (e) c.e = *e;
+    while (!hostapi_acmd_push(&s->cmd, &c)) sched_yield(); /* 待つのは wasm 役だけ */
+}
+
+static void sim_gone(Sim* s, const hostapi_tsched_entry_t* e, bool fired)
+{
+    hostapi_acmd_t c;
+    c.kind = HOSTAPI_ACMD_GONE;
+    c.arg = fired;
+    c.e = *e;
+    hostapi_acmd_push(&s->gone, &c);
+}
+
+/* hostapi_sdl.c の acmd_apply と同じ手順(発音は数えるだけ) */
+static void sim_apply(Sim* s, const hostapi_acmd_t* c)
+{
+    hostapi_tsched_entry_t old;
+    bool fire_old;
+    switch (c->kind) {
+    case HOSTAPI_ACMD_INSERT:
+        s->real.seq = c->e.seq;
+        if (!hostapi_tsched_insert(&s->real, &c->e)) sim_gone(s, &c->e, false);
+        break;
+    case HOSTAPI_ACMD_SET_LEGACY:
+        s->real.seq = c->e.seq;
+        if (!hostapi_tsched_set_legacy(&s->real, hostapi_tsched_time_ms(&c->e),
+                                       (uint32_t)c->arg, &s->last_fired, c->e.freq_hz,
+                                       c->e.dur_ms, c->e.level, &old, &fire_old)) {
+            sim_gone(s, &c->e, false);
+        }
+        if (fire_old) {
+            s->fired++;
+            sim_gone(s, &old, true);
+        }
+        break;
+    case HOSTAPI_ACMD_REMOVE_ID:
+        hostapi_tsched_remove_id(&s->real, c->arg);
+        break;
+    default:
+        break;
+    }
+}
+
+static void* sim_callback(void* arg)
+{
+    Sim* s = arg;
+    static int16_t buf[PERIOD_FRAMES * 2];
+    const long period_us = PERIOD_FRAMES * 1000000L / RATE;
+    struct timespec next;
+    clock_gettime(CLOCK_MONOTONIC, &next);
+    while (!__atomic_load_n(&s->stop_cb, __ATOMIC_ACQUIRE)) {
+        const double t0 = now_us();
+        if (s->use_lock) pthread_mutex_lock(&s->lock);
+        hostapi_acmd_t c;
+        while (hostapi_acmd_pop(&s->cmd, &c)) sim_apply(s, &c);
+        const uint32_t now = __atomic_load_n(&s->now_ms, __ATOMIC_RELAXED) + 6;
+        __atomic_store_n(&s->now_ms, now, __ATOMIC_RELAXED);
+        const hostapi_tsched_entry_t* top;
+        while ((top = hostapi_tsched_top(&s->real)) != NULL && hostapi_tsched_time_ms(top) <= now) {
+            const hostapi_tsched_entry_t e = hostapi_tsched_pop(&s->real);
+            if (e.id == 0) s->last_fired = hostapi_tsched_time_ms(&e);
+            s->fired++;
+            if (!s->use_lock) sim_gone(s, &e, true);
+            hostapi_voices_start(&s->voices, RATE, (uint16_t)(300 + e.seq % 1000), 100, 60,
+                                 98);
+        }
+        hostapi_voices_render(&s->voices, buf, PERIOD_FRAMES);
+        if (s->use_lock) pthread_mutex_unlock(&s->lock);
+        hostapi_lathist_add(&s->hist, (uint32_t)(now_us() - t0));
+
+        next.tv_nsec += period_us * 1000;
+        if (next.tv_nsec >= 1000000000L) {
+            next.tv_sec++;
+            next.tv_nsec -= 1000000000L;
+        }
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+    }
+    return NULL;
+}
+
+static void sim_sync(Sim* s)
+{
+    hostapi_acmd_t c;
+    while (hostapi_acmd_pop(&s->gone, &c)) {
+        hostapi_tsched_remove_seq(&s->ui, c.e.seq);
+        const uint32_t time_ms = hostapi_tsched_time_ms(&c.e);
+        if (c.arg && c.e.id == 0 && time_ms > s->ui_last_fired) s->ui_last_fired = time_ms;
+    }
+}
+
+/* 1 回ぶんの API 呼び出し。q は mutex 版では本体、channel 版では写し */
+static void sim_op(Sim* s, hostapi_tsched_t* q, uint32_t* last_fired, uint32_t r)
+{
+    const uint32_t now = __atomic_load_n(&s->now_ms, __ATOMIC_RELAXED);
+    hostapi_tsched_entry_t e = hostapi_tsched_tone_entry(1000, 30, 100);
+    const uint32_t t = now + r % 200;
+    e.time_us = (int64_t)t * 1000;
+    const uint32_t kind = (r >> 8) % 16;
+    if (kind < 10) { /* enqueue */
+        e.id = hostapi_tsched_next_id(q);
+        e.seq = q->seq;
+        if (hostapi_tsched_insert(q, &e) && !s->use_lock) {
+            sim_send(s, HOSTAPI_ACMD_INSERT, 0, &e);
+        }
+    } else if (kind < 14) { /* 取り消し */
+        if (q->count == 0) return;
+        const int32_t id = q->e[(r >> 12) % (uint32_t)q->count].id;
+        if (id == 0) return;
+        if (hostapi_tsched_remove_id(q, id) && !s->use_lock) {
+            sim_send(s, HOSTAPI_ACMD_REMOVE_ID, id, NULL);
+        }
+    } else { /* legacy の置き換え(期限到来済みの旧予約が残っていることもある) */
+        hostapi_tsched_entry_t old;
+        bool fire_old;
+        e.seq = q->seq;
+        if (hostapi_tsched_set_legacy(q, t, now, last_fired, 1000, 30, 100, &old,
+                                      &fire_old) &&
+            !s->use_lock) {
+            sim_send(s, HOSTAPI_ACMD_SET_LEGACY, (int32_t)now, &e);
+        }
+        if (fire_old && s->use_lock) s->fired++;
+    }
+}
+
+static void* sim_ui(void* arg)
+{
+    Sim* s = arg;
+    uint32_t r = 12345;
+    while (!__atomic_load_n(&s->stop_ui, __ATOMIC_ACQUIRE)) {
+        r = r * 1103515245u + 12345u;
+        /* 64 回に 1 回、2ms 止まる(mutex 版はロックを持ったまま) */
+        const bool stall = ((r >> 16) & 63) == 0;
+        if (s->use_lock) {
+            pthread_mutex_lock(&s->lock);
+            sim_op(s, &s->real, &s->last_fired, r >> 3);
+            if (stall) sleep_us(2000);
+            pthread_mutex_unlock(&s->lock);
+        } else {
+            sim_sync(s);
+            sim_op(s, &s->ui, &s->ui_last_fired, r >> 3);
+            if (stall) sleep_us(2000);
+        }
+        s->ops++;
+        sleep_us(50); /* tick 内の API 呼び出し間隔の模擬 */
+    }
+    return NULL;
+}
+
+/* 写しと本体の予約が seq の集合として一致するか */
+static bool sim_consistent(const Sim* s)
+{
+    if (s->ui.count != s->real.count) return false;
+    for (int i = 0; i < s->ui.count; i++) {
+        bool found = false;
+        for (int j = 0; j < s->real.count && !found; j++) {
+            found = s->ui.e[i].seq == s->real.e[j].seq;
+        }
+        if (!found) return false;
+    }
+    return true;
+}
+
+static int run_sim(int use_lock, double seconds, hostapi_lathist_t* out)
+{
+    static Sim s;
+    memset(&s, 0, sizeof(s));
+    s.use_lock = use_lock;
+    pthread_mutex_init(&s.lock, NULL);
+    hostapi_acmd_init(&s.cmd);
+    hostapi_acmd_init(&s.gone);
+    hostapi_tsched_reset(&s.real);
+    hostapi_tsched_reset(&s.ui);
+    hostapi_voices_init(&s.voices, HOSTAPI_VOICE_DEFAULT);
+    hostapi_lathist_init(&s.hist, PERIOD_FRAMES * 1000000u / RATE);
+    pthread_t cb, ui;
+    pthread_create(&cb, NULL, sim_callback, &s);
+    pthread_create(&ui, NULL, sim_ui, &s);
+    sleep_us((long)(seconds * 1e6));
+    __atomic_store_n(&s.stop_ui, 1, __ATOMIC_RELEASE);
+    pthread_join(ui, NULL);
+    /* コールバック役にコマンドを全部適用させてから止める */
+    while (__atomic_load_n(&s.cmd.head, __ATOMIC_ACQUIRE) != s.cmd.tail) sleep_us(1000);
+    sleep_us(20000);
+    __atomic_store_n(&s.stop_cb, 1, __ATOMIC_RELEASE);
+    pthread_join(cb, NULL);
+    *out = s.hist;
+    printf("%s: %u API calls, %u fired\n", use_lock ? "mutex" : "channel", (unsigned)s.ops,
+           (unsigned)s.fired);
+    if (use_lock) return 0;
+    sim_sync(&s);
+    const bool ok = sim_consistent(&s) && s.gone.full == 0;
+    printf("check mirror: %s (ui %d / real %d pending, gone ring full %u, cmd high water %u)\n",
+           ok ? "OK" : "NG", s.ui.count, s.real.count, (unsigned)s.gone.full,
+           (unsigned)s.cmd.high_water);
+    return ok ? 0 : 1;
+}
+
+int main(int argc, char** argv)
+{
+    const double seconds = argc > 1 ? atof(argv[1]) : 2.0;
+    int fail = 0;
+    fail |= check_ring();
+    fail |= check_hist();
+    hostapi_lathist_t h_lock, h_chan;
+    printf("\ncallback every %d frames (%.1f ms), wasm thread stalls 2 ms every ~64 calls, "
+           "%.1f s each\n",
+           PERIOD_FRAMES, PERIOD_FRAMES * 1000.0 / RATE, seconds);
+    run_sim(1, seconds, &h_lock);
+    fail |= run_sim(0, seconds, &h_chan);
+    printf("\n");
+    hostapi_lathist_print(stdout, "callback (mutex)", &h_lock);
+    hostapi_lathist_print(stdout, "callback (channel)", &h_chan);
+    return fail;
+}
@@ -0,0 +1,98 @@
+/* draw_lines / draw_points のスループット計測。
+ *
+ * 総点数を HOSTAPI_LINE_SLOTS 個の slot に分けて登録し、
+ *   - native 呼び出し(点列取り込み)
+ *   - host_sdl_render(全スロットの描画+Present)
+ * をそれぞれ平均する。比較用に同じ点数を fill_rect 1x1 相当
+ * (host_sdl_rect の直接呼び出し)で描いた場合も出す。
+ *
+ *   SDL_VIDEODRIVER=dummy SDL_AUDIODRIVER=dummy ./build/bench/bench_draw
+ */
+#include <stdint.h>
+#include <stdio.h>
+
+#include <SDL.h>
+
+#include "hostapi_defs.h"
+#include "hostapi_sdl.h"
+
+#define ITERATIONS 200
+
+static int16_t s_pts[HOSTAPI_LINE_MAX_POINTS * 2];
+
+static double elapsed_us(uint64_t t0, uint64_t t1)
+{
+    return (double)(t1 - t0) * 1e6 / (double)SDL_GetPerformanceFrequency();
+}
+
+static void fill_pattern(int slot, int n)
+{
+    for (int i = 0; i < n; ++i) {
+        s_pts[i * 2] = (int16_t)(i * 320 / n);
+        s_pts[i * 2 + 1] = (int16_t)(slot * 60 + (i * 7) % 56);
+    }
+}
+
+static void bench_slots(int total, bool points)
+{
+    const int per_slot = total / HOSTAPI_LINE_SLOTS;
+    double t_update = 0.0, t_render = 0.0;
+
+    for (int it = 0; it < ITERATIONS; ++it) {
+        for (int slot = 0; slot < HOSTAPI_LINE_SLOTS; ++slot) {
+            fill_pattern(slot, per_slot);
+            const uint64_t t0 = SDL_GetPerformanceCounter();
+            if (points) {
+                native_hostapi_draw_points(NULL, slot, (const char*)s_pts,
+                                           (uint32_t)per_slot * 4, 0x40c0ff);
+            } else {
+                native_hostapi_draw_lines(NULL, slot, (const char*)s_pts,
+                                          (uint32_t)per_slot * 4, 0x40c0ff);
+            }
+            t_update += elapsed_us(t0, SDL_GetPerformanceCounter());
+        }
+        const uint64_t t1 = SDL_GetPerformanceCounter();
+        host_sdl_render();
+        t_render += elapsed_us(t1, SDL_GetPerformanceCounter());
+    }
+    printf("draw_%-6s %5d pts: update %8.1f us  render %8.1f us\n",
+           points ? "points" : "lines", total, t_update / ITERATIONS,
+           t_render / ITERATIONS);
+}
+
+/* 従来手段(1 点 = 1 矩形)との比較 */
+static void bench_rects(int total)
+{
+    const int per_slot = total / HOSTAPI_LINE_SLOTS;
+    double t_render = 0.0;
+
+    for (int it = 0; it < ITERATIONS; ++it) {
+        const uint64_t t0 = SDL_GetPerformanceCounter();
+        host_sdl_begin_frame(0x000000);
+        for (int slot = 0; slot < HOSTAPI_LINE_SLOTS; ++slot) {
+            fill_pattern(slot, per_slot);
+            for (int i = 0; i < per_slot; ++i) {
+                host_sdl_rect(s_pts[i * 2], s_pts[i * 2 + 1], 1, 1, 0x40c0ff);
+            }
+        }
+        host_sdl_present();
+        t_render += elapsed_us(t0, SDL_GetPerformanceCounter());
+    }
+    printf("rect 1x1     %5d pts: render %8.1f us\n", total, t_render / ITERATIONS);
+}
+
+int main(void)
+{
+    if (!host_sdl_init()) return 1;
+
+    static const int kTotals[] = { 256, 1024, 4096 };
+    for (size_t i = 0; i < sizeof(kTotals) / sizeof(kTotals[0]); ++i) {
+        bench_slots(kTotals[i], false);
+        bench_slots(kTotals[i], true);
+        bench_rects(kTotals[i]);
+        host_sdl_clear_slots();
+    }
+
+    host_sdl_shutdown();
+    return 0;
+}
@@ -0,0 +1,329 @@
+/* shared/hostapi_evq.h(入力イベント SPSC リング)のストレス検証とスループット計測。
+ *
+ * stress: 生産者/消費者の 2 スレッドで DOWN → MOVE… → UP の列と widget CHANGED を
+ *         大量に流し、消費者側で次を検証する(違反があれば exit 1)。
+ *   - 取り出し順が time_ms(生産順の通し番号)で単調増加(FIFO)
+ *   - 各イベントの x / y / time_ms が同じ通し番号から作られている(破れ読みなし)
+ *   - 積んだ数 = 取り出した数 + 最古として捨てた数(取りこぼし・二重取り出しなし)
+ *   深さ 2 / 16 / 64 それぞれで、消費者の速度を変えた 3 通り(追従 / 間欠 / 低速)で回す。低速では満杯に
+ *   なり、最古の追い出しと MOVE の破棄も起きる。
+ * throughput: 1 スレッドでの push+pop 往復、2 スレッドでの連続転送を
+ *   pthread mutex 版キュー(従来の spinlock 臨界区間相当)と比較する。
+ *
+ *   ./build/bench/bench_evq [stress_events]
+ */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "hostapi_evq.h"
+
+#define DEPTH HOSTAPI_EVQ_DEPTH  /* throughput の深さ(ホストと同じ既定値) */
+#define STRESS_MAX_DEPTH 64
+
+static double now_sec(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+/* ---- stress ---- */
+
+typedef struct {
+    hostapi_evq_t q;
+    hostapi_evq_slot_t slots[STRESS_MAX_DEPTH];
+    uint32_t depth;
+    uint32_t n_events;
+    int consumer_mode;     /* 0=追従, 1=間欠(yield), 2=低速(64 件ごとに 100µs 眠る) */
+    volatile int done;
+    /* 生産者の結果集計 */
+    uint64_t res[5];
+    /* 消費者の集計 */
+    uint64_t popped;
+    uint64_t errors;
+} Stress;
+
+static int16_t enc_x(uint32_t seq) { return (int16_t)(seq & 0x7fff); }
+static int16_t enc_y(uint32_t seq) { return (int16_t)((seq >> 15) & 0x7fff); }
+
+static void* stress_producer(void* arg)
+{
+    Stress* st = arg;
+    for (uint32_t seq = 1; seq <= st->n_events; ++seq) {
+        const uint32_t phase = seq % 64;
+        uint16_t type;
+        int16_t y = enc_y(seq);
+        uint16_t param = 0;
+        if (phase == 0) {
+            type = HOSTAPI_EV_TOUCH_DOWN;
+        } else if (phase == 40) {
+            type = HOSTAPI_EV_TOUCH_UP;
+        } else if (phase > 48 && phase % 4 == 0) {
+            type = HOSTAPI_EV_WIDGET;
+            param = (uint16_t)(seq % 3);
+            y = HOSTAPI_WIDGET_EV_CHANGED;
+        } else {
+            type = HOSTAPI_EV_TOUCH_MOVE; /* UP 後の MOVE は REJECTED になる */
+        }
+        const hostapi_evq_result_t r = hostapi_evq_push(&st->q, type, param, enc_x(seq), y, seq);
+        st->res[r]++;
+        /* 1 コア環境でも消費者と交互に動くよう、ときどき譲る */
+        if ((seq & 31) == 0) sched_yield();
+    }
+    __atomic_store_n(&st->done, 1, __ATOMIC_RELEASE);
+    return NULL;
+}
+
+static void* stress_consumer(void* arg)
+{
+    Stress* st = arg;
+    uint32_t last_seq = 0;
+    uint64_t spin = 0;
+    for (;;) {
+        hostapi_event_t ev;
+        if (!hostapi_evq_pop(&st->q, &ev)) {
+            if (__atomic_load_n(&st->done, __ATOMIC_ACQUIRE) && hostapi_evq_count(&st->q) == 0) {
+                break;
+            }
+            sched_yield();
+            continue;
+        }
+        st->popped++;
+        const uint32_t seq = ev.time_ms;
+        bool ok = seq > last_seq && ev.x == enc_x(seq);
+        if (ev.type == HOSTAPI_EV_WIDGET) {
+            ok = ok && ev.y == HOSTAPI_WIDGET_EV_CHANGED && ev.param == seq % 3;
+        } else {
+            ok = ok && ev.y == enc_y(seq);
+            if (ev.type == HOSTAPI_EV_TOUCH_MOVE) ok = ok && ev.param >= 1;
+            else ok = ok && ev.param == 0;
+        }
+        if (!ok) {
+            if (st->errors < 10) {
+                fprintf(stderr, "  bad event: type=%u param=%u x=%d y=%d t=%u (last %u)\n",
+                        ev.type, ev.param, ev.x, ev.y, ev.time_ms, last_seq);
+            }
+            st->errors++;
+        }
+        last_seq = seq;
+
+        if (st->consumer_mode == 1 && (++spin & 7) == 0) {
+            sched_yield();
+        } else if (st->consumer_mode == 2 && (++spin & 63) == 0) {
+            const struct timespec ts = { 0, 100 * 1000 };
+            nanosleep(&ts, NULL);
+        }
+    }
+    return NULL;
+}
+
+static bool run_stress(uint32_t n_events, uint32_t depth, int mode)
+{
+    static const char* kModeName[] = { "follow", "yield", "slow" };
+    Stress* st = calloc(1, sizeof(*st));
+    hostapi_evq_init(&st->q, st->slots, depth);
+    st->depth = depth;
+    st->n_events = n_events;
+    st->consumer_mode = mode;
+
+    pthread_t prod, cons;
+    const double t0 = now_sec();
+    pthread_create(&cons, NULL, stress_consumer, st);
+    pthread_create(&prod, NULL, stress_producer, st);
+    pthread_join(prod, NULL);
+    pthread_join(cons, NULL);
+    const double dt = now_sec() - t0;
+
+    const uint64_t stored = st->res[HOSTAPI_EVQ_PUSHED] + st->res[HOSTAPI_EVQ_DROPPED_OLDEST];
+    const uint64_t dropped_oldest = st->res[HOSTAPI_EVQ_DROPPED_OLDEST];
+    const bool balanced = stored == st->popped + dropped_oldest;
+    const bool counters_ok =
+        st->q.dropped == dropped_oldest + st->res[HOSTAPI_EVQ_DROPPED_NEW] &&
+        st->q.coalesced == st->res[HOSTAPI_EVQ_COALESCED] && st->q.high_water <= depth;
+    const bool pass = st->errors == 0 && balanced && counters_ok;
+
+    printf("stress d=%-2u %-6s %u ev in %.2fs: pushed %llu coalesced %llu drop-oldest %llu "
+           "drop-new %llu rejected %llu popped %llu high-water %u/%u -> %s\n",
+           depth, kModeName[mode], n_events, dt,
+           (unsigned long long)st->res[HOSTAPI_EVQ_PUSHED],
+           (unsigned long long)st->res[HOSTAPI_EVQ_COALESCED],
+           (unsigned long long)dropped_oldest,
+           (unsigned long long)st->res[HOSTAPI_EVQ_DROPPED_NEW],
+           (unsigned long long)st->res[HOSTAPI_EVQ_REJECTED],
+           (unsigned long long)st->popped, st->q.high_water, depth,
+           pass ? "OK" : "FAIL");
+    if (!balanced) fprintf(stderr, "  count mismatch: stored %llu != popped + dropped\n",
+                           (unsigned long long)stored);
+    if (!counters_ok) fprintf(stderr, "  ring counters disagree with push results\n");
+    free(st);
+    return pass;
+}
+
+/* ---- throughput ---- */
+
+/* 比較用: 従来実装(満杯は最古を捨てる配列キュー)を mutex で保護したもの */
+typedef struct {
+    pthread_mutex_t mu;
+    hostapi_event_t ev[DEPTH];
+    int head, count;
+} MutexQueue;
+
+static void mq_push(MutexQueue* m, const hostapi_event_t* ev)
+{
+    pthread_mutex_lock(&m->mu);
+    if (m->count == DEPTH) {
+        m->head = (m->head + 1) % DEPTH;
+        m->count--;
+    }
+    m->ev[(m->head + m->count) % DEPTH] = *ev;
+    m->count++;
+    pthread_mutex_unlock(&m->mu);
+}
+
+static bool mq_pop(MutexQueue* m, hostapi_event_t* out)
+{
+    pthread_mutex_lock(&m->mu);
+    const bool ok = m->count > 0;
+    if (ok) {
+        *out = m->ev[m->head];
+        m->head = (m->head + 1) % DEPTH;
+        m->count--;
+    }
+    pthread_mutex_unlock(&m->mu);
+    return ok;
+}
+
+typedef struct {
+    hostapi_evq_t q;
+    hostapi_evq_slot_t slots[DEPTH];
+    MutexQueue mq;
+    bool use_mutex;
+    uint32_t n;
+    volatile int done;
+    uint64_t popped;
+} Stream;
+
+static uint32_t stream_count(Stream* s)
+{
+    if (!s->use_mutex) return hostapi_evq_count(&s->q);
+    pthread_mutex_lock(&s->mq.mu);
+    const uint32_t n = (uint32_t)s->mq.count;
+    pthread_mutex_unlock(&s->mq.mu);
+    return n;
+}
+
+/* 満杯なら消費者を待つ(捨てずに全件転送したときの転送速度を測る) */
+static void* stream_producer(void* arg)
+{
+    Stream* s = arg;
+    for (uint32_t i = 1; i <= s->n; ++i) {
+        while (stream_count(s) >= DEPTH) sched_yield();
+        const uint16_t type = (i & 1) ? HOSTAPI_EV_TOUCH_DOWN : HOSTAPI_EV_TOUCH_UP;
+        if (s->use_mutex) {
+            const hostapi_event_t ev = { type, 0, 1, 2, i };
+            mq_push(&s->mq, &ev);
+        } else {
+            hostapi_evq_push(&s->q, type, 0, 1, 2, i);
+        }
+    }
+    __atomic_store_n(&s->done, 1, __ATOMIC_RELEASE);
+    return NULL;
+}
+
+static void* stream_consumer(void* arg)
+{
+    Stream* s = arg;
+    hostapi_event_t ev;
+    for (;;) {
+        const bool got = s->use_mutex ? mq_pop(&s->mq, &ev) : hostapi_evq_pop(&s->q, &ev);
+        if (got) {
+            s->popped++;
+        } else if (__atomic_load_n(&s->done, __ATOMIC_ACQUIRE)) {
+            const bool more = s->use_mutex ? mq_pop(&s->mq, &ev) : hostapi_evq_pop(&s->q, &ev);
+            if (!more) break;
+            s->popped++;
+        } else {
+            sched_yield();
+        }
+    }
+    return NULL;
+}
+
+static void run_stream(uint32_t n, bool use_mutex)
+{
+    Stream* s = calloc(1, sizeof(*s));
+    hostapi_evq_init(&s->q, s->slots, DEPTH);
+    pthread_mutex_init(&s->mq.mu, NULL);
+    s->use_mutex = use_mutex;
+    s->n = n;
+
+    pthread_t prod, cons;
+    const double t0 = now_sec();
+    pthread_create(&cons, NULL, stream_consumer, s);
+    pthread_create(&prod, NULL, stream_producer, s);
+    pthread_join(prod, NULL);
+    pthread_join(cons, NULL);
+    const double dt = now_sec() - t0;
+
+    printf("stream %-5s %u ev: %.1f Mev/s, delivered %.1f%%\n",
+           use_mutex ? "mutex" : "evq", n, n / dt * 1e-6, 100.0 * (double)s->popped / n);
+    pthread_mutex_destroy(&s->mq.mu);
+    free(s);
+}
+
+static void run_pingpong(uint32_t n)
+{
+    static hostapi_evq_slot_t slots[DEPTH];
+    hostapi_evq_t q;
+    hostapi_evq_init(&q, slots, DEPTH);
+    MutexQueue mq = { .head = 0, .count = 0 };
+    pthread_mutex_init(&mq.mu, NULL);
+    hostapi_event_t ev = { 0 };
+    uint64_t sink = 0;
+
+    double t0 = now_sec();
+    for (uint32_t i = 0; i < n; ++i) {
+        hostapi_evq_push(&q, (i & 1) ? HOSTAPI_EV_TOUCH_UP : HOSTAPI_EV_TOUCH_DOWN, 0, 1, 2, i);
+        hostapi_evq_pop(&q, &ev);
+        sink += ev.time_ms;
+    }
+    const double t_evq = now_sec() - t0;
+
+    t0 = now_sec();
+    for (uint32_t i = 0; i < n; ++i) {
+        const hostapi_event_t in = { HOSTAPI_EV_TOUCH_DOWN, 0, 1, 2, i };
+        mq_push(&mq, &in);
+        mq_pop(&mq, &ev);
+        sink += ev.time_ms;
+    }
+    const double t_mq = now_sec() - t0;
+
+    printf("push+pop 1 thread: evq %.1f ns, mutex %.1f ns (sink %llu)\n",
+           t_evq / n * 1e9, t_mq / n * 1e9, (unsigned long long)(sink & 1));
+    pthread_mutex_destroy(&mq.mu);
+}
+
+int main(int argc, char** argv)
+{
+    const uint32_t n = (argc > 1) ? (uint32_t)strtoul(argv[1], NULL, 10) : 1000000;
+
+    static const uint32_t kDepths[] = { 2, 16, STRESS_MAX_DEPTH };
+    bool pass = true;
+    for (size_t i = 0; i < sizeof(kDepths) / sizeof(kDepths[0]); ++i) {
+        pass &= run_stress(n, kDepths[i], 0);
+        pass &= run_stress(n, kDepths[i], 1);
+        pass &= run_stress(n / 10, kDepths[i], 2);
+    }
+
+    run_pingpong(10000000);
+    run_stream(5000000, false);
+    run_stream(5000000, true);
+
+    return pass ? 0 : 1;
+}
@@ -0,0 +1,191 @@
+/* MP3 の音量を掛ける Q15 ゲイン段(shared/hostapi_gain.h)と旧 write_fn の
+ * ループ(1 サンプルずつ float 乗算 + lround + クランプ)の比較。
+ *
+ * 次を検証する(失敗で終了コード 1):
+ *   - SIMD とスカラの出力がビット一致(int16 全域 × 代表的なゲイン)
+ *   - 旧ループとの差が 1 LSB 以内(ゲインの Q15 量子化ぶん)
+ *   - ランプ: ブロックの最後でちょうど新しいゲイン、途中は単調で 1 フレームの
+ *     ゲイン変化が (差 / フレーム数) を超えない
+ *   - 出力ミキサ(shared/hostapi_mix.h)経由で音量を変えても、音楽の出力に
+ *     段差が出ない(直流を入れて隣り合うサンプルの差を見る)
+ * コストは MP3 1 フレーム(1152 フレーム ステレオ)とミキサの 1 チャンク
+ * (HOSTAPI_MIX_CHUNK フレーム)あたり。
+ *
+ *   ./build/bench/bench_gain [反復回数]
+ */
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "hostapi_gain.h"
+#include "hostapi_mix.h"
+
+static double now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+/* 旧 write_fn の音量ループ(比較用) */
+static void gain_float_ref(const int16_t* in, int16_t* out, int n, int volume)
+{
+    const float volume_factor = (float)volume / 100.0f;
+    for (int i = 0; i < n; ++i) {
+        int32_t v = (int32_t)lroundf((float)in[i] * volume_factor);
+        if (v > 32767) v = 32767;
+        else if (v < -32768) v = -32768;
+        out[i] = (int16_t)v;
+    }
+}
+
+static int check_exact(void)
+{
+    enum { N = 65536 };
+    static int16_t in[N], a[N], b[N], f[N];
+    for (int i = 0; i < N; i++) in[i] = (int16_t)(i - 32768);
+    static const int kVol[] = {0, 1, 10, 50, 73, 98, 99};
+    int fail = 0;
+    for (size_t k = 0; k < sizeof(kVol) / sizeof(kVol[0]); k++) {
+        const int32_t g = kVol[k] * HOSTAPI_GAIN_UNITY / 100;
+        hostapi_gain_const_scalar(in, a, N, g);
+        hostapi_gain_const(in + 3, b + 3, N - 3, g); /* 揃っていない先頭も通す */
+        hostapi_gain_const(in, b, 3, g);
+        gain_float_ref(in, f, N, kVol[k]);
+        int worst = 0;
+        for (int i = 0; i < N; i++) {
+            const int d = abs(a[i] - f[i]);
+            if (d > worst) worst = d;
+        }
+        const int same = memcmp(a, b, sizeof(a)) == 0;
+        const int ok = same && worst <= 1;
+        printf("check volume %3d: %s (%s == scalar: %s, max diff vs float %d LSB)\n", kVol[k],
+               ok ? "OK" : "NG", hostapi_gain_kernel_name(), same ? "yes" : "no", worst);
+        fail |= !ok;
+    }
+    /* 1.0 はコピー */
+    hostapi_gain_t gs;
+    hostapi_gain_init(&gs, HOSTAPI_GAIN_UNITY);
+    hostapi_gain_process(&gs, HOSTAPI_GAIN_UNITY, in, a, N / 2, 2);
+    const int unity = memcmp(in, a, sizeof(in)) == 0;
+    printf("check unity: %s (gain 1.0 passes through)\n", unity ? "OK" : "NG");
+    return fail | !unity;
+}
+
+static int check_ramp(void)
+{
+    enum { F = HOSTAPI_MIX_CHUNK };
+    int16_t in[F * 2], out[F * 2];
+    for (int i = 0; i < F * 2; i++) in[i] = 32767;
+    static const int32_t kFrom[] = {HOSTAPI_GAIN_UNITY, 0, 16384, 32112};
+    static const int32_t kTo[] = {0, HOSTAPI_GAIN_UNITY, 16385, 9830};
+    int fail = 0;
+    for (size_t k = 0; k < sizeof(kFrom) / sizeof(kFrom[0]); k++) {
+        hostapi_gain_t g;
+        hostapi_gain_init(&g, kFrom[k]);
+        hostapi_gain_process(&g, kTo[k], in, out, F, 2);
+        const int dir = kTo[k] > kFrom[k] ? 1 : -1;
+        const int32_t max_step = abs(kTo[k] - kFrom[k]) * 32767 / HOSTAPI_GAIN_UNITY / F + 2;
+        int32_t prev = hostapi_gain_mul(32767, kFrom[k]);
+        int mono = 1, lr = 1, step_ok = 1;
+        for (int i = 0; i < F; i++) {
+            const int32_t d = out[i * 2] - prev;
+            if (d * dir < 0) mono = 0;
+            if (abs(d) > max_step) step_ok = 0;
+            if (out[i * 2] != out[i * 2 + 1]) lr = 0;
+            prev = out[i * 2];
+        }
+        const int end = out[(F - 1) * 2] == hostapi_gain_mul(32767, kTo[k]) && g.cur == kTo[k];
+        const int ok = mono && lr && step_ok && end;
+        printf("check ramp %5d -> %5d: %s (monotonic %s, step <= %d %s, ends at target %s)\n",
+               (int)kFrom[k], (int)kTo[k], ok ? "OK" : "NG", mono ? "yes" : "no", (int)max_step,
+               step_ok ? "yes" : "no", end ? "yes" : "no");
+        fail |= !ok;
+    }
+    return fail;
+}
+
+/* 直流の音楽を流しながら音量を 100 → 20 → 100 と変える */
+static int check_mix_zipper(void)
+{
+    enum { N = 1024 };
+    static int16_t music[N * 2], out[N * 2];
+    for (int i = 0; i < N * 2; i++) music[i] = 20000;
+    hostapi_mix_t m;
+    hostapi_mix_init(&m);
+    int worst = 0, prev = -1;
+    static const int kVol[] = {100, 20, 100};
+    for (size_t k = 0; k < sizeof(kVol) / sizeof(kVol[0]); k++) {
+        hostapi_mix_set_gain(&m, HOSTAPI_MIX_MUSIC, kVol[k]);
+        hostapi_mix_render(&m, music, NULL, NULL, out, N);
+        for (int i = 0; i < N; i++) {
+            if (prev >= 0 && abs(out[i * 2] - prev) > worst) worst = abs(out[i * 2] - prev);
+            prev = out[i * 2];
+        }
+    }
+    /* 段差なら 16000。ランプは 16000 / HOSTAPI_MIX_CHUNK ≒ 250 */
+    const int ok = worst <= 16000 / HOSTAPI_MIX_CHUNK + 2 && out[(N - 1) * 2] == 20000;
+    printf("check mix zipper: %s (largest step %d on a 20000 DC input, volume 100->20->100)\n",
+           ok ? "OK" : "NG", worst);
+    return ok ? 0 : 1;
+}
+
+static void bench(int frames, int iters)
+{
+    static int16_t in[1152 * 2], out[1152 * 2];
+    const int n = frames * 2;
+    for (int i = 0; i < n; i++) in[i] = (int16_t)(12000 * sin(i * 0.01));
+    const int32_t g = 98 * HOSTAPI_GAIN_UNITY / 100;
+    volatile int16_t sink = 0;
+
+    double t0 = now_us();
+    for (int it = 0; it < iters; it++) {
+        gain_float_ref(in, out, n, 98);
+        sink = (int16_t)(sink + out[it % n]);
+    }
+    const double us_float = (now_us() - t0) / iters;
+
+    t0 = now_us();
+    for (int it = 0; it < iters; it++) {
+        hostapi_gain_const_scalar(in, out, n, g);
+        sink = (int16_t)(sink + out[it % n]);
+    }
+    const double us_scalar = (now_us() - t0) / iters;
+
+    t0 = now_us();
+    for (int it = 0; it < iters; it++) {
+        hostapi_gain_const(in, out, n, g);
+        sink = (int16_t)(sink + out[it % n]);
+    }
+    const double us_simd = (now_us() - t0) / iters;
+
+    hostapi_gain_t gs;
+    t0 = now_us();
+    for (int it = 0; it < iters; it++) {
+        hostapi_gain_init(&gs, it & 1 ? g : HOSTAPI_GAIN_UNITY / 2);
+        hostapi_gain_process(&gs, it & 1 ? HOSTAPI_GAIN_UNITY / 2 : g, in, out, frames, 2);
+        sink = (int16_t)(sink + out[it % n]);
+    }
+    const double us_ramp = (now_us() - t0) / iters;
+    (void)sink;
+
+    printf("%4d frames stereo: float+lround %7.3f us (%.2f ns/sample) | q15 scalar %7.3f us "
+           "(%.2f) | %s %7.3f us (%.2f) | ramp %7.3f us (%.2f) | speedup %.1fx\n",
+           frames, us_float, us_float * 1000 / n, us_scalar, us_scalar * 1000 / n,
+           hostapi_gain_kernel_name(), us_simd, us_simd * 1000 / n, us_ramp, us_ramp * 1000 / n,
+           us_float / us_simd);
+}
+
+int main(int argc, char** argv)
+{
+    const int iters = argc > 1 ? atoi(argv[1]) : 20000;
+    int fail = 0;
+    fail |= check_exact();
+    fail |= check_ramp();
+    fail |= check_mix_zipper();
+    bench(1152, iters);             /* MP3 1 フレーム */
+    bench(HOSTAPI_MIX_CHUNK, iters); /* ミキサ 1 チャンク */
+    return fail;
+}
@@ -0,0 +1,190 @@
+/* 入力イベント time_ms の誤差計測(X11 + XTest)。
+ *
+ * 別スレッドが XTest で X サーバへ本物のマウス DOWN/UP を不規則な間隔で入れ、
+ * 入れる直前の hostapi_now_ms を真値として記録する。SDL_PushEvent と違い、
+ * 入力は main スレッドが SDL_PumpEvents するまで SDL に届かない(実際の
+ * クリックと同じ経路)。main スレッドは main.c と同じ締切ベースの 100ms tick
+ * ループを回し、tick ごとに重い app_tick を模して BUSY_MS だけ止まる(その間は
+ * ポンプしない)。アプリ側と同じく tick 先頭で poll_event し、
+ *   - time_ms(現行: X サーバの打刻。host_sdl_input_syswm)
+ *   - SDL の timestamp(SDL が取り込んだ時刻)
+ *   - main ループがイベントを処理した時刻(旧実装の打刻)
+ * それぞれの真値との差を集計する。通し番号はポインタの位置で運ぶ。
+ *
+ * X11 のディスプレイ(Xvfb でよい)と XTest 拡張が要る。無ければ理由を出して
+ * 終了コード 0 で飛ばす。
+ *
+ *   xvfb-run ./build/bench/bench_input_ts
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <SDL.h>
+#include <X11/Xlib.h>
+#include <X11/extensions/XTest.h>
+
+#include "hostapi_defs.h"
+#include "hostapi_sdl.h"
+
+#define N_EVENTS 400
+#define TICK_MS 100
+#define BUSY_MS 40      /* app_tick + render を模した main スレッドの停止 */
+#define TARGET_MS 1     /* 目標: 誤差 1ms 以内 */
+#define POS_COLS 200    /* 通し番号 → ウィンドウ内の位置(10 + seq % 200, 10 + seq / 200) */
+
+static uint32_t s_truth[N_EVENTS];
+static uint32_t s_pump_stamp[N_EVENTS];
+static uint32_t s_drain_stamp[N_EVENTS];
+static SDL_atomic_t s_pushed;
+static Display* s_dpy;
+static int s_win_x, s_win_y;
+
+static int producer(void* arg)
+{
+    (void)arg;
+    srand(12345);
+    for (int seq = 0; seq < N_EVENTS; ++seq) {
+        SDL_Delay(2 + rand() % 24);
+        /* 位置を先に動かす(押下中ならドラッグの MOVE になる) */
+        XTestFakeMotionEvent(s_dpy, -1, s_win_x + 10 + seq % POS_COLS,
+                             s_win_y + 10 + seq / POS_COLS, CurrentTime);
+        XFlush(s_dpy);
+        s_truth[seq] = native_hostapi_now_ms(NULL);
+        XTestFakeButtonEvent(s_dpy, 1, (seq & 1) ? False : True, CurrentTime);
+        XFlush(s_dpy);
+        SDL_AtomicSet(&s_pushed, seq + 1);
+    }
+    return 0;
+}
+
+typedef struct {
+    int n;
+    double sum;
+    int max;
+    int hist[64]; /* |誤差| ms 別の件数(63 以上は末尾) */
+} ErrStats;
+
+static void err_add(ErrStats* st, int err)
+{
+    const int a = err < 0 ? -err : err;
+    st->n++;
+    st->sum += a;
+    if (a > st->max) st->max = a;
+    st->hist[a < 63 ? a : 63]++;
+}
+
+static int err_percentile(const ErrStats* st, double p)
+{
+    const int want = (int)(st->n * p + 0.999);
+    int acc = 0;
+    for (int i = 0; i < 64; ++i) {
+        acc += st->hist[i];
+        if (acc >= want) return i;
+    }
+    return 63;
+}
+
+static void err_print(const char* name, const ErrStats* st)
+{
+    printf("%-22s n=%d mean %.2f ms  p50 %d  p99 %d  max %d ms\n", name, st->n,
+           st->n ? st->sum / st->n : 0.0, err_percentile(st, 0.50),
+           err_percentile(st, 0.99), st->max);
+}
+
+int main(void)
+{
+    if (!host_sdl_init()) return 1;
+    const char* driver = SDL_GetCurrentVideoDriver();
+    if (!driver || strcmp(driver, "x11") != 0) {
+        printf("skip: needs the x11 video driver (got %s)\n", driver ? driver : "none");
+        host_sdl_shutdown();
+        return 0;
+    }
+    s_dpy = XOpenDisplay(NULL);
+    int ev_base, err_base, major, minor;
+    if (!s_dpy || !XTestQueryExtension(s_dpy, &ev_base, &err_base, &major, &minor)) {
+        printf("skip: XTest extension not available\n");
+        host_sdl_shutdown();
+        return 0;
+    }
+    /* ウィンドウが出るまで回してから位置を取る */
+    for (int i = 0; i < 20; ++i) {
+        SDL_PumpEvents();
+        host_sdl_render();
+        SDL_Delay(10);
+    }
+    SDL_GetWindowPosition(host_sdl_window(), &s_win_x, &s_win_y);
+    host_sdl_clear_events();
+    /* SDL の timestamp(SDL_GetTicks 時基)→ now_ms 時基 */
+    const uint32_t ticks_origin = SDL_GetTicks() - native_hostapi_now_ms(NULL);
+
+    ErrStats now_stats, pump_stats, old_stats;
+    memset(&now_stats, 0, sizeof(now_stats));
+    memset(&pump_stats, 0, sizeof(pump_stats));
+    memset(&old_stats, 0, sizeof(old_stats));
+
+    SDL_Thread* th = SDL_CreateThread(producer, "input_ts_producer", NULL);
+    int received = 0;
+    uint32_t done_at = 0;
+    uint32_t next_tick = SDL_GetTicks();
+    while (received < N_EVENTS) {
+        int wait_ms = (int)(next_tick - SDL_GetTicks());
+        if (wait_ms < 0) wait_ms = 0;
+        SDL_Event ev;
+        bool have_ev = SDL_WaitEventTimeout(&ev, wait_ms) != 0;
+        for (; have_ev; have_ev = SDL_PollEvent(&ev) != 0) {
+            if (ev.type == SDL_SYSWMEVENT) {
+                host_sdl_input_syswm(&ev);
+                continue;
+            }
+            if (ev.type != SDL_MOUSEBUTTONDOWN && ev.type != SDL_MOUSEBUTTONUP) continue;
+            const int seq = (ev.button.y - 10) * POS_COLS + (ev.button.x - 10);
+            if (seq < 0 || seq >= N_EVENTS) continue;
+            s_pump_stamp[seq] = ev.button.timestamp - ticks_origin;
+            s_drain_stamp[seq] = native_hostapi_now_ms(NULL);
+            host_sdl_push_touch(ev.type == SDL_MOUSEBUTTONDOWN, ev.button.x, ev.button.y,
+                                host_sdl_event_time(ev.button.timestamp));
+        }
+        if ((int32_t)(SDL_GetTicks() - next_tick) < 0) continue;
+        next_tick += TICK_MS;
+
+        /* app_tick 先頭の drain */
+        hostapi_event_t evs[16];
+        int n;
+        while ((n = native_hostapi_poll_event(NULL, (char*)evs, sizeof(evs))) > 0) {
+            for (int i = 0; i < n; ++i) {
+                if (evs[i].type != HOSTAPI_EV_TOUCH_DOWN && evs[i].type != HOSTAPI_EV_TOUCH_UP) {
+                    continue;
+                }
+                const int seq = (evs[i].y - 10) * POS_COLS + (evs[i].x - 10);
+                if (seq < 0 || seq >= N_EVENTS) continue;
+                err_add(&now_stats, (int)(evs[i].time_ms - s_truth[seq]));
+                err_add(&pump_stats, (int)(s_pump_stamp[seq] - s_truth[seq]));
+                err_add(&old_stats, (int)(s_drain_stamp[seq] - s_truth[seq]));
+                received++;
+            }
+        }
+        SDL_Delay(BUSY_MS); /* この間に入った入力は SDL にまだ届かない */
+        SDL_PumpEvents();   /* main.c と同じく Present 前に取り込む */
+
+        /* 満杯で捨てられた分は届かない: 送り終えて 1 秒で打ち切る */
+        if (SDL_AtomicGet(&s_pushed) == N_EVENTS) {
+            if (done_at == 0) done_at = SDL_GetTicks();
+            if (SDL_GetTicks() - done_at > 1000) break;
+        }
+    }
+    SDL_WaitThread(th, NULL);
+    XCloseDisplay(s_dpy);
+
+    printf("input timestamp error vs XTest injection (tick %d ms, busy %d ms per tick, "
+           "delivered %d/%d)\n", TICK_MS, BUSY_MS, received, N_EVENTS);
+    err_print("x server time (now)", &now_stats);
+    err_print("sdl pump timestamp", &pump_stats);
+    err_print("stamp at drain (old)", &old_stats);
+    const bool ok = received > 0 && now_stats.max <= TARGET_MS;
+    printf("target |err| <= %d ms: %s\n", TARGET_MS, ok ? "OK" : "NG");
+    host_sdl_shutdown();
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,257 @@
+/* 出力のレベルメータと帯域解析(shared/hostapi_levels.h、hostapi_audio_get_levels)。
+ *
+ * 次を検証する(失敗で終了コード 1):
+ *   - FFT(N/2 点複素 + 分離)の帯域が素朴な DFT の帯域と 1 以内で一致する
+ *   - ビン中心のサインが入る帯域と強さ(フルスケール 255、-20dB で 170)、
+ *     他の帯域はそれより十分低い
+ *   - ピーク・RMS(フルスケールのサインで 32767 / 23170)とチャネルの分離
+ *   - スナップショット: 描く側が窓ごとに一定値を書き続ける横で、読む側が
+ *     採った窓の PCM とピークが常に同じ窓のもの(破れ読みが無い)
+ * コストは描く側の取り込み(1 フレームあたり)、FFT 1 回、素朴な DFT 1 回、
+ * 更新の無い読み出し 1 回。
+ *
+ *   ./build/bench/bench_levels [反復回数]
+ */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <math.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "hostapi_levels.h"
+
+#define N HOSTAPI_LEVELS_FFT
+
+static double now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static hostapi_levels_fft_t s_fft;
+
+/* 比較用: ハン窓の素朴な DFT(double)で同じ帯域の集計をする */
+static void bands_dft(const int16_t* pcm, uint8_t* band)
+{
+    static double mag2[N / 2];
+    for (int k = 1; k < N / 2; k++) {
+        double re = 0, im = 0;
+        for (int i = 0; i < N; i++) {
+            const double w = 0.5 - 0.5 * cos(2 * M_PI * i / N);
+            re += pcm[i] * w * cos(2 * M_PI * k * i / N);
+            im -= pcm[i] * w * sin(2 * M_PI * k * i / N);
+        }
+        mag2[k] = re * re + im * im;
+    }
+    const double ref = 32767.0 * N / 4;
+    for (int b = 0; b < HOSTAPI_AUDIO_LEVEL_BANDS; b++) {
+        double best = 0;
+        for (int k = s_fft.edge[b]; k < s_fft.edge[b + 1]; k++) {
+            if (mag2[k] > best) best = mag2[k];
+        }
+        const double db = best > 0 ? 10 * log10(best / (ref * ref)) : -1000;
+        const double v = (db + HOSTAPI_LEVELS_FLOOR_DB) * 255 / HOSTAPI_LEVELS_FLOOR_DB;
+        band[b] = (uint8_t)(v <= 0 ? 0 : v >= 255 ? 255 : lround(v));
+    }
+}
+
+static int band_of_bin(int k)
+{
+    for (int b = 0; b < HOSTAPI_AUDIO_LEVEL_BANDS; b++) {
+        if (k >= s_fft.edge[b] && k < s_fft.edge[b + 1]) return b;
+    }
+    return -1;
+}
+
+static int check_fft(void)
+{
+    static int16_t pcm[N];
+    static const struct {
+        double bin;  /* 周波数(ビン単位) */
+        double amp;  /* フルスケール比 */
+    } kCases[] = {{1, 1.0}, {5, 0.1}, {23, 1.0}, {23.4, 0.5}, {100, 0.1}, {300.7, 1.0},
+                  {511, 0.1}};
+    int fail = 0;
+    for (size_t c = 0; c < sizeof(kCases) / sizeof(kCases[0]); c++) {
+        for (int i = 0; i < N; i++) {
+            pcm[i] = (int16_t)lround(32767 * kCases[c].amp *
+                                     sin(2 * M_PI * kCases[c].bin * i / N + 0.3) +
+                                     (rand() % 3 - 1));
+        }
+        uint8_t a[HOSTAPI_AUDIO_LEVEL_BANDS], d[HOSTAPI_AUDIO_LEVEL_BANDS];
+        hostapi_levels_fft_run(&s_fft, pcm, a);
+        bands_dft(pcm, d);
+        int worst = 0;
+        for (int b = 0; b < HOSTAPI_AUDIO_LEVEL_BANDS; b++) {
+            if (abs(a[b] - d[b]) > worst) worst = abs(a[b] - d[b]);
+        }
+        const int hit = band_of_bin((int)lround(kCases[c].bin));
+        int others = 0; /* 隣を除く他の帯域の最大 */
+        for (int b = 0; b < HOSTAPI_AUDIO_LEVEL_BANDS; b++) {
+            if (abs(b - hit) > 1 && a[b] > others) others = a[b];
+        }
+        /* ビン中心なら強さは振幅そのもの(ビン間は窓のスカラップ損失 ~1.4dB まで) */
+        const int expect = (int)lround((20 * log10(kCases[c].amp) + HOSTAPI_LEVELS_FLOOR_DB) *
+                                       255 / HOSTAPI_LEVELS_FLOOR_DB);
+        const int centered = kCases[c].bin == floor(kCases[c].bin);
+        const int level_ok = centered ? abs(a[hit] - expect) <= 1
+                                      : a[hit] <= expect + 1 && a[hit] >= expect - 7;
+        const int ok = worst <= 1 && level_ok && others < a[hit] - 60;
+        printf("check fft bin %6.1f amp %.1f: %s (band %2d = %3d, expect %3d, others <= %3d, "
+               "max diff vs DFT %d)\n",
+               kCases[c].bin, kCases[c].amp, ok ? "OK" : "NG", hit, a[hit], expect, others,
+               worst);
+        fail |= !ok;
+    }
+    memset(pcm, 0, sizeof(pcm));
+    uint8_t z[HOSTAPI_AUDIO_LEVEL_BANDS];
+    hostapi_levels_fft_run(&s_fft, pcm, z);
+    int zero = 1;
+    for (int b = 0; b < HOSTAPI_AUDIO_LEVEL_BANDS; b++) zero &= z[b] == 0;
+    printf("check fft silence: %s\n", zero ? "OK" : "NG");
+    return fail | !zero;
+}
+
+static int check_meter(void)
+{
+    static hostapi_levels_t lv;
+    hostapi_levels_init(&lv);
+    hostapi_levels_fft_init(&s_fft);
+    static int16_t buf[HOSTAPI_LEVELS_HOP * 2];
+    for (int i = 0; i < HOSTAPI_LEVELS_HOP; i++) {
+        const double s = sin(2 * M_PI * 46 * i / HOSTAPI_LEVELS_HOP); /* 窓に 46 周期(~990Hz) */
+        buf[i * 2] = (int16_t)lround(32767 * s);
+        buf[i * 2 + 1] = (int16_t)lround(8192 * s);
+    }
+    hostapi_audio_levels_t out;
+    hostapi_levels_read(&lv, &s_fft, &out);
+    const int empty = out.seq == 0 && out.peak[0] == 0 && out.band[0] == 0;
+    hostapi_levels_push(&lv, buf, 100); /* 半端な区切りでも同じ */
+    hostapi_levels_push(&lv, buf + 200, HOSTAPI_LEVELS_HOP - 100);
+    hostapi_levels_read(&lv, &s_fft, &out);
+    const int ok = empty && out.seq == 1 && out.peak[0] >= 32760 &&
+                   abs(out.rms[0] - 23170) <= 3 && out.peak[1] >= 8180 && out.peak[1] <= 8192 &&
+                   abs(out.rms[1] - 5793) <= 3;
+    printf("check meter: %s (L peak %u rms %u, R peak %u rms %u, seq %u)\n", ok ? "OK" : "NG",
+           out.peak[0], out.rms[0], out.peak[1], out.rms[1], (unsigned)out.seq);
+    return ok ? 0 : 1;
+}
+
+/* 描く側: 窓(HOP フレーム)ごとに L = R = v の一定値を書く */
+typedef struct {
+    hostapi_levels_t lv;
+    volatile int stop;
+    uint32_t windows;
+} seq_test_t;
+
+static void* seq_writer(void* arg)
+{
+    seq_test_t* t = arg;
+    static int16_t buf[64 * 2];
+    int v = 1;
+    int left = HOSTAPI_LEVELS_HOP;
+    while (!t->stop) {
+        const int n = left < 64 ? left : 64;
+        for (int i = 0; i < n * 2; i++) buf[i] = (int16_t)v;
+        hostapi_levels_push(&t->lv, buf, n);
+        left -= n;
+        if (left == 0) {
+            left = HOSTAPI_LEVELS_HOP;
+            v = v % 30000 + 1;
+            t->windows++;
+        }
+    }
+    return NULL;
+}
+
+static int check_seqlock(double seconds)
+{
+    static seq_test_t t;
+    hostapi_levels_init(&t.lv);
+    hostapi_levels_fft_init(&s_fft);
+    pthread_t th;
+    pthread_create(&th, NULL, seq_writer, &t);
+    uint32_t reads = 0, fresh = 0, torn = 0, last = 0;
+    const double t_end = now_us() + seconds * 1e6;
+    while (now_us() < t_end) {
+        hostapi_audio_levels_t out;
+        hostapi_levels_read(&t.lv, &s_fft, &out);
+        reads++;
+        if (out.seq == last) continue;
+        last = out.seq;
+        fresh++;
+        const int16_t v = s_fft.pcm[0];
+        int same = out.peak[0] == v && out.peak[1] == v && out.rms[0] == v;
+        for (int i = 0; i < N; i++) same &= s_fft.pcm[i] == v;
+        torn += !same;
+    }
+    t.stop = 1;
+    pthread_join(th, NULL);
+    const int ok = torn == 0 && fresh > 10;
+    printf("check snapshot: %s (%u windows written, %u reads, %u new windows read, %u torn)\n",
+           ok ? "OK" : "NG", (unsigned)t.windows, (unsigned)reads, (unsigned)fresh,
+           (unsigned)torn);
+    return ok ? 0 : 1;
+}
+
+static void bench(int iters)
+{
+    static hostapi_levels_t lv;
+    static int16_t buf[HOSTAPI_LEVELS_HOP * 2];
+    for (int i = 0; i < HOSTAPI_LEVELS_HOP * 2; i++) buf[i] = (int16_t)(12000 * sin(i * 0.01));
+    hostapi_levels_init(&lv);
+    hostapi_levels_fft_init(&s_fft);
+
+    double t0 = now_us();
+    for (int it = 0; it < iters; it++) hostapi_levels_push(&lv, buf, HOSTAPI_LEVELS_HOP);
+    const double ns_push = (now_us() - t0) * 1000 / ((double)iters * HOSTAPI_LEVELS_HOP);
+
+    uint8_t band[HOSTAPI_AUDIO_LEVEL_BANDS];
+    volatile uint8_t sink = 0;
+    t0 = now_us();
+    for (int it = 0; it < iters; it++) {
+        hostapi_levels_fft_run(&s_fft, buf + (it % 64) * 2, band);
+        sink = (uint8_t)(sink + band[it % HOSTAPI_AUDIO_LEVEL_BANDS]);
+    }
+    const double us_fft = (now_us() - t0) / iters;
+
+    const int dft_iters = iters / 200 > 0 ? iters / 200 : 1;
+    t0 = now_us();
+    for (int it = 0; it < dft_iters; it++) {
+        bands_dft(buf, band);
+        sink = (uint8_t)(sink + band[0]);
+    }
+    const double us_dft = (now_us() - t0) / dft_iters;
+
+    hostapi_audio_levels_t out;
+    hostapi_levels_read(&lv, &s_fft, &out);
+    t0 = now_us();
+    for (int it = 0; it < iters * 100; it++) {
+        hostapi_levels_read(&lv, &s_fft, &out);
+        sink = (uint8_t)(sink + out.band[0]);
+    }
+    const double ns_read = (now_us() - t0) * 1000 / ((double)iters * 100);
+    (void)sink;
+
+    printf("push %.2f ns/frame (%.3f%% of real time) | fft %d + bands %.2f us (%.3f%% of a %d ms "
+           "update) | naive DFT %.0f us (%.0fx) | read without update %.1f ns\n",
+           ns_push, ns_push * 44100 / 1e7, N, us_fft,
+           us_fft * 100 / (HOSTAPI_LEVELS_HOP * 1e6 / 44100), HOSTAPI_LEVELS_HOP * 1000 / 44100,
+           us_dft, us_dft / us_fft, ns_read);
+}
+
+int main(int argc, char** argv)
+{
+    const int iters = argc > 1 ? atoi(argv[1]) : 2000;
+    int fail = 0;
+    fail |= check_meter();
+    fail |= check_fft();
+    fail |= check_seqlock(1.0);
+    bench(iters);
+    return fail;
+}
@@ -0,0 +1,247 @@
+/* 出力ミキサ(shared/hostapi_mix.h)のリサンプラ・ミックス・リミッタのコスト。
+ *
+ * MP3 の典型レート(22.05k モノ/ステレオ、48k ステレオ)から 44.1kHz への
+ * リサンプルと、音楽 + トーン n 声のミックス(リミッタ込み)を、SDL
+ * コールバック 1 回ぶん(1024 フレーム)と実機 DMA ディスクリプタ 1 本ぶん
+ * (240 フレーム)で測る。併せて次を検証する(失敗で終了コード 1):
+ *   - 1:1 のリサンプルは 1 フレーム遅れの恒等写像
+ *   - 入力・出力をどう分割して渡しても出力が同じ(ストリーム状態の連続性)
+ *   - 22.05k → 44.1k の 1kHz サインが理論値から 1.5% 以内、モノは L == R
+ *   - 閾値以下の音楽はゲイン 100% でビット一致で素通り
+ *   - 音楽フルスケール + 16 声でも閾値を超えず符号も反転しない。静かに
+ *     なればゲインは 1 に戻る
+ *
+ *   ./build/bench/bench_mix [反復回数]
+ */
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "hostapi_mix.h"
+
+#define RATE HOSTAPI_MIX_RATE
+
+static double now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+/* in_rate のサイン(振幅 amp)を ch チャンネルで n フレーム */
+static void make_sine(int16_t* buf, int n, int ch, double freq, double in_rate, double amp)
+{
+    for (int i = 0; i < n; i++) {
+        const int16_t v = (int16_t)lrint(amp * sin(2 * M_PI * freq * i / in_rate));
+        for (int c = 0; c < ch; c++) buf[i * ch + c] = (int16_t)(c ? -v : v);
+    }
+}
+
+/* 入力全体を一括でリサンプルする。出力フレーム数を返す */
+static int resample_all(hostapi_resamp_t* r, const int16_t* in, int in_frames, int16_t* out,
+                        int out_cap, int in_piece, int out_piece)
+{
+    int n = 0;
+    while (in_frames > 0 && n < out_cap) {
+        const int take = in_frames < in_piece ? in_frames : in_piece;
+        int fed = 0;
+        while (fed < take && n < out_cap) {
+            const int cap = out_cap - n < out_piece ? out_cap - n : out_piece;
+            int used;
+            n += hostapi_resamp_process(r, in + fed * r->channels, take - fed, &used,
+                                        out + n * 2, cap);
+            fed += used;
+        }
+        in += take * r->channels;
+        in_frames -= take;
+    }
+    return n;
+}
+
+static int check_identity(void)
+{
+    enum { N = 4096 };
+    static int16_t in[N * 2], out[N * 2];
+    make_sine(in, N, 2, 997, RATE, 20000);
+    hostapi_resamp_t r;
+    hostapi_resamp_init(&r, RATE, RATE, 2);
+    const int n = resample_all(&r, in, N, out, N, 333, 100);
+    int ok = n == N && out[0] == 0 && out[1] == 0;
+    for (int i = 1; ok && i < N; i++) {
+        ok = out[i * 2] == in[(i - 1) * 2] && out[i * 2 + 1] == in[(i - 1) * 2 + 1];
+    }
+    printf("check identity: %s (44.1k -> 44.1k, %d frames)\n", ok ? "OK" : "NG", n);
+    return ok ? 0 : 1;
+}
+
+static int check_chunking(void)
+{
+    enum { N = 22050 / 2 };
+    static int16_t in[N * 2], a[N * 3 * 2], b[N * 3 * 2];
+    static const int kRates[] = {11025, 22050, 32000, 48000};
+    int fail = 0;
+    for (size_t k = 0; k < sizeof(kRates) / sizeof(kRates[0]); k++) {
+        make_sine(in, N, 2, 440, kRates[k], 16000);
+        hostapi_resamp_t ra, rb;
+        hostapi_resamp_init(&ra, (uint32_t)kRates[k], RATE, 2);
+        hostapi_resamp_init(&rb, (uint32_t)kRates[k], RATE, 2);
+        const int na = resample_all(&ra, in, N, a, N * 3, N, N * 3);
+        const int nb = resample_all(&rb, in, N, b, N * 3, 1152, 97);
+        const int ok = na == nb && memcmp(a, b, (size_t)na * 4) == 0;
+        printf("check chunking %5d: %s (%d frames one-shot, %d chunked)\n", kRates[k],
+               ok ? "OK" : "NG", na, nb);
+        fail |= !ok;
+    }
+    return fail;
+}
+
+static int check_upsample(void)
+{
+    enum { N = 22050 };
+    static int16_t in[N], out[N * 2 * 2];
+    make_sine(in, N, 1, 1000, 22050, 20000);
+    hostapi_resamp_t r;
+    hostapi_resamp_init(&r, 22050, RATE, 1);
+    const int n = resample_all(&r, in, N, out, N * 2, 1152, 240);
+    double worst = 0;
+    int mono_ok = 1;
+    for (int i = 4; i < n; i++) {
+        /* 出力 i は入力位置 i/2 - 1(prev の 1 フレーム遅れ) */
+        const double ideal = 20000 * sin(2 * M_PI * 1000 * (i / 2.0 - 1) / 22050);
+        const double e = fabs(out[i * 2] - ideal) / 20000;
+        if (e > worst) worst = e;
+        if (out[i * 2] != out[i * 2 + 1]) mono_ok = 0;
+    }
+    const int ok = worst < 0.015 && mono_ok && n >= N * 2 - 2;
+    printf("check upsample: %s (22.05k mono 1kHz -> 44.1k, max error %.2f%%, L==R %s)\n",
+           ok ? "OK" : "NG", worst * 100, mono_ok ? "yes" : "no");
+    return ok ? 0 : 1;
+}
+
+static int check_passthrough(void)
+{
+    enum { N = 4096 };
+    static int16_t music[N * 2], out[N * 2];
+    make_sine(music, N, 2, 440, RATE, HOSTAPI_MIX_LIMIT - 1);
+    hostapi_mix_t m;
+    hostapi_mix_init(&m);
+    hostapi_mix_render(&m, music, NULL, NULL, out, N);
+    const int ok = memcmp(music, out, sizeof(out)) == 0 && m.limited == 0;
+    printf("check passthrough: %s (music below threshold, gain 100%%)\n", ok ? "OK" : "NG");
+    return ok ? 0 : 1;
+}
+
+static int check_limiter(void)
+{
+    enum { N = RATE / 10, QUIET = RATE };
+    static int16_t music[N * 2], out[N * 2], quiet[QUIET * 2], qout[QUIET * 2];
+    make_sine(music, N, 2, 220, RATE, 32767);
+    hostapi_mix_t m;
+    hostapi_mix_init(&m);
+    hostapi_voices_t vs;
+    hostapi_voices_init(&vs, HOSTAPI_VOICE_MAX);
+    for (int i = 0; i < HOSTAPI_VOICE_MAX; i++) hostapi_voices_start(&vs, RATE, 220, 100, 100, 100);
+    hostapi_mix_render(&m, music, &vs, NULL, out, N);
+    int peak = 0, flips = 0;
+    for (int i = 0; i < N * 2; i++) {
+        const int a = abs(out[i]);
+        if (a > peak) peak = a;
+        /* 音楽の L は +、R は -。トーンはモノラル。大きい方と符号が合うこと */
+        if (i % 2 == 0 && music[i] > 1000 && out[i] < -1000) flips++;
+    }
+    const int32_t g_loud = m.lim_gain;
+    make_sine(quiet, QUIET, 2, 440, RATE, 1000);
+    hostapi_mix_render(&m, quiet, &vs, NULL, qout, QUIET);
+    const int ok = peak <= HOSTAPI_MIX_LIMIT && flips == 0 && m.limited > 0 &&
+                   m.lim_gain == HOSTAPI_MIX_UNITY;
+    printf("check limiter: %s (peak %d <= %d, gain %.3f -> %.3f after 1s quiet, %u blocks "
+           "limited)\n",
+           ok ? "OK" : "NG", peak, HOSTAPI_MIX_LIMIT, g_loud / 32768.0,
+           m.lim_gain / 32768.0, (unsigned)m.limited);
+    return ok ? 0 : 1;
+}
+
+static void bench_resamp(int out_frames, int iters)
+{
+    static const struct {
+        int rate, ch;
+    } kCases[] = {{22050, 1}, {22050, 2}, {32000, 2}, {48000, 2}, {44100, 2}};
+    static int16_t in[4096 * 2], out[4096 * 2];
+    const double budget_us = out_frames * 1e6 / RATE;
+    printf("\nresample to %d frames (%.1f ms of audio), %d iterations\n", out_frames,
+           budget_us / 1000, iters);
+    printf("source          us/buffer   ns/frame   %% of buffer\n");
+    for (size_t k = 0; k < sizeof(kCases) / sizeof(kCases[0]); k++) {
+        const int in_frames = (int)((int64_t)out_frames * kCases[k].rate / RATE) + 2;
+        make_sine(in, in_frames, kCases[k].ch, 440, kCases[k].rate, 16000);
+        hostapi_resamp_t r;
+        hostapi_resamp_init(&r, (uint32_t)kCases[k].rate, RATE, kCases[k].ch);
+        double total = 0;
+        for (int it = 0; it < iters; it++) {
+            r.pos = 0;
+            int used;
+            const double t0 = now_us();
+            hostapi_resamp_process(&r, in, in_frames, &used, out, out_frames);
+            total += now_us() - t0;
+        }
+        const double per = total / iters;
+        printf("%5d Hz %-6s  %9.2f   %8.2f   %10.2f\n", kCases[k].rate,
+               kCases[k].ch == 1 ? "mono" : "stereo", per, per * 1000 / out_frames,
+               per * 100 / budget_us);
+    }
+}
+
+static void bench_mix(int frames, int iters)
+{
+    static int16_t music[4096 * 2], out[4096 * 2];
+    make_sine(music, frames, 2, 440, RATE, 24000);
+    const double budget_us = frames * 1e6 / RATE;
+    printf("\nmix %d frames (%.1f ms of audio), %d iterations\n", frames, budget_us / 1000,
+           iters);
+    printf("sources                 us/buffer   ns/frame   %% of buffer\n");
+    static const int kVoices[] = {0, 1, 8, 16};
+    for (int with_music = 0; with_music < 2; with_music++) {
+        for (size_t k = 0; k < sizeof(kVoices) / sizeof(kVoices[0]); k++) {
+            const int nv = kVoices[k];
+            if (!with_music && nv == 0) continue;
+            hostapi_mix_t m;
+            hostapi_mix_init(&m);
+            hostapi_mix_set_gain(&m, HOSTAPI_MIX_MUSIC, 98);
+            hostapi_voices_t vs;
+            hostapi_voices_init(&vs, nv ? nv : 1);
+            double total = 0;
+            for (int it = 0; it < iters; it++) {
+                hostapi_voices_reset(&vs);
+                for (int i = 0; i < nv; i++) {
+                    hostapi_voices_start(&vs, RATE, (uint16_t)(200 + 150 * i), 100, 100, 98);
+                }
+                const double t0 = now_us();
+                hostapi_mix_render(&m, with_music ? music : NULL, &vs, NULL, out, frames);
+                total += now_us() - t0;
+            }
+            const double per = total / iters;
+            char label[32];
+            snprintf(label, sizeof(label), "%s%d voice(s)", with_music ? "music + " : "", nv);
+            printf("%-22s  %9.2f   %8.2f   %10.2f\n", label, per, per * 1000 / frames,
+                   per * 100 / budget_us);
+        }
+    }
+}
+
+int main(int argc, char** argv)
+{
+    const int iters = argc > 1 ? atoi(argv[1]) : 2000;
+    int fail = 0;
+    fail |= check_identity();
+    fail |= check_chunking();
+    fail |= check_upsample();
+    fail |= check_passthrough();
+    fail |= check_limiter();
+    bench_resamp(1024, iters); /* Linux: SDL コールバック 1 回 */
+    bench_resamp(240, iters);  /* 実機: DMA ディスクリプタ 1 本 */
+    bench_mix(1024, iters);
+    bench_mix(240, iters);
+    return fail;
+}
@@ -0,0 +1,241 @@
+/* MP3 のフレーム位置索引(shared/hostapi_mp3idx.h)の検証とコスト。
+ *
+ * フレームヘッダだけ正しい合成 MP3(VBR、先頭に ID3v2、途中にゴミ、末尾に
+ * ID3v1)を一時ファイルに書いて索引を作り、次を検証する(失敗で終了コード 1):
+ *   - 索引の位置が書いたフレームの位置と一致する(間引き後も stride ごと)
+ *   - 曲の長さ、シーク先(目標以前の索引フレームで、ずれは stride フレーム未満)
+ *   - サイドカー(<曲>.mbidx)の書き出し・読み戻しが同じ索引になり、曲の
+ *     サイズが変われば読まずに作り直す
+ *   - MP3 でないファイルと free format は -1
+ * コストは索引の作成(走査とサイドカー読み)と、シーク 1 回あたりの
+ * 索引引き(O(1))と先頭からヘッダを辿り直す素朴なシークの比較。
+ *
+ *   ./build/bench/bench_mp3idx [シーク回数]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "hostapi_mp3idx.h"
+
+static double now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static uint32_t s_rng = 12345;
+static uint32_t rnd(void)
+{
+    s_rng = s_rng * 1664525u + 1013904223u;
+    return s_rng >> 8;
+}
+
+/* 合成 MP3 を path へ書く。mpeg1 = 44.1kHz MPEG-1(1152)/ 22.05kHz MPEG-2(576)。
+ * 各フレームの位置を offs へ返す(NULL 可) */
+static long write_mp3(const char* path, int frames, int mpeg1, int free_format,
+                      uint32_t* offs)
+{
+    FILE* f = fopen(path, "wb");
+    if (!f) return -1;
+    /* ID3v2(本体 1000 バイト、syncsafe) */
+    const uint8_t id3[10] = {'I', 'D', '3', 4, 0, 0, 0, 0, 0x07, 0x68};
+    fwrite(id3, 1, sizeof(id3), f);
+    for (int i = 0; i < 1000; i++) fputc(0, f);
+    uint8_t body[1500];
+    for (int k = 0; k < frames; k++) {
+        if (k == frames / 3) {
+            /* 途中のゴミ(同期語を含まない)。索引は読み飛ばして続ける */
+            for (int i = 0; i < 333; i++) fputc((int)(rnd() % 0xFF), f);
+        }
+        uint8_t h[4];
+        h[0] = 0xFF;
+        h[1] = mpeg1 ? 0xFB : 0xF3;
+        const int kbps_idx = free_format ? 0 : 1 + (int)(rnd() % 14);
+        const int pad = (int)(rnd() & 1);
+        h[2] = (uint8_t)(kbps_idx << 4 | 0 << 2 | pad << 1);
+        h[3] = 0xC4;
+        hostapi_mp3_frame_t fr;
+        uint32_t len = 417;
+        if (!free_format && hostapi_mp3_parse_header(h, &fr)) len = fr.len;
+        if (offs) offs[k] = (uint32_t)ftell(f);
+        fwrite(h, 1, 4, f);
+        for (uint32_t i = 0; i < len - 4; i++) body[i] = (uint8_t)(rnd() % 0xFF);
+        fwrite(body, 1, len - 4, f);
+    }
+    fwrite("TAG", 1, 3, f);
+    for (int i = 0; i < 125; i++) fputc(' ', f);
+    const long size = ftell(f);
+    fclose(f);
+    return size;
+}
+
+static hostapi_mp3idx_t s_idx, s_idx2;
+
+static int check_track(const char* path, int frames, int mpeg1)
+{
+    uint32_t* offs = malloc(sizeof(uint32_t) * (size_t)frames);
+    write_mp3(path, frames, mpeg1, 0, offs);
+    char side[256];
+    snprintf(side, sizeof(side), "%s%s", path, HOSTAPI_MP3IDX_SUFFIX);
+    remove(side);
+
+    const int r = hostapi_mp3idx_build_file(&s_idx, path, 64, NULL, NULL);
+    const uint32_t spf = mpeg1 ? 1152 : 576, rate = mpeg1 ? 44100 : 22050;
+    int ok_entries = r == 1 && s_idx.frames == (uint32_t)frames && s_idx.rate == rate &&
+                     s_idx.spf == spf &&
+                     s_idx.count == ((uint32_t)frames + s_idx.stride - 1) / s_idx.stride;
+    for (uint32_t k = 0; ok_entries && k < s_idx.count; k++) {
+        if (s_idx.entry[k] != offs[k * s_idx.stride]) ok_entries = 0;
+    }
+    const int32_t dur = hostapi_mp3idx_duration_ms(&s_idx);
+    const int ok_dur = dur == (int32_t)((uint64_t)frames * spf * 1000 / rate);
+
+    /* シーク先: 目標以前、ずれ stride フレーム未満、位置は索引フレームの先頭 */
+    int ok_seek = 1;
+    int32_t worst_ms = 0;
+    for (int i = 0; i < 1000; i++) {
+        const uint32_t ms = i == 0 ? 0 : i == 1 ? (uint32_t)dur + 5000 : rnd() % (uint32_t)dur;
+        uint32_t off = 0;
+        const int32_t at = hostapi_mp3idx_lookup(&s_idx, ms, &off);
+        /* at はフレーム先頭の時刻を ms へ切り捨てたもの。フレームへは切り上げで戻す */
+        const uint32_t frame = (uint32_t)(((uint64_t)at * rate + 1000u * spf - 1) / (1000u * spf));
+        const uint32_t want = ms > (uint32_t)dur ? (uint32_t)dur : ms;
+        const int32_t lag = (int32_t)want - at;
+        if (at < 0 || lag < 0 || frame >= (uint32_t)frames || off != offs[frame] ||
+            (uint64_t)lag * rate >= (uint64_t)s_idx.stride * spf * 1000 + spf * 1000) {
+            ok_seek = 0;
+        }
+        if (ms <= (uint32_t)dur && lag > worst_ms) worst_ms = lag;
+    }
+
+    /* サイドカー: 2 回目は読むだけで同じ索引 */
+    const int r2 = hostapi_mp3idx_build_file(&s_idx2, path, 64, NULL, NULL);
+    const int ok_side = r2 == 1 && access(side, F_OK) == 0 && s_idx2.count == s_idx.count &&
+                        s_idx2.stride == s_idx.stride && s_idx2.frames == s_idx.frames &&
+                        memcmp(s_idx2.entry, s_idx.entry, s_idx.count * sizeof(uint32_t)) == 0;
+
+    /* 曲が変わった(サイズ違い): サイドカーは読まずに作り直す */
+    write_mp3(path, frames / 2, mpeg1, 0, NULL);
+    const int r3 = hostapi_mp3idx_build_file(&s_idx2, path, 64, NULL, NULL);
+    const int ok_stale = r3 == 1 && s_idx2.frames == (uint32_t)(frames / 2);
+
+    const int ok = ok_entries && ok_dur && ok_seek && ok_side && ok_stale;
+    printf("check %s %5d frames: %s (stride %u, %u entries %s, duration %d ms %s, "
+           "seek worst lag %d ms %s, sidecar %s, stale sidecar rebuilt %s)\n",
+           mpeg1 ? "mpeg1 44.1k" : "mpeg2 22.05k", frames, ok ? "OK" : "NG",
+           (unsigned)s_idx.stride, (unsigned)s_idx.count, ok_entries ? "match" : "MISMATCH",
+           (int)dur, ok_dur ? "ok" : "NG", (int)worst_ms, ok_seek ? "ok" : "NG",
+           ok_side ? "ok" : "NG", ok_stale ? "yes" : "no");
+    remove(side);
+    free(offs);
+    return ok ? 0 : 1;
+}
+
+static bool stop_after_one(void* ctx)
+{
+    (*(int*)ctx)++;
+    return false;
+}
+
+static int check_reject(const char* path)
+{
+    FILE* f = fopen(path, "wb");
+    for (int i = 0; i < 200000; i++) fputc("not an mp3 file\n"[i % 16], f);
+    fclose(f);
+    const int r_text = hostapi_mp3idx_build_file(&s_idx, path, 64, NULL, NULL);
+    write_mp3(path, 100, 1, 1, NULL);
+    const int r_free = hostapi_mp3idx_build_file(&s_idx, path, 64, NULL, NULL);
+    /* 打ち切り(曲が変わった)は 0 で、サイドカーは書かない */
+    write_mp3(path, 3000, 1, 0, NULL);
+    char side[256];
+    snprintf(side, sizeof(side), "%s%s", path, HOSTAPI_MP3IDX_SUFFIX);
+    remove(side);
+    int calls = 0;
+    const int r_cancel = hostapi_mp3idx_build_file(&s_idx, path, 64, stop_after_one, &calls);
+    const int no_side = access(side, F_OK) != 0;
+    const int ok = r_text == -1 && r_free == -1 && r_cancel == 0 && calls == 1 && no_side;
+    printf("check reject: %s (text %d, free format %d, cancelled %d after %d step, "
+           "no sidecar %s)\n",
+           ok ? "OK" : "NG", r_text, r_free, r_cancel, calls, no_side ? "yes" : "no");
+    return ok ? 0 : 1;
+}
+
+/* 索引を使わないシーク: 先頭からヘッダを辿って目標フレームの位置を得る */
+static uint32_t linear_seek(FILE* f, uint32_t start, uint32_t target_frame)
+{
+    uint32_t pos = start, k = 0;
+    uint8_t h[4];
+    hostapi_mp3_frame_t fr;
+    while (hostapi_mp3idx_read_at(f, pos, h, sizeof(h))) {
+        if (!hostapi_mp3_parse_header(h, &fr)) {
+            pos++;
+            continue;
+        }
+        if (k++ == target_frame) return pos;
+        pos += fr.len;
+    }
+    return pos;
+}
+
+static void bench(const char* path, int frames, int seeks)
+{
+    const long size = write_mp3(path, frames, 1, 0, NULL);
+    char side[256];
+    snprintf(side, sizeof(side), "%s%s", path, HOSTAPI_MP3IDX_SUFFIX);
+    remove(side);
+
+    double t0 = now_us();
+    hostapi_mp3idx_build_file(&s_idx, path, 64, NULL, NULL);
+    const double us_scan = now_us() - t0;
+    t0 = now_us();
+    hostapi_mp3idx_build_file(&s_idx, path, 64, NULL, NULL);
+    const double us_load = now_us() - t0;
+
+    volatile uint32_t sink = 0;
+    t0 = now_us();
+    for (int i = 0; i < seeks * 100; i++) {
+        uint32_t off = 0;
+        sink += (uint32_t)hostapi_mp3idx_lookup(&s_idx, rnd() % 400000u, &off) + off;
+    }
+    const double us_lookup = (now_us() - t0) / (seeks * 100);
+
+    FILE* f = fopen(path, "rb");
+    t0 = now_us();
+    for (int i = 0; i < seeks; i++) sink += linear_seek(f, s_idx.entry[0], rnd() % (uint32_t)frames);
+    const double us_linear = (now_us() - t0) / seeks;
+    fclose(f);
+    (void)sink;
+    remove(side);
+
+    const double sec = (double)frames * 1152 / 44100;
+    printf("%5d frames (%.0f s, %.1f MB): scan %.1f ms (%.0f frames/ms) | sidecar load %.3f ms | "
+           "seek: index %.3f us vs rescan from start %.1f us (%.0fx)\n",
+           frames, sec, size / 1e6, us_scan / 1000, frames / (us_scan / 1000), us_load / 1000,
+           us_lookup, us_linear, us_linear / us_lookup);
+}
+
+int main(int argc, char** argv)
+{
+    const int seeks = argc > 1 ? atoi(argv[1]) : 200;
+    char path[] = "/tmp/bench_mp3idx_XXXXXX";
+    const int fd = mkstemp(path);
+    if (fd < 0) {
+        perror("mkstemp");
+        return 1;
+    }
+    close(fd);
+    int fail = 0;
+    fail |= check_track(path, 2000, 1);   /* 毎フレーム */
+    fail |= check_track(path, 10000, 1);  /* 間引き(stride 4) */
+    fail |= check_track(path, 5000, 0);   /* MPEG-2 */
+    fail |= check_reject(path);
+    bench(path, 2296, seeks);  /* 1 分 */
+    bench(path, 9188, seeks);  /* 4 分 */
+    bench(path, 22970, seeks); /* 10 分 */
+    remove(path);
+    return fail;
+}
@@ -0,0 +1,224 @@
+/* 持続音のノートエンジン(shared/hostapi_note.h)の検証とレンダリングコスト。
+ *
+ * 次を検証する(失敗で終了コード 1):
+ *   - ADSR: アタック終わりで満振幅、ディケイ後は sustain%、note_off から
+ *     release_ms で無音になりチャネルが空く。sustain 0 はディケイで鳴り終わる
+ *   - ピッチ: pitch 6900(A4)が 440Hz、6000 + 50 セントが C4 の 1/4 音上
+ *   - 長時間の発音(10 分)で振幅がずれない(回転ベクトルの正規化)
+ *   - 同じチャネルの鳴らし直し(レガート)で波形が飛ばない
+ *   - 出力ミキサ(shared/hostapi_mix.h)経由でトーンと同じバスに出る
+ * コストは全チャネルを鳴らしたときの SDL オーディオコールバック 1 回ぶん
+ * (1024 フレーム)と実機 DMA ディスクリプタ 1 本ぶん(240 フレーム)。
+ *
+ *   ./build/bench/bench_note [反復回数]
+ */
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "hostapi_mix.h"
+#include "hostapi_note.h"
+
+#define RATE 44100
+
+static double now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+/* n フレーム描いて |x| のピークを返す(acc は呼び出しごとにゼロから) */
+static int render_peak(hostapi_notes_t* n, int frames)
+{
+    static int32_t acc[RATE];
+    int peak = 0;
+    while (frames > 0) {
+        const int k = frames < 240 ? frames : 240;
+        memset(acc, 0, (size_t)k * sizeof(int32_t));
+        hostapi_notes_accum(n, acc, k);
+        for (int i = 0; i < k; i++) {
+            const int a = abs(acc[i]);
+            if (a > peak) peak = a;
+        }
+        frames -= k;
+    }
+    return peak;
+}
+
+static int near(int got, double want, double tol)
+{
+    return fabs(got - want) <= tol;
+}
+
+static int check_adsr(void)
+{
+    hostapi_notes_t n;
+    hostapi_notes_init(&n, RATE);
+    const hostapi_note_env_t env = {10, 100, 50, 200};
+    hostapi_notes_define(&n, 1, &env);
+    hostapi_notes_on(&n, 0, 1, 6900, 127, 100);
+    const double full = HOSTAPI_VOICE_FULL_SCALE;
+    /* アタック 10ms(441 フレーム)の終わりをまたぐ 1 周期 */
+    render_peak(&n, 441 - 50);
+    const int attack = render_peak(&n, 100);
+    /* ディケイ 100ms の後、サステインを 200ms */
+    render_peak(&n, RATE / 10 - 50);
+    const int sustain = render_peak(&n, RATE / 5);
+    const int active_on = n.active;
+    hostapi_notes_off(&n, 0);
+    const int release_head = render_peak(&n, 100);
+    render_peak(&n, RATE / 5 - 100);
+    const int after = render_peak(&n, 1000);
+    const int ok_adsr = near(attack, full, full * 0.01) && near(sustain, full * 0.5, full * 0.01) &&
+                        release_head <= sustain && release_head > sustain * 0.9 && after == 0 &&
+                        active_on == 1 && n.active == 0;
+    printf("check adsr: %s (attack peak %d, sustain %d (want %.0f), release head %d, "
+           "after release %d, active %d -> %d)\n",
+           ok_adsr ? "OK" : "NG", attack, sustain, full * 0.5, release_head, after, active_on,
+           n.active);
+
+    /* sustain 0: ディケイの終わりで鳴り終わる(note_off 不要) */
+    const hostapi_note_env_t pluck = {0, 50, 0, 500};
+    hostapi_notes_define(&n, 2, &pluck);
+    hostapi_notes_on(&n, 3, 2, 6000, 100, 100);
+    const int head = render_peak(&n, 50);
+    render_peak(&n, RATE / 20);
+    const int ok_pluck = head > 0 && n.active == 0 && n.ch[3].stage == HOSTAPI_NOTE_IDLE;
+    printf("check sustain 0: %s (head %d, active %d after decay)\n", ok_pluck ? "OK" : "NG", head,
+           n.active);
+    return !(ok_adsr && ok_pluck);
+}
+
+/* 1 秒の上向きゼロ交差から周波数を出す */
+static double measure_hz(int32_t pitch)
+{
+    static int32_t acc[RATE];
+    hostapi_notes_t n;
+    hostapi_notes_init(&n, RATE);
+    const hostapi_note_env_t flat = {0, 0, 100, 0};
+    hostapi_notes_define(&n, 0, &flat);
+    hostapi_notes_on(&n, 0, 0, pitch, 127, 100);
+    memset(acc, 0, sizeof(acc));
+    hostapi_notes_accum(&n, acc, RATE);
+    int first = -1, last = -1, cross = 0;
+    for (int i = 1; i < RATE; i++) {
+        if (acc[i - 1] < 0 && acc[i] >= 0) {
+            if (first < 0) first = i;
+            last = i;
+            cross++;
+        }
+    }
+    return cross > 1 ? (double)(cross - 1) * RATE / (last - first) : 0.0;
+}
+
+static int check_pitch(void)
+{
+    const double a4 = measure_hz(6900);
+    const double c4q = measure_hz(6050);
+    const double want_c4q = 440.0 * pow(2.0, (6050 - 6900) / 1200.0);
+    const int ok = fabs(a4 - 440.0) < 0.1 && fabs(c4q - want_c4q) < 0.1;
+    printf("check pitch: %s (6900 -> %.3f Hz, 6050 -> %.3f Hz (want %.3f))\n", ok ? "OK" : "NG",
+           a4, c4q, want_c4q);
+    return ok ? 0 : 1;
+}
+
+static int check_long_run(void)
+{
+    hostapi_notes_t n;
+    hostapi_notes_init(&n, RATE);
+    const hostapi_note_env_t flat = {0, 0, 100, 0};
+    hostapi_notes_define(&n, 0, &flat);
+    hostapi_notes_on(&n, 0, 0, 8100, 127, 100); /* A5 */
+    const int first = render_peak(&n, RATE / 10);
+    for (int s = 0; s < 600; s++) render_peak(&n, RATE);
+    const int last = render_peak(&n, RATE / 10);
+    const int ok = abs(last - first) <= 2 && n.active == 1;
+    printf("check long run: %s (peak %d -> %d after 10 min)\n", ok ? "OK" : "NG", first, last);
+    return ok ? 0 : 1;
+}
+
+/* 鳴らし直しの境目の 1 サンプル差が、定常状態の最大差を超えない */
+static int check_legato(void)
+{
+    enum { N = 4096 };
+    static int32_t acc[N * 2];
+    hostapi_notes_t n;
+    hostapi_notes_init(&n, RATE);
+    hostapi_notes_on(&n, 0, 0, 6900, 127, 100);
+    memset(acc, 0, sizeof(acc));
+    hostapi_notes_accum(&n, acc, N);
+    hostapi_notes_on(&n, 0, 0, 7600, 100, 100); /* E5、velocity も変える */
+    hostapi_notes_accum(&n, acc + N, N);
+    int steady = 0;
+    for (int i = N + 1; i < 2 * N; i++) {
+        const int d = abs(acc[i] - acc[i - 1]);
+        if (d > steady) steady = d;
+    }
+    const int jump = abs(acc[N] - acc[N - 1]);
+    const int ok = jump <= steady && n.active == 1;
+    printf("check legato: %s (boundary step %d, max step after %d)\n", ok ? "OK" : "NG", jump,
+           steady);
+    return ok ? 0 : 1;
+}
+
+static int check_mix(void)
+{
+    enum { N = 2048 };
+    static int16_t out[N * 2];
+    hostapi_notes_t n;
+    hostapi_notes_init(&n, RATE);
+    hostapi_mix_t m;
+    hostapi_mix_init(&m);
+    hostapi_mix_set_notes(&m, &n);
+    const int idle = hostapi_mix_notes_active(&m);
+    hostapi_notes_on(&n, 5, 0, 6900, 127, 100);
+    hostapi_mix_render(&m, NULL, NULL, NULL, out, N);
+    int peak = 0, lr = 1;
+    for (int i = 0; i < N; i++) {
+        if (abs(out[i * 2]) > peak) peak = abs(out[i * 2]);
+        if (out[i * 2] != out[i * 2 + 1]) lr = 0;
+    }
+    const int ok = !idle && hostapi_mix_notes_active(&m) && peak > 0 && lr;
+    printf("check mix: %s (peak %d via tone bus, L==R %s)\n", ok ? "OK" : "NG", peak,
+           lr ? "yes" : "no");
+    return ok ? 0 : 1;
+}
+
+static void bench(int frames, int iters)
+{
+    static int32_t acc[1024];
+    hostapi_notes_t n;
+    hostapi_notes_init(&n, RATE);
+    const hostapi_note_env_t flat = {0, 0, 100, 0};
+    hostapi_notes_define(&n, 0, &flat);
+    for (int ch = 0; ch < HOSTAPI_NOTE_CHANNELS; ch++) {
+        hostapi_notes_on(&n, ch, 0, 4800 + ch * 400, 64, 100);
+    }
+    const double t0 = now_us();
+    for (int i = 0; i < iters; i++) {
+        memset(acc, 0, (size_t)frames * sizeof(int32_t));
+        hostapi_notes_accum(&n, acc, frames);
+    }
+    const double us = (now_us() - t0) / iters;
+    printf("bench %4d frames x %d channels: %7.2f us/buffer (%.2f ns/sample/channel, %.2f%% "
+           "of buffer time)\n",
+           frames, HOSTAPI_NOTE_CHANNELS, us,
+           us * 1000.0 / frames / HOSTAPI_NOTE_CHANNELS, us / (frames * 1e6 / RATE) * 100.0);
+}
+
+int main(int argc, char** argv)
+{
+    const int iters = argc > 1 ? atoi(argv[1]) : 2000;
+    int fail = 0;
+    fail |= check_adsr();
+    fail |= check_pitch();
+    fail |= check_long_run();
+    fail |= check_legato();
+    fail |= check_mix();
+    bench(1024, iters); /* Linux: SDL コールバック 1 回 */
+    bench(240, iters);  /* 実機: DMA ディスクリプタ 1 本 */
+    return fail;
+}
@@ -0,0 +1,540 @@
+/* 出力キャプチャ(--wav)の発音位置解析と、その自己検証。
+ *
+ *   ./build/bench/bench_onset                 自己検証(下記)
+ *   ./build/bench/bench_onset out.wav [sched] キャプチャを解析する(sched の
+ *                                             既定は out.wav.sched)
+ *
+ * 解析: WAV(16bit、左 ch)から立ち上がりを検出し(shared/hostapi_capture.h)、
+ * 予約の発火(fire)を予定サンプル位置と突き合わせて、誤差(サンプル)の
+ * 分布・未検出・余分な立ち上がりを出す。即時発音(play)は依頼時刻から
+ * 鳴り始めまでの遅延(ms)として別に出す(予定位置が無いので誤差には入れない)。
+ * 再生キューの曲の切り替え(track)は、その時刻から TRACK_WINDOW_MS の間で
+ * L/R とも 0 が続く最長の区間を測り、TRACK_GAP_MS 以上あれば曲間に無音が
+ * 入ったとして終了コード 1 を返す(切り替えの記録はリングに積まれる前の
+ * 時刻なので、実際の境目はリングの深さぶん後ろになる)。
+ *
+ * 自己検証: ホストのコールバックと同じく「目標位置まで描いてから発音」で
+ * 声とミキサ(hostapi_voice.h / hostapi_mix.h)を回し、わざと既知のずれ
+ * (0 / ±1 / 数十サンプル)を入れた位置で発音させた出力を WAV と .sched に
+ * 書いて(tmpfile)読み戻し、解析が次を満たすか確かめる(失敗で終了コード 1):
+ *   - 無音から始まる発音は、入れたずれをサンプル単位で正確に測る
+ *   - 鳴っている最中の発音は 8 割以上を検出でき、誤差は比較窓(5ms)以内
+ *   - 和音(同じ位置に複数)は 1 つの立ち上がりに対応し、余分が出ない
+ *   - 即時発音の遅延を入れたとおりに測る
+ *   - 曲と曲を隙間なくつないだ出力では曲間の無音を出さず、10ms の無音を
+ *     入れた出力ではそれを測る
+ */
+#include <inttypes.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "hostapi_capture.h"
+#include "hostapi_mix.h"
+
+#define RATE HOSTAPI_MIX_RATE
+#define HIST_SPAN 8            /* 誤差のヒストグラム: -8..+8 は 1 サンプルずつ */
+#define DOUBLE_MS 50           /* 対応済みの立ち上がりの直後にある余分 = 二重発音 */
+#define PLAY_WINDOW_MS 200     /* 即時発音の遅延の上限 */
+#define TRACK_LEAD_MS 20       /* 曲の切り替えの記録より前も少し見る */
+#define TRACK_WINDOW_MS 400    /* 切り替えの記録からリングの深さ(~186ms)+ 余裕 */
+#define TRACK_GAP_MS 1         /* これ以上の 0 の連続は曲間の無音 */
+
+/* ---- WAV を読む(16bit PCM。fmt と data 以外のチャンクは飛ばす) ---- */
+typedef struct {
+    uint32_t rate;
+    int channels;
+    int64_t frames;
+    int16_t* pcm;              /* interleaved。呼び出し側が free */
+} wav_t;
+
+static uint32_t rd32(const uint8_t* p)
+{
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static bool wav_read(FILE* f, wav_t* w)
+{
+    uint8_t h[12];
+    memset(w, 0, sizeof(*w));
+    if (fread(h, 1, 12, f) != 12 || memcmp(h, "RIFF", 4) != 0 || memcmp(h + 8, "WAVE", 4) != 0) {
+        return false;
+    }
+    int bits = 0;
+    for (;;) {
+        uint8_t c[8];
+        if (fread(c, 1, 8, f) != 8) return false;
+        const uint32_t size = rd32(c + 4);
+        if (memcmp(c, "fmt ", 4) == 0 && size >= 16) {
+            uint8_t fmt[16];
+            if (fread(fmt, 1, 16, f) != 16) return false;
+            w->channels = fmt[2] | fmt[3] << 8;
+            w->rate = rd32(fmt + 4);
+            bits = fmt[14] | fmt[15] << 8;
+            if (fseek(f, (long)(size - 16 + (size & 1)), SEEK_CUR) != 0) return false;
+        } else if (memcmp(c, "data", 4) == 0) {
+            if (bits != 16 || w->channels < 1) return false;
+            w->frames = size / (uint32_t)(2 * w->channels);
+            w->pcm = (int16_t*)malloc((size_t)w->frames * (size_t)w->channels * 2 + 2);
+            if (!w->pcm) return false;
+            /* 書きかけ(ヘッダのフレーム数が 0 のまま)でも読めた分を使う */
+            const size_t got = fread(w->pcm, (size_t)(2 * w->channels), (size_t)w->frames, f);
+            w->frames = (int64_t)got;
+            return true;
+        } else if (fseek(f, (long)(size + (size & 1)), SEEK_CUR) != 0) {
+            return false;
+        }
+    }
+}
+
+static int cmp_i64(const void* a, const void* b)
+{
+    const int64_t x = *(const int64_t*)a;
+    const int64_t y = *(const int64_t*)b;
+    return x < y ? -1 : x > y;
+}
+
+/* ---- 解析 ---- */
+typedef struct {
+    int64_t fires, missed, extra, doubles;
+    int64_t matched;
+    int64_t err_min, err_max;
+    double err_avg, err_sd;
+    int64_t exact;             /* 誤差 0 */
+    int64_t hist[2 * HIST_SPAN + 3]; /* [0] < -SPAN、[末尾] > +SPAN */
+    int64_t plays, play_found;
+    double play_min_ms, play_avg_ms, play_max_ms;
+    int64_t onsets;
+    int64_t tracks, track_gaps;   /* 曲の切り替え、そのうち無音が入ったもの */
+    int64_t track_run_max;        /* 切り替えの前後で最長の 0 の連続(フレーム) */
+    int64_t track_run_at;         /* その始まり(WAV 先頭基準、無ければ -1) */
+    int64_t* err;              /* fire ごと(位置順)。INT64_MIN は未検出 */
+    int64_t* want;
+} report_t;
+
+static void report_free(report_t* r)
+{
+    free(r->err);
+    free(r->want);
+}
+
+static bool analyse(const wav_t* w, const hostapi_capture_log_t* log, report_t* r)
+{
+    memset(r, 0, sizeof(*r));
+    hostapi_onset_cfg_t cfg;
+    hostapi_onset_cfg_default(&cfg, w->rate);
+    int64_t* on = (int64_t*)malloc((size_t)(w->frames / cfg.hold + 1) * sizeof(int64_t));
+    int64_t* want = (int64_t*)malloc((size_t)(log->count + 1) * sizeof(int64_t));
+    int64_t* play = (int64_t*)malloc((size_t)(log->count + 1) * sizeof(int64_t));
+    int64_t* err = (int64_t*)malloc((size_t)(log->count + 1) * sizeof(int64_t));
+    bool* used = (bool*)malloc((size_t)(w->frames / cfg.hold + 1) * sizeof(bool));
+    if (!on || !want || !play || !err || !used) {
+        free(on);
+        free(want);
+        free(play);
+        free(err);
+        free(used);
+        return false;
+    }
+    r->onsets = hostapi_onset_detect(w->pcm, w->channels, w->frames, &cfg, on,
+                                     w->frames / cfg.hold + 1);
+
+    /* 予定位置(WAV 先頭基準)。範囲外(キャプチャ前後)の予約は数えない */
+    int64_t nplay = 0;
+    for (int i = 0; i < log->count; i++) {
+        const hostapi_capture_rec_t* rec = &log->rec[i];
+        const int64_t pos =
+            (int64_t)hostapi_capture_ms_to_sample(rec->time_ms, log->epoch_ms, log->rate) -
+            (int64_t)log->base_sample;
+        if (pos < 0 || pos >= w->frames) continue;
+        if (rec->kind == HOSTAPI_CAPTURE_FIRE) {
+            want[r->fires++] = pos;
+        } else if (rec->kind == HOSTAPI_CAPTURE_PLAY) {
+            play[nplay++] = pos;
+        } else if (w->channels == 2) {
+            /* 曲の切り替え: 前後の 0 の連続 */
+            int64_t at;
+            const int64_t run = hostapi_capture_zero_run(
+                w->pcm, w->frames, pos - (int64_t)w->rate * TRACK_LEAD_MS / 1000,
+                pos + (int64_t)w->rate * TRACK_WINDOW_MS / 1000, &at);
+            r->tracks++;
+            if (run >= (int64_t)w->rate * TRACK_GAP_MS / 1000) r->track_gaps++;
+            if (r->tracks == 1 || run > r->track_run_max) {
+                r->track_run_max = run;
+                r->track_run_at = at;
+            }
+        }
+    }
+    qsort(want, (size_t)r->fires, sizeof(int64_t), cmp_i64);
+    qsort(play, (size_t)nplay, sizeof(int64_t), cmp_i64);
+
+    const int64_t window = cfg.win * 2;
+    hostapi_onset_match(want, r->fires, on, r->onsets, window, err, &r->missed, used);
+
+    /* 即時発音: 予約に対応しなかった立ち上がりのうち、依頼の後 PLAY_WINDOW_MS
+     * 以内で最初のもの(同じ位置の依頼は同じ立ち上がり) */
+    r->plays = nplay;
+    r->play_min_ms = 1e9;
+    int64_t m = 0;
+    for (int64_t k = 0; k < nplay; k++) {
+        while (m < r->onsets && on[m] < play[k]) m++;
+        int64_t j = m;
+        while (j < r->onsets && used[j] && !(k > 0 && play[k] == play[k - 1])) j++;
+        if (j >= r->onsets || on[j] - play[k] > (int64_t)w->rate * PLAY_WINDOW_MS / 1000) continue;
+        used[j] = true;
+        const double d = (on[j] - play[k]) * 1000.0 / w->rate;
+        if (d < r->play_min_ms) r->play_min_ms = d;
+        if (d > r->play_max_ms) r->play_max_ms = d;
+        r->play_avg_ms += d;
+        r->play_found++;
+    }
+    if (r->play_found) r->play_avg_ms /= (double)r->play_found;
+
+    /* 余分: どれにも対応しなかった立ち上がり。対応済みの直後なら二重発音 */
+    int64_t last_used = -1;
+    for (int64_t j = 0; j < r->onsets; j++) {
+        if (used[j]) {
+            last_used = on[j];
+            continue;
+        }
+        r->extra++;
+        if (last_used >= 0 && on[j] - last_used <= (int64_t)w->rate * DOUBLE_MS / 1000) {
+            r->doubles++;
+        }
+    }
+
+    /* 誤差の分布(和音は 1 件として数える) */
+    double sum = 0, sum2 = 0;
+    r->err_min = INT64_MAX;
+    r->err_max = INT64_MIN;
+    for (int64_t k = 0; k < r->fires; k++) {
+        if (err[k] == INT64_MIN || (k > 0 && want[k] == want[k - 1])) continue;
+        const int64_t e = err[k];
+        r->matched++;
+        sum += (double)e;
+        sum2 += (double)e * (double)e;
+        if (e < r->err_min) r->err_min = e;
+        if (e > r->err_max) r->err_max = e;
+        r->exact += e == 0;
+        int b = e < -HIST_SPAN ? 0 : e > HIST_SPAN ? 2 * HIST_SPAN + 2 : (int)e + HIST_SPAN + 1;
+        r->hist[b]++;
+    }
+    if (r->matched) {
+        r->err_avg = sum / (double)r->matched;
+        const double var = sum2 / (double)r->matched - r->err_avg * r->err_avg;
+        r->err_sd = var > 0 ? sqrt(var) : 0;
+    }
+    r->err = err;
+    r->want = want;
+    free(on);
+    free(play);
+    free(used);
+    return true;
+}
+
+static void report_print(const report_t* r, uint32_t rate, int64_t frames)
+{
+    printf("capture: %.2f s, %" PRId64 " onsets detected\n", frames / (double)rate, r->onsets);
+    printf("scheduled fires: %" PRId64 " (matched %" PRId64 " positions, missed %" PRId64
+           ")\n",
+           r->fires, r->matched, r->missed);
+    if (r->matched) {
+        printf("  error (onset - scheduled, samples): min %" PRId64 " avg %.2f max %" PRId64
+               " stddev %.2f, exact %" PRId64 " (%.1f%%)\n",
+               r->err_min, r->err_avg, r->err_max, r->err_sd, r->exact,
+               100.0 * (double)r->exact / (double)r->matched);
+        printf("  = %.3f .. %.3f ms\n", r->err_min * 1000.0 / rate, r->err_max * 1000.0 / rate);
+        for (int b = 0; b < 2 * HIST_SPAN + 3; b++) {
+            if (r->hist[b] == 0) continue;
+            char label[16];
+            if (b == 0) {
+                snprintf(label, sizeof(label), "< %d", -HIST_SPAN);
+            } else if (b == 2 * HIST_SPAN + 2) {
+                snprintf(label, sizeof(label), "> %d", HIST_SPAN);
+            } else {
+                snprintf(label, sizeof(label), "%d", b - HIST_SPAN - 1);
+            }
+            const int bar = (int)(r->hist[b] * 40 / r->matched);
+            printf("  %8s %9" PRId64 " %.*s\n", label, r->hist[b], bar,
+                   "########################################");
+        }
+    }
+    printf("extra onsets: %" PRId64 " (double triggers within %d ms: %" PRId64 ")\n", r->extra,
+           DOUBLE_MS, r->doubles);
+    if (r->plays) {
+        printf("immediate plays: %" PRId64 " (found %" PRId64 "), request -> onset min %.1f avg "
+               "%.1f max %.1f ms\n",
+               r->plays, r->play_found, r->play_found ? r->play_min_ms : 0.0, r->play_avg_ms,
+               r->play_max_ms);
+    }
+    if (r->tracks) {
+        printf("track switches: %" PRId64 ", with a gap >= %d ms: %" PRId64
+               ", longest zero run %" PRId64 " frames (%.2f ms)",
+               r->tracks, TRACK_GAP_MS, r->track_gaps, r->track_run_max,
+               r->track_run_max * 1000.0 / rate);
+        if (r->track_run_at >= 0) printf(" at %.3f s", r->track_run_at / (double)rate);
+        printf("\n");
+    }
+}
+
+static int analyse_files(const char* wav_path, const char* sched_path)
+{
+    char buf[512];
+    if (!sched_path) {
+        snprintf(buf, sizeof(buf), "%s.sched", wav_path);
+        sched_path = buf;
+    }
+    FILE* fw = fopen(wav_path, "rb");
+    FILE* fs = fopen(sched_path, "r");
+    if (!fw || !fs) {
+        fprintf(stderr, "cannot open %s / %s\n", wav_path, sched_path);
+        if (fw) fclose(fw);
+        if (fs) fclose(fs);
+        return 2;
+    }
+    wav_t w;
+    hostapi_capture_log_t log;
+    const bool wav_ok = wav_read(fw, &w);
+    const bool log_ok = hostapi_capture_read_log(fs, &log);
+    fclose(fw);
+    fclose(fs);
+    if (!wav_ok || !log_ok) {
+        fprintf(stderr, "%s\n", !wav_ok ? "not a 16-bit PCM WAV" : "no epoch line in the log");
+        free(w.pcm);
+        free(log.rec);
+        return 2;
+    }
+    if (w.rate != log.rate) {
+        fprintf(stderr, "rate mismatch: wav %u, log %u\n", (unsigned)w.rate, (unsigned)log.rate);
+    }
+    report_t r;
+    int ret = 2;
+    if (analyse(&w, &log, &r)) {
+        report_print(&r, w.rate, w.frames);
+        ret = r.track_gaps ? 1 : 0;
+        report_free(&r);
+    }
+    free(w.pcm);
+    free(log.rec);
+    return ret;
+}
+
+/* ---- 自己検証 ---- */
+static uint32_t s_rng = 0x2545f491u;
+static uint32_t rnd(void)
+{
+    s_rng ^= s_rng << 13;
+    s_rng ^= s_rng >> 17;
+    s_rng ^= s_rng << 5;
+    return s_rng;
+}
+
+#define SELF_EPOCH_MS 1000     /* 音声クロックの原点(now_ms) */
+#define SELF_BASE 441          /* キャプチャ開始の音声クロック */
+#define SELF_EVENTS 600
+
+typedef struct {
+    int64_t at;                /* 実際に発音させる位置(音声クロック) */
+    uint16_t freq_hz;
+    uint16_t dur_ms;
+    int64_t shift;             /* 予定位置からわざと入れたずれ */
+    bool overlap;              /* 前の音が鳴っている最中 */
+    bool play;                 /* 即時発音(記録は依頼時刻) */
+} ev_t;
+
+static int cmp_ev(const void* a, const void* b)
+{
+    const ev_t* x = (const ev_t*)a;
+    const ev_t* y = (const ev_t*)b;
+    return x->at < y->at ? -1 : x->at > y->at;
+}
+
+static int self_test(void)
+{
+    static const int kShift[] = {0, 0, 0, 1, -1, 3, 37, -20};
+    static ev_t ev[SELF_EVENTS * 3];
+    static hostapi_voices_t vs;
+    static hostapi_mix_t mix;
+    FILE* fw = tmpfile();
+    FILE* fs = tmpfile();
+    if (!fw || !fs) {
+        fprintf(stderr, "tmpfile failed\n");
+        return 1;
+    }
+
+    /* 予定(ms)を並べ、ずれを入れた発音位置と .sched の記録を作る */
+    fprintf(fs, "rate %d\n", RATE);
+    int n = 0;
+    uint32_t t_ms = SELF_EPOCH_MS + 50;
+    int64_t sound_end = 0;
+    bool prev_play = false;
+    for (int i = 0; i < SELF_EVENTS; i++) {
+        const uint32_t kind = rnd() % 10;
+        const bool overlap = kind < 2 && !prev_play; /* 即時発音は依頼より後に鳴る */
+        t_ms += overlap ? 12 : 40 + rnd() % 200;
+        const int64_t want = (int64_t)hostapi_capture_ms_to_sample(t_ms, SELF_EPOCH_MS, RATE);
+        hostapi_capture_rec_t rec = {HOSTAPI_CAPTURE_FIRE, t_ms, 0, false, 0};
+        if (kind == 9) {
+            /* 即時発音: 依頼から 5..30ms 後に鳴る */
+            rec.kind = HOSTAPI_CAPTURE_PLAY;
+            ev[n] = (ev_t){want + (int64_t)RATE * (5 + rnd() % 26) / 1000, 880, 30, 0, false,
+                           true};
+        } else {
+            const int64_t shift = kShift[rnd() % (sizeof(kShift) / sizeof(kShift[0]))];
+            ev[n] = (ev_t){want + shift, (uint16_t)(300 + rnd() % 900), 30, shift,
+                           want + shift < sound_end, false};
+            rec.id = (int32_t)(i + 1);
+        }
+        rec.param = ev[n].freq_hz;
+        hostapi_capture_write_rec(fs, &rec);
+        sound_end = ev[n].at + (int64_t)RATE * ev[n].dur_ms / 1000;
+        prev_play = ev[n].play;
+        n++;
+        if (!ev[n - 1].play && !overlap && kind == 2) {
+            /* 和音: 同じ位置にもう 2 音 */
+            for (int c = 1; c <= 2; c++) {
+                ev[n] = ev[n - 1];
+                ev[n].freq_hz = (uint16_t)(ev[n - 1].freq_hz + 100 * c);
+                rec.param = ev[n].freq_hz;
+                hostapi_capture_write_rec(fs, &rec);
+                n++;
+            }
+        }
+    }
+    qsort(ev, (size_t)n, sizeof(ev[0]), cmp_ev);
+
+    /* ホストのコールバックと同じく、発音位置まで描いてから鳴らす */
+    const int64_t total = ev[n - 1].at + RATE / 2 - SELF_BASE;
+    hostapi_voices_init(&vs, HOSTAPI_VOICE_DEFAULT);
+    hostapi_mix_init(&mix);
+    hostapi_capture_wav_header(fw, RATE, 0);
+    int16_t out[512 * 2];
+    int64_t clock = SELF_BASE;
+    int k = 0;
+    while (clock < SELF_BASE + total) {
+        while (k < n && ev[k].at <= clock) {
+            hostapi_voices_start(&vs, RATE, ev[k].freq_hz, ev[k].dur_ms, 100, 100);
+            k++;
+        }
+        int64_t len = 512;
+        if (k < n && ev[k].at - clock < len) len = ev[k].at - clock;
+        if (SELF_BASE + total - clock < len) len = SELF_BASE + total - clock;
+        hostapi_mix_render(&mix, NULL, &vs, NULL, out, (int)len);
+        fwrite(out, 4, (size_t)len, fw);
+        clock += len;
+    }
+    fprintf(fs, "epoch %d %d\n", SELF_EPOCH_MS, SELF_BASE);
+    fseek(fw, 0, SEEK_SET);
+    hostapi_capture_wav_header(fw, RATE, (uint32_t)total);
+
+    /* 読み戻して解析 */
+    rewind(fw);
+    rewind(fs);
+    wav_t w;
+    hostapi_capture_log_t log;
+    if (!wav_read(fw, &w) || !hostapi_capture_read_log(fs, &log) || w.frames != total) {
+        fprintf(stderr, "round trip failed\n");
+        return 1;
+    }
+    fclose(fw);
+    fclose(fs);
+    report_t r;
+    if (!analyse(&w, &log, &r)) return 1;
+    report_print(&r, w.rate, w.frames);
+
+    /* 入れたずれと測った誤差を比べる(r.want / r.err は位置順 = ev の fire 順) */
+    int64_t iso = 0, iso_bad = 0, ovl = 0, ovl_found = 0, ovl_bad = 0, plays = 0;
+    int64_t j = 0;
+    for (int i = 0; i < n; i++) {
+        if (ev[i].play) {
+            plays++;
+            continue;
+        }
+        const int64_t e = r.err[j++];
+        if (ev[i].overlap) {
+            ovl++;
+            if (e == INT64_MIN) continue;
+            ovl_found++;
+            if (llabs(e - ev[i].shift) > (int64_t)RATE / 200) ovl_bad++;
+        } else {
+            iso++;
+            if (e != ev[i].shift) iso_bad++;
+        }
+    }
+    const bool ok = iso_bad == 0 && r.extra == 0 && ovl_found * 5 >= ovl * 4 && ovl_bad == 0 &&
+                    r.play_found == plays && j == r.fires;
+    printf("self test: from silence %" PRId64 "/%" PRId64 " exact, over a sounding tone %" PRId64
+           "/%" PRId64 " found (%" PRId64 " off by > 5 ms), plays %" PRId64 "/%" PRId64 "  %s\n",
+           iso - iso_bad, iso, ovl_found, ovl, ovl_bad, r.play_found, plays, ok ? "OK" : "NG");
+    report_free(&r);
+    free(w.pcm);
+    free(log.rec);
+    return ok ? 0 : 1;
+}
+
+/* 曲の切り替え: 鳴り続ける 2 曲(和音)を gap_frames の 0 を挟んでつないだ出力を
+ * 作り、切り替えの記録はリングの深さぶん前に置く。測った最長の 0 の連続を返す
+ * (-1 は失敗) */
+static int64_t self_test_track(int64_t gap_frames)
+{
+    FILE* fw = tmpfile();
+    FILE* fs = tmpfile();
+    if (!fw || !fs) {
+        fprintf(stderr, "tmpfile failed\n");
+        return -1;
+    }
+    const int64_t len = RATE;               /* 1 曲 1 秒 */
+    const int64_t total = len * 2 + gap_frames;
+    const uint32_t switch_ms = SELF_EPOCH_MS + 1000 - 150; /* 境目の 150ms 前 */
+    fprintf(fs, "rate %d\nepoch %d 0\ntrack %u 2\n", RATE, SELF_EPOCH_MS, (unsigned)switch_ms);
+    hostapi_capture_wav_header(fw, RATE, (uint32_t)total);
+    for (int64_t i = 0; i < total; i++) {
+        int16_t f[2] = {0, 0};
+        if (i < len || i >= len + gap_frames) {
+            const double t = (double)(i < len ? i : i - len - gap_frames) / RATE;
+            const double hz = i < len ? 220.0 : 330.0;
+            f[0] = (int16_t)(6000 * sin(2 * M_PI * hz * t + 0.3) +
+                             3000 * sin(2 * M_PI * hz * 1.5 * t + 1.1));
+            f[1] = (int16_t)(6000 * sin(2 * M_PI * hz * t + 0.7) +
+                             3000 * sin(2 * M_PI * hz * 1.25 * t + 2.0));
+        }
+        fwrite(f, 4, 1, fw);
+    }
+    rewind(fw);
+    rewind(fs);
+    wav_t w;
+    hostapi_capture_log_t log;
+    const bool ok = wav_read(fw, &w) && hostapi_capture_read_log(fs, &log);
+    fclose(fw);
+    fclose(fs);
+    if (!ok) {
+        fprintf(stderr, "round trip failed\n");
+        return -1;
+    }
+    report_t r;
+    int64_t run = -1;
+    if (analyse(&w, &log, &r)) {
+        if (r.tracks == 1) run = r.track_run_max;
+        report_free(&r);
+    }
+    free(w.pcm);
+    free(log.rec);
+    return run;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc > 1) return analyse_files(argv[1], argc > 2 ? argv[2] : NULL);
+    int ret = self_test();
+    const int64_t gap = RATE / 100; /* 10ms */
+    const int64_t joined = self_test_track(0);
+    const int64_t gapped = self_test_track(gap);
+    const bool ok = joined >= 0 && joined < RATE * TRACK_GAP_MS / 1000 && gapped == gap;
+    printf("self test: track switch zero run, joined %" PRId64 " frames, with a 10 ms gap %" PRId64
+           " frames  %s\n",
+           joined, gapped, ok ? "OK" : "NG");
+    return ret || !ok;
+}
@@ -0,0 +1,155 @@
+/* トーンの発振カーネル(shared/hostapi_osc.h)のサンプルあたりコストと精度。
+ *
+ * float(参照)/ Q31 スカラ / Q31 SIMD を、ミキサと同じ 128 フレームの
+ * ブロックで 1 声・8 声・16 声ぶん回し、ns/sample と cycles/sample(x86 のみ。
+ * TSC なので定格クロック換算)を出す。併せて次を検証する(失敗で終了コード 1):
+ *   - Q31 / Q31 SIMD の出力が倍精度の閉形式と ±HOSTAPI_OSC_TOL 以内(周波数・
+ *     長さ 1 秒までを振って全サンプル。回転の丸め誤差が溜まらないこと)
+ *     float 参照の誤差も並べて出す
+ *
+ *   ./build/bench/bench_osc [反復回数]
+ */
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HAVE_TSC 1
+#else
+#define HAVE_TSC 0
+#endif
+
+#include "hostapi_voice.h"
+
+#define RATE 44100
+#define BLOCK HOSTAPI_VOICE_CHUNK
+#define HOSTAPI_OSC_TOL 2 /* 閉形式との許容差(LSB) */
+
+static double now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static uint64_t cycles(void)
+{
+#if HAVE_TSC
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+static const int kKernels[] = {HOSTAPI_OSC_FLOAT, HOSTAPI_OSC_Q31, HOSTAPI_OSC_Q31_SIMD};
+
+/* 1 声を kernel で最後まで鳴らす(ブロック長は端数を含めて変える) */
+static int render_all(int kernel, int32_t* out, uint16_t freq_hz, uint16_t dur_ms, uint8_t level)
+{
+    hostapi_voice_t v;
+    const float w = 2.0f * (float)M_PI * (float)freq_hz / RATE;
+    const int32_t total = RATE * dur_ms / 1000;
+    hostapi_osc_start(&v, w, HOSTAPI_VOICE_FULL_SCALE * level / 100.0f, total);
+    memset(out, 0, (size_t)total * sizeof(int32_t));
+    int pos = 0, step = 1;
+    while (v.remaining > 0) {
+        const int n = v.remaining < step ? v.remaining : step;
+        hostapi_osc_mix(kernel, &v, out + pos, n);
+        pos += n;
+        step = step % BLOCK + 7; /* 4 の倍数でないブロックも混ぜる */
+    }
+    return total;
+}
+
+/* 倍精度の閉形式 amp0 * decay^(i+1) * sin((i+1)w) との最大誤差(LSB) */
+static double max_error(int kernel, uint16_t freq_hz, uint16_t dur_ms)
+{
+    static int32_t out[RATE];
+    const int n = render_all(kernel, out, freq_hz, dur_ms, 100);
+    const double w = 2.0f * (float)M_PI * (float)freq_hz / RATE;
+    const double decay = exp(-3.5 / n);
+    double worst = 0, env = HOSTAPI_VOICE_FULL_SCALE;
+    for (int i = 0; i < n; i++) {
+        env *= decay;
+        const double e = fabs(out[i] - env * sin((i + 1) * w));
+        if (e > worst) worst = e;
+    }
+    return worst;
+}
+
+static int check_accuracy(void)
+{
+    static const uint16_t kFreqs[] = {40, 220, 1000, 4186, 12000, 20000};
+    static const uint16_t kDurs[] = {5, 30, 100, 1000};
+    int fail = 0;
+    for (size_t k = 0; k < sizeof(kKernels) / sizeof(kKernels[0]); k++) {
+        const int kernel = kKernels[k];
+        if (kernel == HOSTAPI_OSC_Q31_SIMD && !hostapi_osc_simd_supported()) continue;
+        double worst = 0;
+        for (size_t f = 0; f < sizeof(kFreqs) / sizeof(kFreqs[0]); f++) {
+            for (size_t d = 0; d < sizeof(kDurs) / sizeof(kDurs[0]); d++) {
+                const double e = max_error(kernel, kFreqs[f], kDurs[d]);
+                if (e > worst) worst = e;
+            }
+        }
+        /* float 参照は長いトーンで回転の丸めが溜まるので判定しない(表示のみ) */
+        const int ok = kernel == HOSTAPI_OSC_FLOAT || worst <= HOSTAPI_OSC_TOL;
+        printf("check %-11s: %s (max error vs exact %.2f LSB)\n", hostapi_osc_name(kernel),
+               kernel == HOSTAPI_OSC_FLOAT ? "--" : ok ? "OK" : "NG", worst);
+        fail |= !ok;
+    }
+    return fail;
+}
+
+static void bench(int voices, int iters)
+{
+    static int32_t acc[BLOCK];
+    printf("\n%d voice(s), %d-frame blocks, %d iterations\n", voices, BLOCK, iters);
+    printf("kernel        %s   ns/sample   speedup\n", HAVE_TSC ? "cycles/sample" : "             ");
+    double base_ns = 0;
+    for (size_t k = 0; k < sizeof(kKernels) / sizeof(kKernels[0]); k++) {
+        const int kernel = kKernels[k];
+        if (kernel == HOSTAPI_OSC_Q31_SIMD && !hostapi_osc_simd_supported()) {
+            printf("%-12s  (not available)\n", hostapi_osc_name(kernel));
+            continue;
+        }
+        hostapi_voice_t v[HOSTAPI_VOICE_MAX];
+        double ns = 0;
+        uint64_t cyc = 0;
+        for (int it = 0; it < iters; it++) {
+            /* 1 秒トーンを毎回鳴らし直す(ブロック内で鳴り終わらない) */
+            for (int i = 0; i < voices; i++) {
+                const float w = 2.0f * (float)M_PI * (float)(200 + 150 * i) / RATE;
+                hostapi_osc_start(&v[i], w, 6000.0f, RATE);
+            }
+            memset(acc, 0, sizeof(acc));
+            const double t0 = now_ns();
+            const uint64_t c0 = cycles();
+            for (int i = 0; i < voices; i++) hostapi_osc_mix(kernel, &v[i], acc, BLOCK);
+            cyc += cycles() - c0;
+            ns += now_ns() - t0;
+        }
+        const double samples = (double)iters * voices * BLOCK;
+        if (k == 0) base_ns = ns;
+        printf("%-12s  ", hostapi_osc_name(kernel));
+        if (HAVE_TSC) {
+            printf("%13.2f", cyc / samples);
+        } else {
+            printf("%13s", "-");
+        }
+        printf("   %9.3f   %6.2fx\n", ns / samples, base_ns / ns);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    const int iters = argc > 1 ? atoi(argv[1]) : 20000;
+    printf("default kernel: %s\n", hostapi_osc_name(hostapi_osc_best()));
+    const int fail = check_accuracy();
+    bench(1, iters);
+    bench(HOSTAPI_VOICE_DEFAULT, iters);
+    bench(HOSTAPI_VOICE_MAX, iters);
+    return fail;
+}
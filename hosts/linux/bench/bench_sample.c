@@ -0,0 +1,360 @@
+/* サンプル(shared/hostapi_sample.h)のデコード・キャッシュ・発音のコスト。
+ *
+ * ロード(tmpfile 上の WAV をデコードして 44.1kHz へ。SD の読み出しは含まない)
+ * にかかる時間を音声 1 秒あたりで、発音中のサンプル n 声のミックスを SDL
+ * コールバック 1 回ぶん(1024 フレーム)と実機 DMA ディスクリプタ 1 本ぶん
+ * (240 フレーム)で測る。併せて次を検証する(失敗で終了コード 1):
+ *   - 44.1kHz の 16bit モノ/ステレオ・EXTENSIBLE・raw はビット一致、8/24bit は
+ *     上位ビット一致。未知のチャンク(奇数長を含む)は読み飛ばす
+ *   - 22.05k / 48k からの変換は長さがレート比どおり、22.05k の 1kHz サインが
+ *     理論値から 1.5% 以内
+ *   - float・3ch・data の無いファイルは -1
+ *   - 同じキーの再ロードは読まずに同じハンドル。容量・スロット不足は -1 で
+ *     キャッシュは変わらない。reset で空になる
+ *   - level 100 x 音量 100 の 1 声はミキサを通してもビット一致、鳴り終われば
+ *     空きに戻る。声が足りなければ残りが最も短い声を奪う
+ *
+ *   ./build/bench/bench_sample [反復回数]
+ */
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "hostapi_mix.h"
+
+#define RATE HOSTAPI_MIX_RATE
+#define ARENA_BYTES (4u * 1024u * 1024u)
+
+static double now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static void put16(FILE* f, uint32_t v)
+{
+    fputc((int)(v & 0xFF), f);
+    fputc((int)((v >> 8) & 0xFF), f);
+}
+
+static void put32(FILE* f, uint32_t v)
+{
+    put16(f, v & 0xFFFF);
+    put16(f, v >> 16);
+}
+
+/* ch チャンネル・rate の 16bit サイン(振幅 amp、R は逆相)を frames フレーム */
+static void make_sine(int16_t* buf, int frames, int ch, double freq, double rate, double amp)
+{
+    for (int i = 0; i < frames; i++) {
+        const int16_t v = (int16_t)lrint(amp * sin(2 * M_PI * freq * i / rate));
+        for (int c = 0; c < ch; c++) buf[i * ch + c] = (int16_t)(c ? -v : v);
+    }
+}
+
+/* pcm(16bit)を bits で書いた WAV を tmpfile に作る。tag 0xFFFE は EXTENSIBLE。
+ * junk なら fmt と data の間に奇数長の LIST チャンクを挟む */
+static FILE* make_wav(const int16_t* pcm, int frames, int ch, uint32_t rate, int bits,
+                      uint16_t tag, bool junk)
+{
+    FILE* f = tmpfile();
+    if (!f) return NULL;
+    const uint32_t data = (uint32_t)(frames * ch * bits / 8);
+    const uint32_t fmt_len = tag == 0xFFFE ? 40 : 16;
+    fwrite("RIFF", 1, 4, f);
+    put32(f, 4 + 8 + fmt_len + (junk ? 8 + 6 : 0) + 8 + data);
+    fwrite("WAVEfmt ", 1, 8, f);
+    put32(f, fmt_len);
+    put16(f, tag);
+    put16(f, (uint32_t)ch);
+    put32(f, rate);
+    put32(f, rate * (uint32_t)ch * (uint32_t)bits / 8);
+    put16(f, (uint32_t)(ch * bits / 8));
+    put16(f, (uint32_t)bits);
+    if (tag == 0xFFFE) {
+        put16(f, 22);
+        put16(f, (uint32_t)bits);
+        put32(f, ch == 1 ? 0x4 : 0x3);
+        put16(f, 1); /* SubFormat = KSDATAFORMAT_SUBTYPE_PCM */
+        fwrite("\x00\x00\x00\x00\x10\x00\x80\x00\x00\xAA\x00\x38\x9B\x71", 1, 14, f);
+    }
+    if (junk) {
+        fwrite("LIST", 1, 4, f);
+        put32(f, 5);
+        fwrite("INFOx\0", 1, 6, f); /* 5 バイト + パディング */
+    }
+    fwrite("data", 1, 4, f);
+    put32(f, data);
+    for (int i = 0; i < frames * ch; i++) {
+        const int v = pcm[i];
+        if (bits == 8) {
+            fputc((v >> 8) + 128, f);
+        } else if (bits == 16) {
+            put16(f, (uint16_t)v);
+        } else {
+            fputc(0x5A, f); /* 下位 8bit は捨てられる */
+            put16(f, (uint16_t)v);
+        }
+    }
+    rewind(f);
+    return f;
+}
+
+static hostapi_sample_cache_t s_cache;
+
+static int load(const char* key, FILE* f, bool raw)
+{
+    const int h = hostapi_sample_decode(&s_cache, key, (uint32_t)strlen(key), f, raw, RATE);
+    fclose(f);
+    return h;
+}
+
+/* 44.1kHz の各形式がそのまま(8bit は上位 8bit)戻ること */
+static int check_formats(void)
+{
+    enum { N = 5000 };
+    static int16_t pcm[N * 2];
+    static const struct {
+        const char* name;
+        int ch, bits;
+        uint16_t tag;
+        bool junk;
+    } kCases[] = {
+        {"16bit mono", 1, 16, 1, false},       {"16bit stereo + LIST", 2, 16, 1, true},
+        {"8bit mono", 1, 8, 1, false},         {"24bit stereo", 2, 24, 1, false},
+        {"extensible stereo", 2, 16, 0xFFFE, true},
+    };
+    int fail = 0;
+    for (size_t k = 0; k < sizeof(kCases) / sizeof(kCases[0]); k++) {
+        const int ch = kCases[k].ch;
+        make_sine(pcm, N, ch, 997, RATE, 30000);
+        const int h = load(kCases[k].name,
+                           make_wav(pcm, N, ch, RATE, kCases[k].bits, kCases[k].tag,
+                                    kCases[k].junk),
+                           false);
+        const hostapi_sample_t* s = hostapi_sample_get(&s_cache, h);
+        int ok = s && s->frames == N && s->channels == ch;
+        const int16_t mask = kCases[k].bits == 8 ? (int16_t)0xFF00 : (int16_t)0xFFFF;
+        for (int i = 0; ok && i < N * ch; i++) ok = s->pcm[i] == (int16_t)(pcm[i] & mask);
+        printf("check %-20s: %s\n", kCases[k].name, ok ? "OK" : "NG");
+        fail |= !ok;
+    }
+
+    make_sine(pcm, N, 1, 997, RATE, 30000);
+    FILE* f = tmpfile();
+    fwrite(pcm, sizeof(int16_t), N, f); /* x86 / ARM はリトルエンディアン */
+    rewind(f);
+    const hostapi_sample_t* s = hostapi_sample_get(&s_cache, load("raw", f, true));
+    const int ok = s && s->frames == N && memcmp(s->pcm, pcm, N * 2) == 0;
+    printf("check %-20s: %s\n", "raw 16bit mono", ok ? "OK" : "NG");
+    return fail | !ok;
+}
+
+static int check_resample(void)
+{
+    enum { N = 22050 };
+    static int16_t pcm[48000 * 2];
+    make_sine(pcm, N, 1, 1000, 22050, 20000);
+    const hostapi_sample_t* s = hostapi_sample_get(
+        &s_cache, load("22k", make_wav(pcm, N, 1, 22050, 16, 1, false), false));
+    double worst = 0;
+    for (uint32_t i = 4; s && i < s->frames; i++) {
+        /* 出力 i は入力位置 i/2 - 1(リサンプラの 1 フレーム遅れ) */
+        const double ideal = 20000 * sin(2 * M_PI * 1000 * (i / 2.0 - 1) / 22050);
+        const double e = fabs(s->pcm[i] - ideal) / 20000;
+        if (e > worst) worst = e;
+    }
+    int ok = s && s->channels == 1 && abs((int)s->frames - N * 2) <= 2 && worst < 0.015;
+    printf("check 22.05k -> 44.1k     : %s (%u frames, max error %.2f%%)\n", ok ? "OK" : "NG",
+           s ? (unsigned)s->frames : 0, worst * 100);
+    int fail = !ok;
+
+    make_sine(pcm, 48000, 2, 440, 48000, 20000);
+    s = hostapi_sample_get(&s_cache, load("48k", make_wav(pcm, 48000, 2, 48000, 16, 1, false),
+                                          false));
+    ok = s && s->channels == 2 && abs((int)s->frames - RATE) <= 2;
+    printf("check 48k stereo -> 44.1k : %s (%u frames)\n", ok ? "OK" : "NG",
+           s ? (unsigned)s->frames : 0);
+    return fail | !ok;
+}
+
+static int check_reject(void)
+{
+    int16_t pcm[64] = {0};
+    const int h_float = load("float", make_wav(pcm, 16, 2, RATE, 16, 3, false), false);
+    const int h_3ch = load("3ch", make_wav(pcm, 16, 3, RATE, 16, 1, false), false);
+    FILE* f = make_wav(pcm, 16, 1, RATE, 16, 1, false);
+    fseek(f, 0, SEEK_END);
+    const long full = ftell(f);
+    rewind(f);
+    static uint8_t bytes[256];
+    const size_t n = fread(bytes, 1, (size_t)full, f);
+    fclose(f);
+    f = tmpfile();
+    fwrite(bytes, 1, n < 36 ? n : 36, f); /* fmt まで(data チャンク無し) */
+    rewind(f);
+    const int h_trunc = load("truncated", f, false);
+    const int ok = h_float < 0 && h_3ch < 0 && h_trunc < 0;
+    printf("check reject              : %s (float %d, 3ch %d, no data %d)\n", ok ? "OK" : "NG",
+           h_float, h_3ch, h_trunc);
+    return ok ? 0 : 1;
+}
+
+static int check_cache(void)
+{
+    enum { N = RATE };
+    static int16_t pcm[N];
+    int fail = 0;
+
+    /* 再ロード: 中身がゴミのファイルでも読まずに同じハンドル */
+    const int before = s_cache.count;
+    const int h0 = hostapi_sample_cache_find(&s_cache, "16bit mono", 10);
+    FILE* junk = tmpfile();
+    const int h1 = load("16bit mono", junk, false);
+    int ok = h0 >= 0 && h1 == h0 && s_cache.count == before;
+    printf("check reload same key     : %s (handle %d)\n", ok ? "OK" : "NG", h1);
+    fail |= !ok;
+
+    /* 容量不足: 小さいアリーナに 1 秒ステレオは入らない */
+    static uint8_t small[64 * 1024];
+    hostapi_sample_cache_t c;
+    hostapi_sample_cache_init(&c, small, sizeof(small));
+    make_sine(pcm, N / 2, 2, 440, RATE, 10000);
+    FILE* f = make_wav(pcm, N / 2, 2, RATE, 16, 1, false);
+    const int h_big = hostapi_sample_decode(&c, "big", 3, f, false, RATE);
+    fclose(f);
+    ok = h_big < 0 && c.count == 0 && c.used == 0;
+    /* スロット不足: 小さなサンプルで埋めた次は -1 */
+    for (int i = 0; i <= HOSTAPI_SAMPLE_SLOTS && ok; i++) {
+        char key[16];
+        snprintf(key, sizeof(key), "s%d", i);
+        f = make_wav(pcm, 32, 1, RATE, 16, 1, false);
+        const int h = hostapi_sample_decode(&c, key, (uint32_t)strlen(key), f, false, RATE);
+        fclose(f);
+        ok = i < HOSTAPI_SAMPLE_SLOTS ? h == i : (h < 0 && c.count == HOSTAPI_SAMPLE_SLOTS);
+    }
+    hostapi_sample_cache_reset(&c);
+    ok = ok && c.count == 0 && c.used == 0 && hostapi_sample_get(&c, 0) == NULL;
+    printf("check capacity / reset    : %s (arena %u KB, %d slots)\n", ok ? "OK" : "NG",
+           (unsigned)(sizeof(small) / 1024), HOSTAPI_SAMPLE_SLOTS);
+    return fail | !ok;
+}
+
+static int check_player(void)
+{
+    const hostapi_sample_t* s = hostapi_sample_get(&s_cache, 0); /* 16bit mono 5000 */
+    static int16_t out[8192 * 2];
+    hostapi_mix_t m;
+    hostapi_mix_init(&m);
+    hostapi_splayer_t p;
+    hostapi_splayer_reset(&p);
+    hostapi_splayer_start(&p, s, 100, 100);
+    const int n = (int)s->frames + 100;
+    hostapi_mix_render(&m, NULL, NULL, &p, out, n);
+    int ok = p.active == 0 && m.limited == 0;
+    for (int i = 0; ok && i < n; i++) {
+        const int16_t want = i < (int)s->frames ? s->pcm[i] : 0;
+        ok = out[i * 2] == want && out[i * 2 + 1] == want;
+    }
+    printf("check play through mixer  : %s (bit exact, voice freed)\n", ok ? "OK" : "NG");
+    int fail = !ok;
+
+    /* 奪い方: 全声を時間差で鳴らし、次は残りの最も短い(最初の)声を奪う */
+    hostapi_splayer_reset(&p);
+    static int32_t l[64], r[64];
+    for (int i = 0; i < HOSTAPI_SAMPLE_VOICES; i++) {
+        hostapi_splayer_start(&p, s, 50, 100);
+        hostapi_splayer_accum(&p, l, r, 64);
+    }
+    const bool stolen = hostapi_splayer_start(&p, s, 50, 100);
+    ok = stolen && p.stolen == 1 && p.active == HOSTAPI_SAMPLE_VOICES && p.v[0].pos == 0 &&
+         p.v[1].pos == 64 * (HOSTAPI_SAMPLE_VOICES - 1);
+    printf("check voice stealing      : %s (%d voices)\n", ok ? "OK" : "NG",
+           HOSTAPI_SAMPLE_VOICES);
+    return fail | !ok;
+}
+
+static void bench_load(int iters)
+{
+    static const struct {
+        int rate, ch, bits;
+    } kCases[] = {{44100, 1, 16}, {44100, 2, 16}, {22050, 1, 16}, {48000, 2, 24}};
+    static int16_t pcm[48000 * 2];
+    static uint8_t arena[RATE * 2 * 2 + 64];
+    printf("\nload 1 s of audio (from page cache, no SD), %d iterations\n", iters);
+    printf("source              ms/load   KB cached\n");
+    for (size_t k = 0; k < sizeof(kCases) / sizeof(kCases[0]); k++) {
+        make_sine(pcm, kCases[k].rate, kCases[k].ch, 440, kCases[k].rate, 16000);
+        FILE* f = make_wav(pcm, kCases[k].rate, kCases[k].ch, (uint32_t)kCases[k].rate,
+                           kCases[k].bits, 1, false);
+        hostapi_sample_cache_t c;
+        double total = 0;
+        for (int it = 0; it < iters; it++) {
+            hostapi_sample_cache_init(&c, arena, sizeof(arena));
+            rewind(f);
+            const double t0 = now_us();
+            hostapi_sample_decode(&c, "x", 1, f, false, RATE);
+            total += now_us() - t0;
+        }
+        fclose(f);
+        printf("%5d Hz %2dbit %-6s %8.3f   %9u\n", kCases[k].rate, kCases[k].bits,
+               kCases[k].ch == 1 ? "mono" : "stereo", total / iters / 1000,
+               (unsigned)(c.used / 1024));
+    }
+}
+
+static void bench_mix(int frames, int iters)
+{
+    static int16_t out[4096 * 2];
+    const hostapi_sample_t* mono = hostapi_sample_get(&s_cache, 0);
+    const hostapi_sample_t* stereo = hostapi_sample_get(&s_cache, 1);
+    const double budget_us = frames * 1e6 / RATE;
+    printf("\nmix %d frames (%.1f ms of audio), %d iterations\n", frames, budget_us / 1000,
+           iters);
+    printf("samples            us/buffer   ns/frame   %% of buffer\n");
+    static const int kVoices[] = {1, 4, HOSTAPI_SAMPLE_VOICES};
+    for (int st = 0; st < 2; st++) {
+        for (size_t k = 0; k < sizeof(kVoices) / sizeof(kVoices[0]); k++) {
+            hostapi_mix_t m;
+            hostapi_mix_init(&m);
+            hostapi_splayer_t p;
+            double total = 0;
+            for (int it = 0; it < iters; it++) {
+                hostapi_splayer_reset(&p);
+                for (int i = 0; i < kVoices[k]; i++) {
+                    hostapi_splayer_start(&p, st ? stereo : mono, 30, 98);
+                }
+                const double t0 = now_us();
+                hostapi_mix_render(&m, NULL, NULL, &p, out, frames);
+                total += now_us() - t0;
+            }
+            const double per = total / iters;
+            char label[32];
+            snprintf(label, sizeof(label), "%d x %s", kVoices[k], st ? "stereo" : "mono");
+            printf("%-17s  %9.2f   %8.2f   %10.2f\n", label, per, per * 1000 / frames,
+                   per * 100 / budget_us);
+        }
+    }
+}
+
+int main(int argc, char** argv)
+{
+    const int iters = argc > 1 ? atoi(argv[1]) : 2000;
+    void* arena = malloc(ARENA_BYTES);
+    if (!arena) return 1;
+    hostapi_sample_cache_init(&s_cache, arena, ARENA_BYTES);
+    int fail = 0;
+    fail |= check_formats();
+    fail |= check_resample();
+    fail |= check_reject();
+    fail |= check_cache();
+    fail |= check_player();
+    bench_load(iters / 100 > 0 ? iters / 100 : 1);
+    bench_mix(1024, iters); /* Linux: SDL コールバック 1 回 */
+    bench_mix(240, iters);  /* 実機: DMA ディスクリプタ 1 本 */
+    free(arena);
+    return fail;
+}
@@ -0,0 +1,365 @@
+/* 実機の常時ストリーミング描画ループ(shared/hostapi_stream.h)の Linux ハーネス。
+ *
+ * I2S の DMA リング(240 フレームのディスクリプタ D 本、1 本は常に再生中)を
+ * 仮想時間(フレーム単位)で模し、実機と同じ描画ループ・声・ミキサを回す。
+ * 書き込みはリングが空くまで「待つ」(仮想時間を進める)。発音依頼は不規則な
+ * 間隔(2..250ms)で来て、次の poll で取り込まれる。比べるのは:
+ *
+ *   stream  hostapi_stream_step を回し続ける(無音もリングへ書く)
+ *   burst   旧トーンタスク: 鳴っている間だけ書き、鳴り終わったらリング 1 周
+ *           (6 本)のゼロを書いてから眠る(Phase 7B fix)
+ *
+ * 依頼から、その音の入ったディスクリプタが再生され始めるまでの遅延を
+ * 集計する。次を検証する(失敗で終了コード 1):
+ *   - stream はアンダーフロー 0(再生中のディスクリプタの後が常に書かれている)
+ *   - stream の遅延のばらつき(最大 - 最小)は 1 チャンク以内
+ *   - 全ての依頼が発音され、その先頭チャンクに音が入っている。無音チャンクは
+ *     ゼロ
+ * 併せて、描画ループがときどき止められた(優先度の高い処理に奪われた)ときの
+ * アンダーフロー数をリングの本数別に出し、1 ステップの実時間コストを測る。
+ *
+ *   ./build/bench/bench_stream [依頼数]
+ */
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "hostapi_stream.h"
+
+#define RATE HOSTAPI_MIX_RATE
+#define CHUNK 240       /* 実機の DMA ディスクリプタ 1 本 */
+#define OLD_DESCS 6     /* 旧実装(IDF 既定)のリング本数 = ゼロ埋めの本数 */
+#define MAX_REQ 20000
+#define MAX_PENDING 8
+
+static double now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static uint32_t s_rng = 0x12345678u;
+static uint32_t rnd(void)
+{
+    s_rng ^= s_rng << 13;
+    s_rng ^= s_rng >> 17;
+    s_rng ^= s_rng << 5;
+    return s_rng;
+}
+
+static double ms(int64_t frames)
+{
+    return frames * 1000.0 / RATE;
+}
+
+typedef struct {
+    int64_t t;          /* 依頼時刻(フレーム) */
+    uint16_t freq_hz;
+    int64_t start;      /* 再生され始めた時刻。-1 は未発音 */
+} req_t;
+
+/* DMA リングと描画側の仮想時間 */
+typedef struct {
+    int descs;
+    int64_t now;                    /* 描画側の現在時刻 */
+    int64_t q[MAX_PENDING + 1];     /* 書き込み済み・未再生のディスクリプタの開始時刻 */
+    int nq;
+    int64_t last_end;               /* 最後に書いたディスクリプタの終了時刻 */
+    bool started;
+    uint32_t underflows;            /* 開始後に何も書かれていなかった境界の数 */
+    int64_t blocked;                /* 書き込みで待った合計 */
+    /* 依頼 */
+    req_t* req;
+    int nreq;
+    int next;                       /* 次に取り込む依頼 */
+    int onset[MAX_REQ];             /* このチャンクで発音を始めた依頼 */
+    int nonset;
+    bool sounding;                  /* poll の時点で鳴っていた */
+    int silent_bad;                 /* 無音のはずのチャンクに音があった */
+    int onset_bad;                  /* 発音の先頭チャンクが無音だった */
+    /* 描画ループを止める(プリエンプションの模擬) */
+    uint32_t stall_per;             /* 1/stall_per の確率で 1 ステップ止まる。0 は止めない */
+    int64_t stall_max;
+    hostapi_voices_t* voices;
+} sim_t;
+
+static sim_t s_sim;
+
+static void sim_init(sim_t* s, int descs, req_t* req, int nreq, hostapi_voices_t* vs)
+{
+    memset(s, 0, sizeof(*s));
+    s->descs = descs;
+    s->req = req;
+    s->nreq = nreq;
+    s->voices = vs;
+    for (int i = 0; i < nreq; i++) req[i].start = -1;
+}
+
+/* t までに再生を始めたディスクリプタをリングから外す */
+static void sim_advance(sim_t* s, int64_t t)
+{
+    int k = 0;
+    while (k < s->nq && s->q[k] <= t) k++;
+    if (k > 0) {
+        memmove(s->q, s->q + k, (size_t)(s->nq - k) * sizeof(s->q[0]));
+        s->nq -= k;
+    }
+}
+
+/* 1 チャンクをリングへ書く。1 本は常に再生中なので、未再生は descs - 1 本まで。
+ * 空きが無ければ再生中の 1 本が終わる(次が始まる)まで待つ */
+static int64_t sim_write(sim_t* s)
+{
+    sim_advance(s, s->now);
+    while (s->nq >= s->descs - 1) {
+        s->blocked += s->q[0] - s->now;
+        s->now = s->q[0];
+        sim_advance(s, s->now);
+    }
+    int64_t start = (s->now / CHUNK + 1) * CHUNK; /* 空なら次の境界(今の境界は無音で始まった) */
+    if (s->started && s->last_end > s->now) start = s->last_end;
+    if (s->started && start > s->last_end) s->underflows += (uint32_t)((start - s->last_end) / CHUNK);
+    s->q[s->nq++] = start;
+    s->last_end = start + CHUNK;
+    return start;
+}
+
+static void sim_take_requests(sim_t* s)
+{
+    if (s->stall_per && rnd() % s->stall_per == 0) {
+        s->now += (int64_t)(rnd() % (uint32_t)(s->stall_max + 1));
+    }
+    s->nonset = 0;
+    while (s->next < s->nreq && s->req[s->next].t <= s->now) {
+        hostapi_voices_start(s->voices, RATE, s->req[s->next].freq_hz, 30, 100, 98);
+        s->onset[s->nonset++] = s->next++;
+    }
+    s->sounding = s->voices->active > 0;
+}
+
+static void sim_check_chunk(sim_t* s, const int16_t* pcm, int frames, int64_t start)
+{
+    bool any = false;
+    for (int i = 0; i < frames * 2 && !any; i++) any = pcm[i] != 0;
+    if (s->nonset > 0 && !any) s->onset_bad++;
+    if (!s->sounding && any) s->silent_bad++;
+    for (int i = 0; i < s->nonset; i++) s->req[s->onset[i]].start = start;
+}
+
+/* ---- stream: hostapi_stream の io ---- */
+static void io_poll(void* ctx)
+{
+    sim_take_requests((sim_t*)ctx);
+}
+
+static bool io_write(void* ctx, const int16_t* pcm, int frames)
+{
+    sim_t* s = (sim_t*)ctx;
+    const int64_t start = sim_write(s);
+    s->started = true;
+    sim_check_chunk(s, pcm, frames, start);
+    return true;
+}
+
+static void run_stream(sim_t* s, int64_t until)
+{
+    static hostapi_voices_t vs;
+    static hostapi_mix_t mix;
+    static hostapi_stream_t st;
+    static int16_t out[CHUNK * 2];
+    hostapi_voices_init(&vs, HOSTAPI_VOICE_DEFAULT);
+    hostapi_mix_init(&mix);
+    s->voices = &vs;
+    const hostapi_stream_io_t io = {s, io_poll, NULL, io_write};
+    hostapi_stream_init(&st, &io, &mix, &vs, NULL, out, NULL, CHUNK);
+    while (s->now < until) hostapi_stream_step(&st);
+}
+
+/* ---- burst: 旧トーンタスク(鳴っている間 + ゼロ 6 本だけ書き、あとは眠る) ---- */
+static void run_burst(sim_t* s, int64_t until)
+{
+    static hostapi_voices_t vs;
+    static hostapi_mix_t mix;
+    static int16_t out[CHUNK * 2];
+    hostapi_voices_init(&vs, HOSTAPI_VOICE_DEFAULT);
+    hostapi_mix_init(&mix);
+    s->voices = &vs;
+    int pad = 0;
+    while (s->now < until) {
+        sim_take_requests(s);
+        if (vs.active) {
+            hostapi_mix_render(&mix, NULL, &vs, NULL, out, CHUNK);
+            pad = OLD_DESCS;
+        } else if (pad > 0) {
+            memset(out, 0, sizeof(out));
+            pad--;
+        } else {
+            /* 眠る: 次の依頼で起きる。リングはその間に空になる(アンダーフローは
+             * 想定どおりなので数えない) */
+            if (s->next >= s->nreq) break;
+            s->now = s->req[s->next].t;
+            s->started = false;
+            continue;
+        }
+        const int64_t start = sim_write(s);
+        s->started = true;
+        sim_check_chunk(s, out, CHUNK, start);
+    }
+}
+
+typedef struct {
+    double min_ms, avg_ms, max_ms;
+    int missing;
+} lat_t;
+
+static lat_t latency(const req_t* req, int n)
+{
+    lat_t l = {1e9, 0, 0, 0};
+    int count = 0;
+    for (int i = 0; i < n; i++) {
+        if (req[i].start < 0) {
+            l.missing++;
+            continue;
+        }
+        const double d = ms(req[i].start - req[i].t);
+        if (d < l.min_ms) l.min_ms = d;
+        if (d > l.max_ms) l.max_ms = d;
+        l.avg_ms += d;
+        count++;
+    }
+    l.avg_ms = count ? l.avg_ms / count : 0;
+    return l;
+}
+
+/* 依頼列: 2..250ms の不規則な間隔。ときどき 3 和音(同時刻) */
+static int make_requests(req_t* req, int n)
+{
+    int64_t t = RATE / 10;
+    int i = 0;
+    while (i < n) {
+        t += (int64_t)RATE * (2 + (int)(rnd() % 249)) / 1000;
+        const int chord = rnd() % 8 == 0 ? 3 : 1;
+        for (int c = 0; c < chord && i < n; c++, i++) {
+            req[i].t = t;
+            req[i].freq_hz = (uint16_t)(600 + 200 * c);
+        }
+    }
+    return n;
+}
+
+static int compare(int nreq)
+{
+    static req_t req[MAX_REQ];
+    make_requests(req, nreq);
+    const int64_t until = req[nreq - 1].t + RATE / 2;
+    int fail = 0;
+
+    printf("latency: request -> first frame on the DAC (%d requests, %.1f s)\n", nreq,
+           until / (double)RATE);
+    sim_init(&s_sim, OLD_DESCS, req, nreq, NULL);
+    run_burst(&s_sim, until);
+    lat_t l = latency(req, nreq);
+    printf("  burst  %d descs: min %5.1f avg %5.1f max %5.1f ms (spread %5.1f), "
+           "blocked %.1f ms per request\n",
+           OLD_DESCS, l.min_ms, l.avg_ms, l.max_ms, l.max_ms - l.min_ms,
+           ms(s_sim.blocked) / nreq);
+
+    static const int kDescs[] = {2, 3, 4, 6};
+    for (size_t k = 0; k < sizeof(kDescs) / sizeof(kDescs[0]); k++) {
+        sim_init(&s_sim, kDescs[k], req, nreq, NULL);
+        run_stream(&s_sim, until);
+        l = latency(req, nreq);
+        const bool ok = s_sim.underflows == 0 && l.missing == 0 && s_sim.onset_bad == 0 &&
+                        s_sim.silent_bad == 0 && l.max_ms - l.min_ms <= ms(CHUNK) + 1e-9;
+        printf("  stream %d descs: min %5.1f avg %5.1f max %5.1f ms (spread %5.1f), "
+               "underflows %u  %s\n",
+               kDescs[k], l.min_ms, l.avg_ms, l.max_ms, l.max_ms - l.min_ms,
+               (unsigned)s_sim.underflows, ok ? "OK" : "NG");
+        if (!ok) {
+            printf("    missing %d, silent onset %d, noise in silence %d\n", l.missing,
+                   s_sim.onset_bad, s_sim.silent_bad);
+        }
+        fail |= !ok;
+    }
+    return fail;
+}
+
+/* 描画ループが 1/200 の確率で 0..stall ms 止められたときのアンダーフロー */
+static void stalls(int nreq)
+{
+    static req_t req[MAX_REQ];
+    make_requests(req, nreq);
+    const int64_t until = req[nreq - 1].t + RATE / 2;
+    static const int kStallMs[] = {5, 10, 20};
+    printf("underflows per minute when the render loop is stalled (1 in 200 chunks)\n");
+    printf("  %-10s", "stall");
+    for (int d = 2; d <= 8; d++) printf(" %5d descs", d);
+    printf("\n");
+    for (size_t k = 0; k < sizeof(kStallMs) / sizeof(kStallMs[0]); k++) {
+        printf("  <=%3d ms  ", kStallMs[k]);
+        for (int d = 2; d <= 8; d++) {
+            s_rng = 0x9e3779b9u;
+            sim_init(&s_sim, d, req, nreq, NULL);
+            s_sim.stall_per = 200;
+            s_sim.stall_max = (int64_t)RATE * kStallMs[k] / 1000;
+            run_stream(&s_sim, until);
+            printf(" %11.1f", s_sim.underflows * 60.0 * RATE / until);
+        }
+        printf("\n");
+    }
+}
+
+/* 実時間の 1 ステップ(240 フレーム)コスト。シンクは捨てるだけ */
+static void sink_poll(void* ctx)
+{
+    (void)ctx;
+}
+static bool sink_write(void* ctx, const int16_t* pcm, int frames)
+{
+    (void)ctx;
+    (void)pcm;
+    (void)frames;
+    return true;
+}
+
+static void step_cost(void)
+{
+    static hostapi_voices_t vs;
+    static hostapi_mix_t mix;
+    static hostapi_stream_t st;
+    static int16_t out[CHUNK * 2];
+    const hostapi_stream_io_t io = {NULL, sink_poll, NULL, sink_write};
+    static const int kVoices[] = {0, 1, 8};
+    for (size_t k = 0; k < sizeof(kVoices) / sizeof(kVoices[0]); k++) {
+        hostapi_voices_init(&vs, HOSTAPI_VOICE_DEFAULT);
+        hostapi_mix_init(&mix);
+        hostapi_stream_init(&st, &io, &mix, &vs, NULL, out, NULL, CHUNK);
+        double total = 0;
+        int steps = 0;
+        for (int r = 0; r < 200; r++) {
+            for (int i = 0; i < kVoices[k]; i++) {
+                hostapi_voices_start(&vs, RATE, (uint16_t)(300 + 100 * i), 100, 60, 98);
+            }
+            const double t0 = now_us();
+            for (int i = 0; i < 16; i++) hostapi_stream_step(&st);
+            total += now_us() - t0;
+            steps += 16;
+        }
+        printf("step cost: %d voices: %.2f us / %d frames\n", kVoices[k], total / steps, CHUNK);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    int nreq = argc > 1 ? atoi(argv[1]) : 4000;
+    if (nreq < 1) nreq = 1;
+    if (nreq > MAX_REQ) nreq = MAX_REQ;
+    int fail = compare(nreq);
+    stalls(nreq);
+    step_cost();
+    return fail;
+}
@@ -0,0 +1,284 @@
+/* トーンのポリフォニー発音エンジン(shared/hostapi_voice.h)のレンダリングコスト。
+ *
+ * 声数 1..16 を同時に鳴らし(既定カーネル)、SDL オーディオコールバック 1 回ぶん(1024 フレーム)
+ * と実機 DMA ディスクリプタ 1 本ぶん(240 フレーム)を描く時間を測る。
+ * 併せて次を検証する(失敗で終了コード 1):
+ *   - 1 声の出力(float カーネル)が従来の単声ループ(hostapi_sdl.c の旧
+ *     audio_callback)と一致
+ *   - 全声 level 100 で重ねても int16 に飽和し、符号が反転(ラップ)しない
+ *   - 声数を超える発音は最も減衰した声を奪う
+ *   - レンダ済みキャッシュ(shared/hostapi_tcache.h)の再生が発振と 1 LSB 以内で
+ *     一致(全カーネル、音量 100 / 98)。再生中の枠は上書きされず、入らない
+ *     定義は発振で鳴る
+ * レンダ済みキャッシュについては、発音 1 回ぶん(voices_start + 最初の
+ * バッファ = 発音依頼から出力までに乗る処理)と声数別の描画時間を発振と比べる。
+ *
+ *   ./build/bench/bench_voice [反復回数]
+ */
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "hostapi_voice.h"
+
+#define RATE 44100
+
+static double now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+/* 旧実装の単声ループ(比較用) */
+static void render_mono_ref(int16_t* out, int frames, uint16_t freq_hz, uint16_t dur_ms,
+                            uint8_t level, int volume)
+{
+    const float w = 2.0f * (float)M_PI * (float)freq_hz / RATE;
+    int remaining = RATE * dur_ms / 1000;
+    float s = 0.0f, c = 1.0f;
+    const float cw = cosf(w), sw = sinf(w);
+    const float decay = expf(-3.5f / (float)remaining);
+    float amp = 12000.0f * level / 100.0f * volume / 100.0f;
+    memset(out, 0, (size_t)frames * 4);
+    for (int i = 0; i < frames && remaining > 0; i++, remaining--) {
+        const float s2 = s * cw + c * sw;
+        c = c * cw - s * sw;
+        s = s2;
+        amp *= decay;
+        const int16_t v = (int16_t)(amp * s);
+        out[i * 2] = v;
+        out[i * 2 + 1] = v;
+    }
+}
+
+static int check_mono(void)
+{
+    enum { N = RATE * 30 / 1000 + 300 };
+    static int16_t ref[N * 2], got[N * 2];
+    hostapi_voices_t vs;
+    hostapi_voices_init(&vs, HOSTAPI_VOICE_DEFAULT);
+    hostapi_voices_set_kernel(&vs, HOSTAPI_OSC_FLOAT);
+    hostapi_voices_start(&vs, RATE, 1000, 30, 100, 98);
+    hostapi_voices_render(&vs, got, N);
+    render_mono_ref(ref, N, 1000, 30, 100, 98);
+    if (memcmp(ref, got, sizeof(ref)) != 0 || vs.active != 0) {
+        printf("check mono: NG (differs from single-voice reference)\n");
+        return 1;
+    }
+    printf("check mono: OK (1 voice == reference, %d frames)\n", N);
+    return 0;
+}
+
+static int check_saturation(void)
+{
+    enum { N = 2048 };
+    static int16_t buf[N * 2];
+    hostapi_voices_t vs;
+    hostapi_voices_init(&vs, HOSTAPI_VOICE_MAX);
+    /* 同じ周波数・同位相で全声重ねる: 和は int16 を大きく超える */
+    for (int i = 0; i < HOSTAPI_VOICE_MAX; i++) hostapi_voices_start(&vs, RATE, 440, 100, 100, 100);
+    hostapi_voices_render(&vs, buf, N);
+    hostapi_voices_t one;
+    hostapi_voices_init(&one, 1);
+    hostapi_voices_start(&one, RATE, 440, 100, 100, 100);
+    static int16_t ref[N * 2];
+    hostapi_voices_render(&one, ref, N);
+    int clipped = 0;
+    for (int i = 0; i < N; i++) {
+        /* 飽和しても 1 声の符号と一致する(ラップすると反転する) */
+        if ((ref[i * 2] > 0 && buf[i * 2] < 0) || (ref[i * 2] < 0 && buf[i * 2] > 0)) {
+            printf("check saturation: NG (sign flip at frame %d)\n", i);
+            return 1;
+        }
+        if (buf[i * 2] == 32767 || buf[i * 2] == -32768) clipped++;
+    }
+    printf("check saturation: OK (%d voices in phase, %d/%d frames clipped)\n",
+           HOSTAPI_VOICE_MAX, clipped, N);
+    return 0;
+}
+
+static int check_steal(void)
+{
+    enum { N = 256 };
+    static int16_t buf[N * 2];
+    hostapi_voices_t vs;
+    hostapi_voices_init(&vs, 4);
+    for (int i = 0; i < 4; i++) {
+        hostapi_voices_start(&vs, RATE, (uint16_t)(300 + 100 * i), 100, 100, 98);
+        hostapi_voices_render(&vs, buf, N); /* 先に鳴らした声ほど減衰している */
+    }
+    const bool stolen = hostapi_voices_start(&vs, RATE, 2000, 50, 100, 98);
+    const bool ok = stolen && vs.active == 4 && vs.stolen == 1 &&
+                    vs.v[0].remaining == RATE * 50 / 1000;
+    printf("check steal: %s (oldest voice replaced, active %d)\n", ok ? "OK" : "NG",
+           vs.active);
+    return ok ? 0 : 1;
+}
+
+/* 1 声を描いて L チャンネルを out へ(キャッシュ有無で比べる) */
+static void render_one(hostapi_voices_t* vs, int16_t* out, int n, int volume)
+{
+    static int16_t st[RATE / 10 * 2];
+    hostapi_voices_start(vs, RATE, 1234, 100, 80, volume);
+    hostapi_voices_render(vs, st, n);
+    for (int i = 0; i < n; i++) out[i] = st[i * 2];
+}
+
+static int check_cache(void)
+{
+    enum { N = RATE / 10 };
+    static int16_t pcm[HOSTAPI_TCACHE_MAX_ENTRIES * HOSTAPI_TCACHE_ENTRY_FRAMES(RATE)];
+    static int16_t ref[N], got[N];
+    static const int kKernels[] = {HOSTAPI_OSC_FLOAT, HOSTAPI_OSC_Q31, HOSTAPI_OSC_Q31_SIMD};
+    int fail = 0;
+    for (size_t k = 0; k < sizeof(kKernels) / sizeof(kKernels[0]); k++) {
+        for (int volume = 98; volume <= 100; volume += 2) {
+            hostapi_tcache_t c;
+            hostapi_tcache_init(&c, pcm, HOSTAPI_TCACHE_MAX_ENTRIES, RATE);
+            hostapi_voices_t osc, cached;
+            hostapi_voices_init(&osc, 1);
+            hostapi_voices_set_kernel(&osc, kKernels[k]);
+            hostapi_voices_init(&cached, 1);
+            hostapi_voices_set_kernel(&cached, kKernels[k]);
+            hostapi_voices_set_cache(&cached, &c);
+            render_one(&osc, ref, N, volume);
+            render_one(&cached, got, N, volume); /* 1 回目: 描いてから再生 */
+            render_one(&cached, got, N, volume); /* 2 回目: 命中 */
+            int worst = 0;
+            for (int i = 0; i < N; i++) {
+                const int d = abs(ref[i] - got[i]);
+                if (d > worst) worst = d;
+            }
+            const int ok = worst <= 1 && c.renders == 1 && c.hits == 1 && cached.active == 0 &&
+                           c.e[0].users == 0;
+            printf("check cache %-5s vol %3d: %s (max diff %d LSB, %u render, %u hit)\n",
+                   hostapi_osc_name(cached.kernel), volume, ok ? "OK" : "NG", worst,
+                   (unsigned)c.renders, (unsigned)c.hits);
+            fail |= !ok;
+        }
+    }
+
+    /* 2 枠に 3 定義: 再生中の枠は上書きされず、3 つ目は発振で鳴る */
+    hostapi_tcache_t c;
+    hostapi_tcache_init(&c, pcm, 2, RATE);
+    hostapi_voices_t vs;
+    hostapi_voices_init(&vs, 4);
+    hostapi_voices_set_cache(&vs, &c);
+    hostapi_voices_start(&vs, RATE, 1000, 100, 100, 98);
+    hostapi_voices_start(&vs, RATE, 1500, 100, 100, 98);
+    hostapi_voices_start(&vs, RATE, 2000, 100, 100, 98);
+    const int ok_busy = vs.p[0].entry == 0 && vs.p[1].entry == 1 && vs.p[2].entry < 0 &&
+                        c.bypass == 1;
+    hostapi_voices_reset(&vs); /* 枠が空く: 最も古く使った枠(1000Hz)を入れ替える */
+    hostapi_voices_start(&vs, RATE, 1500, 100, 100, 98);
+    hostapi_voices_start(&vs, RATE, 2000, 100, 100, 98);
+    const int ok_lru = vs.p[1].entry == 0 && c.e[0].freq_hz == 2000 && c.e[1].users == 1;
+    printf("check cache eviction: %s (busy entries kept, LRU replaced)\n",
+           ok_busy && ok_lru ? "OK" : "NG");
+    fail |= !(ok_busy && ok_lru);
+    return fail;
+}
+
+/* 発音 1 回ぶん(voices_start + 最初のバッファ)と、声数別の描画を発振と比べる */
+static void bench_cache(int frames, int iters)
+{
+    static int16_t pcm[2 * HOSTAPI_TCACHE_ENTRY_FRAMES(RATE)]; /* 強拍・弱拍の 2 枠 */
+    int16_t* buf = malloc((size_t)frames * 4);
+    const double budget_us = frames * 1e6 / RATE;
+    hostapi_tcache_t c;
+    hostapi_tcache_init(&c, pcm, 2, RATE);
+    printf("\ntone cache, %d frames per buffer, %d iterations\n", frames, iters);
+    printf("trigger (start + first buffer)   us      %% of buffer\n");
+    static const char* const kPaths[] = {"oscillator", "cache hit", "cache miss (render)"};
+    for (int path = 0; path < 3; path++) {
+        hostapi_voices_t vs;
+        hostapi_voices_init(&vs, HOSTAPI_VOICE_DEFAULT);
+        if (path > 0) hostapi_voices_set_cache(&vs, &c);
+        double total = 0;
+        for (int it = 0; it < iters; it++) {
+            hostapi_voices_reset(&vs);
+            if (path == 2) hostapi_tcache_clear(&c);
+            if (path == 1) hostapi_voices_prepare(&vs, RATE, 1000, 30, 100);
+            const double t0 = now_us();
+            hostapi_voices_start(&vs, RATE, 1000, 30, 100, 98);
+            hostapi_voices_render(&vs, buf, frames);
+            total += now_us() - t0;
+        }
+        const double per = total / iters;
+        printf("%-30s %6.2f   %10.2f\n", kPaths[path], per, per * 100 / budget_us);
+    }
+    printf("voices   osc us/buffer   cached us/buffer   speedup\n");
+    static const int kCounts[] = {1, 2, 4, 8, 16};
+    for (size_t k = 0; k < sizeof(kCounts) / sizeof(kCounts[0]); k++) {
+        const int n = kCounts[k];
+        double per[2];
+        for (int cached = 0; cached < 2; cached++) {
+            hostapi_voices_t vs;
+            hostapi_voices_init(&vs, n);
+            if (cached) hostapi_voices_set_cache(&vs, &c);
+            double total = 0;
+            for (int it = 0; it < iters; it++) {
+                hostapi_voices_reset(&vs);
+                for (int i = 0; i < n; i++) {
+                    hostapi_voices_start(&vs, RATE, (uint16_t)(i % 2 ? 1000 : 1500), 100, 100,
+                                         98);
+                }
+                const double t0 = now_us();
+                hostapi_voices_render(&vs, buf, frames);
+                total += now_us() - t0;
+            }
+            per[cached] = total / iters;
+        }
+        printf("%6d   %13.2f   %16.2f   %6.2fx\n", n, per[0], per[1], per[0] / per[1]);
+    }
+    free(buf);
+}
+
+static void bench(int frames, int iters)
+{
+    int16_t* buf = malloc((size_t)frames * 4);
+    const double budget_us = frames * 1e6 / RATE;
+    printf("\nrender %d frames (%.1f ms of audio), %d iterations\n", frames, budget_us / 1000,
+           iters);
+    printf("voices   us/buffer   ns/frame   ns/voice-frame   %% of buffer\n");
+    static const int kCounts[] = {0, 1, 2, 4, 8, 12, 16};
+    for (size_t k = 0; k < sizeof(kCounts) / sizeof(kCounts[0]); k++) {
+        const int n = kCounts[k];
+        hostapi_voices_t vs;
+        hostapi_voices_init(&vs, n ? n : 1);
+        double total = 0;
+        for (int it = 0; it < iters; it++) {
+            /* 100ms トーンを毎回鳴らし直す(途中で鳴り終わらないように) */
+            hostapi_voices_reset(&vs);
+            for (int i = 0; i < n; i++) {
+                hostapi_voices_start(&vs, RATE, (uint16_t)(200 + 150 * i), 100, 100, 98);
+            }
+            const double t0 = now_us();
+            hostapi_voices_render(&vs, buf, frames);
+            total += now_us() - t0;
+        }
+        const double per_buf = total / iters;
+        printf("%6d   %9.2f   %8.2f   %14.2f   %10.2f\n", n, per_buf, per_buf * 1000 / frames,
+               n ? per_buf * 1000 / frames / n : 0.0, per_buf * 100 / budget_us);
+    }
+    free(buf);
+}
+
+int main(int argc, char** argv)
+{
+    const int iters = argc > 1 ? atoi(argv[1]) : 2000;
+    int fail = 0;
+    printf("kernel: %s\n", hostapi_osc_name(hostapi_osc_best()));
+    fail |= check_mono();
+    fail |= check_saturation();
+    fail |= check_steal();
+    fail |= check_cache();
+    bench(1024, iters); /* Linux: SDL コールバック 1 回 */
+    bench(240, iters);  /* 実機: DMA ディスクリプタ 1 本 */
+    bench_cache(1024, iters);
+    bench_cache(240, iters);
+    return fail;
+}
@@ -0,0 +1,154 @@
+/* 出力の取りこぼし検出と DAC 時刻の見積もり(shared/hostapi_xrun.h、ホストの
+ * --audio-buffer 時の統計)。
+ *
+ * デバイスを仮想時間で模す: バッファ k(period フレーム)はデバイスの
+ * クロック(壁時計に対して ±ppm のずれ)で T_k に要求され、手持ち(reserve)を
+ * 鳴らし切る T_k + reserve までに描けば間に合う。コールバックは要求から
+ * 揺れ(一様 0..jitter)ぶん遅れて呼ばれ、バースト型(quantum ごとにまとめて
+ * 要求するサーバ)では quantum の頭でまとめて呼ばれる。止め(stall)は
+ * その間のコールバックを止め、手持ちを超えたぶんデバイスが無音を出して
+ * 以後の要求がずれる(取りこぼし)。次を検証する(失敗で終了コード 1):
+ *   - 揺れ・クロックのずれ・バーストだけなら 0 回(60 秒)
+ *   - 手持ちに収まる止めは数えず、超える止めは 1 回ずつ数え、失った時間が
+ *     実際と 1 周期以内
+ *   - DAC 時刻の見積もりと実際の差(等間隔なら揺れ + 1 周期以内、バースト型は
+ *     quantum + 1 周期以内)
+ * コストは update 1 回。
+ *
+ *   ./build/bench/bench_xrun [秒数]
+ */
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "hostapi_xrun.h"
+
+#define RATE 44100
+
+static double now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static uint32_t s_rng = 777;
+static uint32_t rnd(void)
+{
+    s_rng = s_rng * 1664525u + 1013904223u;
+    return s_rng >> 8;
+}
+
+typedef struct {
+    const char* name;
+    int period;        /* コールバックのフレーム数 */
+    int reserve;       /* デバイスの手持ち(フレーム) */
+    int quantum;       /* 0 = 等間隔、それ以外はまとめて要求する単位(フレーム) */
+    int jitter_us;
+    double ppm;        /* デバイスのクロックのずれ */
+    int stalls;        /* 止めの回数(秒数に均等に散らす) */
+    int stall_us;
+    int expect_xruns;
+} scenario_t;
+
+static int run(const scenario_t* sc, double seconds)
+{
+    hostapi_xrun_t x;
+    hostapi_xrun_init(&x, RATE, (uint32_t)sc->period);
+    const double per_frame_us = 1e6 / RATE * (1.0 + sc->ppm * 1e-6);
+    const double reserve_us = sc->reserve * per_frame_us;
+    const double q_us = sc->quantum * per_frame_us;
+    const int64_t total = (int64_t)(seconds * RATE / sc->period);
+    const int64_t stall_every = sc->stalls ? total / (sc->stalls + 1) : 0;
+
+    double lost = 0;        /* 実際に失った時間(以後の要求がずれる) */
+    double last_call = -1e18;
+    double release = -1e18; /* 止めの明け */
+    double err_min = 1e18, err_max = -1e18;
+    double lost_err_max = 0;
+    int unconfirmed = 0;
+    int64_t next_stall = stall_every;
+    for (int64_t k = 0; k < total; k++) {
+        const uint64_t samples = (uint64_t)k * (uint64_t)sc->period;
+        const double t_req = 10000.0 + (double)samples * per_frame_us + lost;
+        double call = sc->quantum ? floor(t_req / q_us) * q_us : t_req;
+        call += (double)(rnd() % (uint32_t)(sc->jitter_us + 1));
+        if (stall_every && k == next_stall) {
+            release = call + sc->stall_us;
+            next_stall += stall_every;
+        }
+        if (call < release) call = release;
+        if (call < last_call) call = last_call + 2; /* 呼び出しは順に */
+        last_call = call;
+        /* 手持ちを鳴らし切るまでに描けなければ、そのぶん無音が入る */
+        double gap = 0;
+        if (call > t_req + reserve_us) {
+            gap = call - (t_req + reserve_us);
+            lost += gap;
+        }
+        if (gap > 0) unconfirmed = 1;
+        if (hostapi_xrun_update(&x, (int64_t)call, samples)) unconfirmed = 0;
+        /* このバッファの先頭が DAC から出る時刻: 要求 + 手持ち(無音ぶん後ろへ)。
+         * 取りこぼしから確定までの間(基準が古い)は見ない */
+        if (k * sc->period > RATE * 2 && !unconfirmed) {
+            const double dac = 10000.0 + (double)samples * per_frame_us + lost + reserve_us;
+            const double est =
+                (double)hostapi_xrun_dac_us(&x, samples, (uint32_t)reserve_us);
+            const double e = est - dac;
+            if (e < err_min) err_min = e;
+            if (e > err_max) err_max = e;
+        }
+    }
+    /* 失った時間の合計が実際と(回数 x 1 周期)以内 */
+    const double period_us = sc->period * 1e6 / RATE;
+    lost_err_max = fabs((double)x.lost_us - lost);
+    const int ok_count = (int)x.xruns == sc->expect_xruns;
+    const int ok_lost = lost_err_max <= period_us * (sc->expect_xruns + 1);
+    const double err_bound = sc->quantum ? q_us + period_us : sc->jitter_us + period_us;
+    const int ok_err = err_min >= -err_bound && err_max <= err_bound;
+    const int ok = ok_count && ok_lost && ok_err;
+    printf("check %-34s: %s (xruns %u/%d, lost %.1f ms vs %.1f ms, allow %.2f ms, "
+           "DAC estimate error %+.2f..%+.2f ms)\n",
+           sc->name, ok ? "OK" : "NG", (unsigned)x.xruns, sc->expect_xruns,
+           (double)x.lost_us / 1000, lost / 1000, (double)x.allow_us / 1000, err_min / 1000,
+           err_max / 1000);
+    return ok ? 0 : 1;
+}
+
+static void bench(void)
+{
+    hostapi_xrun_t x;
+    hostapi_xrun_init(&x, RATE, 128);
+    const int n = 10000000;
+    volatile uint32_t sink = 0;
+    const double t0 = now_us();
+    for (int k = 0; k < n; k++) {
+        sink += hostapi_xrun_update(&x, 1000 + (int64_t)k * 2902 + (rnd() & 255),
+                                    (uint64_t)k * 128);
+    }
+    const double ns = (now_us() - t0) * 1000 / n;
+    (void)sink;
+    printf("update %.2f ns/callback (%.5f%% of a 128-frame callback)\n", ns,
+           ns / (128 * 1e9 / RATE) * 100);
+}
+
+int main(int argc, char** argv)
+{
+    const double seconds = argc > 1 ? atof(argv[1]) : 60.0;
+    /* 手持ちはバックエンドの典型(ALSA: 2 周期) */
+    const scenario_t kCases[] = {
+        {"regular 128, jitter, +80ppm", 128, 256, 0, 400, 80, 0, 0, 0},
+        {"regular 128, jitter, -80ppm", 128, 256, 0, 400, -80, 0, 0, 0},
+        {"regular 64, jitter", 64, 128, 0, 300, 20, 0, 0, 0},
+        {"burst 128 in 1024 quanta", 128, 1024 + 256, 1024, 150, 50, 0, 0, 0},
+        {"regular 128, stalls within reserve", 128, 256, 0, 200, 30, 10, 4000, 0},
+        {"regular 128, stalls past reserve", 128, 256, 0, 200, 30, 10, 25000, 10},
+        {"regular 1024, stalls past reserve", 1024, 2048, 0, 500, 30, 5, 90000, 5},
+        {"burst 128 in 1024, stalls past reserve", 128, 1024 + 256, 1024, 150, 50, 5, 60000, 5},
+    };
+    int fail = 0;
+    for (size_t i = 0; i < sizeof(kCases) / sizeof(kCases[0]); i++) fail |= run(&kCases[i], seconds);
+    bench();
+    return fail;
+}
@@ -3,11 +3,17 @@
  *
  * 実機側 (src/components/wasm_runtime/hostapi.cpp) と同じ retained モデル:
  * (x,y) をキーに text / rect のスロットを保持し、同一座標への再描画は置き換え。
- * 毎 tick、host_sdl_render() が全スロットを描き直す(rect 群→text 群の順)。
+ * 毎 tick、host_sdl_render() が全スロットを描き直す(rect 群→line 群→text 群→
+ * widget 群の順)。折れ線/点列と widget は座標ではなく slot / id をキーにする
+ * (hostapi_defs.h の gfx / widget 参照)。widget の押下表示は tick を待たず、
+ * host_sdl_take_redraw() で main ループに再描画を要求する。
  *
  * テキストは font8x8 (public domain) の 8x8 ビットマップで描画。
  * クリック音は実機と同じ 1kHz 減衰サイン 30ms を SDL のキューへ書く。
  */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE /* pthread_setaffinity_np(--audio-rt) */
+#endif
 #include "hostapi_sdl.h"
 
 #include <SDL.h>
@@ -16,6 +22,9 @@
 #include <string.h>
 #include <stdlib.h>
 #include <dirent.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
 #include <sys/stat.h>
 
 #ifdef HAVE_SDL_TTF
@@ -26,9 +35,29 @@
 #include <SDL_mixer.h>
 #endif
 
+#if defined(HAVE_X11) && defined(SDL_VIDEO_DRIVER_X11)
+#include <SDL_syswm.h>
+#include <time.h>
+#define HOST_X11_INPUT_TIME 1
+#endif
+
 #include "font8x8_basic.h"
+#include "hostapi_aclock.h"
+#include "hostapi_acmd.h"
+#include "hostapi_capture.h"
 #include "hostapi_defs.h"
+#include "hostapi_evq.h"
+#include "hostapi_evrec.h"
+#include "hostapi_gesture.h"
+#include "hostapi_levels.h"
 #include "hostapi_midi.h"
+#include "hostapi_mix.h"
+#include "hostapi_mp3idx.h"
+#include "hostapi_playlist.h"
+#include "hostapi_sample.h"
+#include "hostapi_tsched.h"
+#include "hostapi_voice.h"
+#include "hostapi_xrun.h"
 
 /* 実機と同じランドスケープ 320x240 */
 #define SCREEN_W 320
@@ -38,7 +67,7 @@
 #define MAX_TEXT_SLOTS 16
 #define MAX_RECT_SLOTS 16
 #define MAX_TEXT_LEN 63
-#define EVENT_QUEUE_DEPTH 16
+#define EVENT_QUEUE_DEPTH HOSTAPI_EVQ_DEPTH
 
 typedef struct {
     bool used;
@@ -52,20 +81,70 @@ typedef struct {
     uint32_t rgb888;
 } RectSlot;
 
+/* 折れ線/点列スロット。点は SDL_Point に展開して保持し、描画は 1 回の
+ * SDL_RenderDrawLines / SDL_RenderDrawPoints で行う */
+typedef struct {
+    int n;           /* 点数(0=空) */
+    bool points;     /* true=点列(draw_points)、false=折れ線(draw_lines) */
+    uint32_t rgb888;
+    SDL_Point pts[HOSTAPI_LINE_MAX_POINTS];
+} LineSlot;
+
+/* ネイティブ部品 (hostapi_defs.h の widget)。配色は実機 hostapi.cpp と共通 */
+#define WIDGET_COLOR_BG 0x2a3340
+#define WIDGET_COLOR_PRESSED 0x4a6a90
+#define WIDGET_COLOR_ON 0x2f7d4f
+#define WIDGET_COLOR_FILL 0x3a7bd5
+
+typedef struct {
+    int kind;        /* HOSTAPI_WIDGET_*(0=未使用) */
+    int32_t x, y, w, h;
+    int value;
+    char label[MAX_TEXT_LEN + 1];
+} WidgetSlot;
+
+static WidgetSlot s_widgets[HOSTAPI_WIDGET_SLOTS];
+static int s_widget_active = -1;  /* 押下中の部品 id(-1=なし) */
+static bool s_widget_inside;      /* 押下中のポインタが部品内にあるか */
+static bool s_redraw;             /* tick を待たずに再描画が必要 */
+
 static SDL_Window* s_window;
 static SDL_Renderer* s_renderer;
 static SDL_AudioDeviceID s_audio;
 static uint32_t s_start_ms;
 
+/* 仮想時計(--replay --headless)。有効な間は now_ms とイベント時刻をこの値に
+ * 固定し、main ループが tick ごとに進める。音声はオフライン描画
+ * (host_sdl_audio_offline)にすれば同じ時計で進む */
+static bool s_clock_virtual;
+static uint32_t s_clock_virtual_ms;
+
+uint32_t host_sdl_now_ms(void)
+{
+    return s_clock_virtual ? s_clock_virtual_ms : SDL_GetTicks() - s_start_ms;
+}
+
+void host_sdl_set_virtual_clock(bool enable, uint32_t now_ms)
+{
+    s_clock_virtual = enable;
+    s_clock_virtual_ms = now_ms;
+}
+
 /* ---- クリック音のコールバックミキサ (Phase 7A) ----
  * v0 の SDL_QueueAudio(push 型)では発音タイミングがポーリング周期に縛られる
  * ため、クリック用デバイスをコールバック(pull)型に変更。再生済みフレーム数を
  * 音声クロックとして扱い、予約時刻(now_ms 時基)を目標サンプル位置に換算して
  * バッファ内オフセットでサンプル精度の発音を行う。
- * 共有状態は SDL_LockAudioDevice(コールバックは暗黙にロック保持)で保護。 */
+ * wasm スレッドとコールバックはロックを共有しない。発音・予約・音量・
+ * リセットはコマンドチャネル(shared/hostapi_acmd.h の SPSC リング)で送り、
+ * コールバックが先頭でまとめて適用する。戻り値(予約 id、取り消せたか)は
+ * wasm スレッド側の予約キューの写しで決め、コールバックからは「予約が
+ * キューを出た」通知を逆向きのリングで返して写しを揃える。コールバックは
+ * wasm スレッドを決して待たない(所要時間は終了時にヒストグラムで出す)。 */
 #define CLICK_RATE 44100
 
-/* トーンパレット (Phase 7C)。アプリセッション状態(audio_reset で初期化) */
+/* トーンパレット (Phase 7C)。アプリセッション状態(audio_reset で初期化)。
+ * wasm スレッド専有(コールバックへは予約・発音時のスナップショットを送る) */
 typedef struct {
     bool defined;
     uint16_t freq_hz;
@@ -75,36 +154,305 @@ typedef struct {
 static ToneDef s_tones[HOSTAPI_TONE_SLOTS];
 static const ToneDef kDefaultClick = {true, 1000, 30, 100};
 
-/* 発音中のボイス(キャッシュレス合成: 再帰振動子)。単声(v2 契約) */
-typedef struct {
-    int remaining;      /* 残りフレーム(0=idle) */
-    float s, c;         /* sin/cos の回転状態 */
-    float cw, sw;       /* 回転係数 */
-    float decay, amp;
-} Voice;
-static Voice s_voice;
+/* 発音中のボイス(shared/hostapi_voice.h のポリフォニーエンジン)。
+ * 実機と同じ声数・奪い方で重ねて鳴らす */
+static hostapi_voices_t s_voices;
+
+/* レンダ済みトーン(shared/hostapi_tcache.h)。パレットの全スロットぶん。
+ * tone_define の時点で描き(PREPARE コマンドでコールバックが描く)、発音は
+ * PCM の音量倍だけにする。
+ * 中身は定義だけで決まるのでアプリを跨いで使い回す */
+static hostapi_tcache_t s_tone_cache;
+static int16_t
+    s_tone_cache_pcm[HOSTAPI_TCACHE_MAX_ENTRIES * HOSTAPI_TCACHE_ENTRY_FRAMES(CLICK_RATE)];
+
+/* サンプル(shared/hostapi_sample.h)。キャッシュは hostapi_sample_load が
+ * デコードして積み(ロック外。公開は count の release)、発音中の声は
+ * コールバックだけが触る。アリーナは起動時に 1 回確保(実機の既定と同じ量) */
+#define SAMPLE_CACHE_BYTES (1024u * 1024u)
+static hostapi_sample_cache_t s_samples;
+static hostapi_splayer_t s_splayer;
+
+/* 持続音(shared/hostapi_note.h)。コールバック専有で、出力ミキサがトーンと
+ * 同じバスに混ぜる。エンベロープの定義もコマンドで送ってコールバック側に持つ */
+static hostapi_notes_t s_notes;
+
+/* 出力ミキサ(shared/hostapi_mix.h、実機と共通)。MP3 は SDL_mixer の
+ * デバイスでデコードさせ、その出力をポストミックスで横取りして
+ * (SDL_mixer 側は無音にする)このデバイスでトーンと混ぜる。実機と同じく
+ * 44.1kHz 1 本にまとめ、ソース別ゲインとリミッタを通す。
+ * 2 デバイス間は SPSC リング(下記)で受け渡す。 */
+static hostapi_mix_t s_mix;
+static bool s_music_routed;        /* SDL_mixer の出力をミキサ経由にしているか(atomic) */
+#define MUSIC_RING_FRAMES 8192     /* 2 のべき乗(~186ms) */
+#define MUSIC_PRIME_FRAMES 2048    /* 空から再開するとき溜める量(コールバック 2 回ぶん) */
+#define MUSIC_PIECE_FRAMES 1024
+static int16_t s_music_ring[MUSIC_RING_FRAMES * 2];
+static uint32_t s_music_head;      /* 消費側(オーディオコールバック)だけが進める */
+static uint32_t s_music_tail;      /* 生産側(SDL_mixer のスレッド)だけが進める */
+static bool s_music_primed;        /* 消費側のみ */
+static uint32_t s_music_underruns; /* 足りずに無音を挟んだ回数(消費側) */
+static int s_music_flush;          /* main → 消費側: head を flush_to へ飛ばす(シーク、atomic) */
+static uint32_t s_music_flush_to;
+/* 開始時刻の指定(hostapi_audio_play_at)。main が gen << 32 | time_ms を置き、
+ * 消費側はその時刻の音声クロック上のフレームまで音楽を取り出さない(その間に
+ * リングに溜まった分が開始時のプライム)。過ぎたら同じ値を gate_open に返す。
+ * 0 = 指定なし(どちらも atomic) */
+static uint64_t s_music_gate;
+static uint64_t s_music_gate_open;
+#ifdef HAVE_SDL_MIXER
+static hostapi_resamp_t s_music_resamp; /* SDL_mixer の出力レート → 44.1kHz */
+static uint32_t s_music_overruns;  /* リング満杯で捨てた回数(生産側) */
+
+/* 生産側。44.1kHz ステレオを積む。入りきらない分は捨てる */
+static void music_ring_push(const int16_t* st, int frames)
+{
+    const uint32_t head = __atomic_load_n(&s_music_head, __ATOMIC_ACQUIRE);
+    const uint32_t tail = s_music_tail;
+    const uint32_t space = MUSIC_RING_FRAMES - (tail - head);
+    if ((uint32_t)frames > space) {
+        s_music_overruns++;
+        frames = (int)space;
+    }
+    for (int i = 0; i < frames; i++) {
+        const uint32_t k = (tail + (uint32_t)i) & (MUSIC_RING_FRAMES - 1);
+        s_music_ring[k * 2] = st[i * 2];
+        s_music_ring[k * 2 + 1] = st[i * 2 + 1];
+    }
+    __atomic_store_n(&s_music_tail, tail + (uint32_t)frames, __ATOMIC_RELEASE);
+}
+#endif
+
+/* 消費側。シーク・開始時刻待ちの前にデコードした分を捨て、溜まり直すのを待つ */
+static void music_ring_flush(void)
+{
+    if (!__atomic_load_n(&s_music_flush, __ATOMIC_ACQUIRE)) return;
+    if ((int32_t)(s_music_flush_to - s_music_head) > 0) {
+        __atomic_store_n(&s_music_head, s_music_flush_to, __ATOMIC_RELEASE);
+    }
+    s_music_primed = false;
+    __atomic_store_n(&s_music_flush, 0, __ATOMIC_RELEASE);
+}
+
+/* 消費側。frames フレーム取り出す(足りなければ残りは 0)。空から再開するときは
+ * MUSIC_PRIME_FRAMES 溜まるまで待つ(false = 音楽なし) */
+static bool music_ring_pop(int16_t* out, int frames)
+{
+    music_ring_flush();
+    const uint32_t tail = __atomic_load_n(&s_music_tail, __ATOMIC_ACQUIRE);
+    const uint32_t head = s_music_head;
+    uint32_t avail = tail - head;
+    if (!s_music_primed) {
+        if (avail < MUSIC_PRIME_FRAMES) return false;
+        s_music_primed = true;
+    }
+    if (avail < (uint32_t)frames) {
+        s_music_underruns++;
+        s_music_primed = false;
+        memset(out + avail * 2, 0, (size_t)(frames - (int)avail) * 4);
+    } else {
+        avail = (uint32_t)frames;
+    }
+    for (uint32_t i = 0; i < avail; i++) {
+        const uint32_t k = (head + i) & (MUSIC_RING_FRAMES - 1);
+        out[i * 2] = s_music_ring[k * 2];
+        out[i * 2 + 1] = s_music_ring[k * 2 + 1];
+    }
+    __atomic_store_n(&s_music_head, head + avail, __ATOMIC_RELEASE);
+    return true;
+}
 
+static uint64_t click_ms_to_sample(uint32_t ms);
+
+/* 消費側。音声クロック上のフレーム at から n フレーム描くとき、開始時刻待ちで
+ * 音楽を出さないなら true(開始がこの範囲に入るなら n をそこまでに縮める)。
+ * 開始したら、待つ間に溜まった分をプライム済みとしてそのフレームから鳴らす */
+static bool music_gated(uint64_t at, int* n)
+{
+    const uint64_t g = __atomic_load_n(&s_music_gate, __ATOMIC_ACQUIRE);
+    if (g == 0 || g == __atomic_load_n(&s_music_gate_open, __ATOMIC_RELAXED)) return false;
+    music_ring_flush(); /* 前の曲の残りはすぐ捨てる(溜めるのは新しい曲だけ) */
+    const uint64_t start = click_ms_to_sample((uint32_t)g);
+    if (at < start) {
+        if (start - at < (uint64_t)*n) *n = (int)(start - at);
+        return true;
+    }
+    if (at == start) s_music_primed = true; /* 遅れて開いたときは通常のプライム待ち */
+    __atomic_store_n(&s_music_gate_open, g, __ATOMIC_RELEASE);
+    return false;
+}
+
+/* out へ frames フレーム描く: MP3 とトーンの全声を出力ミキサで混ぜる。
+ * at は out 先頭の音声クロック上のフレーム */
+static void mix_render(int16_t* out, int frames, uint64_t at)
+{
+    int16_t music[MUSIC_PIECE_FRAMES * 2];
+    while (frames > 0) {
+        int n = frames < MUSIC_PIECE_FRAMES ? frames : MUSIC_PIECE_FRAMES;
+        const bool has_music = __atomic_load_n(&s_music_routed, __ATOMIC_ACQUIRE) &&
+                               !music_gated(at, &n) && music_ring_pop(music, n);
+        hostapi_mix_render(&s_mix, has_music ? music : NULL, &s_voices, &s_splayer, out, n);
+        out += n * 2;
+        frames -= n;
+        at += (uint64_t)n;
+    }
+}
+
+/* 以下 s_cb_hist まではコールバック専有(wasm スレッドはコマンドで頼む) */
 static uint64_t s_audio_samples;   /* 再生済みフレーム数(音声クロック) */
 static uint32_t s_audio_epoch_ms;  /* サンプル 0 に対応する now_ms */
 static bool s_audio_epoch_set;     /* エポックは最初のコールバックで確定する */
-static uint32_t s_click_pending;   /* 予約時刻(0=なし) */
-static ToneDef s_pending_tone;     /* 予約時のスナップショット */
-static uint32_t s_click_last_fired;
-static bool s_click_asap;          /* 即時発音要求: 次のバッファ先頭で発音 */
-static ToneDef s_asap_tone;
+static hostapi_tsched_t s_tsched;  /* 予約(tone_schedule 1 件 + tone_enqueue) */
+static uint32_t s_click_last_fired; /* tone_schedule の最後に発音した予約時刻 */
+/* 即時発音要求: 次のバッファ先頭でまとめて発音(和音は同じ tick の複数要求)。
+ * 予約と同じ形(トーン定義のスナップショットかサンプルのハンドル)で持つ */
+static hostapi_tsched_entry_t s_asap[HOSTAPI_VOICE_MAX + HOSTAPI_SAMPLE_VOICES +
+                                    2 * HOSTAPI_NOTE_CHANNELS];
+static int s_asap_count;
 static int s_master_vol = 98;      /* マスター音量(実機の既定と一致) */
+static hostapi_lathist_t s_cb_hist; /* コールバックの所要時間(終了時に表示) */
+static hostapi_xrun_t s_xrun;         /* 取りこぼしの検出と DAC 時刻の見積もり */
+static hostapi_xrun_lat_t s_sched_lat; /* 予約 → DAC の遅れ(ジッタ統計ごとに表示) */
+static hostapi_xrun_lat_t s_sched_lat_all; /* 同(終了時に表示) */
+static hostapi_aclock_t s_aclock;     /* 描画位置と now_us64 の対応(wasm スレッドが読む) */
+
+/* コマンドチャネル。s_acmd は wasm スレッドが積みコールバックが取る。
+ * s_acmd_gone はその逆(予約がキューを出た通知) */
+static hostapi_acmd_ring_t s_acmd;
+static hostapi_acmd_ring_t s_acmd_gone;
+
+/* 予約・即時発音要求から 1 声発音する(ノートは on / off)。マスター音量は
+ * 発音時に焼き込む */
+static void voice_start_entry(const hostapi_tsched_entry_t* e)
+{
+    if (e->note == HOSTAPI_TSCHED_NOTE_ON) {
+        hostapi_notes_on(&s_notes, e->note_ch, e->note_env, e->freq_hz, e->level, s_master_vol);
+        return;
+    }
+    if (e->note == HOSTAPI_TSCHED_NOTE_OFF) {
+        hostapi_notes_off(&s_notes, e->note_ch);
+        return;
+    }
+    if (e->sample >= 0) {
+        const hostapi_sample_t* smp = hostapi_sample_get(&s_samples, e->sample);
+        if (smp) hostapi_splayer_start(&s_splayer, smp, e->level, s_master_vol);
+        return;
+    }
+    hostapi_voices_start(&s_voices, CLICK_RATE, e->freq_hz, e->dur_ms, e->level,
+                         s_master_vol);
+}
+
+/* 即時発音要求を積む(コールバック内)。あふれた分は捨てる */
+static void asap_push(const hostapi_tsched_entry_t* e)
+{
+    if (s_asap_count < (int)(sizeof(s_asap) / sizeof(s_asap[0]))) s_asap[s_asap_count++] = *e;
+}
+
+/* ---- 出力のキャプチャ(--wav。形式は shared/hostapi_capture.h) ----
+ * コールバックは描いた出力をそのまま SPSC リングへ積むだけで、WAV への
+ * 書き出しは main スレッド(host_sdl_capture_pump)が行う。リングが満杯なら
+ * 捨てて数える(その WAV は位置がずれるので解析に使えない)。発音記録は
+ * wasm スレッドが書く(予約の発火は「キューを出た」通知から) */
+#define CAPTURE_RING_FRAMES 65536  /* 2 のべき乗(~1.5s) */
+static int16_t s_cap_ring[CAPTURE_RING_FRAMES * 2];
+static uint32_t s_cap_head;        /* main スレッドだけが進める */
+static uint32_t s_cap_tail;        /* コールバックだけが進める */
+static bool s_cap_on;              /* atomic。立てるのは main スレッド */
+static bool s_cap_started;         /* 以下 2 つはコールバック専有 */
+static uint64_t s_cap_base;        /* WAV の先頭に当たる音声クロック */
+static uint32_t s_cap_dropped;     /* リング満杯で捨てたフレーム(コールバック) */
+static FILE* s_cap_wav;            /* 以下は main スレッド */
+static FILE* s_cap_log;
+static uint32_t s_cap_frames;
+
+/* 出力のレベル(hostapi_audio_get_levels、shared/hostapi_levels.h)。
+ * コールバックがピーク・RMS と直近の窓を公開し、FFT は読む側(wasm スレッド)が
+ * 新しい窓ごとに 1 回だけ行う */
+static hostapi_levels_t s_levels;         /* 書くのはコールバックだけ */
+static hostapi_levels_fft_t s_levels_fft; /* wasm スレッドのみ */
+static bool s_levels_fft_ready;
+
+/* コールバック内。out(ステレオ frames フレーム、先頭は音声クロック buf_start) */
+static void capture_push(const int16_t* out, int frames, uint64_t buf_start)
+{
+    if (!__atomic_load_n(&s_cap_on, __ATOMIC_ACQUIRE)) return;
+    if (!s_cap_started) {
+        s_cap_base = buf_start;
+        s_cap_started = true;
+    }
+    const uint32_t head = __atomic_load_n(&s_cap_head, __ATOMIC_ACQUIRE);
+    const uint32_t tail = s_cap_tail;
+    if ((uint32_t)frames > CAPTURE_RING_FRAMES - (tail - head)) {
+        s_cap_dropped += (uint32_t)frames;
+        return;
+    }
+    for (int i = 0; i < frames; i++) {
+        const uint32_t k = (tail + (uint32_t)i) & (CAPTURE_RING_FRAMES - 1);
+        s_cap_ring[k * 2] = out[i * 2];
+        s_cap_ring[k * 2 + 1] = out[i * 2 + 1];
+    }
+    __atomic_store_n(&s_cap_tail, tail + (uint32_t)frames, __ATOMIC_RELEASE);
+}
+
+/* 発音記録を 1 行(wasm スレッド) */
+static void capture_log(int kind, const hostapi_tsched_entry_t* e, uint32_t time_ms)
+{
+    if (!s_cap_log || e->note == HOSTAPI_TSCHED_NOTE_OFF) return; /* 立ち上がりは無い */
+    hostapi_capture_rec_t r;
+    r.kind = kind;
+    r.time_ms = time_ms;
+    r.id = e->id;
+    r.sample = e->sample >= 0;
+    r.param = e->sample >= 0 ? e->sample : e->freq_hz;
+    hostapi_capture_write_rec(s_cap_log, &r);
+}
+
+/* ---- wasm スレッド側 ----
+ * 予約キューの写し。コールバックの s_tsched と同じ操作列を先に適用して、
+ * 予約 id・満杯・取り消せたかをその場で返す。発火・不受理の通知で追いつく */
+static hostapi_tsched_t s_tsched_ui;
+static uint32_t s_ui_last_fired;   /* 写し側の last_fired */
+static uint32_t s_ui_epoch_seq;    /* 直近のリセット時の seq(それより前の通知は無視) */
+
+/* コールバックへ送る。満杯なら false(呼び出し側は -1 を返すか諦める) */
+static bool acmd_send(int32_t kind, int32_t arg, const hostapi_tsched_entry_t* e)
+{
+    hostapi_acmd_t c;
+    memset(&c, 0, sizeof(c));
+    c.kind = kind;
+    c.arg = arg;
+    if (e) c.e = *e;
+    return hostapi_acmd_push(&s_acmd, &c);
+}
+
+/* 取りこぼせない要求(取り消し・音量・リセット・エンベロープ定義)。待つのは
+ * wasm スレッドの側だけで、コールバックが止まっていても 100ms で諦める */
+static bool acmd_send_entry_wait(int32_t kind, int32_t arg, const hostapi_tsched_entry_t* e)
+{
+    for (int i = 0; i < 100; i++) {
+        if (acmd_send(kind, arg, e)) return true;
+        SDL_Delay(1);
+    }
+    fprintf(stderr, "audio: command %d dropped (callback not running?)\n", (int)kind);
+    return false;
+}
 
-/* ボイスをトーン定義から初期化(発音開始)。マスター音量は発音時に焼き込む */
-static void voice_start(const ToneDef* t)
+static void acmd_send_wait(int32_t kind, int32_t arg)
 {
-    const float w = 2.0f * (float)M_PI * (float)t->freq_hz / CLICK_RATE;
-    s_voice.remaining = CLICK_RATE * t->dur_ms / 1000;
-    s_voice.s = 0.0f;
-    s_voice.c = 1.0f;
-    s_voice.cw = cosf(w);
-    s_voice.sw = sinf(w);
-    s_voice.decay = expf(-3.5f / (float)s_voice.remaining); /* 終端で ~-30dB */
-    s_voice.amp = 12000.0f * t->level / 100.0f * s_master_vol / 100.0f;
+    (void)acmd_send_entry_wait(kind, arg, NULL);
+}
+
+/* コールバックからの「キューを出た」通知で写しを揃える。各 API の先頭で呼ぶ */
+static void acmd_sync(void)
+{
+    hostapi_acmd_t c;
+    while (hostapi_acmd_pop(&s_acmd_gone, &c)) {
+        const uint32_t time_ms = hostapi_tsched_time_ms(&c.e);
+        if (c.arg) capture_log(HOSTAPI_CAPTURE_FIRE, &c.e, time_ms);
+        if ((int32_t)(c.e.seq - s_ui_epoch_seq) < 0) continue; /* リセット前の予約 */
+        hostapi_tsched_remove_seq(&s_tsched_ui, c.e.seq);
+        if (c.arg && c.e.id == 0 && time_ms > s_ui_last_fired) s_ui_last_fired = time_ms;
+    }
 }
 
 /* ジッタ統計: 発音開始位置(音声クロック)と壁時計を N 発ごとに集計 */
@@ -140,6 +488,16 @@ static void click_record_fire(uint64_t sample)
         fprintf(stderr,
                 "click jitter (wall clock)  : min=%u avg=%.1f max=%u ms (n=%d)\n",
                 wmin, (double)wsum / (CLICK_STAT_N - 1), wmax, CLICK_STAT_N - 1);
+        if (s_sched_lat.count > 0) {
+            fprintf(stderr,
+                    "click sched->DAC (est.)    : min=%+.1f avg=%+.1f max=%+.1f ms (n=%u), "
+                    "xruns %u\n",
+                    s_sched_lat.min_us / 1000.0,
+                    (double)s_sched_lat.sum_us / s_sched_lat.count / 1000.0,
+                    s_sched_lat.max_us / 1000.0, (unsigned)s_sched_lat.count,
+                    (unsigned)s_xrun.xruns);
+            hostapi_xrun_lat_reset(&s_sched_lat);
+        }
         s_fire_count = 0;
     }
 }
@@ -147,71 +505,326 @@ static void click_record_fire(uint64_t sample)
 /* now_ms → 音声クロック上の目標フレーム */
 static uint64_t click_ms_to_sample(uint32_t ms)
 {
-    if (ms <= s_audio_epoch_ms) return 0;
-    return (uint64_t)(ms - s_audio_epoch_ms) * CLICK_RATE / 1000;
+    return hostapi_capture_ms_to_sample(ms, s_audio_epoch_ms, CLICK_RATE);
+}
+
+/* オフライン描画(host_sdl_audio_offline)。デバイスを止め、main スレッドが
+ * 仮想時計に合わせてコールバックを直接呼ぶ */
+static bool s_audio_offline;
+static int s_audio_buf_frames = 1024; /* コールバック 1 回ぶん(デバイスに合わせる) */
+
+/* デバイスの設定(host_sdl_audio_config、host_sdl_init 前)。既定は余裕を見た
+ * 1024 フレーム(~23ms)で、--audio-buffer で 64 まで下げられる */
+#define AUDIO_BUF_DEFAULT 1024
+#define AUDIO_BUF_MIN 64
+#define AUDIO_BUF_MAX 4096
+static int s_audio_want_frames = AUDIO_BUF_DEFAULT;
+static bool s_audio_rt;
+/* 要求されてから DAC から出るまでの見込み(デバイスの手持ち。SDL からは
+ * 取れないので ALSA/PulseAudio の既定の 2 周期とみる) */
+#define AUDIO_OUT_PERIODS 2
+static uint32_t s_audio_out_us;
+static Uint64 s_perf_origin; /* s_start_ms に当たるパフォーマンスカウンタ */
+
+/* --audio-rt: コールバックのスレッド(SDL のオーディオスレッド)を SCHED_FIFO に
+ * して、許された CPU の最後の 1 つへ固定する。最初のコールバックで 1 回だけ。
+ * 結果は main スレッドが host_sdl_audio_pump で表示する */
+#define AUDIO_RT_PRIORITY 70
+static int s_audio_rt_err = -1; /* -1 = 未、0 = 成功、それ以外は errno(atomic) */
+static int s_audio_rt_cpu = -1;
+
+static void audio_thread_realtime(void)
+{
+    struct sched_param sp;
+    memset(&sp, 0, sizeof(sp));
+    sp.sched_priority = AUDIO_RT_PRIORITY;
+    if (sp.sched_priority > sched_get_priority_max(SCHED_FIFO)) {
+        sp.sched_priority = sched_get_priority_max(SCHED_FIFO);
+    }
+    int err = pthread_setschedparam(pthread_self(), SCHED_FIFO, &sp);
+    cpu_set_t set;
+    if (pthread_getaffinity_np(pthread_self(), sizeof(set), &set) == 0) {
+        for (int c = CPU_SETSIZE - 1; c >= 0; c--) {
+            if (!CPU_ISSET(c, &set)) continue;
+            CPU_ZERO(&set);
+            CPU_SET(c, &set);
+            if (pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0) {
+                s_audio_rt_cpu = c;
+            }
+            break;
+        }
+    }
+    __atomic_store_n(&s_audio_rt_err, err, __ATOMIC_RELEASE);
+}
+
+/* パフォーマンスカウンタ → now_ms と同じ時基の µs */
+static int64_t audio_perf_us(Uint64 t)
+{
+    const Uint64 freq = SDL_GetPerformanceFrequency();
+    const Uint64 d = t - s_perf_origin;
+    return (int64_t)(d / freq * 1000000 + d % freq * 1000000 / freq);
+}
+
+/* コールバックから見た壁時計。オフラインでは音声クロックそのもの */
+static uint32_t audio_wall_ms(uint64_t sample)
+{
+    if (s_audio_offline) return s_audio_epoch_ms + (uint32_t)(sample * 1000 / CLICK_RATE);
+    return SDL_GetTicks() - s_start_ms;
+}
+
+/* 予約 e がキューを出たことを wasm スレッドの写しへ知らせる。通知は写しに
+ * ある予約 1 件につき 1 件で、写しは積む前とリセットの前に acmd_sync で
+ * 通知を取り込む。溜まる通知はリセット前の残り(本体のキュー 1 杯)と
+ * 写し 1 杯の和までで、リングは満杯にならない(下の assert)。満杯を
+ * 待たないのはコールバックを止めないためで、もし落とすと写しに残った
+ * 予約はリセットまで消えない */
+_Static_assert(2 * HOSTAPI_TSCHED_CAP < HOSTAPI_ACMD_DEPTH,
+               "gone ring must hold every pending reservation notification");
+static void acmd_gone(const hostapi_tsched_entry_t* e, bool fired)
+{
+    hostapi_acmd_t c;
+    c.kind = HOSTAPI_ACMD_GONE;
+    c.arg = fired;
+    c.e = *e;
+    hostapi_acmd_push(&s_acmd_gone, &c);
+}
+
+/* wasm スレッドからのコマンドを 1 件適用する(コールバック内) */
+static void acmd_apply(const hostapi_acmd_t* c)
+{
+    switch (c->kind) {
+    case HOSTAPI_ACMD_PLAY:
+        asap_push(&c->e);
+        break;
+    case HOSTAPI_ACMD_INSERT:
+        s_tsched.seq = c->e.seq; /* 写しと同じ seq で積む */
+        if (!hostapi_tsched_insert(&s_tsched, &c->e)) acmd_gone(&c->e, false);
+        break;
+    case HOSTAPI_ACMD_SET_LEGACY: {
+        /* 写しと同じ判定をここでもう一度する(写しが知らない間に発火していれば
+         * こちらが正しい)。置き換えガードで旧予約を発音扱いにするのもここ */
+        hostapi_tsched_entry_t old;
+        bool fire_old;
+        s_tsched.seq = c->e.seq;
+        if (!hostapi_tsched_set_legacy(&s_tsched, hostapi_tsched_time_ms(&c->e),
+                                       (uint32_t)c->arg, &s_click_last_fired, c->e.freq_hz,
+                                       c->e.dur_ms, c->e.level, &old, &fire_old)) {
+            acmd_gone(&c->e, false);
+        }
+        if (fire_old) {
+            asap_push(&old);
+            acmd_gone(&old, true);
+            /* 新しい予約の staging より後 */
+            host_midi_notify_beat_fired(hostapi_tsched_time_ms(&old));
+        }
+        break;
+    }
+    case HOSTAPI_ACMD_CANCEL_LEGACY:
+        hostapi_tsched_cancel_legacy(&s_tsched);
+        break;
+    case HOSTAPI_ACMD_REMOVE_ID:
+        hostapi_tsched_remove_id(&s_tsched, c->arg);
+        break;
+    case HOSTAPI_ACMD_CLEAR:
+        hostapi_tsched_clear(&s_tsched); /* last_fired は保つ */
+        break;
+    case HOSTAPI_ACMD_VOLUME:
+        s_master_vol = c->arg;
+        hostapi_mix_set_gain(&s_mix, HOSTAPI_MIX_MUSIC, c->arg); /* MP3 は即時 */
+        break;
+    case HOSTAPI_ACMD_PREPARE:
+        hostapi_voices_prepare(&s_voices, CLICK_RATE, c->e.freq_hz, c->e.dur_ms, c->e.level);
+        break;
+    case HOSTAPI_ACMD_NOTE_ENV: {
+        const hostapi_note_env_t env = {c->e.freq_hz, c->e.dur_ms, c->e.level,
+                                        (uint16_t)c->arg};
+        hostapi_notes_define(&s_notes, c->e.note_env, &env);
+        break;
+    }
+    case HOSTAPI_ACMD_RESET:
+        hostapi_tsched_reset(&s_tsched);
+        s_click_last_fired = 0;
+        s_asap_count = 0;
+        hostapi_voices_reset(&s_voices);
+        hostapi_splayer_reset(&s_splayer);
+        hostapi_notes_reset(&s_notes);
+        s_fire_count = 0;
+        s_master_vol = 98;
+        hostapi_mix_set_gain(&s_mix, HOSTAPI_MIX_MUSIC, s_master_vol);
+        break;
+    default:
+        break;
+    }
 }
 
 /* SDL オーディオスレッドから呼ばれる。stream は 16bit ステレオ */
 static void audio_callback(void* userdata, Uint8* stream, int len)
 {
     (void)userdata;
-    memset(stream, 0, len);
+    const Uint64 t_enter = SDL_GetPerformanceCounter();
     int16_t* out = (int16_t*)stream;
     const int frames = len / 4;
     const uint64_t buf_start = s_audio_samples;
+    /* 取りこぼしの検出(オフラインでは起こらない)。描いたフレーム数と入口の
+     * 時刻のずれを見る */
+    if (!s_audio_offline) {
+        if (s_audio_rt && s_audio_rt_err < 0) audio_thread_realtime();
+        hostapi_xrun_update(&s_xrun, audio_perf_us(t_enter), buf_start);
+    }
+
+    /* wasm スレッドからの要求を先に全部適用する(待たない) */
+    hostapi_acmd_t cmd;
+    while (hostapi_acmd_pop(&s_acmd, &cmd)) acmd_apply(&cmd);
 
     /* エポックは最初のコールバックで確定する。pull 型のコールバックは実再生より
      * バッファ深さぶん先行して呼ばれるため、これで音声クロックが壁時計より
      * わずかに先行し、「壁時計上は拍を過ぎたが未発火」の窓(アプリの毎 tick
      * 再予約が未発火の予約を置き換えて拍を落とす競合)が生じない。 */
     if (!s_audio_epoch_set) {
-        s_audio_epoch_ms = SDL_GetTicks() - s_start_ms;
+        s_audio_epoch_ms = s_audio_offline ? host_sdl_now_ms() : SDL_GetTicks() - s_start_ms;
         s_audio_epoch_set = true;
     }
 
-    /* 発火判定: 目標サンプルがこのバッファに入ったらオフセット付きで開始 */
-    int start_off = -1;
-    const ToneDef* start_tone = NULL;
-    if (s_click_asap) {
-        s_click_asap = false;
-        start_off = 0;
-        start_tone = &s_asap_tone;
+    /* 即時発音はバッファ先頭で */
+    if (s_asap_count > 0) {
+        for (int i = 0; i < s_asap_count; i++) voice_start_entry(&s_asap[i]);
+        s_asap_count = 0;
         click_record_fire(buf_start);
-    } else if (s_click_pending != 0 && s_click_pending > s_click_last_fired) {
-        uint64_t target = click_ms_to_sample(s_click_pending);
+    }
+
+    /* 発火判定: 目標サンプルがこのバッファに入った予約を時刻順に取り出し、
+     * その位置までを描いてから発音する(サンプル精度。同じバッファに何件でも) */
+    const uint64_t buf_end = buf_start + (uint64_t)frames;
+    const uint32_t wall_now = audio_wall_ms(buf_start);
+    int done = 0; /* 描画済みフレーム */
+    const hostapi_tsched_entry_t* top;
+    const int64_t epoch_us = (int64_t)s_audio_epoch_ms * 1000;
+    while ((top = hostapi_tsched_top(&s_tsched)) != NULL) {
+        uint64_t target =
+            hostapi_aclock_us_to_sample(hostapi_tsched_time_us(top), epoch_us, CLICK_RATE);
         if (target < buf_start) target = buf_start; /* 過ぎた予約は直ちに */
         /* セーフティネット: 音声バックエンドのコールバックがバースト的に遅れて
          * サンプルクロックが壁時計より遅れた場合でも、壁時計で期限が来た予約は
          * このバッファで発音する(未発火のまま再予約に置き換えられて拍が落ちる
-         * のを防ぐ)。通常はサンプル精度の経路が先に発火する。 */
-        const uint32_t wall_now = SDL_GetTicks() - s_start_ms;
-        const bool wall_due = (s_click_pending <= wall_now);
-        if (target < buf_start + (uint64_t)frames || wall_due) {
-            if (target >= buf_start + (uint64_t)frames) target = buf_start;
-            start_off = (int)(target - buf_start);
-            start_tone = &s_pending_tone;
-            s_click_last_fired = s_click_pending;
-            s_click_pending = 0;
-            click_record_fire(target);
+         * のを防ぐ)。通常はサンプル精度の経路が先に発火する。µs の予約は
+         * 音声クロックの時基なので壁時計では発火させない */
+        const bool wall_due = !top->aclock && hostapi_tsched_time_ms(top) <= wall_now;
+        if (target >= buf_end && !wall_due) break;
+        int off = target < buf_end ? (int)(target - buf_start) : 0;
+        if (off < done) off = done;
+        if (off > done) {
+            mix_render(out + done * 2, off - done, buf_start + (uint64_t)done);
+            done = off;
+        }
+        const hostapi_tsched_entry_t e = hostapi_tsched_pop(&s_tsched);
+        voice_start_entry(&e);
+        acmd_gone(&e, true);
+        if (!s_audio_offline && s_xrun.started) {
+            /* 予約の時刻に対して DAC から出る時刻(見積もり)の遅れ */
+            const int64_t late = hostapi_xrun_dac_us(&s_xrun, buf_start + (uint64_t)off,
+                                                     s_audio_out_us) -
+                                 hostapi_tsched_time_us(&e);
+            hostapi_xrun_lat_add(&s_sched_lat, late);
+            hostapi_xrun_lat_add(&s_sched_lat_all, late);
+        }
+        click_record_fire(buf_start + (uint64_t)off);
+        if (e.id == 0) { /* tone_schedule / click_schedule の予約 */
+            s_click_last_fired = hostapi_tsched_time_ms(&e);
             host_midi_notify_beat_fired(s_click_last_fired); /* Phase 8b */
         }
     }
+    mix_render(out + done * 2, frames - done, buf_start + (uint64_t)done);
+    capture_push(out, frames, buf_start);
+    hostapi_levels_push(&s_levels, out, frames);
 
-    for (int i = 0; i < frames; i++) {
-        if (start_off >= 0 && i == start_off) voice_start(start_tone);
-        if (s_voice.remaining > 0) {
-            const float s2 = s_voice.s * s_voice.cw + s_voice.c * s_voice.sw;
-            s_voice.c = s_voice.c * s_voice.cw - s_voice.s * s_voice.sw;
-            s_voice.s = s2;
-            s_voice.amp *= s_voice.decay;
-            const int16_t v = (int16_t)(s_voice.amp * s_voice.s);
-            out[i * 2] = v;
-            out[i * 2 + 1] = v;
-            s_voice.remaining--;
-        }
+    s_audio_samples += (uint64_t)frames;
+    /* now_us64 = 壁時計 - (デバイスが要求する時刻の基準 - 音声クロックの原点) */
+    const int64_t offset_us = !s_audio_offline && s_xrun.started ? s_xrun.base_us - epoch_us : 0;
+    hostapi_aclock_publish(&s_aclock, s_audio_samples,
+                           hostapi_aclock_sample_to_us(s_audio_samples, epoch_us, CLICK_RATE),
+                           offset_us);
+    const Uint64 dt = SDL_GetPerformanceCounter() - t_enter;
+    hostapi_lathist_add(&s_cb_hist, (uint32_t)(dt * 1000000 / SDL_GetPerformanceFrequency()));
+}
+
+void host_sdl_audio_offline(void)
+{
+    if (s_audio) SDL_PauseAudioDevice(s_audio, 1); /* 戻った時点でコールバックは止まっている */
+    s_audio_offline = true;
+    s_audio_samples = 0;
+    s_audio_epoch_set = false;
+}
+
+void host_sdl_audio_render_until(uint32_t now_ms)
+{
+    if (!s_audio_offline) return;
+    static int16_t buf[4096 * 2];
+    const int piece = s_audio_buf_frames < 4096 ? s_audio_buf_frames : 4096;
+    for (;;) {
+        const uint64_t want = s_audio_epoch_set ? click_ms_to_sample(now_ms) : 1;
+        if (s_audio_samples >= want) break;
+        const uint64_t left = want - s_audio_samples;
+        const int n = left < (uint64_t)piece ? (int)left : piece;
+        audio_callback(NULL, (Uint8*)buf, n * 4);
+        host_sdl_capture_pump();
+    }
+}
+
+bool host_sdl_capture_start(const char* path)
+{
+    char log_path[512];
+    snprintf(log_path, sizeof(log_path), "%s.sched", path);
+    s_cap_wav = fopen(path, "wb");
+    s_cap_log = fopen(log_path, "w");
+    if (!s_cap_wav || !s_cap_log || !hostapi_capture_wav_header(s_cap_wav, CLICK_RATE, 0)) {
+        fprintf(stderr, "capture: cannot write %s / %s\n", path, log_path);
+        if (s_cap_wav) fclose(s_cap_wav);
+        if (s_cap_log) fclose(s_cap_log);
+        s_cap_wav = NULL;
+        s_cap_log = NULL;
+        return false;
     }
+    fprintf(s_cap_log, "# midibox capture log (shared/hostapi_capture.h)\nrate %d\n", CLICK_RATE);
+    s_cap_frames = 0;
+    __atomic_store_n(&s_cap_on, true, __ATOMIC_RELEASE);
+    printf("capture: %s (+ .sched)\n", path);
+    return true;
+}
 
-    s_audio_samples += (uint64_t)frames;
+void host_sdl_capture_pump(void)
+{
+    if (!s_cap_wav) return;
+    acmd_sync(); /* 発火の記録を書き出す(main スレッド = wasm スレッド) */
+    const uint32_t tail = __atomic_load_n(&s_cap_tail, __ATOMIC_ACQUIRE);
+    uint32_t head = s_cap_head;
+    while (head != tail) {
+        const uint32_t k = head & (CAPTURE_RING_FRAMES - 1);
+        uint32_t n = tail - head;
+        if (n > CAPTURE_RING_FRAMES - k) n = CAPTURE_RING_FRAMES - k; /* 折り返しまで */
+        fwrite(&s_cap_ring[k * 2], 4, n, s_cap_wav);
+        s_cap_frames += n;
+        head += n;
+    }
+    __atomic_store_n(&s_cap_head, head, __ATOMIC_RELEASE);
+}
+
+/* コールバックが止まってから呼ぶ */
+static void capture_stop(void)
+{
+    if (!s_cap_wav) return;
+    host_sdl_capture_pump();
+    __atomic_store_n(&s_cap_on, false, __ATOMIC_RELEASE);
+    fprintf(s_cap_log, "epoch %u %llu\n", (unsigned)s_audio_epoch_ms,
+            (unsigned long long)s_cap_base);
+    fclose(s_cap_log);
+    fseek(s_cap_wav, 0, SEEK_SET);
+    hostapi_capture_wav_header(s_cap_wav, CLICK_RATE, s_cap_frames);
+    fclose(s_cap_wav);
+    s_cap_wav = NULL;
+    s_cap_log = NULL;
+    fprintf(stderr, "capture: %u frames (%.1f s), dropped %u%s\n", (unsigned)s_cap_frames,
+            s_cap_frames / (double)CLICK_RATE, (unsigned)s_cap_dropped,
+            s_cap_dropped ? " (positions are unreliable)" : "");
 }
 
 #ifdef HAVE_SDL_TTF
@@ -248,37 +861,391 @@ static void try_open_font(void)
 
 static TextSlot s_texts[MAX_TEXT_SLOTS];
 static RectSlot s_rects[MAX_RECT_SLOTS];
+static LineSlot s_lines[HOSTAPI_LINE_SLOTS];
 
 /* ---- オーディオ (Phase 6B) ----
- * MP3 再生は SDL_mixer(クリック音の SDL_QueueAudio 経路とは独立のデバイス。
- * OS 側ミキサで混ざる)。状態は実機と同じ「ホスト宣言 + 自然終了の取り込み」。 */
+ * MP3 のデコードは SDL_mixer(出力はポストミックスで横取りし、クリック用
+ * デバイスの出力ミキサでトーンと混ぜる。上記 s_mix)。状態は実機と同じ
+ * 「ホスト宣言 + 自然終了の取り込み」。 */
 #define MUSIC_ROOT "./sdcard/music"
 
 static int s_audio_state = 0; /* HOSTAPI_AUDIO_* */
+static hostapi_playlist_t s_playlist; /* 再生キュー(hostapi_audio_enqueue)。main のみ */
 #ifdef HAVE_SDL_MIXER
-static Mix_Music* s_music;
+static Mix_Music* s_music;      /* 以下 3 つは s_music_lock の下(切り替えスレッドも触る) */
+static Mix_Music* s_music_next; /* キュー先頭をプリロードしたもの */
 static volatile int s_music_finished;
 static bool s_mixer_ready;
-
-/* SDL_mixer の音楽スレッドから呼ばれる。フラグを立てるだけ */
+/* 曲間を詰める(main と SDL_mixer のスレッドの間、atomic)。gapless = キュー
+ * 先頭をプリロード済み。hold = 曲が終わり切り替え待ちで、リングに無音を
+ * 積まない(1: 終わったバッファの後ろのゼロ埋めを削る、2: 以後を捨てる)。
+ * 待つ間はリングの残り(~46ms 以上)が鳴り続ける。3: 開始時刻待ち(下記)と
+ * 切り替え直後。曲が鳴り始めたバッファから積む */
+static int s_music_gapless;
+static int s_music_hold;
+
+/* 曲の切り替え(再生キュー)。終了フックが s_music_switch_sem を上げ、専用の
+ * スレッドがすぐに次の曲を Mix_PlayMusic する(フックの中では呼べない。
+ * main ループの tick を待つと、リングより長い tick で曲間に無音が入る)。
+ * s_music / s_music_next / s_music_finished / s_music_paused と切り替えの
+ * 結果は s_music_lock の下。再生キュー・位置・索引・TRACK イベントの帳簿は
+ * main が host_sdl_audio_pump で取り込む */
+static SDL_mutex* s_music_lock;
+static SDL_sem* s_music_switch_sem;
+static SDL_Thread* s_music_switch_thread;
+static int s_music_switch_quit;      /* atomic */
+static bool s_music_paused;          /* PAUSE 中は切り替えない(RESUME で起こす) */
+static int s_music_switched;         /* 1: 切り替えた、-1: 次の曲を鳴らせなかった */
+static uint32_t s_music_switch_ms;   /* 切り替えた時刻(now_ms) */
+static uint32_t s_music_switch_tail; /* 切り替えた時のリングの末尾(次の曲の頭) */
+
+/* 開始時刻の指定(hostapi_audio_play_at)。曲は呼ばれた時点で開いておき
+ * (Mix_LoadMUS)、開始の MUSIC_PREROLL_MS 前に main が鳴らし始める。
+ * デコードした分はリングに溜まり、消費側が s_music_gate の時刻のフレームから
+ * 取り出す。リング(~186ms)に溜めきれる長さで、main ループの遅れと
+ * SDL_mixer のバッファ 1 つぶんを見込む。main のみ */
+#define MUSIC_PREROLL_MS 100
+static bool s_music_at_pending; /* 開いてあり、鳴らし始める前 */
+static uint32_t s_music_at_ms;
+static uint32_t s_music_gate_gen;
+
+/* 再生位置(hostapi_audio_get_position_ms)。出力側が取り出した音楽の
+ * フレーム数で数える: 曲(シーク先)の先頭に当たるリング位置 epoch からの
+ * head の進み + base。main のみ */
+static uint32_t s_pos_epoch;
+static int32_t s_pos_base_ms;
+static int32_t s_pos_frozen_ms = -1; /* PAUSED / FINISHED の間の値 */
+
+/* MP3 の索引(shared/hostapi_mp3idx.h)。曲が始まるたびにスレッドで作る
+ * (サイドカーがあれば読むだけ)。ready になるまではスレッドだけが触る */
+static hostapi_mp3idx_t s_idx;
+static SDL_Thread* s_idx_thread;
+static int s_idx_cancel; /* atomic */
+static int s_idx_ready;  /* atomic。1 = s_idx は今の曲のもの */
+static char s_idx_path[256];
+
+/* SDL_mixer の音楽スレッドから呼ばれる。フラグを立て、プリロード済みなら
+ * 切り替えスレッドを起こす(Mix_PlayMusic はここでは呼ばない) */
 static void music_finished_hook(void)
 {
     s_music_finished = 1;
+    if (__atomic_load_n(&s_music_gapless, __ATOMIC_ACQUIRE)) {
+        __atomic_store_n(&s_music_hold, 1, __ATOMIC_RELEASE);
+        SDL_SemPost(s_music_switch_sem);
+    }
+}
+
+/* 切り替えスレッド。プリロード済みの次の曲をすぐ鳴らす。待つ間はリングに
+ * 積んでいないので、今の末尾が曲の境目になる */
+static int music_switch_thread(void* arg)
+{
+    (void)arg;
+    SDL_SetThreadPriority(SDL_THREAD_PRIORITY_HIGH);
+    for (;;) {
+        SDL_SemWait(s_music_switch_sem);
+        if (__atomic_load_n(&s_music_switch_quit, __ATOMIC_ACQUIRE)) return 0;
+        SDL_LockMutex(s_music_lock);
+        if (s_music_finished && s_music_next && !s_music_paused) {
+            Mix_Music* prev = s_music;
+            s_music = s_music_next;
+            s_music_next = NULL;
+            s_music_finished = 0;
+            __atomic_store_n(&s_music_gapless, 0, __ATOMIC_RELEASE);
+            s_music_switch_tail = __atomic_load_n(&s_music_tail, __ATOMIC_ACQUIRE);
+            s_music_switch_ms = host_sdl_now_ms();
+            /* 鳴り始めたバッファから積む(その前の無音は積まない) */
+            __atomic_store_n(&s_music_hold, 3, __ATOMIC_RELEASE);
+            if (Mix_PlayMusic(s_music, 1) == 0) {
+                s_music_switched = 1;
+            } else {
+                fprintf(stderr, "audio_enqueue: %s (skipped)\n", Mix_GetError());
+                __atomic_store_n(&s_music_hold, 0, __ATOMIC_RELEASE);
+                Mix_FreeMusic(s_music);
+                s_music = NULL;
+                s_music_finished = 1; /* 次があれば(無音を挟んで)続ける、無ければ FINISHED */
+                s_music_switched = -1;
+            }
+            if (prev) Mix_FreeMusic(prev);
+        }
+        SDL_UnlockMutex(s_music_lock);
+    }
+}
+
+/* SDL_mixer のオーディオスレッドから呼ばれる(ミックス後の出力)。44.1kHz へ
+ * リサンプルしてリングに積み、SDL_mixer 側のデバイスは無音にする */
+static void music_postmix(void* udata, Uint8* stream, int len)
+{
+    (void)udata;
+    const int16_t* in = (const int16_t*)stream;
+    const int ch = s_music_resamp.channels;
+    int in_frames = len / (int)(sizeof(int16_t) * ch);
+    int hold = __atomic_load_n(&s_music_hold, __ATOMIC_ACQUIRE);
+    if (hold == 1 &&
+        __atomic_compare_exchange_n(&s_music_hold, &hold, 2, false, __ATOMIC_ACQ_REL,
+                                    __ATOMIC_ACQUIRE)) {
+        /* 曲が終わったバッファ: 後ろのゼロ埋めを積まない */
+        while (in_frames > 0 && in[(in_frames - 1) * ch] == 0 && in[in_frames * ch - 1] == 0) {
+            in_frames--;
+        }
+    } else if (hold == 2) {
+        in_frames = 0; /* 切り替え待ち */
+    } else if (hold == 3) {
+        /* Mix_PlayMusic は SDL_mixer のロック下で効くので、鳴っているバッファは
+         * 曲の先頭から始まる。それより前(止まっている間の無音)は積まない
+         * (ここはそのロックの中だが、SDL のロックは再入できる) */
+        if (!Mix_PlayingMusic()) {
+            in_frames = 0;
+        } else {
+            __atomic_store_n(&s_music_hold, 0, __ATOMIC_RELEASE);
+        }
+    }
+    int16_t out[512 * 2];
+    while (in_frames > 0) {
+        int used;
+        const int n = hostapi_resamp_process(&s_music_resamp, in, in_frames, &used, out, 512);
+        music_ring_push(out, n);
+        in += used * ch;
+        in_frames -= used;
+    }
+    memset(stream, 0, (size_t)len);
+}
+
+/* epoch をリング位置 at に置く(そこから積まれた分が base_ms から始まる) */
+static void music_pos_start_at(uint32_t at, int32_t base_ms)
+{
+    s_pos_epoch = at;
+    s_pos_base_ms = base_ms;
+    s_pos_frozen_ms = -1;
+}
+
+/* epoch を今のリングの末尾に置く */
+static void music_pos_start(int32_t base_ms)
+{
+    music_pos_start_at(__atomic_load_n(&s_music_tail, __ATOMIC_ACQUIRE), base_ms);
+}
+
+static int32_t music_pos_ms(void)
+{
+    if (s_pos_frozen_ms >= 0) return s_pos_frozen_ms;
+    const int32_t played = (int32_t)(__atomic_load_n(&s_music_head, __ATOMIC_ACQUIRE) -
+                                     s_pos_epoch);
+    return s_pos_base_ms + (played > 0 ? (int32_t)((int64_t)played * 1000 / CLICK_RATE) : 0);
+}
+
+static bool idx_keep_going(void* ctx)
+{
+    (void)ctx;
+    return !__atomic_load_n(&s_idx_cancel, __ATOMIC_ACQUIRE);
+}
+
+static int idx_thread(void* arg)
+{
+    (void)arg;
+    SDL_SetThreadPriority(SDL_THREAD_PRIORITY_LOW);
+    const int r = hostapi_mp3idx_build_file(&s_idx, s_idx_path, 1024, idx_keep_going, NULL);
+    if (r > 0) {
+        __atomic_store_n(&s_idx_ready, 1, __ATOMIC_RELEASE);
+    } else if (r < 0) {
+        fprintf(stderr, "mp3idx: %s: no frame index (seek disabled)\n", s_idx_path);
+    }
+    return 0;
+}
+
+static void idx_stop(void)
+{
+    if (s_idx_thread) {
+        __atomic_store_n(&s_idx_cancel, 1, __ATOMIC_RELEASE);
+        SDL_WaitThread(s_idx_thread, NULL);
+        s_idx_thread = NULL;
+    }
+    __atomic_store_n(&s_idx_cancel, 0, __ATOMIC_RELEASE);
+    __atomic_store_n(&s_idx_ready, 0, __ATOMIC_RELEASE);
+}
+
+/* full の索引を作り始める(作りかけは打ち切る) */
+static void idx_start(const char* full)
+{
+    idx_stop();
+    snprintf(s_idx_path, sizeof(s_idx_path), "%s", full);
+    s_idx_thread = SDL_CreateThread(idx_thread, "mp3idx", NULL);
+}
+
+/* キュー先頭を開いてデコーダを用意しておく。開けない曲は飛ばす。今の曲が
+ * もう終わっていれば(切り替えに失敗した後など)すぐ切り替えさせる */
+static void music_preload(void)
+{
+    const hostapi_playlist_item_t* it;
+    while (!s_playlist.preloaded && (it = hostapi_playlist_head(&s_playlist)) != NULL) {
+        char full[256];
+        snprintf(full, sizeof(full), "%s/%s", MUSIC_ROOT, it->path);
+        Mix_Music* m = Mix_LoadMUS(full);
+        if (m) {
+            s_playlist.preloaded = true;
+            SDL_LockMutex(s_music_lock);
+            s_music_next = m;
+            __atomic_store_n(&s_music_gapless, 1, __ATOMIC_RELEASE);
+            if (s_music_finished) SDL_SemPost(s_music_switch_sem);
+            SDL_UnlockMutex(s_music_lock);
+            return;
+        }
+        fprintf(stderr, "audio_enqueue: %s: %s (skipped)\n", full, Mix_GetError());
+        hostapi_playlist_drop(&s_playlist);
+    }
+}
+
+/* 開始時刻の MUSIC_PREROLL_MS 前(main)。リングの今の末尾から先を新しい曲に
+ * して消費側を開始時刻まで止め、鳴らし始める */
+static void music_at_start(void)
+{
+    s_music_at_pending = false;
+    s_music_flush_to = __atomic_load_n(&s_music_tail, __ATOMIC_ACQUIRE); /* hold 3 で止まっている */
+    __atomic_store_n(&s_music_flush, 1, __ATOMIC_RELEASE);
+    if (++s_music_gate_gen == 0) s_music_gate_gen = 1;
+    __atomic_store_n(&s_music_gate, (uint64_t)s_music_gate_gen << 32 | s_music_at_ms,
+                     __ATOMIC_RELEASE);
+    music_pos_start(0); /* 開始までは head が epoch に届かないので 0 */
+    if (Mix_PlayMusic(s_music, 1) != 0) {
+        fprintf(stderr, "audio_play_at: %s\n", Mix_GetError());
+        __atomic_store_n(&s_music_gate, 0, __ATOMIC_RELEASE);
+        __atomic_store_n(&s_music_hold, 0, __ATOMIC_RELEASE);
+        SDL_LockMutex(s_music_lock);
+        s_music_finished = 1; /* FINISHED として見せる(キューがあれば次へ) */
+        if (s_music_next) SDL_SemPost(s_music_switch_sem);
+        SDL_UnlockMutex(s_music_lock);
+    }
+}
+
+/* 開始時刻待ちで、まだ鳴り始めていない(PAUSE とシークは受け付けない) */
+static bool music_at_waiting(void)
+{
+    const uint64_t g = __atomic_load_n(&s_music_gate, __ATOMIC_ACQUIRE);
+    return s_music_at_pending ||
+           (g != 0 && g != __atomic_load_n(&s_music_gate_open, __ATOMIC_ACQUIRE));
 }
 #endif
 
+/* キューを空にする(audio_play / STOP / リセット)。切り替え待ちと開始時刻待ちも
+ * 解く(開始前に溜めた分は捨てる) */
+static void music_queue_clear(void)
+{
+    hostapi_playlist_clear(&s_playlist);
+#ifdef HAVE_SDL_MIXER
+    if (!s_mixer_ready) return;
+    SDL_LockMutex(s_music_lock); /* 切り替えの途中なら終わるまで待つ */
+    s_music_switched = 0;
+    s_music_at_pending = false;
+    if (__atomic_exchange_n(&s_music_gate, 0, __ATOMIC_ACQ_REL) != 0) {
+        s_music_flush_to = __atomic_load_n(&s_music_tail, __ATOMIC_ACQUIRE);
+        __atomic_store_n(&s_music_flush, 1, __ATOMIC_RELEASE);
+    }
+    __atomic_store_n(&s_music_gapless, 0, __ATOMIC_RELEASE);
+    __atomic_store_n(&s_music_hold, 0, __ATOMIC_RELEASE);
+    if (s_music_next) {
+        Mix_FreeMusic(s_music_next);
+        s_music_next = NULL;
+    }
+    SDL_UnlockMutex(s_music_lock);
+#endif
+}
+
+/* コールバックの検出した取りこぼしと --audio-rt の結果を出す(main スレッド) */
+static void audio_report(void)
+{
+    static uint32_t s_reported_xruns;
+    static bool s_reported_rt;
+    const int rt = __atomic_load_n(&s_audio_rt_err, __ATOMIC_ACQUIRE);
+    if (rt >= 0 && !s_reported_rt) {
+        s_reported_rt = true;
+        if (rt == 0) {
+            fprintf(stderr, "audio: realtime thread (SCHED_FIFO %d, CPU %d)\n",
+                    AUDIO_RT_PRIORITY, s_audio_rt_cpu);
+        } else {
+            fprintf(stderr,
+                    "audio: SCHED_FIFO failed: %s (needs CAP_SYS_NICE or an rtprio limit; "
+                    "CPU %d)\n",
+                    strerror(rt), s_audio_rt_cpu);
+        }
+    }
+    const uint32_t xruns = __atomic_load_n(&s_xrun.xruns, __ATOMIC_RELAXED);
+    if (xruns != s_reported_xruns) {
+        fprintf(stderr, "audio: underrun x%u (total %u, ~%.1f ms lost)\n",
+                (unsigned)(xruns - s_reported_xruns), (unsigned)xruns,
+                __atomic_load_n(&s_xrun.lost_us, __ATOMIC_RELAXED) / 1000.0);
+        s_reported_xruns = xruns;
+    }
+}
+
+void host_sdl_audio_pump(void)
+{
+    audio_report();
+#ifdef HAVE_SDL_MIXER
+    if (!s_mixer_ready) return;
+    if (s_music_at_pending &&
+        (int32_t)(host_sdl_now_ms() + MUSIC_PREROLL_MS - s_music_at_ms) >= 0) {
+        music_at_start();
+    }
+    /* 切り替えスレッドがした切り替えを帳簿に取り込む */
+    SDL_LockMutex(s_music_lock);
+    const int switched = s_music_switched;
+    s_music_switched = 0;
+    SDL_UnlockMutex(s_music_lock);
+    const hostapi_playlist_item_t* it = hostapi_playlist_head(&s_playlist);
+    if (switched > 0 && it) {
+        char full[256];
+        snprintf(full, sizeof(full), "%s/%s", MUSIC_ROOT, it->path);
+        printf("audio_enqueue: next track %s\n", full);
+        music_pos_start_at(s_music_switch_tail, 0);
+        idx_start(full);
+        if (s_cap_log) {
+            const hostapi_capture_rec_t rec = {HOSTAPI_CAPTURE_TRACK, s_music_switch_ms, it->id,
+                                               false, 0};
+            hostapi_capture_write_rec(s_cap_log, &rec);
+        }
+        hostapi_playlist_started(&s_playlist, s_music_switch_ms);
+    } else if (switched < 0) {
+        hostapi_playlist_drop(&s_playlist);
+    }
+    if (s_audio_state == HOSTAPI_AUDIO_PLAYING || s_audio_state == HOSTAPI_AUDIO_PAUSED) {
+        music_preload();
+    }
+#endif
+}
+
+int host_sdl_audio_wait_ms(void)
+{
+#ifdef HAVE_SDL_MIXER
+    if (s_music_at_pending) {
+        const int32_t d = (int32_t)(s_music_at_ms - MUSIC_PREROLL_MS - host_sdl_now_ms());
+        return d > 0 ? d : 0;
+    }
+#endif
+    return -1;
+}
+
 static void audio_refresh_finished(void)
 {
 #ifdef HAVE_SDL_MIXER
-    if (s_audio_state == HOSTAPI_AUDIO_PLAYING && s_music_finished) {
+    host_sdl_audio_pump();
+    SDL_LockMutex(s_music_lock);
+    const bool ended = s_music_finished && !s_music_next; /* 次があれば切り替え待ち */
+    SDL_UnlockMutex(s_music_lock);
+    if (s_audio_state == HOSTAPI_AUDIO_PLAYING && ended) {
         s_audio_state = HOSTAPI_AUDIO_FINISHED;
+        /* 位置は曲の長さで止める(分からなければ今の値) */
+        const int32_t dur = __atomic_load_n(&s_idx_ready, __ATOMIC_ACQUIRE)
+                                ? hostapi_mp3idx_duration_ms(&s_idx)
+                                : -1;
+        s_pos_frozen_ms = dur >= 0 ? dur : music_pos_ms();
     }
 #endif
 }
 
 void host_sdl_audio_reset(void)
 {
+    music_queue_clear();
+    hostapi_playlist_reset(&s_playlist);
 #ifdef HAVE_SDL_MIXER
+    idx_stop();
     if (s_mixer_ready) {
         Mix_HaltMusic();
         if (s_music) {
@@ -290,18 +1257,22 @@ void host_sdl_audio_reset(void)
     s_audio_state = HOSTAPI_AUDIO_STOPPED;
 
     /* クリック予約・last_fired・トーンパレットもリセット(Phase 7A/7C 契約)。
-     * マスター音量は既定に戻す(アプリ起動時の初期状態を一定にする) */
+     * マスター音量は既定に戻す(アプリ起動時の初期状態を一定にする)。
+     * 発音中の声・予約はコールバックが RESET コマンドで消す。写しの seq は
+     * 続き番号のままにして、リセット前の予約の通知と取り違えない */
     if (s_audio) {
-        SDL_LockAudioDevice(s_audio);
-        s_click_pending = 0;
-        s_click_last_fired = 0;
-        s_click_asap = false;
-        s_voice.remaining = 0;
-        s_fire_count = 0;
-        s_master_vol = 98;
+        acmd_sync();
+        const uint32_t seq = s_tsched_ui.seq;
+        hostapi_tsched_reset(&s_tsched_ui);
+        s_tsched_ui.seq = seq;
+        s_ui_epoch_seq = seq;
+        s_ui_last_fired = 0;
+        /* サンプルはアプリセッション状態。RESET が届くまでの 1 バッファは古い
+         * PCM を読み得るが、アリーナは解放しないので化けるだけ(実機と同じ) */
+        hostapi_sample_cache_reset(&s_samples);
         for (int i = 0; i < HOSTAPI_TONE_SLOTS; i++) s_tones[i] = (ToneDef){0};
         s_tones[0] = kDefaultClick; /* slot 0 = v0 互換の既定クリック */
-        SDL_UnlockAudioDevice(s_audio);
+        acmd_send_wait(HOSTAPI_ACMD_RESET, 0);
     }
     host_midi_reset(); /* MIDI Clock 生成も必ず停止する (Phase 8b 契約) */
 }
@@ -317,14 +1288,17 @@ static bool audio_path_ok(const char* path, uint32_t len)
     return true;
 }
 
-int32_t native_hostapi_audio_play(wasm_exec_env_t exec_env, const char* path, uint32_t len)
+/* audio_play / audio_play_at。at なら開いてデコーダを用意し、time_ms に鳴り
+ * 始めるよう予約する(MUSIC_PREROLL_MS を切っていればすぐ鳴らし始める) */
+static int32_t audio_start(const char* who, const char* path, uint32_t len, bool at,
+                           uint32_t time_ms)
 {
-    (void)exec_env;
     if (!audio_path_ok(path, len)) {
-        fprintf(stderr, "audio_play: rejected path\n");
+        fprintf(stderr, "%s: rejected path\n", who);
         s_audio_state = HOSTAPI_AUDIO_ERROR;
         return -1;
     }
+    music_queue_clear();
 #ifdef HAVE_SDL_MIXER
     if (!s_mixer_ready) {
         s_audio_state = HOSTAPI_AUDIO_ERROR;
@@ -340,28 +1314,58 @@ int32_t native_hostapi_audio_play(wasm_exec_env_t exec_env, const char* path, ui
     }
     s_music = Mix_LoadMUS(full);
     if (!s_music) {
-        fprintf(stderr, "audio_play: %s: %s\n", full, Mix_GetError());
+        fprintf(stderr, "%s: %s: %s\n", who, full, Mix_GetError());
         s_audio_state = HOSTAPI_AUDIO_ERROR;
         return -1;
     }
     s_music_finished = 0;
+    if (at) {
+        /* 鳴らし始めるまでは SDL_mixer の出力(無音)を積まない */
+        __atomic_store_n(&s_music_hold, 3, __ATOMIC_RELEASE);
+        s_music_at_ms = time_ms;
+        s_music_at_pending = true;
+        s_pos_frozen_ms = 0;
+        printf("%s: %s at %u ms (now %u)\n", who, full, (unsigned)time_ms,
+               (unsigned)host_sdl_now_ms());
+        s_audio_state = HOSTAPI_AUDIO_PLAYING;
+        host_sdl_audio_pump();
+        idx_start(full);
+        return 0;
+    }
     if (Mix_PlayMusic(s_music, 1) != 0) {
-        fprintf(stderr, "audio_play: %s\n", Mix_GetError());
+        fprintf(stderr, "%s: %s\n", who, Mix_GetError());
         Mix_FreeMusic(s_music);
         s_music = NULL;
         s_audio_state = HOSTAPI_AUDIO_ERROR;
         return -1;
     }
-    printf("audio_play: %s\n", full);
+    printf("%s: %s\n", who, full);
     s_audio_state = HOSTAPI_AUDIO_PLAYING;
+    music_pos_start(0);
+    idx_start(full);
     return 0;
 #else
-    fprintf(stderr, "audio_play: built without SDL_mixer\n");
+    (void)at;
+    (void)time_ms;
+    fprintf(stderr, "%s: built without SDL_mixer\n", who);
     s_audio_state = HOSTAPI_AUDIO_ERROR;
     return -1;
 #endif
 }
 
+int32_t native_hostapi_audio_play(wasm_exec_env_t exec_env, const char* path, uint32_t len)
+{
+    (void)exec_env;
+    return audio_start("audio_play", path, len, false, 0);
+}
+
+int32_t native_hostapi_audio_play_at(wasm_exec_env_t exec_env, const char* path, uint32_t len,
+                                     int32_t time_ms)
+{
+    (void)exec_env;
+    return audio_start("audio_play_at", path, len, true, (uint32_t)time_ms);
+}
+
 int32_t native_hostapi_audio_ctrl(wasm_exec_env_t exec_env, int32_t cmd)
 {
     (void)exec_env;
@@ -370,18 +1374,30 @@ int32_t native_hostapi_audio_ctrl(wasm_exec_env_t exec_env, int32_t cmd)
     case HOSTAPI_AUDIO_CMD_PAUSE:
         if (s_audio_state != HOSTAPI_AUDIO_PLAYING) return -1;
 #ifdef HAVE_SDL_MIXER
+        if (music_at_waiting()) return -1;
+        SDL_LockMutex(s_music_lock);
+        s_music_paused = true;
         Mix_PauseMusic();
+        SDL_UnlockMutex(s_music_lock);
+        s_pos_frozen_ms = music_pos_ms();
 #endif
         s_audio_state = HOSTAPI_AUDIO_PAUSED;
         return 0;
     case HOSTAPI_AUDIO_CMD_RESUME:
         if (s_audio_state != HOSTAPI_AUDIO_PAUSED) return -1;
 #ifdef HAVE_SDL_MIXER
+        SDL_LockMutex(s_music_lock);
+        s_music_paused = false;
         Mix_ResumeMusic();
+        /* 止める直前に曲が終わっていれば、待たせていた切り替えをする */
+        if (s_music_finished && s_music_next) SDL_SemPost(s_music_switch_sem);
+        SDL_UnlockMutex(s_music_lock);
+        music_pos_start(s_pos_frozen_ms);
 #endif
         s_audio_state = HOSTAPI_AUDIO_PLAYING;
         return 0;
     case HOSTAPI_AUDIO_CMD_STOP:
+        music_queue_clear();
 #ifdef HAVE_SDL_MIXER
         if (s_mixer_ready) Mix_HaltMusic();
 #endif
@@ -398,13 +1414,9 @@ void native_hostapi_audio_set_volume(wasm_exec_env_t exec_env, int32_t v)
     if (v < 0) v = 0;
     if (v > 100) v = 100;
     /* マスター音量 (v2): MP3 とクリックの両方に適用 */
-    if (s_audio) {
-        SDL_LockAudioDevice(s_audio);
-        s_master_vol = v;
-        SDL_UnlockAudioDevice(s_audio);
-    }
+    if (s_audio) acmd_send_wait(HOSTAPI_ACMD_VOLUME, v);
 #ifdef HAVE_SDL_MIXER
-    if (s_mixer_ready) Mix_VolumeMusic(v * MIX_MAX_VOLUME / 100);
+    if (s_mixer_ready && !s_music_routed) Mix_VolumeMusic(v * MIX_MAX_VOLUME / 100);
 #endif
 }
 
@@ -415,82 +1427,441 @@ int32_t native_hostapi_audio_get_state(wasm_exec_env_t exec_env)
     return s_audio_state;
 }
 
-/* ---- ファイル列挙 (Phase 6C) ----
- * 実機側 hostapi.cpp と同じ契約: MUSIC_ROOT 直下の .mp3 を idx で列挙 */
-static bool has_mp3_ext(const char* name)
+int32_t native_hostapi_audio_get_position_ms(wasm_exec_env_t exec_env)
+{
+    (void)exec_env;
+    audio_refresh_finished();
+#ifdef HAVE_SDL_MIXER
+    if (s_audio_state == HOSTAPI_AUDIO_PLAYING || s_audio_state == HOSTAPI_AUDIO_PAUSED ||
+        s_audio_state == HOSTAPI_AUDIO_FINISHED) {
+        return music_pos_ms();
+    }
+#endif
+    return -1;
+}
+
+int32_t native_hostapi_audio_get_duration_ms(wasm_exec_env_t exec_env)
+{
+    (void)exec_env;
+    audio_refresh_finished();
+#ifdef HAVE_SDL_MIXER
+    if ((s_audio_state == HOSTAPI_AUDIO_PLAYING || s_audio_state == HOSTAPI_AUDIO_PAUSED ||
+         s_audio_state == HOSTAPI_AUDIO_FINISHED) &&
+        __atomic_load_n(&s_idx_ready, __ATOMIC_ACQUIRE)) {
+        return hostapi_mp3idx_duration_ms(&s_idx);
+    }
+#endif
+    return -1;
+}
+
+/* 索引で目標をフレーム境界の時刻に丸め、SDL_mixer のデコーダをそこへ動かす
+ * (ファイル位置は実機のシークが使う。Linux は SDL_mixer が時刻で探す) */
+int32_t native_hostapi_audio_seek_ms(wasm_exec_env_t exec_env, int32_t ms)
+{
+    (void)exec_env;
+    audio_refresh_finished();
+    if (ms < 0) return -1;
+    if (s_audio_state != HOSTAPI_AUDIO_PLAYING && s_audio_state != HOSTAPI_AUDIO_PAUSED) {
+        return -1;
+    }
+#ifdef HAVE_SDL_MIXER
+    if (music_at_waiting() || !__atomic_load_n(&s_idx_ready, __ATOMIC_ACQUIRE)) return -1;
+    uint32_t offset;
+    const int32_t at = hostapi_mp3idx_lookup(&s_idx, (uint32_t)ms, &offset);
+    if (at < 0 || Mix_SetMusicPosition(at / 1000.0) != 0) return -1;
+    /* リングに残っているシーク前の分は捨てる。以後に積まれる分が at から */
+    s_music_flush_to = __atomic_load_n(&s_music_tail, __ATOMIC_ACQUIRE);
+    __atomic_store_n(&s_music_flush, 1, __ATOMIC_RELEASE);
+    music_pos_start(at);
+    if (s_audio_state == HOSTAPI_AUDIO_PAUSED) s_pos_frozen_ms = at;
+    return at;
+#else
+    return -1;
+#endif
+}
+
+int32_t native_hostapi_audio_get_levels(wasm_exec_env_t exec_env, char* buf, uint32_t len)
+{
+    (void)exec_env;
+    hostapi_audio_levels_t lv;
+    if (!buf || len < sizeof(lv)) return -1;
+    if (!s_levels_fft_ready) {
+        hostapi_levels_fft_init(&s_levels_fft);
+        s_levels_fft_ready = true;
+    }
+    hostapi_levels_read(&s_levels, &s_levels_fft, &lv);
+    memcpy(buf, &lv, sizeof(lv));
+    return (int32_t)sizeof(lv);
+}
+
+/* 鳴っていれば末尾に積み(先頭ならすぐプリロード)、止まっていれば
+ * audio_play と同じくすぐ鳴らす */
+int32_t native_hostapi_audio_enqueue(wasm_exec_env_t exec_env, const char* path, uint32_t len)
+{
+    if (!audio_path_ok(path, len)) {
+        fprintf(stderr, "audio_enqueue: rejected path\n");
+        return -1;
+    }
+    audio_refresh_finished();
+    if (s_audio_state == HOSTAPI_AUDIO_PLAYING || s_audio_state == HOSTAPI_AUDIO_PAUSED) {
+        const int32_t id = hostapi_playlist_push(&s_playlist, path, len);
+        if (id >= 0) host_sdl_audio_pump();
+        return id;
+    }
+    if (native_hostapi_audio_play(exec_env, path, len) != 0) return -1;
+    const int32_t id = hostapi_playlist_push(&s_playlist, path, len);
+    hostapi_playlist_started(&s_playlist, host_sdl_now_ms());
+    return id;
+}
+
+/* ---- ファイル列挙 (Phase 6C) ----
+ * 実機側 hostapi.cpp と同じ契約: MUSIC_ROOT 直下の .mp3 を idx で列挙 */
+static bool has_mp3_ext(const char* name)
+{
+    size_t len = strlen(name);
+    return len > 4 && strcasecmp(name + len - 4, ".mp3") == 0;
+}
+
+int32_t native_hostapi_fs_list(wasm_exec_env_t exec_env, int32_t idx,
+                               char* buf, uint32_t buf_len)
+{
+    (void)exec_env;
+    if (idx < 0) return -1;
+
+    DIR* dir = opendir(MUSIC_ROOT);
+    if (!dir) return -1;
+
+    int32_t found = -1;
+    int32_t count = 0;
+    struct dirent* ent;
+    while ((ent = readdir(dir)) != NULL) {
+        if (ent->d_name[0] == '.') continue;
+        if (!has_mp3_ext(ent->d_name)) continue;
+        size_t name_len = strlen(ent->d_name);
+        if (name_len > 63) continue; /* 契約: 63 バイト超は列挙から除外 */
+
+        char full[512];
+        snprintf(full, sizeof(full), "%s/%s", MUSIC_ROOT, ent->d_name);
+        struct stat st;
+        if (stat(full, &st) != 0 || !S_ISREG(st.st_mode)) continue;
+
+        if (count == idx) {
+            uint32_t n = (name_len < buf_len) ? (uint32_t)name_len : buf_len;
+            memcpy(buf, ent->d_name, n);
+            found = (int32_t)n;
+            break;
+        }
+        count++;
+    }
+    closedir(dir);
+    return found;
+}
+
+/* ---- 入力イベントキュー (Phase 6A) ----
+ * 実機と同じ規約・同じ実装(shared/hostapi_evq.h の SPSC リング): 深さ既定 16、
+ * 満杯は最古から捨てる、DOWN 未配送の UP は捨てる、MOVE / CHANGED は合体。
+ * Linux は main ループ単一スレッドから push / poll するが、実機と同じ経路を通す。 */
+static hostapi_evq_slot_t s_evq_slots[EVENT_QUEUE_DEPTH];
+static hostapi_evq_t s_evq = HOSTAPI_EVQ_INITIALIZER(s_evq_slots, EVENT_QUEUE_DEPTH);
+static hostapi_gesture_t s_gesture;
+
+void host_sdl_clear_events(void)
+{
+    if (s_evq.dropped || s_evq.coalesced) {
+        fprintf(stderr, "event queue: dropped %u, coalesced %u, high water %u/%d\n",
+                s_evq.dropped, s_evq.coalesced, s_evq.high_water, EVENT_QUEUE_DEPTH);
+    }
+    hostapi_evq_reset(&s_evq);
+    hostapi_gesture_reset(&s_gesture, 0); /* ジェスチャはアプリごとに既定で無効 */
+}
+
+/* 入力イベントの記録(--record)。time_ms はアプリ起動からの相対で書く */
+static FILE* s_rec;
+static uint32_t s_rec_base_ms;
+static uint32_t s_rec_count;
+
+bool host_sdl_record_start(const char* path)
+{
+    host_sdl_record_stop();
+    s_rec = fopen(path, "wb");
+    if (!s_rec || !hostapi_evrec_write_header(s_rec)) {
+        fprintf(stderr, "record: cannot write %s\n", path);
+        if (s_rec) fclose(s_rec);
+        s_rec = NULL;
+        return false;
+    }
+    s_rec_base_ms = host_sdl_now_ms();
+    s_rec_count = 0;
+    return true;
+}
+
+void host_sdl_record_stop(void)
+{
+    if (!s_rec) return;
+    fclose(s_rec);
+    s_rec = NULL;
+    printf("record: %u events\n", s_rec_count);
+}
+
+static void record_event(uint16_t type, uint16_t param, int16_t x, int16_t y, uint32_t time_ms)
+{
+    const int32_t rel = (int32_t)(time_ms - s_rec_base_ms);
+    hostapi_event_t ev;
+    ev.type = type;
+    ev.param = param;
+    ev.x = x;
+    ev.y = y;
+    ev.time_ms = rel > 0 ? (uint32_t)rel : 0;
+    if (hostapi_evrec_write(s_rec, &ev)) s_rec_count++;
+}
+
+/* X サーバの打刻。SDL2 の timestamp は SDL_PumpEvents でイベントを取り込んだ
+ * 時刻なので、tick(app_tick + 描画)の間に届いた入力はそのぶん遅れて打たれる。
+ * X11 では入力の直前に届く SYSWM イベントから XEvent.time(サーバが入力を
+ * 受けた時刻)を取り、続く SDL のマウスイベントの時刻にする */
+#ifdef HOST_X11_INPUT_TIME
+static bool s_xtime_pending;
+static uint32_t s_xtime;      /* 保留中の XEvent.time(サーバ時刻 ms) */
+static bool s_xoff_valid;
+static int32_t s_xoff;        /* now_ms - サーバ時刻 の見積もり(最小値) */
+
+/* サーバ時刻 → now_ms 時基。Xorg のサーバ時刻は CLOCK_MONOTONIC の ms なので、
+ * 手元の同じ時計との差(経過時間)が妥当ならそのまま引く。別の時計(リモート
+ * 等)なら今までで最小の「取り込み - サーバ時刻」を時計の差とみる。
+ * pumped(SDL の打刻)より後にも、1 秒より前にもしない */
+static uint32_t x11_event_time(uint32_t xtime, uint32_t pumped)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    const uint32_t mono_ms = (uint32_t)((uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000);
+    const uint32_t now = host_sdl_now_ms();
+    const int32_t age = (int32_t)(mono_ms - xtime);
+    uint32_t t;
+    if (age >= 0 && age < 1000) {
+        t = now - (uint32_t)age;
+    } else {
+        const int32_t off = (int32_t)(now - xtime);
+        if (!s_xoff_valid || off < s_xoff) s_xoff = off;
+        s_xoff_valid = true;
+        t = xtime + (uint32_t)s_xoff;
+    }
+    if ((int32_t)(t - pumped) > 0 || (int32_t)(pumped - t) > 1000) return pumped;
+    return t;
+}
+#endif
+
+void host_sdl_input_syswm(const SDL_Event* ev)
+{
+#ifdef HOST_X11_INPUT_TIME
+    const SDL_SysWMmsg* m = ev->syswm.msg;
+    if (!m || m->subsystem != SDL_SYSWM_X11) return;
+    const XEvent* xe = &m->msg.x11.event;
+    if (xe->type == ButtonPress || xe->type == ButtonRelease) {
+        s_xtime = (uint32_t)xe->xbutton.time;
+    } else if (xe->type == MotionNotify) {
+        s_xtime = (uint32_t)xe->xmotion.time;
+    } else {
+        return;
+    }
+    s_xtime_pending = true;
+#else
+    (void)ev;
+#endif
+}
+
+uint32_t host_sdl_event_time(uint32_t sdl_timestamp)
+{
+    /* timestamp は SDL_GetTicks と同じ時基(SDL_Init からの ms)。0 は未設定 */
+    if (s_clock_virtual || sdl_timestamp == 0) return host_sdl_now_ms();
+    const int32_t t = (int32_t)(sdl_timestamp - s_start_ms);
+    const uint32_t pumped = t > 0 ? (uint32_t)t : 0; /* host_sdl_init 前に積まれたもの */
+#ifdef HOST_X11_INPUT_TIME
+    if (s_xtime_pending) {
+        s_xtime_pending = false;
+        return x11_event_time(s_xtime, pumped);
+    }
+#endif
+    return pumped;
+}
+
+/* time_ms は入力が SDL に届いた時刻(now_ms 時基)。キューへ積んだ時刻ではない */
+static void push_event(uint16_t type, uint16_t param, int16_t x, int16_t y, uint32_t time_ms)
+{
+    const hostapi_evq_result_t r = hostapi_evq_push(&s_evq, type, param, x, y, time_ms);
+    if (r == HOSTAPI_EVQ_DROPPED_OLDEST) {
+        fprintf(stderr, "event queue full, dropped oldest\n");
+    }
+    if (s_rec && r != HOSTAPI_EVQ_REJECTED) record_event(type, param, x, y, time_ms);
+}
+
+void host_sdl_replay_event(const hostapi_event_t* ev, uint32_t base_ms)
+{
+    /* widget は記録時の確定値を部品にも反映する(get_value と表示を合わせる) */
+    if (ev->type == HOSTAPI_EV_WIDGET && ev->y == HOSTAPI_WIDGET_EV_CHANGED &&
+        ev->param < HOSTAPI_WIDGET_SLOTS && s_widgets[ev->param].kind) {
+        s_widgets[ev->param].value = ev->x;
+        s_redraw = true;
+    }
+    push_event(ev->type, ev->param, ev->x, ev->y, base_ms + ev->time_ms);
+}
+
+/* ---- ジェスチャ(shared/hostapi_gesture.h) ----
+ * 部品が消費しなかったタッチだけを認識器に通し、TOUCH_* に加えて積む。
+ * SDL2 の timestamp は ms 単位なので、実機と違い打刻は ms 精度になる */
+static void gesture_emit(void* ctx, uint16_t type, uint16_t param, int16_t x, int16_t y,
+                         int64_t time_us)
+{
+    (void)ctx;
+    push_event(type, param, x, y, (uint32_t)(time_us / 1000));
+}
+
+/* TOUCH_* を積んで認識器に通す。その時刻までの長押し連打を先に積み、
+ * キュー内の順序を時刻順に保つ */
+static void push_touch_event(uint16_t type, int x, int y, uint32_t time_ms)
+{
+    const int64_t time_us = (int64_t)time_ms * 1000;
+    hostapi_gesture_timer(&s_gesture, time_us, gesture_emit, NULL);
+    push_event(type, 0, (int16_t)x, (int16_t)y, time_ms);
+    hostapi_gesture_touch(&s_gesture, type, (int16_t)x, (int16_t)y, time_us, gesture_emit,
+                          NULL);
+}
+
+int host_sdl_input_wait_ms(void)
+{
+    const int64_t deadline = hostapi_gesture_deadline(&s_gesture);
+    if (deadline == INT64_MAX) return -1;
+    const int64_t wait = deadline / 1000 - (int64_t)host_sdl_now_ms();
+    return wait > 0 ? (int)wait : 0;
+}
+
+void host_sdl_input_poll(void)
+{
+    hostapi_gesture_timer(&s_gesture, (int64_t)host_sdl_now_ms() * 1000, gesture_emit, NULL);
+}
+
+int32_t native_hostapi_gesture_enable(wasm_exec_env_t exec_env, int32_t mask)
+{
+    (void)exec_env;
+    if ((uint32_t)mask & ~(uint32_t)HOSTAPI_GESTURE_ALL) return -1;
+    /* 押下中に切り替えても途中のタッチは認識させない(次の DOWN から) */
+    hostapi_gesture_reset(&s_gesture, (uint32_t)mask);
+    return 0;
+}
+
+/* ---- widget のヒットテストと押下処理 ---- */
+
+static bool widget_contains(const WidgetSlot* w, int x, int y)
+{
+    return x >= w->x && x < w->x + w->w && y >= w->y && y < w->y + w->h;
+}
+
+/* 後に置いた部品(id 大)を優先する */
+static int widget_hit(int x, int y)
+{
+    for (int id = HOSTAPI_WIDGET_SLOTS - 1; id >= 0; --id) {
+        if (s_widgets[id].kind && widget_contains(&s_widgets[id], x, y)) return id;
+    }
+    return -1;
+}
+
+/* スライダーの値をポインタ位置から更新し、変わったら CHANGED を積む */
+static void widget_slider_track(int id, int x, int y, uint32_t time_ms)
+{
+    WidgetSlot* w = &s_widgets[id];
+    int v;
+    if (w->h > w->w) {
+        v = (w->y + w->h - 1 - y) * HOSTAPI_WIDGET_SLIDER_MAX / (w->h > 1 ? w->h - 1 : 1);
+    } else {
+        v = (x - w->x) * HOSTAPI_WIDGET_SLIDER_MAX / (w->w > 1 ? w->w - 1 : 1);
+    }
+    if (v < 0) v = 0;
+    if (v > HOSTAPI_WIDGET_SLIDER_MAX) v = HOSTAPI_WIDGET_SLIDER_MAX;
+    if (v != w->value) {
+        w->value = v;
+        push_event(HOSTAPI_EV_WIDGET, (uint16_t)id, (int16_t)v, HOSTAPI_WIDGET_EV_CHANGED,
+                   time_ms);
+    }
+}
+
+static void widget_press(int id, int x, int y, uint32_t time_ms)
+{
+    s_widget_active = id;
+    s_widget_inside = true;
+    if (s_widgets[id].kind == HOSTAPI_WIDGET_SLIDER) widget_slider_track(id, x, y, time_ms);
+    s_redraw = true;
+}
+
+static void widget_release(int x, int y, uint32_t time_ms)
 {
-    size_t len = strlen(name);
-    return len > 4 && strcasecmp(name + len - 4, ".mp3") == 0;
+    WidgetSlot* w = &s_widgets[s_widget_active];
+    const int id = s_widget_active;
+    s_widget_active = -1;
+    s_redraw = true;
+    if (!w->kind || !widget_contains(w, x, y)) return; /* 部品外で離した */
+
+    if (w->kind == HOSTAPI_WIDGET_BUTTON) {
+        push_event(HOSTAPI_EV_WIDGET, (uint16_t)id, 0, HOSTAPI_WIDGET_EV_ACTIVATED, time_ms);
+    } else if (w->kind == HOSTAPI_WIDGET_TOGGLE) {
+        w->value = !w->value;
+        push_event(HOSTAPI_EV_WIDGET, (uint16_t)id, (int16_t)w->value,
+                   HOSTAPI_WIDGET_EV_CHANGED, time_ms);
+    }
 }
 
-int32_t native_hostapi_fs_list(wasm_exec_env_t exec_env, int32_t idx,
-                               char* buf, uint32_t buf_len)
+void host_sdl_push_touch(bool down, int x, int y, uint32_t time_ms)
 {
-    (void)exec_env;
-    if (idx < 0) return -1;
-
-    DIR* dir = opendir(MUSIC_ROOT);
-    if (!dir) return -1;
-
-    int32_t found = -1;
-    int32_t count = 0;
-    struct dirent* ent;
-    while ((ent = readdir(dir)) != NULL) {
-        if (ent->d_name[0] == '.') continue;
-        if (!has_mp3_ext(ent->d_name)) continue;
-        size_t name_len = strlen(ent->d_name);
-        if (name_len > 63) continue; /* 契約: 63 バイト超は列挙から除外 */
-
-        char full[512];
-        snprintf(full, sizeof(full), "%s/%s", MUSIC_ROOT, ent->d_name);
-        struct stat st;
-        if (stat(full, &st) != 0 || !S_ISREG(st.st_mode)) continue;
-
-        if (count == idx) {
-            uint32_t n = (name_len < buf_len) ? (uint32_t)name_len : buf_len;
-            memcpy(buf, ent->d_name, n);
-            found = (int32_t)n;
-            break;
+    /* 部品の上で始まったタッチは部品が消費する(TOUCH_* は配送しない) */
+    if (down) {
+        const int id = widget_hit(x, y);
+        if (id >= 0) {
+            widget_press(id, x, y, time_ms);
+            return;
         }
-        count++;
+    } else if (s_widget_active >= 0) {
+        widget_release(x, y, time_ms);
+        return;
     }
-    closedir(dir);
-    return found;
+
+    /* アプリを起動したクリックの UP(DOWN 未配送)はキュー側で捨てる */
+    push_touch_event(down ? HOSTAPI_EV_TOUCH_DOWN : HOSTAPI_EV_TOUCH_UP, x, y, time_ms);
 }
 
-/* ---- 入力イベントキュー (Phase 6A) ----
- * 実機と同じ規約: 深さ 16、満杯は最古から捨てる、DOWN 未配送の UP は捨てる。
- * Linux は main ループ単一スレッドなのでロック不要。 */
-static hostapi_event_t s_evq[EVENT_QUEUE_DEPTH];
-static int s_evq_head = 0;
-static int s_evq_count = 0;
-static bool s_down_delivered = false;
+void host_sdl_push_motion(int x, int y, uint32_t time_ms)
+{
+    if (s_widget_active < 0) {
+        /* タッチ外(DOWN 未配送)の MOVE はキュー側で捨てる */
+        push_touch_event(HOSTAPI_EV_TOUCH_MOVE, x, y, time_ms);
+        return;
+    }
+    WidgetSlot* w = &s_widgets[s_widget_active];
+    if (w->kind == HOSTAPI_WIDGET_SLIDER) {
+        widget_slider_track(s_widget_active, x, y, time_ms);
+        s_redraw = true;
+    } else if (widget_contains(w, x, y) != s_widget_inside) {
+        s_widget_inside = !s_widget_inside; /* 部品外に出たら押下色を解除 */
+        s_redraw = true;
+    }
+}
 
-void host_sdl_clear_events(void)
+bool host_sdl_take_redraw(void)
 {
-    s_evq_head = 0;
-    s_evq_count = 0;
-    s_down_delivered = false;
+    const bool r = s_redraw;
+    s_redraw = false;
+    return r;
 }
 
-void host_sdl_push_touch(bool down, int x, int y)
+void host_sdl_audio_config(int buf_frames, bool realtime)
 {
-    /* アプリを起動したクリックの UP がアプリに漏れないように */
-    if (!down && !s_down_delivered) return;
-    if (down) s_down_delivered = true;
+    /* SDL2 のバッファは 2 の冪 */
+    int n = AUDIO_BUF_MIN;
+    while (n < buf_frames && n < AUDIO_BUF_MAX) n <<= 1;
+    s_audio_want_frames = n;
+    s_audio_rt = realtime;
+}
 
-    if (s_evq_count == EVENT_QUEUE_DEPTH) { /* 満杯: 最古を捨てる */
-        s_evq_head = (s_evq_head + 1) % EVENT_QUEUE_DEPTH;
-        s_evq_count--;
-        fprintf(stderr, "event queue full, dropped oldest\n");
-    }
-    hostapi_event_t* ev = &s_evq[(s_evq_head + s_evq_count) % EVENT_QUEUE_DEPTH];
-    ev->type = down ? HOSTAPI_EV_TOUCH_DOWN : HOSTAPI_EV_TOUCH_UP;
-    ev->param = 0;
-    ev->x = (int16_t)x;
-    ev->y = (int16_t)y;
-    ev->time_ms = SDL_GetTicks() - s_start_ms;
-    s_evq_count++;
+SDL_Window* host_sdl_window(void)
+{
+    return s_window;
 }
 
 bool host_sdl_init(void)
@@ -519,40 +1890,89 @@ bool host_sdl_init(void)
         return false;
     }
     SDL_RenderSetLogicalSize(s_renderer, SCREEN_W, SCREEN_H);
+#ifdef HOST_X11_INPUT_TIME
+    /* 入力の打刻に X サーバの時刻を使う(host_sdl_input_syswm) */
+    const char* driver = SDL_GetCurrentVideoDriver();
+    if (driver && strcmp(driver, "x11") == 0) SDL_EventState(SDL_SYSWMEVENT, SDL_ENABLE);
+#endif
 
 #ifdef HAVE_SDL_TTF
     try_open_font();
 #endif
 
     s_start_ms = SDL_GetTicks();
-
+    s_perf_origin = SDL_GetPerformanceCounter();
+
+    hostapi_voices_init(&s_voices, HOSTAPI_VOICE_DEFAULT);
+    hostapi_tcache_init(&s_tone_cache, s_tone_cache_pcm, HOSTAPI_TCACHE_MAX_ENTRIES, CLICK_RATE);
+    hostapi_voices_set_cache(&s_voices, &s_tone_cache);
+    hostapi_voices_prepare(&s_voices, CLICK_RATE, kDefaultClick.freq_hz, kDefaultClick.dur_ms,
+                           kDefaultClick.level);
+    hostapi_mix_init(&s_mix);
+    hostapi_mix_set_gain(&s_mix, HOSTAPI_MIX_MUSIC, 98);
+    hostapi_notes_init(&s_notes, CLICK_RATE);
+    hostapi_mix_set_notes(&s_mix, &s_notes);
+    hostapi_sample_cache_init(&s_samples, malloc(SAMPLE_CACHE_BYTES), SAMPLE_CACHE_BYTES);
+    hostapi_acmd_init(&s_acmd);
+    hostapi_acmd_init(&s_acmd_gone);
+    hostapi_tsched_reset(&s_tsched_ui);
+    hostapi_playlist_init(&s_playlist);
     SDL_AudioSpec want, have;
     SDL_zero(want);
     want.freq = CLICK_RATE;
     want.format = AUDIO_S16SYS;
     want.channels = 2;
-    want.samples = 1024; /* コールバック粒度 ~23ms(発音自体はバッファ内オフセットでサンプル精度) */
+    /* コールバック粒度(既定 ~23ms。発音自体はバッファ内オフセットでサンプル精度) */
+    want.samples = (Uint16)s_audio_want_frames;
     want.callback = audio_callback;
     s_audio = SDL_OpenAudioDevice(NULL, 0, &want, &have, 0);
     if (!s_audio) {
         fprintf(stderr, "SDL_OpenAudioDevice failed: %s (continuing without sound)\n",
                 SDL_GetError());
     } else {
+        hostapi_lathist_init(&s_cb_hist, (uint32_t)((uint64_t)have.samples * 1000000 / have.freq));
+        s_audio_buf_frames = have.samples;
+        hostapi_xrun_init(&s_xrun, (uint32_t)have.freq, have.samples);
+        s_audio_out_us = (uint32_t)((uint64_t)have.samples * AUDIO_OUT_PERIODS * 1000000 / have.freq);
+        if (have.samples != s_audio_want_frames) {
+            fprintf(stderr, "audio: buffer %d frames requested, device gave %d\n",
+                    s_audio_want_frames, have.samples);
+        }
         SDL_PauseAudioDevice(s_audio, 0);
     }
 
 #ifdef HAVE_SDL_MIXER
     if ((Mix_Init(MIX_INIT_MP3) & MIX_INIT_MP3) == 0) {
-        /* click デバイスとは独立(OS ミキサで混合) */
         fprintf(stderr, "Mix_Init(MP3) failed: %s (audio_play disabled)\n",
                 Mix_GetError());
     } else if (Mix_OpenAudio(44100, MIX_DEFAULT_FORMAT, 2, 1024) != 0) {
         fprintf(stderr, "Mix_OpenAudio failed: %s (audio_play disabled)\n",
                 Mix_GetError());
     } else {
-        s_mixer_ready = true;
+        s_music_lock = SDL_CreateMutex();
+        s_music_switch_sem = SDL_CreateSemaphore(0);
+        s_music_switch_thread =
+            SDL_CreateThread(music_switch_thread, "music_switch", NULL);
+        s_mixer_ready = s_music_lock && s_music_switch_sem && s_music_switch_thread;
+        if (!s_mixer_ready) {
+            fprintf(stderr, "mixer: switch thread: %s (audio_play disabled)\n", SDL_GetError());
+        }
         Mix_HookMusicFinished(music_finished_hook);
-        Mix_VolumeMusic(98 * MIX_MAX_VOLUME / 100); /* 実機の既定音量 98 に合わせる */
+        int freq = 0, channels = 0;
+        Uint16 format = 0;
+        Mix_QuerySpec(&freq, &format, &channels);
+        if (s_audio && format == AUDIO_S16SYS && (channels == 1 || channels == 2)) {
+            /* 出力ミキサ経由(音量はミキサの MUSIC ゲイン) */
+            hostapi_resamp_init(&s_music_resamp, (uint32_t)freq, CLICK_RATE, channels);
+            Mix_VolumeMusic(MIX_MAX_VOLUME);
+            __atomic_store_n(&s_music_routed, true, __ATOMIC_RELEASE);
+            Mix_SetPostMix(music_postmix, NULL);
+        } else {
+            /* 想定外のフォーマット: SDL_mixer のデバイスから直接鳴らす(OS ミキサで混合) */
+            fprintf(stderr, "mixer: music format %d Hz/0x%x/%dch not routed\n", freq,
+                    (unsigned)format, channels);
+            Mix_VolumeMusic(98 * MIX_MAX_VOLUME / 100); /* 実機の既定音量 98 に合わせる */
+        }
     }
 #endif
 
@@ -567,10 +1987,46 @@ void host_sdl_shutdown(void)
 #endif
 #ifdef HAVE_SDL_MIXER
     host_sdl_audio_reset();
+    if (s_music_switch_thread) {
+        __atomic_store_n(&s_music_switch_quit, 1, __ATOMIC_RELEASE);
+        SDL_SemPost(s_music_switch_sem);
+        SDL_WaitThread(s_music_switch_thread, NULL);
+        s_music_switch_thread = NULL;
+    }
+    if (s_music_switch_sem) SDL_DestroySemaphore(s_music_switch_sem);
+    if (s_music_lock) SDL_DestroyMutex(s_music_lock);
+    s_music_switch_sem = NULL;
+    s_music_lock = NULL;
+    if (s_music_routed) {
+        fprintf(stderr, "mixer: music ring overruns=%u underruns=%u, limiter blocks=%u\n",
+                (unsigned)s_music_overruns, (unsigned)s_music_underruns,
+                (unsigned)s_mix.limited);
+    }
     if (s_mixer_ready) Mix_CloseAudio();
     Mix_Quit();
 #endif
-    if (s_audio) SDL_CloseAudioDevice(s_audio);
+    if (s_audio) {
+        SDL_CloseAudioDevice(s_audio);
+        /* コールバックが止まってから読む */
+        hostapi_lathist_print(stderr, "audio callback", &s_cb_hist);
+        fprintf(stderr, "audio: buffer %d frames (%.1f ms)%s, underruns %u (~%.1f ms lost)\n",
+                s_audio_buf_frames, s_audio_buf_frames * 1000.0 / CLICK_RATE,
+                s_audio_rt ? ", realtime" : "", (unsigned)s_xrun.xruns,
+                s_xrun.lost_us / 1000.0);
+        if (s_sched_lat_all.count > 0) {
+            fprintf(stderr,
+                    "audio: sched->DAC (est., +%.1f ms device latency): min=%+.1f avg=%+.1f "
+                    "max=%+.1f ms (n=%u)\n",
+                    s_audio_out_us / 1000.0, s_sched_lat_all.min_us / 1000.0,
+                    (double)s_sched_lat_all.sum_us / s_sched_lat_all.count / 1000.0,
+                    s_sched_lat_all.max_us / 1000.0, (unsigned)s_sched_lat_all.count);
+        }
+        fprintf(stderr, "audio commands: high water %u/%u, full %u; gone full %u\n",
+                (unsigned)s_acmd.high_water, HOSTAPI_ACMD_DEPTH, (unsigned)s_acmd.full,
+                (unsigned)s_acmd_gone.full);
+    }
+    capture_stop();
+    free(s_samples.arena);
     if (s_renderer) SDL_DestroyRenderer(s_renderer);
     if (s_window) SDL_DestroyWindow(s_window);
     SDL_Quit();
@@ -617,12 +2073,66 @@ static void draw_string(int x, int y, const char* s, uint32_t rgb888)
     }
 }
 
+/* draw_string で描いたときの幅/高さ(論理ピクセル) */
+static void string_size(const char* s, int* w, int* h)
+{
+#ifdef HAVE_SDL_TTF
+    if (s_font) {
+        int tw = 0, th = 0;
+        TTF_SizeUTF8(s_font, s, &tw, &th);
+        *w = tw / WINDOW_SCALE;
+        *h = th / WINDOW_SCALE;
+        return;
+    }
+#endif
+    *w = (int)strlen(s) * 8;
+    *h = 8;
+}
+
+static void fill_rect_rgb(int x, int y, int w, int h, uint32_t rgb888)
+{
+    SDL_SetRenderDrawColor(s_renderer, (rgb888 >> 16) & 0xff, (rgb888 >> 8) & 0xff,
+                           rgb888 & 0xff, 255);
+    SDL_Rect rect = { x, y, w, h };
+    SDL_RenderFillRect(s_renderer, &rect);
+}
+
+static void render_widget(int id)
+{
+    const WidgetSlot* w = &s_widgets[id];
+    const bool pressed = (id == s_widget_active) && s_widget_inside;
+
+    uint32_t bg = WIDGET_COLOR_BG;
+    if (w->kind == HOSTAPI_WIDGET_TOGGLE && w->value) bg = WIDGET_COLOR_ON;
+    if (pressed) bg = WIDGET_COLOR_PRESSED;
+    fill_rect_rgb(w->x, w->y, w->w, w->h, bg);
+
+    if (w->kind == HOSTAPI_WIDGET_SLIDER) {
+        if (w->h > w->w) {
+            const int fh = w->h * w->value / HOSTAPI_WIDGET_SLIDER_MAX;
+            fill_rect_rgb(w->x, w->y + w->h - fh, w->w, fh, WIDGET_COLOR_FILL);
+        } else {
+            const int fw = w->w * w->value / HOSTAPI_WIDGET_SLIDER_MAX;
+            fill_rect_rgb(w->x, w->y, fw, w->h, WIDGET_COLOR_FILL);
+        }
+    }
+
+    if (w->label[0]) {
+        int tw, th;
+        string_size(w->label, &tw, &th);
+        draw_string(w->x + (w->w - tw) / 2, w->y + (w->h - th) / 2, w->label, 0xffffff);
+    }
+}
+
 /* ---- 直描画ヘルパ(ランチャーメニュー用。retained スロットとは別系統) ---- */
 
 void host_sdl_clear_slots(void)
 {
     memset(s_texts, 0, sizeof(s_texts));
     memset(s_rects, 0, sizeof(s_rects));
+    for (int i = 0; i < HOSTAPI_LINE_SLOTS; ++i) s_lines[i].n = 0;
+    memset(s_widgets, 0, sizeof(s_widgets));
+    s_widget_active = -1;
 }
 
 void host_sdl_begin_frame(uint32_t rgb888)
@@ -693,12 +2203,28 @@ void host_sdl_render(void)
         SDL_RenderFillRect(s_renderer, &rect);
     }
 
+    for (int i = 0; i < HOSTAPI_LINE_SLOTS; ++i) {
+        const LineSlot* l = &s_lines[i];
+        if (l->n == 0) continue;
+        SDL_SetRenderDrawColor(s_renderer, (l->rgb888 >> 16) & 0xff,
+                               (l->rgb888 >> 8) & 0xff, l->rgb888 & 0xff, 255);
+        if (l->points) {
+            SDL_RenderDrawPoints(s_renderer, l->pts, l->n);
+        } else {
+            SDL_RenderDrawLines(s_renderer, l->pts, l->n);
+        }
+    }
+
     for (int i = 0; i < MAX_TEXT_SLOTS; ++i) {
         if (!s_texts[i].used) continue;
         const TextSlot* t = &s_texts[i];
         draw_string(t->x, t->y, t->text, 0xffffff);
     }
 
+    for (int id = 0; id < HOSTAPI_WIDGET_SLOTS; ++id) {
+        if (s_widgets[id].kind) render_widget(id);
+    }
+
     SDL_RenderPresent(s_renderer);
 }
 
@@ -760,16 +2286,118 @@ void native_hostapi_fill_rect(wasm_exec_env_t exec_env, int32_t x, int32_t y,
     slot->used = true;
 }
 
-/* slot を解決してコピーを返す(未定義なら false)。ロック外から呼ぶこと */
+/* draw_lines / draw_points 共通。pts は int16 (x,y) 組の配列(WAMR 境界検証済み、
+ * アラインメント保証なしなので memcpy で読む) */
+static int32_t line_slot_set(int32_t slot, const char* pts, uint32_t len,
+                             uint32_t rgb888, bool points)
+{
+    if (slot < 0 || slot >= HOSTAPI_LINE_SLOTS) return -1;
+    if (len % 4 != 0) return -1;
+    uint32_t n = len / 4;
+    if (n > HOSTAPI_LINE_MAX_POINTS) {
+        fprintf(stderr, "%s: %u points truncated to %d\n",
+                points ? "draw_points" : "draw_lines", n, HOSTAPI_LINE_MAX_POINTS);
+        n = HOSTAPI_LINE_MAX_POINTS;
+    }
+    LineSlot* l = &s_lines[slot];
+    for (uint32_t i = 0; i < n; ++i) {
+        int16_t xy[2];
+        memcpy(xy, pts + i * 4, sizeof(xy));
+        l->pts[i].x = xy[0];
+        l->pts[i].y = xy[1];
+    }
+    l->n = (int)n;
+    l->points = points;
+    l->rgb888 = rgb888;
+    return 0;
+}
+
+int32_t native_hostapi_draw_lines(wasm_exec_env_t exec_env, int32_t slot,
+                                  const char* pts, uint32_t len, uint32_t rgb888)
+{
+    (void)exec_env;
+    return line_slot_set(slot, pts, len, rgb888, false);
+}
+
+int32_t native_hostapi_draw_points(wasm_exec_env_t exec_env, int32_t slot,
+                                   const char* pts, uint32_t len, uint32_t rgb888)
+{
+    (void)exec_env;
+    return line_slot_set(slot, pts, len, rgb888, true);
+}
+
+int32_t native_hostapi_widget_create(wasm_exec_env_t exec_env, int32_t id, int32_t kind,
+                                     int32_t x, int32_t y, int32_t w, int32_t h,
+                                     const char* label, uint32_t len)
+{
+    (void)exec_env;
+    if (id < 0 || id >= HOSTAPI_WIDGET_SLOTS) return -1;
+    if (kind < HOSTAPI_WIDGET_BUTTON || kind > HOSTAPI_WIDGET_SLIDER) return -1;
+    if (w <= 0 || h <= 0) return -1;
+
+    WidgetSlot* ws = &s_widgets[id];
+    if (len > MAX_TEXT_LEN) len = MAX_TEXT_LEN;
+    memcpy(ws->label, label, len);
+    ws->label[len] = '\0';
+    ws->kind = kind;
+    ws->x = x;
+    ws->y = y;
+    ws->w = w;
+    ws->h = h;
+    ws->value = 0;
+    if (s_widget_active == id) s_widget_active = -1; /* 押下中の置き換えは押下を破棄 */
+    return 0;
+}
+
+int32_t native_hostapi_widget_set_value(wasm_exec_env_t exec_env, int32_t id, int32_t value)
+{
+    (void)exec_env;
+    if (id < 0 || id >= HOSTAPI_WIDGET_SLOTS) return -1;
+    WidgetSlot* ws = &s_widgets[id];
+    if (ws->kind == HOSTAPI_WIDGET_TOGGLE) {
+        ws->value = value ? 1 : 0;
+    } else if (ws->kind == HOSTAPI_WIDGET_SLIDER) {
+        if (value < 0) value = 0;
+        if (value > HOSTAPI_WIDGET_SLIDER_MAX) value = HOSTAPI_WIDGET_SLIDER_MAX;
+        ws->value = value;
+    } else {
+        return -1;
+    }
+    return 0;
+}
+
+int32_t native_hostapi_widget_get_value(wasm_exec_env_t exec_env, int32_t id)
+{
+    (void)exec_env;
+    if (id < 0 || id >= HOSTAPI_WIDGET_SLOTS) return -1;
+    const WidgetSlot* ws = &s_widgets[id];
+    if (ws->kind != HOSTAPI_WIDGET_TOGGLE && ws->kind != HOSTAPI_WIDGET_SLIDER) return -1;
+    return ws->value;
+}
+
+int32_t native_hostapi_widget_delete(wasm_exec_env_t exec_env, int32_t id)
+{
+    (void)exec_env;
+    if (id < 0 || id >= HOSTAPI_WIDGET_SLOTS) return -1;
+    memset(&s_widgets[id], 0, sizeof(s_widgets[id]));
+    if (s_widget_active == id) s_widget_active = -1;
+    return 0;
+}
+
+/* slot を解決してコピーを返す(未定義なら false) */
 static bool tone_lookup(int32_t slot, ToneDef* out)
 {
-    if (slot < 0 || slot >= HOSTAPI_TONE_SLOTS) return false;
-    bool ok;
-    SDL_LockAudioDevice(s_audio);
-    ok = s_tones[slot].defined;
-    if (ok) *out = s_tones[slot];
-    SDL_UnlockAudioDevice(s_audio);
-    return ok;
+    if (slot < 0 || slot >= HOSTAPI_TONE_SLOTS || !s_tones[slot].defined) return false;
+    *out = s_tones[slot];
+    return true;
+}
+
+static hostapi_tsched_entry_t tone_entry(const ToneDef* t, uint32_t time_ms, int32_t id)
+{
+    hostapi_tsched_entry_t e = hostapi_tsched_tone_entry(t->freq_hz, t->dur_ms, t->level);
+    e.time_us = (int64_t)time_ms * 1000;
+    e.id = id;
+    return e;
 }
 
 static int32_t tone_play_impl(int32_t slot)
@@ -778,61 +2406,217 @@ static int32_t tone_play_impl(int32_t slot)
     ToneDef tone;
     if (!tone_lookup(slot, &tone)) return -1;
     /* 即時発音 = 次のコールバックバッファ先頭で開始 */
-    SDL_LockAudioDevice(s_audio);
-    s_asap_tone = tone;
-    s_click_asap = true;
-    SDL_UnlockAudioDevice(s_audio);
+    const hostapi_tsched_entry_t e = tone_entry(&tone, 0, 0);
+    if (!acmd_send(HOSTAPI_ACMD_PLAY, 0, &e)) return -1;
+    capture_log(HOSTAPI_CAPTURE_PLAY, &e, host_sdl_now_ms());
     return 0;
 }
 
+/* 写しに積んでからコールバックへ送る。送れなければ写しからも外す */
+static bool tsched_ui_insert(hostapi_tsched_entry_t* e)
+{
+    e->seq = s_tsched_ui.seq; /* insert が振る seq(コールバック側も同じ値で積む) */
+    if (!hostapi_tsched_insert(&s_tsched_ui, e)) return false;
+    if (!acmd_send(HOSTAPI_ACMD_INSERT, 0, e)) {
+        hostapi_tsched_remove_seq(&s_tsched_ui, e->seq);
+        return false;
+    }
+    return true;
+}
+
 static int32_t tone_schedule_impl(int32_t slot, int32_t time_ms)
 {
     if (!s_audio) return -1;
     const uint32_t t = (uint32_t)time_ms;
-    const uint32_t now = SDL_GetTicks() - s_start_ms;
+    const uint32_t now = host_sdl_now_ms(); /* 仮想時計ならオフライン描画と同じ時計 */
 
+    acmd_sync();
     if (t == 0) { /* キャンセル(slot によらず有効) */
-        SDL_LockAudioDevice(s_audio);
-        s_click_pending = 0;
-        SDL_UnlockAudioDevice(s_audio);
+        hostapi_tsched_cancel_legacy(&s_tsched_ui);
+        acmd_send_wait(HOSTAPI_ACMD_CANCEL_LEGACY, 0);
         return 0;
     }
 
     ToneDef tone;
     if (!tone_lookup(slot, &tone)) return -1;
 
-    bool scheduled = false;
-    bool fire_old = false;
-    uint32_t last_fired_snapshot = 0;
-    SDL_LockAudioDevice(s_audio);
-    if (t > s_click_last_fired) {
-        /* 置き換えガード: 期限到来済みの未発火予約を破棄しない。
-         * 先にその予約を「可及的速やか」に発音扱いにしてから置き換える */
-        if (s_click_pending != 0 && s_click_pending != t &&
-            s_click_pending <= now && s_click_pending > s_click_last_fired) {
-            s_click_last_fired = s_click_pending;
-            s_asap_tone = s_pending_tone;
-            s_click_asap = true;
-            fire_old = true;
-        }
-        s_click_pending = t; /* 置き換え予約(last_fired 以前は無視) */
-        s_pending_tone = tone; /* 予約時スナップショット */
-        scheduled = true;
-        last_fired_snapshot = s_click_last_fired;
-    }
-    SDL_UnlockAudioDevice(s_audio);
+    /* 置き換え予約(last_fired 以前は無視、トーンは予約時スナップショット)。
+     * 置き換えガード: 期限到来済みの未発火予約は破棄せず、先に「可及的
+     * 速やか」に発音扱いにしてから置き換える。写しで判定し、コールバックが
+     * 同じ判定をやり直して旧予約の発音と発音通知をする */
+    hostapi_tsched_entry_t old;
+    bool fire_old;
+    const uint32_t seq = s_tsched_ui.seq;
+    const bool scheduled =
+        hostapi_tsched_set_legacy(&s_tsched_ui, t, now, &s_ui_last_fired, tone.freq_hz,
+                                  tone.dur_ms, tone.level, &old, &fire_old);
     if (scheduled) {
         /* Phase 8b: 新しい予約(t)が確定した時点でテンポを staging する。
-         * fire_old で旧予約を発音扱いにする場合は、その通知より先に行う
-         * (旧拍の発音通知が最新テンポを picks up できるように)。 */
+         * fire_old で旧予約を発音扱いにする場合は、その通知(コールバックが
+         * コマンドを適用するとき)より先に行う(旧拍の発音通知が最新テンポを
+         * picks up できるように)。 */
         host_midi_notify_beat_scheduled(t);
-        if (fire_old) {
-            host_midi_notify_beat_fired(last_fired_snapshot);
+        hostapi_tsched_entry_t e = tone_entry(&tone, t, 0);
+        e.seq = seq;
+        if (!acmd_send(HOSTAPI_ACMD_SET_LEGACY, (int32_t)now, &e)) {
+            hostapi_tsched_remove_seq(&s_tsched_ui, seq);
+            return -1;
         }
     }
     return 0;
 }
 
+/* 予約を 1 件追加する(置き換えない)。発音はコールバックがサンプル精度で行う。
+ * 時刻は µs(ms の API は × 1000、aclock = µs の API) */
+static int32_t tone_enqueue_impl(int32_t slot, int64_t time_us, bool aclock)
+{
+    if (!s_audio) return -1;
+    ToneDef tone;
+    if (!tone_lookup(slot, &tone)) return -1;
+    hostapi_tsched_entry_t e = tone_entry(&tone, 0, 0);
+    if (!hostapi_tsched_set_time_us(&e, time_us, aclock)) return -1;
+    acmd_sync();
+    e.id = hostapi_tsched_next_id(&s_tsched_ui);
+    return tsched_ui_insert(&e) ? e.id : -1;
+}
+
+static int32_t tone_cancel_impl(int32_t id)
+{
+    if (!s_audio || id < 0) return -1;
+    acmd_sync();
+    if (id == 0) {
+        hostapi_tsched_clear(&s_tsched_ui); /* last_fired は保つ */
+        acmd_send_wait(HOSTAPI_ACMD_CLEAR, 0);
+        return 0;
+    }
+    if (!hostapi_tsched_remove_id(&s_tsched_ui, id)) return -1;
+    acmd_send_wait(HOSTAPI_ACMD_REMOVE_ID, id);
+    return 0;
+}
+
+/* ---- サンプル ---- */
+
+/* path(ミュージックルート相対)をデコードしてキャッシュに置く。読み込みと
+ * デコードはロック外(未公開のアリーナ域に書くのでコールバックと競合しない) */
+static bool has_ext(const char* path, uint32_t len, const char* ext)
+{
+    const size_t n = strlen(ext);
+    return len > n && strncasecmp(path + len - n, ext, n) == 0;
+}
+
+static int32_t sample_load_impl(const char* path, uint32_t len)
+{
+    if (!s_audio || !audio_path_ok(path, len)) return -1;
+    const int found = hostapi_sample_cache_find(&s_samples, path, len);
+    if (found >= 0) return found;
+    char full[256];
+    snprintf(full, sizeof(full), "%s/%.*s", MUSIC_ROOT, (int)len, path);
+    FILE* f = fopen(full, "rb");
+    if (!f) {
+        fprintf(stderr, "sample_load: %s: cannot open\n", full);
+        return -1;
+    }
+    const bool raw = has_ext(path, len, ".raw") || has_ext(path, len, ".pcm");
+    const int h = hostapi_sample_decode(&s_samples, path, len, f, raw, CLICK_RATE);
+    fclose(f);
+    if (h < 0) {
+        fprintf(stderr, "sample_load: %s: unsupported or cache full (%u/%u bytes used)\n",
+                full, (unsigned)s_samples.used, (unsigned)s_samples.cap);
+        return -1;
+    }
+    printf("sample_load: %s -> %d (%u frames, %u ch)\n", full, h,
+           (unsigned)s_samples.s[h].frames, (unsigned)s_samples.s[h].channels);
+    return h;
+}
+
+static uint8_t sample_level(int32_t level)
+{
+    if (level < 0) level = 0;
+    if (level > 100) level = 100;
+    return (uint8_t)level;
+}
+
+static int32_t sample_play_impl(int32_t handle, int32_t level)
+{
+    if (!s_audio || !hostapi_sample_get(&s_samples, handle)) return -1;
+    const hostapi_tsched_entry_t e =
+        hostapi_tsched_sample_entry((int16_t)handle, sample_level(level));
+    if (!acmd_send(HOSTAPI_ACMD_PLAY, 0, &e)) return -1;
+    capture_log(HOSTAPI_CAPTURE_PLAY, &e, host_sdl_now_ms());
+    return 0;
+}
+
+/* tone_enqueue と同じキューに積む(取り消しは tone_cancel) */
+static int32_t sample_schedule_impl(int32_t handle, int64_t time_us, bool aclock,
+                                    int32_t level)
+{
+    if (!s_audio || !hostapi_sample_get(&s_samples, handle)) return -1;
+    hostapi_tsched_entry_t e = hostapi_tsched_sample_entry((int16_t)handle, sample_level(level));
+    if (!hostapi_tsched_set_time_us(&e, time_us, aclock)) return -1;
+    acmd_sync();
+    e.id = hostapi_tsched_next_id(&s_tsched_ui);
+    return tsched_ui_insert(&e) ? e.id : -1;
+}
+
+/* ---- 持続音(note_on / note_off) ----
+ * 即時は PLAY、予約は tone_enqueue と同じキューに INSERT で送る。発音も
+ * エンベロープもコールバック側(s_notes)が持つ */
+
+static int32_t note_send(hostapi_tsched_entry_t* e, int64_t time_us, bool aclock)
+{
+    if (!s_audio || time_us < 0) return -1;
+    if (time_us == 0) {
+        if (!acmd_send(HOSTAPI_ACMD_PLAY, 0, e)) return -1;
+        capture_log(HOSTAPI_CAPTURE_PLAY, e, host_sdl_now_ms());
+        return 0;
+    }
+    if (!hostapi_tsched_set_time_us(e, time_us, aclock)) return -1;
+    acmd_sync();
+    e->id = hostapi_tsched_next_id(&s_tsched_ui);
+    return tsched_ui_insert(e) ? e->id : -1;
+}
+
+static int32_t note_on_impl(int32_t ch, int32_t slot, int32_t pitch, int32_t velocity,
+                            int64_t time_us, bool aclock)
+{
+    if (ch < 0 || ch >= HOSTAPI_NOTE_CHANNELS || slot < 0 || slot >= HOSTAPI_NOTE_ENVS ||
+        pitch < 0 || pitch > HOSTAPI_NOTE_PITCH_MAX) {
+        return -1;
+    }
+    if (velocity > 127) velocity = 127;
+    hostapi_tsched_entry_t e =
+        velocity <= 0 ? hostapi_tsched_note_entry(HOSTAPI_TSCHED_NOTE_OFF, ch, 0, 0, 0)
+                      : hostapi_tsched_note_entry(HOSTAPI_TSCHED_NOTE_ON, ch, slot, pitch,
+                                                  velocity);
+    return note_send(&e, time_us, aclock);
+}
+
+static int32_t note_off_impl(int32_t ch, int64_t time_us, bool aclock)
+{
+    if (ch < 0 || ch >= HOSTAPI_NOTE_CHANNELS) return -1;
+    hostapi_tsched_entry_t e = hostapi_tsched_note_entry(HOSTAPI_TSCHED_NOTE_OFF, ch, 0, 0, 0);
+    return note_send(&e, time_us, aclock);
+}
+
+static int32_t note_env_ms(int32_t ms)
+{
+    if (ms < 0) return 0;
+    return ms > HOSTAPI_NOTE_ENV_MAX_MS ? HOSTAPI_NOTE_ENV_MAX_MS : ms;
+}
+
+static int32_t note_define_impl(int32_t slot, int32_t attack_ms, int32_t decay_ms,
+                                int32_t sustain, int32_t release_ms)
+{
+    if (!s_audio || slot < 0 || slot >= HOSTAPI_NOTE_ENVS) return -1;
+    if (sustain < 0) sustain = 0;
+    if (sustain > 100) sustain = 100;
+    hostapi_tsched_entry_t e = hostapi_tsched_note_entry(0, 0, slot, 0, sustain);
+    e.freq_hz = (uint16_t)note_env_ms(attack_ms);
+    e.dur_ms = (uint16_t)note_env_ms(decay_ms);
+    /* 後続の note_on より先に届かないと意味が無いので取りこぼさない */
+    return acmd_send_entry_wait(HOSTAPI_ACMD_NOTE_ENV, note_env_ms(release_ms), &e) ? 0 : -1;
+}
+
 void native_hostapi_play_click(wasm_exec_env_t exec_env)
 {
     (void)exec_env;
@@ -861,9 +2645,10 @@ int32_t native_hostapi_tone_define(wasm_exec_env_t exec_env, int32_t slot,
     if (level < 0) level = 0;
     if (level > 100) level = 100;
 
-    SDL_LockAudioDevice(s_audio);
     s_tones[slot] = (ToneDef){true, (uint16_t)freq_hz, (uint16_t)dur_ms, (uint8_t)level};
-    SDL_UnlockAudioDevice(s_audio);
+    /* 最初の発音より前に描かせておく(取りこぼしても最初の発音で描くだけ) */
+    const hostapi_tsched_entry_t e = tone_entry(&s_tones[slot], 0, 0);
+    acmd_send(HOSTAPI_ACMD_PREPARE, 0, &e);
     return 0;
 }
 
@@ -880,11 +2665,127 @@ int32_t native_hostapi_tone_schedule(wasm_exec_env_t exec_env, int32_t slot,
     return tone_schedule_impl(slot, time_ms);
 }
 
+int32_t native_hostapi_tone_enqueue(wasm_exec_env_t exec_env, int32_t slot, int32_t time_ms)
+{
+    (void)exec_env;
+    return tone_enqueue_impl(slot, (int64_t)(uint32_t)time_ms * 1000, false);
+}
+
+int32_t native_hostapi_tone_enqueue_us(wasm_exec_env_t exec_env, int32_t slot, int64_t time_us)
+{
+    (void)exec_env;
+    return tone_enqueue_impl(slot, time_us, true);
+}
+
+int32_t native_hostapi_tone_cancel(wasm_exec_env_t exec_env, int32_t id)
+{
+    (void)exec_env;
+    return tone_cancel_impl(id);
+}
+
+int32_t native_hostapi_sample_load(wasm_exec_env_t exec_env, const char* path, uint32_t len)
+{
+    (void)exec_env;
+    return sample_load_impl(path, len);
+}
+
+int32_t native_hostapi_sample_play(wasm_exec_env_t exec_env, int32_t handle, int32_t level)
+{
+    (void)exec_env;
+    return sample_play_impl(handle, level);
+}
+
+int32_t native_hostapi_sample_schedule(wasm_exec_env_t exec_env, int32_t handle,
+                                       int32_t time_ms, int32_t level)
+{
+    (void)exec_env;
+    return sample_schedule_impl(handle, (int64_t)(uint32_t)time_ms * 1000, false, level);
+}
+
+int32_t native_hostapi_sample_schedule_us(wasm_exec_env_t exec_env, int32_t handle,
+                                          int64_t time_us, int32_t level)
+{
+    (void)exec_env;
+    return sample_schedule_impl(handle, time_us, true, level);
+}
+
+int32_t native_hostapi_note_define(wasm_exec_env_t exec_env, int32_t slot, int32_t attack_ms,
+                                   int32_t decay_ms, int32_t sustain, int32_t release_ms)
+{
+    (void)exec_env;
+    return note_define_impl(slot, attack_ms, decay_ms, sustain, release_ms);
+}
+
+int32_t native_hostapi_note_on(wasm_exec_env_t exec_env, int32_t ch, int32_t slot,
+                               int32_t pitch, int32_t velocity, int32_t time_ms)
+{
+    (void)exec_env;
+    return note_on_impl(ch, slot, pitch, velocity, (int64_t)(uint32_t)time_ms * 1000, false);
+}
+
+int32_t native_hostapi_note_on_us(wasm_exec_env_t exec_env, int32_t ch, int32_t slot,
+                                  int32_t pitch, int32_t velocity, int64_t time_us)
+{
+    (void)exec_env;
+    return note_on_impl(ch, slot, pitch, velocity, time_us, true);
+}
+
+int32_t native_hostapi_note_off(wasm_exec_env_t exec_env, int32_t ch, int32_t time_ms)
+{
+    (void)exec_env;
+    return note_off_impl(ch, (int64_t)(uint32_t)time_ms * 1000, false);
+}
+
+int32_t native_hostapi_note_off_us(wasm_exec_env_t exec_env, int32_t ch, int64_t time_us)
+{
+    (void)exec_env;
+    return note_off_impl(ch, time_us, true);
+}
+
 uint32_t native_hostapi_now_ms(wasm_exec_env_t exec_env)
 {
     (void)exec_env;
     /* SDL_GetTicks は内部で CLOCK_MONOTONIC 相当。起動からの経過 ms を返す */
-    return SDL_GetTicks() - s_start_ms;
+    return host_sdl_now_ms();
+}
+
+/* 音声クロックに揃えた µs(shared/hostapi_aclock.h)。壁時計(パフォーマンス
+ * カウンタ)からコールバックが公開したずれを引く。音声が始まる前・デバイスが
+ * 無ければ壁時計のまま。仮想時計(--headless)では仮想時計そのもの */
+static int64_t now_us64(void)
+{
+    if (s_clock_virtual) return (int64_t)s_clock_virtual_ms * 1000;
+    static int64_t s_last; /* wasm スレッドだけが読む */
+    uint64_t frames;
+    int64_t frames_us, offset_us;
+    hostapi_aclock_read(&s_aclock, &frames, &frames_us, &offset_us);
+    return hostapi_aclock_monotonic(&s_last,
+                                    audio_perf_us(SDL_GetPerformanceCounter()) - offset_us);
+}
+
+int32_t native_hostapi_now_us64(wasm_exec_env_t exec_env, char* buf, uint32_t len)
+{
+    (void)exec_env;
+    const int64_t t = now_us64();
+    if (!buf || len < sizeof(t)) return -1;
+    memcpy(buf, &t, sizeof(t));
+    return (int32_t)sizeof(t);
+}
+
+int32_t native_hostapi_audio_get_clock(wasm_exec_env_t exec_env, char* buf, uint32_t len)
+{
+    (void)exec_env;
+    hostapi_audio_clock_t c;
+    if (!buf || len < sizeof(c) || !s_audio) return -1;
+    memset(&c, 0, sizeof(c));
+    int64_t offset_us;
+    const bool started = hostapi_aclock_read(&s_aclock, &c.frames, &c.frames_us, &offset_us);
+    c.now_us = now_us64();
+    if (!started) c.frames_us = c.now_us; /* 最初のコールバック前: 次に描くのは今 */
+    c.rate = CLICK_RATE;
+    c.latency_us = s_audio_offline ? 0 : s_audio_out_us;
+    memcpy(buf, &c, sizeof(c));
+    return (int32_t)sizeof(c);
 }
 
 /* buf は WAMR 境界検証済み(シグネチャ "*~")。書いた件数を返す */
@@ -893,11 +2794,14 @@ int32_t native_hostapi_poll_event(wasm_exec_env_t exec_env, char* buf, uint32_t
     (void)exec_env;
     const uint32_t max_events = len / sizeof(hostapi_event_t);
     int32_t n = 0;
-    while (n < (int32_t)max_events && s_evq_count > 0) {
-        memcpy(buf + n * sizeof(hostapi_event_t), &s_evq[s_evq_head],
-               sizeof(hostapi_event_t));
-        s_evq_head = (s_evq_head + 1) % EVENT_QUEUE_DEPTH;
-        s_evq_count--;
+    hostapi_event_t ev;
+    audio_refresh_finished(); /* 曲の切り替えを取り込む */
+    while (n < (int32_t)max_events && hostapi_playlist_take_event(&s_playlist, &ev)) {
+        memcpy(buf + n * sizeof(hostapi_event_t), &ev, sizeof(hostapi_event_t));
+        n++;
+    }
+    while (n < (int32_t)max_events && hostapi_evq_pop(&s_evq, &ev)) {
+        memcpy(buf + n * sizeof(hostapi_event_t), &ev, sizeof(hostapi_event_t));
         n++;
     }
     return n;
@@ -2,10 +2,21 @@
 #pragma once
 
 #include <stdbool.h>
+#include <stdint.h>
 #include "wasm_export.h"
+#include "hostapi_defs.h"
+
+struct SDL_Window;
+union SDL_Event;
 
 /* SDL の window/renderer/audio を初期化する(main スレッドから) */
 bool host_sdl_init(void);
+/* host_sdl_init が作ったウィンドウ(ベンチが位置を取る) */
+struct SDL_Window* host_sdl_window(void);
+/* クリック音デバイスの設定(host_sdl_init 前)。buf_frames はコールバック 1 回の
+ * フレーム数(64..4096 を 2 の冪へ切り上げ。既定 1024)。realtime はコールバックの
+ * スレッドを SCHED_FIFO にして 1 つの CPU へ固定する(権限が無ければ警告して続ける) */
+void host_sdl_audio_config(int buf_frames, bool realtime);
 void host_sdl_shutdown(void);
 
 /* retained スロットの内容を 1 フレーム描画する(main ループから毎 tick) */
@@ -16,14 +27,72 @@ void host_sdl_render(void);
 void host_sdl_clear_slots(void);
 
 /* 入力イベントキュー (Phase 6A)。main ループがマウスイベントを push し、
- * アプリが hostapi_poll_event で drain する。アプリ切り替え時に clear */
-void host_sdl_push_touch(bool down, int x, int y);
+ * アプリが hostapi_poll_event で drain する。アプリ切り替え時に clear。
+ * time_ms はイベントの time_ms になる(host_sdl_event_time で SDL の
+ * timestamp から換算した値を渡す。処理時刻で打つと tick 中の遅れが乗る) */
+void host_sdl_push_touch(bool down, int x, int y, uint32_t time_ms);
 void host_sdl_clear_events(void);
 
+/* 左ボタン押下中のポインタ移動。widget 押下中は押下追従・スライダー操作、
+ * それ以外は TOUCH_MOVE(キュー末尾の MOVE と合体)として積む */
+void host_sdl_push_motion(int x, int y, uint32_t time_ms);
+
+/* ジェスチャ認識(shared/hostapi_gesture.h)の時間経過分。input_wait_ms は
+ * 次の期限までの ms(無ければ -1)で、main ループの待ち時間に含める。
+ * input_poll は期限が来た長押し連打を予定時刻で積む */
+int host_sdl_input_wait_ms(void);
+void host_sdl_input_poll(void);
+
+/* SDL イベントの timestamp(SDL_GetTicks 時基)→ hostapi_now_ms の時基。
+ * 直前に host_sdl_input_syswm が X サーバの打刻を取っていればそちらを使う
+ * (SDL の timestamp はイベントを取り込んだ時刻で、tick 中に届いた入力は遅れる) */
+uint32_t host_sdl_event_time(uint32_t sdl_timestamp);
+
+/* SDL_SYSWMEVENT を渡す(X11 では host_sdl_init が有効にする)。マウスの
+ * XEvent の時刻を続く SDL のマウスイベント用に取っておく。他は無視 */
+void host_sdl_input_syswm(const union SDL_Event* ev);
+
+/* hostapi_now_ms と同じ時計。仮想時計を有効にすると now_ms とイベント時刻が
+ * now_ms に固定される(--replay --headless で tick ごとに進める) */
+uint32_t host_sdl_now_ms(void);
+void host_sdl_set_virtual_clock(bool enable, uint32_t now_ms);
+
+/* オフライン描画(--headless)。音声デバイスを止め、以後はコールバックを
+ * render_until から直接呼ぶ(音声クロックの原点は最初の描画時の now_ms)。
+ * render_until は now_ms に当たるサンプルまで描く(tick の後に呼ぶ) */
+void host_sdl_audio_offline(void);
+void host_sdl_audio_render_until(uint32_t now_ms);
+
+/* 出力のキャプチャ(shared/hostapi_capture.h の形式。path と path.sched)。
+ * pump はコールバックが積んだ出力と発音記録を書き出す(main ループから
+ * 呼ぶ)。閉じるのは host_sdl_shutdown */
+bool host_sdl_capture_start(const char* path);
+void host_sdl_capture_pump(void);
+
+/* 入力イベントの記録/再生(shared/hostapi_evrec.h の形式)。記録はアプリに
+ * 配送したイベントを起動からの相対時刻で書く。start はアプリ起動直後、
+ * stop は破棄時に呼ぶ。replay_event は記録 1 件をキューへ積む(time_ms は
+ * base_ms + 相対時刻。widget CHANGED は部品の値にも反映する) */
+bool host_sdl_record_start(const char* path);
+void host_sdl_record_stop(void);
+void host_sdl_replay_event(const hostapi_event_t* ev, uint32_t base_ms);
+
+/* 入力処理で描画が変わった(widget の押下表示等)なら true を返してクリアする。
+ * main ループは true なら tick を待たずに host_sdl_render() する */
+bool host_sdl_take_redraw(void);
+
 /* オーディオ停止+状態リセット (Phase 6B ライフサイクル契約)。
  * アプリ起動直前と破棄時に呼ぶ */
 void host_sdl_audio_reset(void);
 
+/* 再生キュー(hostapi_audio_enqueue)を進める: 専用スレッドが曲の終わりで
+ * すぐ切り替えた分を帳簿(キュー・位置・TRACK イベント)に取り込み、その次を
+ * 開いておく。main ループから毎回呼ぶ(切り替え自体は tick を待たない) */
+void host_sdl_audio_pump(void);
+/* hostapi_audio_play_at の曲を鳴らし始めるまでの ms(無ければ -1)。main ループの
+ * 待ち時間に含める(期限が来たら pump が鳴らし始める) */
+int host_sdl_audio_wait_ms(void);
+
 /* 直描画ヘルパ(ランチャーメニュー用)。begin_frame → rect/text → present */
 void host_sdl_begin_frame(uint32_t rgb888);
 void host_sdl_rect(int x, int y, int w, int h, uint32_t rgb888);
@@ -41,13 +110,33 @@ void native_hostapi_draw_text(wasm_exec_env_t exec_env, int32_t x, int32_t y,
                               const char* str, uint32_t len);
 void native_hostapi_fill_rect(wasm_exec_env_t exec_env, int32_t x, int32_t y,
                               int32_t w, int32_t h, uint32_t rgb888);
+int32_t native_hostapi_draw_lines(wasm_exec_env_t exec_env, int32_t slot,
+                                  const char* pts, uint32_t len, uint32_t rgb888);
+int32_t native_hostapi_draw_points(wasm_exec_env_t exec_env, int32_t slot,
+                                   const char* pts, uint32_t len, uint32_t rgb888);
+int32_t native_hostapi_widget_create(wasm_exec_env_t exec_env, int32_t id, int32_t kind,
+                                     int32_t x, int32_t y, int32_t w, int32_t h,
+                                     const char* label, uint32_t len);
+int32_t native_hostapi_widget_set_value(wasm_exec_env_t exec_env, int32_t id, int32_t value);
+int32_t native_hostapi_widget_get_value(wasm_exec_env_t exec_env, int32_t id);
+int32_t native_hostapi_widget_delete(wasm_exec_env_t exec_env, int32_t id);
 void native_hostapi_play_click(wasm_exec_env_t exec_env);
 uint32_t native_hostapi_now_ms(wasm_exec_env_t exec_env);
+int32_t native_hostapi_now_us64(wasm_exec_env_t exec_env, char* buf, uint32_t len);
 int32_t native_hostapi_poll_event(wasm_exec_env_t exec_env, char* buf, uint32_t len);
+int32_t native_hostapi_gesture_enable(wasm_exec_env_t exec_env, int32_t mask);
 int32_t native_hostapi_audio_play(wasm_exec_env_t exec_env, const char* path, uint32_t len);
+int32_t native_hostapi_audio_play_at(wasm_exec_env_t exec_env, const char* path, uint32_t len,
+                                     int32_t time_ms);
 int32_t native_hostapi_audio_ctrl(wasm_exec_env_t exec_env, int32_t cmd);
 void native_hostapi_audio_set_volume(wasm_exec_env_t exec_env, int32_t v);
 int32_t native_hostapi_audio_get_state(wasm_exec_env_t exec_env);
+int32_t native_hostapi_audio_enqueue(wasm_exec_env_t exec_env, const char* path, uint32_t len);
+int32_t native_hostapi_audio_get_position_ms(wasm_exec_env_t exec_env);
+int32_t native_hostapi_audio_get_duration_ms(wasm_exec_env_t exec_env);
+int32_t native_hostapi_audio_seek_ms(wasm_exec_env_t exec_env, int32_t ms);
+int32_t native_hostapi_audio_get_levels(wasm_exec_env_t exec_env, char* buf, uint32_t len);
+int32_t native_hostapi_audio_get_clock(wasm_exec_env_t exec_env, char* buf, uint32_t len);
 int32_t native_hostapi_fs_list(wasm_exec_env_t exec_env, int32_t idx,
                                char* buf, uint32_t buf_len);
 int32_t native_hostapi_click_schedule(wasm_exec_env_t exec_env, int32_t time_ms);
@@ -57,3 +146,24 @@ int32_t native_hostapi_tone_define(wasm_exec_env_t exec_env, int32_t slot,
 int32_t native_hostapi_tone_play(wasm_exec_env_t exec_env, int32_t slot);
 int32_t native_hostapi_tone_schedule(wasm_exec_env_t exec_env, int32_t slot,
                                      int32_t time_ms);
+int32_t native_hostapi_tone_enqueue(wasm_exec_env_t exec_env, int32_t slot,
+                                    int32_t time_ms);
+int32_t native_hostapi_tone_enqueue_us(wasm_exec_env_t exec_env, int32_t slot,
+                                       int64_t time_us);
+int32_t native_hostapi_tone_cancel(wasm_exec_env_t exec_env, int32_t id);
+int32_t native_hostapi_sample_load(wasm_exec_env_t exec_env, const char* path,
+                                   uint32_t len);
+int32_t native_hostapi_sample_play(wasm_exec_env_t exec_env, int32_t handle,
+                                   int32_t level);
+int32_t native_hostapi_sample_schedule(wasm_exec_env_t exec_env, int32_t handle,
+                                       int32_t time_ms, int32_t level);
+int32_t native_hostapi_sample_schedule_us(wasm_exec_env_t exec_env, int32_t handle,
+                                          int64_t time_us, int32_t level);
+int32_t native_hostapi_note_define(wasm_exec_env_t exec_env, int32_t slot, int32_t attack_ms,
+                                   int32_t decay_ms, int32_t sustain, int32_t release_ms);
+int32_t native_hostapi_note_on(wasm_exec_env_t exec_env, int32_t ch, int32_t slot,
+                               int32_t pitch, int32_t velocity, int32_t time_ms);
+int32_t native_hostapi_note_on_us(wasm_exec_env_t exec_env, int32_t ch, int32_t slot,
+                                  int32_t pitch, int32_t velocity, int64_t time_us);
+int32_t native_hostapi_note_off(wasm_exec_env_t exec_env, int32_t ch, int32_t time_ms);
+int32_t native_hostapi_note_off_us(wasm_exec_env_t exec_env, int32_t ch, int64_t time_us);
@@ -0,0 +1,34 @@
+/* LVGL ホスト用の lv_conf.h(LVGL 9.2)。
+ * 実機(esp_lvgl_port + sdkconfig の LVGL 既定値)に描画条件を揃える:
+ * RGB565、組込みヒープ 64KB、リフレッシュ周期 33ms、Montserrat 14 既定フォント。
+ * 未定義の項目は lv_conf_internal.h の既定値になる。 */
+#ifndef LV_CONF_H
+#define LV_CONF_H
+
+#define LV_COLOR_DEPTH 16
+
+#define LV_USE_STDLIB_MALLOC LV_STDLIB_BUILTIN
+#define LV_MEM_SIZE (64 * 1024U)
+
+#define LV_DEF_REFR_PERIOD 33
+#define LV_USE_OS LV_OS_NONE
+
+#define LV_FONT_MONTSERRAT_14 1
+#define LV_FONT_DEFAULT &lv_font_montserrat_14
+
+#define LV_USE_LOG 1
+#define LV_LOG_LEVEL LV_LOG_LEVEL_WARN
+#define LV_LOG_PRINTF 1
+
+#define LV_USE_SYSMON 0
+
+/* SDL ディスプレイ/入力ドライバ。バッファは main_lvgl.cpp で実機と同じ
+ * 部分描画(320x30 行 x2)に差し替える */
+#define LV_USE_SDL 1
+#define LV_SDL_INCLUDE_PATH <SDL.h>
+#define LV_SDL_RENDER_MODE LV_DISPLAY_RENDER_MODE_PARTIAL
+#define LV_SDL_BUF_COUNT 2
+#define LV_SDL_FULLSCREEN 0
+#define LV_SDL_DIRECT_EXIT 0
+
+#endif /* LV_CONF_H */
@@ -0,0 +1,366 @@
+// MidiAppBox WASM — Linux LVGL ホスト(描画経路プロファイル用)。
+//
+// 実機の src/components/wasm_runtime/hostapi.cpp をそのままビルドし、LVGL 9 の
+// SDL ドライバ上で動かす。SDL 直描画の通常ホスト(../main.c)と違い、
+// lv_label / lv_obj のスタイル設定・無効化・部分描画という実機と同じ
+// retained-object 経路のコストを PC 上で測れる。
+//
+// 使い方:
+//   midibox_lvgl_host <file.wasm> [--seconds N] [--report-ms N]
+//   midibox_lvgl_host --bench       ... hostapi_bench_draw()(実機 NATIVE_BENCH と同一)
+//
+// 計測カウンタ(--report-ms ごと、および終了時に stdout へ出す):
+//   refr   LV_EVENT_REFR_START → REFR_READY(1 回のリフレッシュ全体)
+//   flush  LV_EVENT_FLUSH_START → FLUSH_FINISH の合計(SDL テクスチャ転送)
+//   render refr - flush(LVGL のソフトウェア描画分)
+//   tick   app_tick 呼び出し(native 経由の LVGL オブジェクト操作を含む)
+//   inv    無効化要求の回数と面積(px。重複・画面外を含む要求ベース)
+//
+// ライフサイクルは実機/通常ホストと同一(load → app_init → 100ms tick →
+// app_exit → 破棄)。ランチャーメニューは持たない(単発実行のみ)。
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <SDL.h>
+
+#include "lvgl.h"
+#include "esp_lvgl_port.h"
+#include "esp_timer.h"
+#include "wasm_export.h"
+#include "hostapi.hpp"
+
+namespace {
+
+constexpr uint32_t kAppTickMs = 100;
+constexpr int32_t kScreenW = 320;
+constexpr int32_t kScreenH = 240;
+// 実機 display.cpp と同じ部分描画バッファ(LCD_H_RES * 40 px、ダブルバッファ)
+constexpr uint32_t kDrawBufPx = 240 * 40;
+
+uint8_t s_wamr_heap[48 * 1024]; // 実機(Phase 7B で 64→48KB)と同一
+uint16_t s_draw_buf[2][kDrawBufPx];
+
+bool s_quit = false;
+
+// ---- 計測カウンタ ----
+
+struct Stat {
+    uint32_t n = 0;
+    int64_t sum_us = 0;
+    int64_t max_us = 0;
+
+    void add(int64_t us)
+    {
+        n++;
+        sum_us += us;
+        if (us > max_us) max_us = us;
+    }
+    int64_t avg() const { return n ? sum_us / n : 0; }
+};
+
+struct Prof {
+    Stat refr;
+    Stat flush;
+    Stat tick;
+    int64_t render_sum_us = 0; // refr ごとの (refr - そのリフレッシュ中の flush) の合計
+    int64_t flush_in_refr_us = 0;
+    uint32_t inv_n = 0;
+    uint64_t inv_px = 0;
+    int64_t refr_t0 = 0;
+    int64_t flush_t0 = 0;
+};
+
+Prof s_prof;       // --report-ms 区間
+Prof s_prof_total; // 起動からの累計
+
+void prof_merge(Prof& dst, const Prof& src)
+{
+    auto merge = [](Stat& d, const Stat& s) {
+        d.n += s.n;
+        d.sum_us += s.sum_us;
+        if (s.max_us > d.max_us) d.max_us = s.max_us;
+    };
+    merge(dst.refr, src.refr);
+    merge(dst.flush, src.flush);
+    merge(dst.tick, src.tick);
+    dst.render_sum_us += src.render_sum_us;
+    dst.inv_n += src.inv_n;
+    dst.inv_px += src.inv_px;
+}
+
+void prof_print(const char* label, const Prof& p)
+{
+    const int64_t render_avg = p.refr.n ? p.render_sum_us / p.refr.n : 0;
+    printf("prof %s: refr %" PRIu32 " (avg %" PRId64 " max %" PRId64 " us) render avg %" PRId64
+           " us, flush %" PRIu32 " (avg %" PRId64 " max %" PRId64 " us), tick %" PRIu32
+           " (avg %" PRId64 " max %" PRId64 " us), inv %" PRIu32 " req %" PRIu64 " px\n",
+           label, p.refr.n, p.refr.avg(), p.refr.max_us, render_avg, p.flush.n,
+           p.flush.avg(), p.flush.max_us, p.tick.n, p.tick.avg(), p.tick.max_us, p.inv_n,
+           p.inv_px);
+    fflush(stdout);
+}
+
+void display_event_cb(lv_event_t* e)
+{
+    const int64_t now = esp_timer_get_time();
+    switch (lv_event_get_code(e)) {
+    case LV_EVENT_REFR_START:
+        s_prof.refr_t0 = now;
+        s_prof.flush_in_refr_us = 0;
+        break;
+    case LV_EVENT_REFR_READY: {
+        const int64_t us = now - s_prof.refr_t0;
+        s_prof.refr.add(us);
+        s_prof.render_sum_us += us - s_prof.flush_in_refr_us;
+        break;
+    }
+    case LV_EVENT_FLUSH_START:
+        s_prof.flush_t0 = now;
+        break;
+    case LV_EVENT_FLUSH_FINISH: {
+        const int64_t us = now - s_prof.flush_t0;
+        s_prof.flush.add(us);
+        s_prof.flush_in_refr_us += us;
+        break;
+    }
+    case LV_EVENT_INVALIDATE_AREA: {
+        const lv_area_t* a = static_cast<const lv_area_t*>(lv_event_get_param(e));
+        if (a) {
+            s_prof.inv_n++;
+            s_prof.inv_px += (uint64_t)lv_area_get_size(a);
+        }
+        break;
+    }
+    case LV_EVENT_DELETE:
+        s_quit = true; // ウィンドウクローズで SDL ドライバがディスプレイを削除する
+        break;
+    default:
+        break;
+    }
+}
+
+lv_display_t* display_create()
+{
+    lv_display_t* disp = lv_sdl_window_create(kScreenW, kScreenH);
+    if (!disp) return nullptr;
+    lv_sdl_window_set_zoom(disp, 2); // 通常ホストと同じ 2 倍表示
+    lv_sdl_window_set_title(disp, "MidiAppBox WASM host (LVGL)");
+    lv_display_set_buffers(disp, s_draw_buf[0], s_draw_buf[1], sizeof(s_draw_buf[0]),
+                           LV_DISPLAY_RENDER_MODE_PARTIAL);
+    lv_sdl_mouse_create();
+    lv_display_add_event_cb(disp, display_event_cb, LV_EVENT_ALL, nullptr);
+    return disp;
+}
+
+// 実機 LVGL タスク相当: ロック下で lv_timer_handler を 1 回回し、次回までの ms を返す
+uint32_t lvgl_service()
+{
+    lvgl_port_lock(0);
+    const uint32_t wait = lv_timer_handler();
+    lvgl_port_unlock();
+    return wait;
+}
+
+uint8_t* read_file(const char* path, uint32_t* out_size)
+{
+    FILE* f = fopen(path, "rb");
+    if (!f) {
+        fprintf(stderr, "cannot open %s\n", path);
+        return nullptr;
+    }
+    fseek(f, 0, SEEK_END);
+    const long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    if (size <= 0 || size > 512 * 1024) {
+        fprintf(stderr, "bad file size (%ld)\n", size);
+        fclose(f);
+        return nullptr;
+    }
+    uint8_t* buf = static_cast<uint8_t*>(malloc(size));
+    if (!buf || fread(buf, 1, size, f) != (size_t)size) {
+        fprintf(stderr, "read failed: %s\n", path);
+        free(buf);
+        fclose(f);
+        return nullptr;
+    }
+    fclose(f);
+    *out_size = (uint32_t)size;
+    return buf;
+}
+
+// アプリ 1 本を実行する。seconds > 0 なら経過後に app_exit して戻る
+int run_app(const char* path, uint32_t seconds, uint32_t report_ms)
+{
+    char error_buf[128];
+    uint32_t size = 0;
+    uint8_t* buf = read_file(path, &size);
+    if (!buf) return 1;
+
+    int ret = 1;
+    wasm_module_t module = nullptr;
+    wasm_module_inst_t inst = nullptr;
+    wasm_exec_env_t exec_env = nullptr;
+    wasm_function_inst_t fn_init = nullptr, fn_tick = nullptr, fn_exit = nullptr;
+    uint32_t argv[1] = {0};
+
+    module = wasm_runtime_load(buf, size, error_buf, sizeof(error_buf));
+    if (!module) {
+        fprintf(stderr, "load: %s\n", error_buf);
+        goto out;
+    }
+    inst = wasm_runtime_instantiate(module, 8 * 1024, 8 * 1024, error_buf, sizeof(error_buf));
+    if (!inst) {
+        fprintf(stderr, "instantiate: %s\n", error_buf);
+        goto out;
+    }
+    exec_env = wasm_runtime_create_exec_env(inst, 8 * 1024);
+    if (!exec_env) {
+        fprintf(stderr, "create_exec_env failed\n");
+        goto out;
+    }
+    fn_init = wasm_runtime_lookup_function(inst, "app_init");
+    fn_tick = wasm_runtime_lookup_function(inst, "app_tick");
+    fn_exit = wasm_runtime_lookup_function(inst, "app_exit");
+    if (!fn_init || !fn_tick) {
+        fprintf(stderr, "app_init/app_tick not exported\n");
+        goto out;
+    }
+
+    wasmrt::hostapi_audio_reset();
+    wasmrt::hostapi_app_screen_create();
+
+    if (!wasm_runtime_call_wasm(exec_env, fn_init, 0, argv)) {
+        fprintf(stderr, "app_init: %s\n", wasm_runtime_get_exception(inst));
+    } else {
+        printf("app started: %s (app_init=%d)\n", path, (int)argv[0]);
+        const uint32_t start = SDL_GetTicks();
+        uint32_t next_tick = start;
+        uint32_t next_report = start + report_ms;
+        bool trapped = false;
+
+        while (!s_quit && !trapped) {
+            const uint32_t wait = lvgl_service();
+            const uint32_t now = SDL_GetTicks();
+            if (seconds > 0 && now - start >= seconds * 1000) break;
+
+            if ((int32_t)(now - next_tick) >= 0) {
+                const int64_t t0 = esp_timer_get_time();
+                if (!wasm_runtime_call_wasm(exec_env, fn_tick, 0, nullptr)) {
+                    fprintf(stderr, "app_tick: %s\n", wasm_runtime_get_exception(inst));
+                    trapped = true;
+                }
+                s_prof.tick.add(esp_timer_get_time() - t0);
+                next_tick += kAppTickMs;
+                if ((int32_t)(now - next_tick) >= 0) next_tick = now + kAppTickMs; // 遅延は追わない
+            }
+            if (report_ms > 0 && (int32_t)(now - next_report) >= 0) {
+                prof_print("interval", s_prof);
+                prof_merge(s_prof_total, s_prof);
+                s_prof = Prof{};
+                next_report = now + report_ms;
+            }
+
+            uint32_t sleep_ms = wait;
+            const uint32_t until_tick = next_tick - SDL_GetTicks();
+            if ((int32_t)until_tick < 0) sleep_ms = 0;
+            else if (until_tick < sleep_ms) sleep_ms = until_tick;
+            if (sleep_ms > 5) sleep_ms = 5; // SDL イベント取り込み(5ms タイマ)を遅らせない
+            SDL_Delay(sleep_ms);
+        }
+
+        if (!trapped && fn_exit && !wasm_runtime_call_wasm(exec_env, fn_exit, 0, nullptr)) {
+            fprintf(stderr, "app_exit trapped: %s\n", wasm_runtime_get_exception(inst));
+        }
+        ret = trapped ? 1 : 0;
+    }
+
+    prof_merge(s_prof_total, s_prof);
+    prof_print("total", s_prof_total);
+
+    wasmrt::hostapi_audio_reset();
+    if (!s_quit) {
+        // アクティブなスクリーンは削除できないので空スクリーンへ切り替えてから破棄
+        lvgl_port_lock(0);
+        lv_screen_load(lv_obj_create(nullptr));
+        wasmrt::hostapi_app_screen_destroy();
+        lvgl_port_unlock();
+    }
+
+out:
+    // 破棄は必ずこの順序: exec_env → instance → module → wasm バッファ
+    if (exec_env) wasm_runtime_destroy_exec_env(exec_env);
+    if (inst) wasm_runtime_deinstantiate(inst);
+    if (module) wasm_runtime_unload(module);
+    free(buf);
+    return ret;
+}
+
+void usage()
+{
+    fprintf(stderr,
+            "usage: midibox_lvgl_host <file.wasm> [--seconds N] [--report-ms N]\n"
+            "       midibox_lvgl_host --bench\n");
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    const char* path = nullptr;
+    uint32_t seconds = 0;
+    uint32_t report_ms = 5000;
+    bool bench = false;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--seconds") == 0 && i + 1 < argc) {
+            seconds = (uint32_t)strtoul(argv[++i], nullptr, 10);
+        } else if (strcmp(argv[i], "--report-ms") == 0 && i + 1 < argc) {
+            report_ms = (uint32_t)strtoul(argv[++i], nullptr, 10);
+        } else if (strcmp(argv[i], "--bench") == 0) {
+            bench = true;
+        } else if (argv[i][0] != '-' && !path) {
+            path = argv[i];
+        } else {
+            usage();
+            return 2;
+        }
+    }
+    if (!bench && !path) {
+        usage();
+        return 2;
+    }
+
+    lv_init();
+    lv_tick_set_cb(SDL_GetTicks);
+    if (!display_create()) {
+        fprintf(stderr, "lv_sdl_window_create failed\n");
+        return 1;
+    }
+    lv_screen_load(lv_obj_create(nullptr));
+    lvgl_service();
+
+    RuntimeInitArgs init_args;
+    memset(&init_args, 0, sizeof(init_args));
+    init_args.mem_alloc_type = Alloc_With_Pool;
+    init_args.mem_alloc_option.pool.heap_buf = s_wamr_heap;
+    init_args.mem_alloc_option.pool.heap_size = sizeof(s_wamr_heap);
+
+    int ret = 1;
+    if (!wasm_runtime_full_init(&init_args)) {
+        fprintf(stderr, "wasm_runtime_full_init failed\n");
+    } else if (!wasmrt::hostapi_register_natives()) {
+        fprintf(stderr, "register_natives failed\n");
+    } else if (bench) {
+        wasmrt::hostapi_bench_draw();
+        prof_print("bench", s_prof);
+        ret = 0;
+    } else {
+        ret = run_app(path, seconds, report_ms);
+    }
+
+    wasm_runtime_destroy();
+    lv_deinit();
+    return ret;
+}
@@ -0,0 +1,41 @@
+#pragma once
+// audio コンポーネントの Linux シム(LVGL ホスト用)。
+// LVGL ホストは描画経路のプロファイル専用なので音は出さない。hostapi.cpp が
+// 呼ぶ C ラッパだけを同じ宣言で用意する(実体は esp_shim.cpp の no-op)。
+#include <cstdint>
+
+#include "hostapi_defs.h"
+
+namespace audio {
+
+extern "C" {
+    bool Play_Tone(uint16_t freq_hz, uint16_t dur_ms, uint8_t level);
+    void Tone_Prepare(uint16_t freq_hz, uint16_t dur_ms, uint8_t level);
+    int  Sample_Load(const char* key, uint32_t key_len, const char* full_path);
+    bool Sample_Exists(int handle);
+    bool Play_Sample(int handle, uint8_t level);
+    void Sample_Reset(void);
+    bool Note_On(uint8_t ch, uint8_t env_slot, uint16_t pitch, uint8_t velocity);
+    bool Note_Off(uint8_t ch);
+    bool Note_Define(uint8_t slot, uint16_t attack_ms, uint16_t decay_ms, uint8_t sustain,
+                     uint16_t release_ms);
+    void Note_Reset(void);
+    void Music_resume(void);
+    void Music_pause(void);
+    void Music_stop(void);
+    bool Music_finished(void);
+    bool Music_play_path(const char* path);
+    bool Music_play_path_at(const char* path, uint32_t start_ms);
+    bool Music_start_pending(void);
+    bool Music_queue_next(const char* path);
+    void Music_clear_next(void);
+    uint32_t Music_track_changes(uint32_t* time_ms);
+    void Audio_Get_Levels(hostapi_audio_levels_t* out);
+    bool Audio_Get_Clock(hostapi_audio_clock_t* out);
+    int32_t Music_position_ms(void);
+    int32_t Music_duration_ms(void);
+    int32_t Music_seek_ms(uint32_t ms);
+    void Volume_adjustment(uint8_t Vol);
+}
+
+} // namespace audio
@@ -0,0 +1,11 @@
+#pragma once
+/* ESP-IDF esp_log.h の Linux シム。D/V は実機の既定ログレベル(INFO)に合わせて出さない */
+#include <stdio.h>
+
+#define ESP_LOGE(tag, fmt, ...) fprintf(stderr, "E %s: " fmt "\n", tag, ##__VA_ARGS__)
+#define ESP_LOGW(tag, fmt, ...) fprintf(stderr, "W %s: " fmt "\n", tag, ##__VA_ARGS__)
+#define ESP_LOGI(tag, fmt, ...) fprintf(stderr, "I %s: " fmt "\n", tag, ##__VA_ARGS__)
+#define ESP_LOGD(tag, fmt, ...) \
+    do { if (0) fprintf(stderr, "D %s: " fmt "\n", tag, ##__VA_ARGS__); } while (0)
+#define ESP_LOGV(tag, fmt, ...) \
+    do { if (0) fprintf(stderr, "V %s: " fmt "\n", tag, ##__VA_ARGS__); } while (0)
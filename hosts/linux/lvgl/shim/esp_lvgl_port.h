@@ -0,0 +1,19 @@
+#pragma once
+/* esp_lvgl_port の Linux シム。LVGL の描画は main_lvgl.cpp のメインループが
+ * このロック下で lv_timer_handler を回す(実機の LVGL タスク相当)。
+ * 実機同様に再帰ロック。timeout_ms は 0(無期限)のみ想定。 */
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "lvgl.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+bool lvgl_port_lock(uint32_t timeout_ms);
+void lvgl_port_unlock(void);
+
+#ifdef __cplusplus
+}
+#endif
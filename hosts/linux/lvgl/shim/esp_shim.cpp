@@ -0,0 +1,315 @@
+// ESP-IDF / esp_lvgl_port / audio / midi の Linux シム実装(LVGL ホスト用)。
+// hostapi.cpp を無改造でリンクするための最小限。挙動は実機に合わせるが、
+// 音と MIDI は出さない(描画経路のプロファイルが目的)。
+#include "esp_lvgl_port.h"
+#include "esp_timer.h"
+#include "audio.hpp"
+#include "midi.hpp"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// ---- lvgl_port_lock ----
+
+namespace {
+std::recursive_mutex s_lvgl_mutex;
+} // namespace
+
+extern "C" bool lvgl_port_lock(uint32_t timeout_ms)
+{
+    (void)timeout_ms;
+    s_lvgl_mutex.lock();
+    return true;
+}
+
+extern "C" void lvgl_port_unlock(void)
+{
+    s_lvgl_mutex.unlock();
+}
+
+// ---- esp_timer ----
+// 全タイマを 1 本のディスパッチスレッドで処理する(実機の esp_timer タスク相当)。
+// コールバックはロック外で呼ぶので、コールバック内から start/stop してよい。
+
+struct esp_timer {
+    esp_timer_cb_t callback;
+    void* arg;
+    bool armed;
+    int64_t deadline_us;
+};
+
+namespace {
+
+std::mutex s_timer_mutex;
+std::condition_variable s_timer_cv;
+std::vector<esp_timer*> s_timers;
+bool s_timer_thread_started = false;
+
+void timer_thread()
+{
+    std::unique_lock<std::mutex> lk(s_timer_mutex);
+    for (;;) {
+        esp_timer* due = nullptr;
+        int64_t next = INT64_MAX;
+        const int64_t now = esp_timer_get_time();
+        for (esp_timer* t : s_timers) {
+            if (!t->armed) continue;
+            if (t->deadline_us <= now) {
+                due = t;
+                break;
+            }
+            if (t->deadline_us < next) next = t->deadline_us;
+        }
+        if (due) {
+            due->armed = false;
+            esp_timer_cb_t cb = due->callback;
+            void* arg = due->arg;
+            lk.unlock();
+            cb(arg);
+            lk.lock();
+            continue;
+        }
+        if (next == INT64_MAX) {
+            s_timer_cv.wait(lk);
+        } else {
+            s_timer_cv.wait_for(lk, std::chrono::microseconds(next - now));
+        }
+    }
+}
+
+} // namespace
+
+extern "C" int64_t esp_timer_get_time(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+extern "C" esp_err_t esp_timer_create(const esp_timer_create_args_t* args,
+                                      esp_timer_handle_t* out)
+{
+    if (!args || !args->callback || !out) return ESP_ERR_INVALID_ARG;
+    esp_timer* t = new esp_timer{args->callback, args->arg, false, 0};
+    std::lock_guard<std::mutex> lk(s_timer_mutex);
+    s_timers.push_back(t);
+    if (!s_timer_thread_started) {
+        std::thread(timer_thread).detach();
+        s_timer_thread_started = true;
+    }
+    *out = t;
+    return ESP_OK;
+}
+
+extern "C" esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us)
+{
+    std::lock_guard<std::mutex> lk(s_timer_mutex);
+    if (timer->armed) return ESP_ERR_INVALID_STATE;
+    timer->armed = true;
+    timer->deadline_us = esp_timer_get_time() + (int64_t)timeout_us;
+    s_timer_cv.notify_one();
+    return ESP_OK;
+}
+
+extern "C" esp_err_t esp_timer_stop(esp_timer_handle_t timer)
+{
+    std::lock_guard<std::mutex> lk(s_timer_mutex);
+    if (!timer->armed) return ESP_ERR_INVALID_STATE;
+    timer->armed = false;
+    return ESP_OK;
+}
+
+extern "C" esp_err_t esp_timer_delete(esp_timer_handle_t timer)
+{
+    std::lock_guard<std::mutex> lk(s_timer_mutex);
+    if (timer->armed) return ESP_ERR_INVALID_STATE;
+    for (auto it = s_timers.begin(); it != s_timers.end(); ++it) {
+        if (*it == timer) {
+            s_timers.erase(it);
+            break;
+        }
+    }
+    delete timer;
+    return ESP_OK;
+}
+
+// ---- audio(no-op) ----
+
+namespace audio {
+
+extern "C" {
+
+bool Play_Tone(uint16_t freq_hz, uint16_t dur_ms, uint8_t level)
+{
+    (void)freq_hz;
+    (void)dur_ms;
+    (void)level;
+    return true;
+}
+
+void Tone_Prepare(uint16_t freq_hz, uint16_t dur_ms, uint8_t level)
+{
+    (void)freq_hz;
+    (void)dur_ms;
+    (void)level;
+}
+
+int Sample_Load(const char* key, uint32_t key_len, const char* full_path)
+{
+    (void)key;
+    (void)key_len;
+    fprintf(stderr, "W SHIM: audio not available in LVGL host (%s)\n", full_path);
+    return -1;
+}
+
+bool Sample_Exists(int handle)
+{
+    (void)handle;
+    return false;
+}
+
+bool Play_Sample(int handle, uint8_t level)
+{
+    (void)handle;
+    (void)level;
+    return false;
+}
+
+void Sample_Reset(void) {}
+
+bool Note_On(uint8_t ch, uint8_t env_slot, uint16_t pitch, uint8_t velocity)
+{
+    (void)ch;
+    (void)env_slot;
+    (void)pitch;
+    (void)velocity;
+    return false;
+}
+
+bool Note_Off(uint8_t ch)
+{
+    (void)ch;
+    return false;
+}
+
+bool Note_Define(uint8_t slot, uint16_t attack_ms, uint16_t decay_ms, uint8_t sustain,
+                 uint16_t release_ms)
+{
+    (void)slot;
+    (void)attack_ms;
+    (void)decay_ms;
+    (void)sustain;
+    (void)release_ms;
+    return false;
+}
+
+void Note_Reset(void) {}
+
+void Music_resume(void) {}
+void Music_pause(void) {}
+void Music_stop(void) {}
+
+bool Music_finished(void)
+{
+    return false;
+}
+
+bool Music_play_path(const char* path)
+{
+    fprintf(stderr, "W SHIM: audio not available in LVGL host (%s)\n", path);
+    return false;
+}
+
+bool Music_play_path_at(const char* path, uint32_t start_ms)
+{
+    (void)start_ms;
+    return Music_play_path(path);
+}
+
+bool Music_start_pending(void)
+{
+    return false;
+}
+
+bool Music_queue_next(const char* path)
+{
+    (void)path;
+    return false;
+}
+
+void Music_clear_next(void) {}
+
+uint32_t Music_track_changes(uint32_t* time_ms)
+{
+    if (time_ms) *time_ms = 0;
+    return 0;
+}
+
+void Audio_Get_Levels(hostapi_audio_levels_t* out)
+{
+    memset(out, 0, sizeof(*out));
+}
+
+bool Audio_Get_Clock(hostapi_audio_clock_t* out)
+{
+    (void)out;
+    return false;
+}
+
+int32_t Music_position_ms(void)
+{
+    return -1;
+}
+
+int32_t Music_duration_ms(void)
+{
+    return -1;
+}
+
+int32_t Music_seek_ms(uint32_t ms)
+{
+    (void)ms;
+    return -1;
+}
+
+void Volume_adjustment(uint8_t Vol)
+{
+    (void)Vol;
+}
+
+} // extern "C"
+
+} // namespace audio
+
+// ---- midi(no-op。送信バイト列も捨てる) ----
+
+namespace midi {
+
+void Midi_Init() {}
+
+int32_t Midi_Send(const uint8_t* bytes, size_t len)
+{
+    (void)bytes;
+    return (len >= 1 && len <= 8) ? 0 : -1;
+}
+
+void Midi_NotifyBeatScheduled(uint32_t target_ms)
+{
+    (void)target_ms;
+}
+
+void Midi_NotifyBeatFired(uint32_t fired_ms)
+{
+    (void)fired_ms;
+}
+
+void Midi_Reset() {}
+
+} // namespace midi
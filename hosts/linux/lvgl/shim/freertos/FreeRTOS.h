@@ -0,0 +1,27 @@
+#pragma once
+/* FreeRTOS (ESP-IDF port) の Linux シム。hostapi.cpp が使うクリティカル
+ * セクションのみ。実機の portMUX と同じくスピンロック(再帰不可)。 */
+#include <stdint.h>
+
+typedef uint32_t TickType_t;
+
+typedef struct {
+    int locked;
+} portMUX_TYPE;
+
+#define portMUX_INITIALIZER_UNLOCKED { 0 }
+
+static inline void shim_port_enter_critical(portMUX_TYPE* mux)
+{
+    while (__atomic_exchange_n(&mux->locked, 1, __ATOMIC_ACQUIRE)) {
+    }
+}
+
+static inline void shim_port_exit_critical(portMUX_TYPE* mux)
+{
+    __atomic_store_n(&mux->locked, 0, __ATOMIC_RELEASE);
+}
+
+#define portENTER_CRITICAL(mux) shim_port_enter_critical(mux)
+#define portEXIT_CRITICAL(mux) shim_port_exit_critical(mux)
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
@@ -11,6 +11,26 @@
  *   midibox_host <dir>           ... 指定ディレクトリをスキャンしてメニュー表示
  *   midibox_host <file.wasm>     ... 単発実行(メニューなし。CI スモーク用)
  *
+ * 入力の記録/再生(shared/hostapi_evrec.h):
+ *   --record <file>   アプリに配送した入力を記録する(アプリ起動ごとに上書き)
+ *   --replay <file>   記録を元の時刻で再注入する(単発実行のみ。マウス入力は無視)
+ *   --headless        --replay と併用。ウィンドウ/音声なし・仮想時計で tick を
+ *                     間断なく回し、記録の末尾 + 1 秒で終了して tick 時間を出す
+ *                     (同じ記録なら毎回同じ tick に同じイベントが届く)。音声は
+ *                     仮想時計に合わせてオフラインで描く
+ *
+ * 出力のキャプチャ(shared/hostapi_capture.h):
+ *   --wav <file>      オーディオコールバックの出力をそのまま WAV に取り、発音の
+ *                     予約/依頼を <file>.sched に書く(bench/bench_onset で解析)。
+ *                     --headless と併用すると毎回同じ WAV になる
+ *
+ * 音声デバイス:
+ *   --audio-buffer <n>  コールバック 1 回のフレーム数(64..4096、既定 1024 ≒ 23ms)。
+ *                     小さいほど予約から発音までが短い。取りこぼしは検出して
+ *                     数え、予約 → DAC 時刻の遅れ(見積もり)とともに表示する
+ *   --audio-rt        オーディオスレッドを SCHED_FIFO にして 1 つの CPU へ固定する
+ *                     (CAP_SYS_NICE か rtprio の上限が要る。無ければ警告して続ける)
+ *
  * 操作: マウスクリックで起動 / ESC でメニューに戻る(実機の power_key 短押し相当)
  *       メニューで ESC またはウィンドウクローズで終了
  */
@@ -24,6 +44,7 @@
 
 #include "wasm_export.h"
 #include "hostapi_defs.h"
+#include "hostapi_evrec.h"
 #include "hostapi_sdl.h"
 #include "hostapi_midi.h"
 
@@ -54,6 +75,59 @@ static int s_app_count = 0;
 static char s_status[128] = "";
 static char s_apps_dir[384] = "";
 
+/* 記録/再生 */
+static const char* s_record_path;
+static hostapi_event_t* s_replay;
+static int s_replay_count;
+static int s_replay_next;
+static uint32_t s_replay_base_ms; /* 再生中アプリの起動時刻(now_ms 時基) */
+
+static bool replay_load(const char* path)
+{
+    FILE* f = fopen(path, "rb");
+    if (!f || !hostapi_evrec_read_header(f)) {
+        fprintf(stderr, "replay: %s is not an event record\n", path);
+        if (f) fclose(f);
+        return false;
+    }
+    int cap = 0;
+    hostapi_event_t ev;
+    while (hostapi_evrec_read(f, &ev)) {
+        if (s_replay_count == cap) {
+            cap = cap ? cap * 2 : 256;
+            hostapi_event_t* p = realloc(s_replay, sizeof(*p) * cap);
+            if (!p) break;
+            s_replay = p;
+        }
+        s_replay[s_replay_count++] = ev;
+    }
+    fclose(f);
+    printf("replay: %d events from %s\n", s_replay_count, path);
+    return true;
+}
+
+static bool replay_active(void)
+{
+    return s_replay && s_replay_next < s_replay_count;
+}
+
+/* 再生時刻が now_ms に達した記録をキューへ積む */
+static void replay_pump(uint32_t now_ms)
+{
+    while (replay_active() &&
+           (int32_t)(now_ms - (s_replay_base_ms + s_replay[s_replay_next].time_ms)) >= 0) {
+        host_sdl_replay_event(&s_replay[s_replay_next++], s_replay_base_ms);
+    }
+}
+
+/* 次の記録の再生時刻までの ms(無ければ -1) */
+static int replay_wait_ms(uint32_t now_ms)
+{
+    if (!replay_active()) return -1;
+    const int32_t d = (int32_t)(s_replay_base_ms + s_replay[s_replay_next].time_ms - now_ms);
+    return d > 0 ? d : 0;
+}
+
 /* ---- アプリ一覧スキャン(dir 直下と 1 段下のサブディレクトリ) ---- */
 
 static void add_app(const char* name, const char* path)
@@ -196,6 +270,9 @@ static bool app_load(const char* path, App* a)
         host_sdl_clear_slots(); /* 実機のアプリスクリーン再生成に相当 */
         host_sdl_clear_events();
         host_sdl_audio_reset(); /* アプリは STOPPED 状態から始まる */
+        if (s_record_path) host_sdl_record_start(s_record_path);
+        s_replay_base_ms = host_sdl_now_ms();
+        s_replay_next = 0;
         uint32_t argv[1] = {0};
         if (!wasm_runtime_call_wasm(a->exec_env, fn_init, 0, argv)) {
             snprintf(s_status, sizeof(s_status), "app_init: %s",
@@ -229,6 +306,7 @@ static void app_unload(App* a, bool clean_stop)
     if (a->module) wasm_runtime_unload(a->module);
     free(a->buf);
     memset(a, 0, sizeof(*a));
+    host_sdl_record_stop();
     host_sdl_clear_slots();
     host_sdl_clear_events();
     host_sdl_audio_reset(); /* 契約: アプリ破棄時にオーディオを停止 */
@@ -268,23 +346,122 @@ static int menu_hit_test(int lx, int ly)
     return -1;
 }
 
+/* ---- ヘッドレス再生(--replay --headless) ----
+ * 仮想時計を APP_TICK_MS ずつ進めながら tick を間断なく回す。各 tick の直前に
+ * その時刻までの記録を積むので、リアルタイム再生と同じ tick に同じイベントが
+ * 届き、now_ms も毎回同じになる。 */
+static int run_headless(const char* path)
+{
+    App app;
+    host_sdl_set_virtual_clock(true, 0);
+    if (!app_load(path, &app)) {
+        fprintf(stderr, "%s\n", s_status);
+        return 1;
+    }
+
+    const uint32_t end_ms = (s_replay_count ? s_replay[s_replay_count - 1].time_ms : 0) + 1000;
+    const double us_per_count = 1e6 / (double)SDL_GetPerformanceFrequency();
+    uint64_t t_tick = 0, t_tick_max = 0, t_render = 0;
+    int ticks = 0;
+    const uint64_t t_start = SDL_GetPerformanceCounter();
+    for (uint32_t vt = 0; vt <= end_ms; vt += APP_TICK_MS) {
+        host_sdl_set_virtual_clock(true, vt);
+        replay_pump(vt);
+        const uint64_t t0 = SDL_GetPerformanceCounter();
+        if (!wasm_runtime_call_wasm(app.exec_env, app.fn_tick, 0, NULL)) {
+            fprintf(stderr, "app_tick: %s\n", wasm_runtime_get_exception(app.inst));
+            app_unload(&app, false);
+            host_sdl_set_virtual_clock(false, 0);
+            return 1;
+        }
+        const uint64_t t1 = SDL_GetPerformanceCounter();
+        host_sdl_take_redraw();
+        host_sdl_render();
+        const uint64_t t2 = SDL_GetPerformanceCounter();
+        host_sdl_audio_render_until(vt + APP_TICK_MS); /* 次の tick までの音 */
+        t_tick += t1 - t0;
+        t_render += t2 - t1;
+        if (t1 - t0 > t_tick_max) t_tick_max = t1 - t0;
+        ticks++;
+    }
+    const double wall_ms = (double)(SDL_GetPerformanceCounter() - t_start) * us_per_count / 1000.0;
+    const int injected = s_replay_next;
+    app_unload(&app, true);
+    host_sdl_set_virtual_clock(false, 0);
+
+    printf("headless replay: %d ticks (%u ms virtual), %d/%d events, wall %.1f ms\n",
+           ticks, end_ms, injected, s_replay_count, wall_ms);
+    printf("  app_tick avg %.1f us  max %.1f us / render avg %.1f us\n",
+           (double)t_tick * us_per_count / ticks, (double)t_tick_max * us_per_count,
+           (double)t_render * us_per_count / ticks);
+    return 0;
+}
+
 /* ---- main ---- */
 
 int main(int argc, char** argv)
 {
     bool single_mode = false;
     const char* single_path = NULL;
+    const char* replay_path = NULL;
+    const char* wav_path = NULL;
+    bool headless = false;
+    int audio_buffer = 1024;
+    bool audio_rt = false;
+
+    int argi = 1;
+    for (; argi < argc; ++argi) {
+        if (strcmp(argv[argi], "--record") == 0 && argi + 1 < argc) {
+            s_record_path = argv[++argi];
+        } else if (strcmp(argv[argi], "--replay") == 0 && argi + 1 < argc) {
+            replay_path = argv[++argi];
+        } else if (strcmp(argv[argi], "--wav") == 0 && argi + 1 < argc) {
+            wav_path = argv[++argi];
+        } else if (strcmp(argv[argi], "--headless") == 0) {
+            headless = true;
+        } else if (strcmp(argv[argi], "--audio-buffer") == 0 && argi + 1 < argc) {
+            audio_buffer = atoi(argv[++argi]);
+        } else if (strcmp(argv[argi], "--audio-rt") == 0) {
+            audio_rt = true;
+        } else {
+            break;
+        }
+    }
+    const char* target = (argi < argc) ? argv[argi] : NULL;
 
-    if (argc > 1 && has_wasm_ext(argv[1])) {
+    if (target && has_wasm_ext(target)) {
         single_mode = true;
-        single_path = argv[1];
+        single_path = target;
     } else {
-        snprintf(s_apps_dir, sizeof(s_apps_dir), "%s",
-                 (argc > 1) ? argv[1] : "../../wasm-apps");
+        snprintf(s_apps_dir, sizeof(s_apps_dir), "%s", target ? target : "../../wasm-apps");
+    }
+    if ((replay_path || headless) && !single_mode) {
+        fprintf(stderr, "--replay / --headless need a .wasm file\n");
+        return 2;
+    }
+    if (headless && !replay_path) {
+        fprintf(stderr, "--headless needs --replay\n");
+        return 2;
+    }
+    if (replay_path && !replay_load(replay_path)) return 1;
+    if (headless) {
+        setenv("SDL_VIDEODRIVER", "dummy", 1);
+        setenv("SDL_AUDIODRIVER", "dummy", 1);
     }
 
+    if (audio_buffer < 64 || audio_buffer > 4096) {
+        fprintf(stderr, "--audio-buffer must be 64..4096 frames\n");
+        return 2;
+    }
+    host_sdl_audio_config(audio_buffer, audio_rt);
     if (!host_sdl_init()) return 1;
     host_midi_init();
+    if (headless) host_sdl_audio_offline();
+    if (wav_path && !host_sdl_capture_start(wav_path)) {
+        host_midi_shutdown();
+        host_sdl_shutdown();
+        return 1;
+    }
 
     RuntimeInitArgs init_args;
     memset(&init_args, 0, sizeof(init_args));
@@ -304,6 +481,11 @@ int main(int argc, char** argv)
         goto out;
     }
 
+    if (headless) {
+        ret = run_headless(single_path);
+        goto out;
+    }
+
     {
         App app;
         bool app_running = false;
@@ -322,11 +504,28 @@ int main(int argc, char** argv)
             printf("launcher: %s (click to launch, ESC to return)\n", s_apps_dir);
         }
 
+        /* 入力はイベント到着時に即処理し(widget の押下表示を tick 待ちにしない)、
+         * app_tick は締切ベースで 100ms 周期に回す */
+        uint32_t next_tick = SDL_GetTicks();
         while (!quit) {
             SDL_Event ev;
-            while (SDL_PollEvent(&ev)) {
+            int wait_ms = 30; /* メニュー表示中の再描画周期 */
+            if (app_running) {
+                wait_ms = (int)(next_tick - SDL_GetTicks());
+                if (wait_ms < 0) wait_ms = 0;
+                const int replay_ms = replay_wait_ms(host_sdl_now_ms());
+                if (replay_ms >= 0 && replay_ms < wait_ms) wait_ms = replay_ms;
+                const int input_ms = host_sdl_input_wait_ms(); /* 長押し連打の期限 */
+                if (input_ms >= 0 && input_ms < wait_ms) wait_ms = input_ms;
+                const int audio_ms = host_sdl_audio_wait_ms(); /* play_at の鳴らし始め */
+                if (audio_ms >= 0 && audio_ms < wait_ms) wait_ms = audio_ms;
+            }
+            bool have_ev = SDL_WaitEventTimeout(&ev, wait_ms) != 0;
+            for (; have_ev; have_ev = SDL_PollEvent(&ev) != 0) {
                 if (ev.type == SDL_QUIT) {
                     quit = true;
+                } else if (ev.type == SDL_SYSWMEVENT) {
+                    host_sdl_input_syswm(&ev); /* X サーバの打刻(続くマウスイベント用) */
                 } else if (ev.type == SDL_KEYDOWN &&
                            ev.key.keysym.sym == SDLK_ESCAPE) {
                     if (app_running) {
@@ -342,13 +541,19 @@ int main(int argc, char** argv)
                     } else {
                         quit = true; /* メニューで ESC = 終了 */
                     }
-                } else if (app_running && (ev.type == SDL_MOUSEBUTTONDOWN ||
-                                           ev.type == SDL_MOUSEBUTTONUP) &&
+                } else if (app_running && !s_replay &&
+                           (ev.type == SDL_MOUSEBUTTONDOWN || ev.type == SDL_MOUSEBUTTONUP) &&
                            ev.button.button == SDL_BUTTON_LEFT) {
                     /* 実機のタッチ DOWN/UP 相当としてアプリのキューへ */
                     int lx, ly;
                     host_sdl_window_to_logical(ev.button.x, ev.button.y, &lx, &ly);
-                    host_sdl_push_touch(ev.type == SDL_MOUSEBUTTONDOWN, lx, ly);
+                    host_sdl_push_touch(ev.type == SDL_MOUSEBUTTONDOWN, lx, ly,
+                                        host_sdl_event_time(ev.button.timestamp));
+                } else if (app_running && !s_replay && ev.type == SDL_MOUSEMOTION &&
+                           (ev.motion.state & SDL_BUTTON_LMASK)) {
+                    int lx, ly;
+                    host_sdl_window_to_logical(ev.motion.x, ev.motion.y, &lx, &ly);
+                    host_sdl_push_motion(lx, ly, host_sdl_event_time(ev.motion.timestamp));
                 } else if (!app_running && !single_mode &&
                            ev.type == SDL_MOUSEMOTION) {
                     int lx, ly;
@@ -363,6 +568,7 @@ int main(int argc, char** argv)
                     if (idx >= 0) {
                         if (app_load(s_apps[idx].path, &app)) {
                             app_running = true;
+                            next_tick = SDL_GetTicks();
                         }
                         /* 失敗時は s_status にエラーが入りメニューに留まる */
                     }
@@ -370,7 +576,20 @@ int main(int argc, char** argv)
             }
             if (quit) break;
 
+            host_sdl_capture_pump();
+            host_sdl_audio_pump(); /* 曲の切り替え(専用スレッド)を帳簿に取り込む */
             if (app_running) {
+                replay_pump(host_sdl_now_ms()); /* 再生中はマウスの代わりに記録を積む */
+                host_sdl_input_poll();
+                if ((int32_t)(SDL_GetTicks() - next_tick) < 0) {
+                    /* tick 前: 入力で変わった widget 表示だけ即時に描き直す */
+                    if (host_sdl_take_redraw()) host_sdl_render();
+                    continue;
+                }
+                next_tick += APP_TICK_MS;
+                if ((int32_t)(SDL_GetTicks() - next_tick) >= 0) {
+                    next_tick = SDL_GetTicks() + APP_TICK_MS; /* 遅延は追わない */
+                }
                 if (!wasm_runtime_call_wasm(app.exec_env, app.fn_tick, 0, NULL)) {
                     snprintf(s_status, sizeof(s_status), "app_tick: %s",
                              wasm_runtime_get_exception(app.inst));
@@ -384,11 +603,14 @@ int main(int argc, char** argv)
                     }
                     continue;
                 }
+                /* tick 中に届いた入力を Present(vsync 待ちがあり得る)の前に SDL の
+                 * キューへ取り込む。time_ms は X11 ならサーバの打刻、それ以外は
+                 * ここで取り込んだ時刻 */
+                SDL_PumpEvents();
+                host_sdl_take_redraw();
                 host_sdl_render();
-                SDL_Delay(APP_TICK_MS);
             } else {
                 menu_render(hover);
-                SDL_Delay(30);
             }
         }
 
@@ -400,5 +622,6 @@ out:
     wasm_runtime_destroy();
     host_midi_shutdown();
     host_sdl_shutdown();
+    free(s_replay);
     return ret;
 }
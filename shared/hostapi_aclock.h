@@ -0,0 +1,98 @@
+/*
+ * 音声クロック(出力へ描いたフレーム数)とアプリの µs 時基の対応
+ * (hostapi_now_us64 / hostapi_audio_get_clock / µs の予約。実機 ESP32 ホストと
+ * Linux ホストで共有)。
+ *
+ * 描く側(Linux: オーディオコールバック、実機: 描画ループ)はバッファを描く
+ * たびに次の 3 つを組で公開し、読む側(wasm スレッド)が 1 組を取る:
+ *   frames     描いたフレーム数(次に描くフレームの番号)
+ *   frames_us  そのフレームの時刻(hostapi_now_us64 の時基)
+ *   offset_us  hostapi_now_us64 = 壁時計 - offset_us
+ *
+ * Linux の壁時計(SDL の時計)と音声デバイスのクロックは別の水晶で、長く回すと
+ * ずれる。Linux は now_us64 を音声クロックに揃える: 予約の µs 時刻 t は
+ * フレーム (t - epoch_us) × rate に当たり(hostapi_aclock_us_to_sample)、
+ * offset_us はデバイスがそのフレームを要求する時刻とのずれ(hostapi_xrun.h の
+ * base。クロックのずれと取りこぼしに付いていく)。now_us64 で数えた間隔は
+ * そのままフレーム数になり、何時間回しても積み上がらない。実機は I2S と
+ * esp_timer が同じ水晶なので offset_us = 0(now_us64 = esp_timer)。
+ *
+ * 公開は seqlock(hostapi_levels.h と同じ)。64bit 値は 32bit 語 2 つで持つ
+ * (実機は 32bit CPU)。書く側は 1 スレッドだけ。
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+typedef struct {
+    uint32_t seq;     /* 奇数 = 書いている途中 */
+    uint32_t w[6];    /* frames / frames_us / offset_us の下位・上位 */
+} hostapi_aclock_t;
+
+static inline void hostapi_aclock_init(hostapi_aclock_t* c)
+{
+    memset(c, 0, sizeof(*c));
+}
+
+static inline void hostapi_aclock_publish(hostapi_aclock_t* c, uint64_t frames, int64_t frames_us,
+                                          int64_t offset_us)
+{
+    const uint64_t v[3] = {frames, (uint64_t)frames_us, (uint64_t)offset_us};
+    const uint32_t s = c->seq;
+    __atomic_store_n(&c->seq, s + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    for (int i = 0; i < 3; i++) {
+        __atomic_store_n(&c->w[i * 2], (uint32_t)v[i], __ATOMIC_RELAXED);
+        __atomic_store_n(&c->w[i * 2 + 1], (uint32_t)(v[i] >> 32), __ATOMIC_RELAXED);
+    }
+    __atomic_store_n(&c->seq, s + 2, __ATOMIC_RELEASE);
+}
+
+/* 1 組を読む。公開前(seq 0)は false で、出力は 0 */
+static inline bool hostapi_aclock_read(const hostapi_aclock_t* c, uint64_t* frames,
+                                       int64_t* frames_us, int64_t* offset_us)
+{
+    uint64_t v[3];
+    uint32_t s1;
+    for (;;) {
+        s1 = __atomic_load_n(&c->seq, __ATOMIC_ACQUIRE);
+        if (s1 & 1) continue; /* 書き換え中(数十 ns) */
+        for (int i = 0; i < 3; i++) {
+            v[i] = (uint64_t)__atomic_load_n(&c->w[i * 2 + 1], __ATOMIC_RELAXED) << 32 |
+                   __atomic_load_n(&c->w[i * 2], __ATOMIC_RELAXED);
+        }
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&c->seq, __ATOMIC_RELAXED) == s1) break;
+    }
+    *frames = v[0];
+    *frames_us = (int64_t)v[1];
+    *offset_us = (int64_t)v[2];
+    return s1 != 0;
+}
+
+/* µs 時刻 → 音声クロック上のフレーム(epoch_us = フレーム 0 の時刻。過ぎていれば 0) */
+static inline uint64_t hostapi_aclock_us_to_sample(int64_t time_us, int64_t epoch_us,
+                                                   uint32_t rate)
+{
+    if (time_us <= epoch_us) return 0;
+    const uint64_t d = (uint64_t)(time_us - epoch_us);
+    return d / 1000000 * rate + d % 1000000 * rate / 1000000;
+}
+
+/* フレーム → µs 時刻(us_to_sample の逆。切り捨て) */
+static inline int64_t hostapi_aclock_sample_to_us(uint64_t sample, int64_t epoch_us,
+                                                  uint32_t rate)
+{
+    return epoch_us + (int64_t)(sample / rate * 1000000 + sample % rate * 1000000 / rate);
+}
+
+/* 読む側の単調化: offset_us が増える(時計を戻す向き)ときは追い付くまで
+ * 前回値に留める。last は読む側ごとに持つ */
+static inline int64_t hostapi_aclock_monotonic(int64_t* last, int64_t now_us)
+{
+    if (now_us < *last) return *last;
+    *last = now_us;
+    return now_us;
+}
@@ -0,0 +1,165 @@
+/*
+ * オーディオコマンドチャネルとコールバック所要時間のヒストグラム。
+ *
+ * Linux ホストの wasm スレッドとオーディオコールバックの受け渡しに使う
+ * (bench からも使うので shared に置く。実機はトーンタスクへの FreeRTOS
+ * キューで同じことをしている)。
+ *
+ *   wasm スレッド → コールバック: 発音・予約・取り消し・音量・リセット要求
+ *   コールバック → wasm スレッド: 予約がキューを出た(発音した / 受け付け
+ *                                なかった)通知
+ *
+ * どちらも単一生産者/単一消費者(SPSC)のウェイトフリーリング。head / tail は
+ * 単調増加の u32(添字は & mask)で、tail は生産者だけ、head は消費者だけが
+ * 書く。スロットを書いてから tail を release で進め、読んでから head を
+ * release で進めるので、スロット自体は atomic でなくてよい。満杯なら積まずに
+ * false(待つかどうかは生産者が決める。コールバックは決して待たない)。
+ *
+ * GCC/Clang の __atomic 組み込みを使う(hostapi_evq.h と同じ)。
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "hostapi_tsched.h"
+
+#define HOSTAPI_ACMD_DEPTH 256 /* 2 のべき乗 */
+
+enum {
+    /* wasm スレッド → コールバック */
+    HOSTAPI_ACMD_PLAY = 0,      /* e を次のバッファ先頭で発音 */
+    HOSTAPI_ACMD_INSERT,        /* e を予約キューへ(seq は e.seq のまま) */
+    HOSTAPI_ACMD_SET_LEGACY,    /* legacy 予約を e に置き換える。arg = 呼び出し時の now_ms */
+    HOSTAPI_ACMD_CANCEL_LEGACY,
+    HOSTAPI_ACMD_REMOVE_ID,     /* arg = enqueue の予約 id */
+    HOSTAPI_ACMD_CLEAR,         /* 全予約を取り消す(last_fired は保つ) */
+    HOSTAPI_ACMD_VOLUME,        /* arg = マスター音量 0..100 */
+    HOSTAPI_ACMD_PREPARE,       /* e のトーンをレンダ済みキャッシュへ描く */
+    HOSTAPI_ACMD_RESET,         /* アプリセッションの音を全て初期状態へ */
+    HOSTAPI_ACMD_NOTE_ENV,      /* ノートのエンベロープ定義。e.note_env = slot、
+                                   e.freq_hz / dur_ms = attack / decay ms、
+                                   e.level = sustain %、arg = release ms */
+    /* コールバック → wasm スレッド */
+    HOSTAPI_ACMD_GONE,          /* 予約 e がキューを出た。arg = 1 なら発音した */
+};
+
+typedef struct {
+    int32_t kind;               /* HOSTAPI_ACMD_* */
+    int32_t arg;
+    hostapi_tsched_entry_t e;
+} hostapi_acmd_t;
+
+typedef struct {
+    hostapi_acmd_t slot[HOSTAPI_ACMD_DEPTH];
+    uint32_t head;              /* 消費者のみ書く */
+    uint32_t tail;              /* 生産者のみ書く */
+    uint32_t full;              /* 満杯で積めなかった回数(生産者のみ書く) */
+    uint32_t high_water;        /* 積んだ直後の最大滞留数(同上) */
+} hostapi_acmd_ring_t;
+
+static inline void hostapi_acmd_init(hostapi_acmd_ring_t* q)
+{
+    memset(q, 0, sizeof(*q));
+}
+
+/* 生産者。満杯なら積まずに false */
+static inline bool hostapi_acmd_push(hostapi_acmd_ring_t* q, const hostapi_acmd_t* c)
+{
+    const uint32_t tail = q->tail;
+    const uint32_t used = tail - __atomic_load_n(&q->head, __ATOMIC_ACQUIRE);
+    if (used >= HOSTAPI_ACMD_DEPTH) {
+        q->full++;
+        return false;
+    }
+    q->slot[tail & (HOSTAPI_ACMD_DEPTH - 1)] = *c;
+    __atomic_store_n(&q->tail, tail + 1, __ATOMIC_RELEASE);
+    if (used + 1 > q->high_water) q->high_water = used + 1;
+    return true;
+}
+
+/* 消費者。空なら false */
+static inline bool hostapi_acmd_pop(hostapi_acmd_ring_t* q, hostapi_acmd_t* c)
+{
+    const uint32_t head = q->head;
+    if (head == __atomic_load_n(&q->tail, __ATOMIC_ACQUIRE)) return false;
+    *c = q->slot[head & (HOSTAPI_ACMD_DEPTH - 1)];
+    __atomic_store_n(&q->head, head + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+/* ---- 所要時間のヒストグラム ----
+ * 2 のべき乗の µs 区間 [0,1) [1,2) [2,4) … で数える。最後の区間は上限なし。
+ * 書くのは計測する 1 スレッドだけ(表示は計測が止まってから) */
+#define HOSTAPI_LATHIST_BUCKETS 18  /* 最後は 65.5ms 以上 */
+
+typedef struct {
+    uint32_t b[HOSTAPI_LATHIST_BUCKETS];
+    uint32_t count;
+    uint32_t max_us;
+    uint32_t budget_us;         /* これを超えたら over(0 なら数えない) */
+    uint32_t over;
+    uint64_t sum_us;
+} hostapi_lathist_t;
+
+static inline void hostapi_lathist_init(hostapi_lathist_t* h, uint32_t budget_us)
+{
+    memset(h, 0, sizeof(*h));
+    h->budget_us = budget_us;
+}
+
+static inline void hostapi_lathist_add(hostapi_lathist_t* h, uint32_t us)
+{
+    int i = 0;
+    while (i < HOSTAPI_LATHIST_BUCKETS - 1 && (us >> i) != 0) i++;
+    h->b[i]++;
+    h->count++;
+    h->sum_us += us;
+    if (us > h->max_us) h->max_us = us;
+    if (h->budget_us && us > h->budget_us) h->over++;
+}
+
+/* 区間 i の下限(µs) */
+static inline uint32_t hostapi_lathist_lo(int i)
+{
+    return i == 0 ? 0 : 1u << (i - 1);
+}
+
+/* p(0..1)分位点が入る区間の上限(µs)。空なら 0 */
+static inline uint32_t hostapi_lathist_quantile(const hostapi_lathist_t* h, double p)
+{
+    const uint64_t want = (uint64_t)(p * h->count + 0.5);
+    uint64_t seen = 0;
+    for (int i = 0; i < HOSTAPI_LATHIST_BUCKETS; i++) {
+        seen += h->b[i];
+        if (seen >= want && seen > 0) {
+            return i == HOSTAPI_LATHIST_BUCKETS - 1 ? h->max_us : 1u << i;
+        }
+    }
+    return 0;
+}
+
+/* 1 行の要約と、数のある区間だけを棒付きで出す */
+static inline void hostapi_lathist_print(FILE* f, const char* name, const hostapi_lathist_t* h)
+{
+    fprintf(f, "%s: n=%u avg=%.1fus p99<=%uus max=%uus", name, (unsigned)h->count,
+            h->count ? (double)h->sum_us / h->count : 0.0,
+            (unsigned)hostapi_lathist_quantile(h, 0.99), (unsigned)h->max_us);
+    if (h->budget_us) fprintf(f, " over %uus=%u", (unsigned)h->budget_us, (unsigned)h->over);
+    fputc('\n', f);
+    for (int i = 0; i < HOSTAPI_LATHIST_BUCKETS; i++) {
+        if (h->b[i] == 0) continue;
+        char range[32];
+        if (i == HOSTAPI_LATHIST_BUCKETS - 1) {
+            snprintf(range, sizeof(range), ">=%u", (unsigned)hostapi_lathist_lo(i));
+        } else {
+            snprintf(range, sizeof(range), "%u-%u", (unsigned)hostapi_lathist_lo(i),
+                     (unsigned)(1u << i));
+        }
+        const int bar = (int)((uint64_t)h->b[i] * 40 / h->count);
+        fprintf(f, "  %12s us %9u %.*s\n", range, (unsigned)h->b[i], bar,
+                "########################################");
+    }
+}
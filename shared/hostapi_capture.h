@@ -0,0 +1,296 @@
+/*
+ * 出力キャプチャと発音位置の解析(Linux ホストの --wav と bench_onset で共有)。
+ *
+ * ホストの発火統計(click_record_fire)は「いつ発音を決めたか」の記帳で、
+ * 出力ストリームのどこに音が立ち上がったかは見ていない。ここでは出力
+ * そのもの(オーディオコールバックがデバイスに渡したのと同じ PCM)を WAV に
+ * 取り、信号から立ち上がりを検出して予約時刻と突き合わせる。
+ *
+ * キャプチャは 2 ファイル:
+ *   <name>.wav        44.1kHz 16bit ステレオ PCM。先頭はキャプチャ開始時の
+ *                     音声クロック base_sample
+ *   <name>.wav.sched  テキストの発音記録(1 行 1 件、順不同):
+ *     rate <hz>
+ *     fire <time_ms> <id> tone <freq_hz> | sample <handle>   予約の発火
+ *     play <now_ms> tone <freq_hz> | sample <handle>         即時発音の依頼
+ *     epoch <epoch_ms> <base_sample>                         音声クロックの原点
+ *     track <now_ms> <id>                                    再生キューの曲の切り替え
+ *   予約 time_ms の目標位置は WAV 上で
+ *     hostapi_capture_ms_to_sample(time_ms, epoch_ms, rate) - base_sample
+ *   (ホストの発火判定と同じ換算)。
+ *
+ * 立ち上がりの検出(hostapi_onset_detect)はモノラル 1ch を見る:
+ *   - 無音(|x| <= quiet)が gap サンプル以上続いた後、rise サンプル以内に
+ *     thr に届いたら、無音の直後のサンプルを立ち上がりとする(減衰サインの
+ *     初項は非 0 なので、無音からの発音はサンプル単位で正確)
+ *   - 鳴っている最中の発音は、その win サンプル前の窓のピークの ratio% を
+ *     超えたところ(目安。前の音が大きい・和音の上に 1 音足す、などは
+ *     検出できない)
+ *   - 検出後 hold サンプルは次を探さない
+ * 音楽が鳴っているキャプチャは無音が無いので対象外(立ち上がりが過剰に出る)。
+ *
+ * 曲の切り替え(track)は、その時刻の前後で L/R とも 0 のフレームが続く
+ * 最長の区間(hostapi_capture_zero_run)を見る。曲の中の無音と違い、切り替えの
+ * 隙間はディザも残響も無いデジタルの 0 になる。
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define HOSTAPI_CAPTURE_WAV_HEADER 44
+
+/* ---- WAV(16bit ステレオ) ---- */
+static inline void hostapi_capture_le32(uint8_t* p, uint32_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+/* ヘッダを書く。frames は data のフレーム数(書き始めは 0、閉じる前に
+ * 先頭へ戻ってもう一度書く) */
+static inline bool hostapi_capture_wav_header(FILE* f, uint32_t rate, uint32_t frames)
+{
+    uint8_t h[HOSTAPI_CAPTURE_WAV_HEADER];
+    const uint32_t bytes = frames * 4;
+    memcpy(h, "RIFF", 4);
+    hostapi_capture_le32(h + 4, 36 + bytes);
+    memcpy(h + 8, "WAVEfmt ", 8);
+    hostapi_capture_le32(h + 16, 16);
+    h[20] = 1; /* PCM */
+    h[21] = 0;
+    h[22] = 2; /* ステレオ */
+    h[23] = 0;
+    hostapi_capture_le32(h + 24, rate);
+    hostapi_capture_le32(h + 28, rate * 4);
+    h[32] = 4; /* block align */
+    h[33] = 0;
+    h[34] = 16;
+    h[35] = 0;
+    memcpy(h + 36, "data", 4);
+    hostapi_capture_le32(h + 40, bytes);
+    return fwrite(h, 1, sizeof(h), f) == sizeof(h);
+}
+
+/* ホストの click_ms_to_sample と同じ換算 */
+static inline uint64_t hostapi_capture_ms_to_sample(uint32_t ms, uint32_t epoch_ms, uint32_t rate)
+{
+    if (ms <= epoch_ms) return 0;
+    return (uint64_t)(ms - epoch_ms) * rate / 1000;
+}
+
+/* ---- 発音記録 ---- */
+enum { HOSTAPI_CAPTURE_FIRE = 0, HOSTAPI_CAPTURE_PLAY = 1, HOSTAPI_CAPTURE_TRACK = 2 };
+
+typedef struct {
+    int kind;          /* HOSTAPI_CAPTURE_FIRE / PLAY / TRACK */
+    uint32_t time_ms;  /* fire: 予約時刻、play / track: その時の now_ms */
+    int32_t id;        /* fire: 予約(0 = tone_schedule)、track: キューの項目 */
+    bool sample;       /* false: トーン */
+    int32_t param;     /* freq_hz / handle */
+} hostapi_capture_rec_t;
+
+static inline void hostapi_capture_write_rec(FILE* f, const hostapi_capture_rec_t* r)
+{
+    if (r->kind == HOSTAPI_CAPTURE_FIRE) {
+        fprintf(f, "fire %u %d %s %d\n", (unsigned)r->time_ms, (int)r->id,
+                r->sample ? "sample" : "tone", (int)r->param);
+    } else if (r->kind == HOSTAPI_CAPTURE_TRACK) {
+        fprintf(f, "track %u %d\n", (unsigned)r->time_ms, (int)r->id);
+    } else {
+        fprintf(f, "play %u %s %d\n", (unsigned)r->time_ms, r->sample ? "sample" : "tone",
+                (int)r->param);
+    }
+}
+
+typedef struct {
+    uint32_t rate;
+    uint32_t epoch_ms;
+    uint64_t base_sample;
+    bool have_epoch;
+    hostapi_capture_rec_t* rec;   /* malloc。呼び出し側が free */
+    int count;
+} hostapi_capture_log_t;
+
+/* .sched を読む。epoch 行が無ければ false */
+static inline bool hostapi_capture_read_log(FILE* f, hostapi_capture_log_t* log)
+{
+    memset(log, 0, sizeof(*log));
+    log->rate = 44100;
+    int cap = 0;
+    char line[128];
+    while (fgets(line, sizeof(line), f)) {
+        hostapi_capture_rec_t r;
+        char what[16];
+        unsigned t = 0, rate = 0;
+        unsigned long long base = 0;
+        int id = 0, param = 0;
+        memset(&r, 0, sizeof(r));
+        if (sscanf(line, "rate %u", &rate) == 1) {
+            log->rate = rate;
+            continue;
+        }
+        if (sscanf(line, "epoch %u %llu", &t, &base) == 2) {
+            log->epoch_ms = t;
+            log->base_sample = base;
+            log->have_epoch = true;
+            continue;
+        }
+        if (sscanf(line, "fire %u %d %15s %d", &t, &id, what, &param) == 4) {
+            r.kind = HOSTAPI_CAPTURE_FIRE;
+        } else if (sscanf(line, "play %u %15s %d", &t, what, &param) == 3) {
+            r.kind = HOSTAPI_CAPTURE_PLAY;
+        } else if (sscanf(line, "track %u %d", &t, &id) == 2) {
+            r.kind = HOSTAPI_CAPTURE_TRACK;
+            strcpy(what, "track");
+        } else {
+            continue;
+        }
+        r.time_ms = t;
+        r.id = id;
+        r.sample = strcmp(what, "sample") == 0;
+        r.param = param;
+        if (log->count == cap) {
+            cap = cap ? cap * 2 : 256;
+            hostapi_capture_rec_t* p =
+                (hostapi_capture_rec_t*)realloc(log->rec, (size_t)cap * sizeof(*p));
+            if (!p) return false;
+            log->rec = p;
+        }
+        log->rec[log->count++] = r;
+    }
+    return log->have_epoch;
+}
+
+/* pcm(ステレオ、frames フレーム)の [from, to) で L/R とも 0 のフレームが
+ * 続く最長の区間。長さを返し、始まりを *at へ(無ければ 0 と -1) */
+static inline int64_t hostapi_capture_zero_run(const int16_t* pcm, int64_t frames, int64_t from,
+                                               int64_t to, int64_t* at)
+{
+    if (from < 0) from = 0;
+    if (to > frames) to = frames;
+    int64_t best = 0, run = 0;
+    *at = -1;
+    for (int64_t i = from; i < to; i++) {
+        if (pcm[i * 2] != 0 || pcm[i * 2 + 1] != 0) {
+            run = 0;
+            continue;
+        }
+        if (++run > best) {
+            best = run;
+            *at = i - run + 1;
+        }
+    }
+    return best;
+}
+
+/* ---- 立ち上がりの検出 ---- */
+typedef struct {
+    int thr;      /* 発音とみなす振幅 */
+    int quiet;    /* これ以下は無音 */
+    int gap;      /* 無音とみなす連続サンプル数(ゼロ交差と区別する) */
+    int rise;     /* 無音の後 thr に届くまでの上限(サンプル) */
+    int win;      /* 鳴っている最中の比較窓(サンプル) */
+    int ratio;    /* 鳴っている最中の立ち上がり: 比較窓のピークに対する % */
+    int hold;     /* 検出後に次を探さないサンプル数 */
+} hostapi_onset_cfg_t;
+
+static inline void hostapi_onset_cfg_default(hostapi_onset_cfg_t* c, uint32_t rate)
+{
+    c->thr = 64;
+    c->quiet = 0;
+    c->gap = (int)(rate / 2000);  /* 0.5ms */
+    c->rise = (int)(rate / 200);  /* 5ms(100Hz の 1/2 周期) */
+    c->win = (int)(rate / 200);   /* 5ms */
+    c->ratio = 130;
+    c->hold = (int)(rate / 100);  /* 10ms */
+}
+
+/* x(stride おきのモノラル、n サンプル)の立ち上がり位置を out へ昇順に
+ * 最大 max 件。見つけた件数を返す(max を超えた分は数えるだけ) */
+static inline int64_t hostapi_onset_detect(const int16_t* x, int stride, int64_t n,
+                                           const hostapi_onset_cfg_t* c, int64_t* out,
+                                           int64_t max)
+{
+    int64_t found = 0;
+    int64_t quiet_run = 0;        /* 今の無音の長さ */
+    int64_t quiet_end = -1;       /* gap 以上続いた無音の最後のサンプル */
+    int64_t next_ok = 0;          /* hold 明け */
+    for (int64_t i = 0; i < n; i++) {
+        const int a = abs((int)x[i * stride]);
+        if (a <= c->quiet) {
+            if (++quiet_run >= c->gap) quiet_end = i;
+            continue;
+        }
+        quiet_run = 0;
+        if (a < c->thr || i < next_ok) continue;
+        int64_t at = -1;
+        if (quiet_end >= 0 && i - quiet_end <= c->rise) {
+            at = quiet_end + 1;
+        } else if (i >= 2 * (int64_t)c->win) {
+            /* 鳴っている最中: [i-2win, i-win) のピークの ratio% を超えた */
+            int peak = 0;
+            for (int64_t j = i - 2 * c->win; j < i - c->win; j++) {
+                const int b = abs((int)x[j * stride]);
+                if (b > peak) peak = b;
+            }
+            if (a * 100 > peak * c->ratio && peak > c->quiet) {
+                at = i;
+                for (int64_t j = i - c->win; j < i; j++) {
+                    if (abs((int)x[j * stride]) > peak) {
+                        at = j;
+                        break;
+                    }
+                }
+            }
+        }
+        if (at < 0) continue;
+        if (found < max) out[found] = at;
+        found++;
+        quiet_end = -1;
+        next_ok = at + c->hold;
+    }
+    return found;
+}
+
+/* ---- 予定位置との突き合わせ ----
+ * want(昇順、同じ位置の重複可 = 和音)ごとに ±window 内で最も近い立ち上がりを
+ * 取る。同じ位置の want は同じ立ち上がりに対応させる。err[k] = 立ち上がり -
+ * want[k](対応が無ければ missed に数え、err は INT64_MIN)。どの want にも
+ * 対応しなかった立ち上がりの数を返す */
+static inline int64_t hostapi_onset_match(const int64_t* want, int64_t nwant,
+                                          const int64_t* on, int64_t non, int64_t window,
+                                          int64_t* err, int64_t* missed, bool* used)
+{
+    int64_t j = 0;
+    *missed = 0;
+    memset(used, 0, (size_t)non * sizeof(bool));
+    for (int64_t k = 0; k < nwant; k++) {
+        if (k > 0 && want[k] == want[k - 1]) {
+            err[k] = err[k - 1];
+            if (err[k] == INT64_MIN) (*missed)++;
+            continue;
+        }
+        while (j < non && on[j] < want[k] - window) j++;
+        int64_t best = -1;
+        for (int64_t m = j; m < non && on[m] <= want[k] + window; m++) {
+            if (used[m]) continue;
+            if (best < 0 || llabs(on[m] - want[k]) < llabs(on[best] - want[k])) best = m;
+        }
+        if (best < 0) {
+            err[k] = INT64_MIN;
+            (*missed)++;
+            continue;
+        }
+        used[best] = true;
+        err[k] = on[best] - want[k];
+    }
+    int64_t extra = 0;
+    for (int64_t m = 0; m < non; m++) extra += !used[m];
+    return extra;
+}
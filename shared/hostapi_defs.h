@@ -30,6 +30,52 @@
  *   hostapi_fill_rect(x, y, w, h, rgb888)
  *     矩形塗り。色は 0xRRGGBB。
  *
+ *   hostapi_draw_lines(slot, pts_ptr, pts_len, rgb888) -> 0/-1
+ *     折れ線(ポリライン)を 1 回の呼び出しで描く。ピアノロール・エンベロープ・
+ *     グラフ用。pts は int16 (x, y) の組の配列(リトルエンディアン、1 点 4 バイト、
+ *     pts_len はバイト数)。点列はホストにコピーされ、呼び出し後のバッファ再利用は
+ *     自由。
+ *     - 座標ではなく slot(0..HOSTAPI_LINE_SLOTS-1)をキーにした retained
+ *       オブジェクト(点列は毎 tick 変わり得るため)。同じ slot への再描画は置き換え。
+ *     - pts_len == 0 で slot を消去。
+ *     - 1 slot あたり HOSTAPI_LINE_MAX_POINTS 点まで。超過分は警告ログの上で
+ *       切り捨て(-1 にはしない)。
+ *     - 不正な slot、pts_len が 4 の倍数でない場合は -1。
+ *     - 他の描画との重なり順は規定しない(text / rect 間と同様)。
+ *   hostapi_draw_points(slot, pts_ptr, pts_len, rgb888) -> 0/-1
+ *     draw_lines の点列版(各点を 1 ピクセルで打つ。散布図・波形ドット用)。
+ *     slot は draw_lines と共有で、描画した方の種類で置き換わる。
+ *
+ * ============================== widget ==============================
+ *
+ * ボタン・トグル・スライダーをホスト側のネイティブ部品として置く。アプリは
+ * 一度宣言するだけで、ヒットテストと押下中の見た目(押下色・つまみ位置)は
+ * ホストが描画フレーム内で処理し、確定した操作だけを 1 件のイベント
+ * (HOSTAPI_EV_WIDGET)で届ける。tick を待たずに押下フィードバックが出る。
+ *
+ *   hostapi_widget_create(id, kind, x, y, w, h, label_ptr, label_len) -> 0/-1
+ *     id(0..HOSTAPI_WIDGET_SLOTS-1)に部品を置く。同じ id への再 create は
+ *     置き換え(値は 0 に戻る)。kind は HOSTAPI_WIDGET_*。label は部品上に
+ *     表示する UTF-8(63 バイトまで。空可)。不正な id / kind、w/h <= 0 は -1。
+ *     - BUTTON: 押して部品内で離すと ACTIVATED(x=0)。値は持たない。
+ *     - TOGGLE: 押して部品内で離すたびに 0/1 が反転し CHANGED(x=新しい値)。
+ *     - SLIDER: 押下中の位置で値 0..100 が変わり、変わるたびに CHANGED
+ *       (x=値)。h > w なら縦(下端 0、上端 100)、それ以外は横(左端 0)。
+ *       同じ id の CHANGED がキュー末尾にあれば値を上書きする(ドラッグで
+ *       キューを溢れさせない)。
+ *   hostapi_widget_set_value(id, value) -> 0/-1
+ *     値を設定する(TOGGLE は非 0 で 1、SLIDER は 0..100 にクランプ)。
+ *     イベントは発生しない。未使用 id・BUTTON は -1。
+ *   hostapi_widget_get_value(id) -> value/-1
+ *     現在値(未使用 id・BUTTON は -1)。
+ *   hostapi_widget_delete(id) -> 0/-1
+ *     部品を消す(未使用 id は何もせず 0、範囲外 id は -1)。
+ *
+ *   - 部品の上で始まったタッチは部品が消費し、TOUCH_DOWN/UP は配送しない。
+ *   - 押下中に部品外へ出て離した場合、BUTTON / TOGGLE は何も起きない。
+ *   - 配色はホスト既定(v1 では変更不可)。他の描画との重なり順は規定しない。
+ *   - アプリ起動時は全 id 未使用。破棄で消滅。
+ *
  * ============================== input ==============================
  *
  *   hostapi_poll_event(buf_ptr, buf_len) -> n
@@ -42,28 +88,117 @@
  *     - hostapi_event_t は 12 バイト固定・リトルエンディアン。サイズ変更は
  *       しない。拡張は type の追加(アプリは未知 type を無視する契約)と
  *       param への型依存値で行う。
- *     - ホスト側キューは深さ 16。溢れたら最古から捨てる。
+ *     - ホスト側キューは深さ 16(ホストのビルド設定で 2 のべき乗に変更可。
+ *       アプリは深さに依存しないこと)。溢れたら最古から捨てる。両ホストとも
+ *       shared/hostapi_evq.h の同一実装を使う。
  *     - 対応する DOWN を配送していない UP はホストが捨てる(アプリを起動
  *       したタップの UP が漏れないように)。アプリ側も DOWN なしの UP は
  *       無視してよい。
  *     - v1 はシングルタッチ(マルチタッチは将来 param=finger id で拡張)。
+ *     - time_ms は入力がホストに届いた時刻で、キューへ積んだ・poll した時刻
+ *       ではない(tap tempo 等で間隔を測れるよう、誤差は 1ms 程度を目標にする)。
+ *     - HOSTAPI_EV_TOUCH_MOVE: 押下中の位置変化。配送済み DOWN と対応する UP の
+ *       間にだけ発生する(widget が消費したタッチでは発生しない)。ホストは
+ *       合体して積む: キュー末尾が MOVE なら新しい MOVE は積まずに末尾の
+ *       x/y/time_ms を最新位置で上書きし、param(合体した生の移動回数、
+ *       65535 で飽和)を加算する。したがって MOVE は常に最新位置を表し、
+ *       DOWN/UP の間に高々「配送回数 + 1」件しか並ばない。
+ *     - キュー満杯時、MOVE は捨てられる側で、MOVE を積むために DOWN/UP を
+ *       追い出すことはない(満杯で末尾も MOVE でなければ新しい MOVE を捨てる)。
+ *     - HOSTAPI_EV_WIDGET: param=widget id、x=値(BUTTON は 0)、
+ *       y=HOSTAPI_WIDGET_EV_*。time_ms は操作が確定した時刻。
+ *     - HOSTAPI_EV_AUDIO_TRACK(audio 節の hostapi_audio_enqueue)は入力の
+ *       キューとは別に持ち(深さに数えない)、その回の入力イベントより先に返す。
+ *
+ *   hostapi_gesture_enable(mask) -> 0/-1
+ *     ホスト側のジェスチャ認識を種類ごとに有効化する(HOSTAPI_GESTURE_* の
+ *     ビット和。0 で全無効、未知のビットがあれば -1 で変更しない)。
+ *     アプリ起動時は全無効。認識はアプリ画面上のタッチ(widget が消費した
+ *     タッチは対象外)に対して行い、TOUCH_DOWN/MOVE/UP はこれまで通り配送
+ *     した上で、以下を追加で積む(時刻はホストが µs で判定し time_ms に打つ)。
+ *     - HOSTAPI_EV_LONG_PRESS: 500ms 押し続けると param=0、以後押している間
+ *       連打として param=1,2,... を積む。連打間隔は押下 1.5 秒まで 400ms、
+ *       3 秒まで 200ms、以降 100ms。time_ms は予定時刻(tick に量子化され
+ *       ない)。x/y は現在位置。DOWN 位置から 12px を超えて動くと止まる。
+ *     - HOSTAPI_EV_SWIPE: 600ms 以内に主軸方向へ 40px 以上動かして離した。
+ *       param は方向と速度(HOSTAPI_SWIPE_DIR / HOSTAPI_SWIPE_SPEED)、
+ *       x/y は DOWN からの移動量 dx/dy。長押しを認識したタッチでは出ない。
+ *     - HOSTAPI_EV_DOUBLE_TAP: タップ(12px 以内・400ms 以内で離す)の UP から
+ *       300ms 以内に 40px 以内で次のタップ。2 回目の UP で積む。
+ *       param=2 回の DOWN の間隔(ms)、x/y は 2 回目の位置。
  *
  * ============================== audio ==============================
  *
  * MP3 のデコード・出力はネイティブ側。アプリは制御のみを持つ。
+ * MP3 とトーン(hostapi_tone_* / クリック)は同時に鳴る: ホストの出力ミキサ
+ * (shared/hostapi_mix.h)が MP3 を 44.1kHz へリサンプルしてトーンと加算し、
+ * リミッタ(閾値 ~-0.8dBFS)を通して出す。出力レートは曲によらず 44.1kHz 固定。
  * path は「ミュージックルート相対」(実機 /sdcard/music/、Linux
  * ./sdcard/music/)。".." を含む・"/" で始まるパスは拒否(サンドボックス境界)。
  *
  *   hostapi_audio_play(path_ptr, path_len) -> 0/-1
- *     再生開始。再生中に呼ぶと現在の曲を止めて差し替える。
+ *     再生開始。再生中に呼ぶと現在の曲を止めて差し替える(キューは空にする)。
  *     成功 0(state=PLAYING)、失敗 -1(state=ERROR)。
+ *   hostapi_audio_play_at(path_ptr, path_len, time_ms) -> 0/-1
+ *     audio_play と同じだが、曲の先頭を hostapi_now_ms の時基で time_ms に
+ *     鳴らす(tone_schedule の予約と同じ位置。小節線に合わせて伴奏を始める)。
+ *     ホストはすぐ曲を開いてデコーダを用意し、開始の少し前からデコードして
+ *     おき、その時刻まで出力に出さない。Linux はサンプル精度、実機は
+ *     出力チャンク(240 フレーム、~5ms)境界。state はすぐ PLAYING で、
+ *     鳴り始めるまで get_position_ms は 0、PAUSE とシークは -1。過ぎた
+ *     time_ms はすぐ(audio_play と同じ)。audio_play・STOP で取り消せる。
+ *     パスの検査・開けないときの扱いは audio_play と同じ。
+ *   hostapi_audio_enqueue(path_ptr, path_len) -> id/-1
+ *     曲を再生キューの末尾に積み、id(1..65535、積むたびに増える)を返す。
+ *     path の規則は audio_play と同じ。キューは最大 HOSTAPI_AUDIO_QUEUE_MAX 曲で、
+ *     溢れる・path が不正なら -1(何も変えない)。
+ *     - PLAYING / PAUSED 中: ホストはキュー先頭の曲を今の曲が終わる前に開いて
+ *       デコーダを用意しておき(プリロード)、終わった時点で無音を挟まずに
+ *       切り替える。state は PLAYING のまま(FINISHED にならない)。
+ *     - それ以外(STOPPED / FINISHED / ERROR): audio_play と同様にすぐ鳴らす。
+ *       開けなければ -1(state=ERROR)。
+ *     キューの曲が鳴り始めるたびに HOSTAPI_EV_AUDIO_TRACK を hostapi_poll_event
+ *     で届ける(param=id、x=まだ並んでいる曲数、time_ms=ホストが切り替えた
+ *     時刻。実際に聞こえるのは出力バッファの深さぶん後)。開けなかった曲は
+ *     飛ばす(イベントなし)。キューが空のまま曲が終われば従来通り FINISHED。
+ *     audio_play・STOP・アプリ破棄でキューは空になる(PAUSE / RESUME は保つ)。
+ *   hostapi_audio_get_position_ms() -> ms/-1
+ *     今の曲の再生位置(曲の先頭から、出力へ渡した分まで)。PLAYING / PAUSED /
+ *     FINISHED(曲の終わり)で有効、それ以外は -1。キューの曲へ切り替わると
+ *     0 から数え直す。
+ *   hostapi_audio_get_duration_ms() -> ms/-1
+ *     今の曲の長さ。ホストは曲が始まるとバックグラウンドで MP3 のフレーム
+ *     索引を作り(曲の隣に <曲>.mbidx として保存し、次からは読むだけ)、
+ *     できるまでは -1。
+ *   hostapi_audio_seek_ms(ms) -> 実際の位置 ms/-1
+ *     PLAYING / PAUSED 中の曲を ms へ動かす(PAUSED なら RESUME でそこから)。
+ *     位置は索引のあるフレーム境界(ms 以前で最も近いもの。長い曲ほど粗く、
+ *     7 分の曲で ~100ms 刻み)に丸め、実際の位置を返す。曲の長さを超える ms は
+ *     最後のほう。索引ができる前・それ以外の状態・ms < 0 は -1 で何もしない。
+ *   hostapi_audio_get_levels(buf_ptr, buf_len) -> 28/-1
+ *     出力(MP3・トーン・サンプル・ノートを混ぜてリミッタを通した後、音量込み)の
+ *     レベルを hostapi_audio_levels_t として buf に書く。buf_len が足りなければ
+ *     -1。ホストは出力を描きながら ~46ms ごとにチャネルごとのピーク・RMS と
+ *     直近 ~23ms の帯域の強さ(1024 点 FFT、~43Hz から 22kHz を対数で
+ *     HOSTAPI_AUDIO_LEVEL_BANDS 本)を更新しておき、この呼び出しは最新の値を
+ *     写すだけ(tick ごとに 1 回で足りる)。状態によらず呼べ、何も鳴って
+ *     いなければ 0。出力より出力バッファの深さぶん先行する。
+ *   hostapi_audio_get_clock(buf_ptr, buf_len) -> 32/-1
+ *     出力の描画位置を hostapi_now_us64 の時基で hostapi_audio_clock_t として
+ *     buf に書く(buf_len が足りない・音声出力が無ければ -1)。frames は出力へ
+ *     描いたフレーム数、frames_us はその次のフレームの時刻で、µs の予約の
+ *     時刻 t はフレーム frames + (t - frames_us) × rate / 10^6 に入る
+ *     (frames_us より前の t は次のバッファの頭で、遅れて鳴る)。DAC から
+ *     出るのはそのさらに latency_us 後(見込み。Linux はデバイスの手持ち
+ *     2 周期、実機は I2S DMA リングの深さ)。シーケンサは now_us と
+ *     frames_us の差で描画の先行分を、latency_us で映像との合わせを知る。
  *   hostapi_audio_ctrl(cmd) -> 0/-1
  *     HOSTAPI_AUDIO_CMD_*。現在の状態で無効なコマンド(停止中の PAUSE 等)
  *     は何もせず -1。STOP は任意の状態から STOPPED へ。
  *   hostapi_audio_set_volume(v)
  *     マスター音量 0..100(範囲外はクランプ)。MP3 とクリックの両方に適用
  *     (v2 で「MP3 の音量」から再定義)。曲をまたいで持続する。
- *     発音中のクリックには効かず、次の発音から有効。
+ *     MP3 には即時、発音中のクリックには効かず次の発音から有効。
  *   hostapi_audio_get_state() -> HOSTAPI_AUDIO_*
  *     FINISHED(自然終了)は読み取りでは消えず、次の play か STOP まで保持
  *     (100ms tick のポーリングで取りこぼさないため)。ERROR も同様。
@@ -80,8 +215,20 @@
  * ============================== misc ==============================
  *
  *   hostapi_play_click()   クリック音(短い減衰サイン)を即時再生。
- *                          MP3 再生との同時使用は将来の音源 API で整理予定。
+ *                          MP3 再生中も重ねて鳴る。
  *   hostapi_now_ms() -> u32  起動からの経過ミリ秒(イベントの time_ms と同一時基)。
+ *   hostapi_now_us64(buf_ptr, buf_len) -> 8/-1
+ *     起動からの経過 µs を i64(リトルエンディアン)で buf に書く(buf_len < 8
+ *     は -1)。wasm の戻り値を i32 に揃えるため out-pointer で返す。巡回しない。
+ *     音声クロックに揃えた時計で、µs の予約(hostapi_tone_enqueue_us 等)と
+ *     hostapi_audio_get_clock の時基。now_us64 で数えた間隔はそのまま出力の
+ *     フレーム数になり、何時間回しても発音とずれが積み上がらない。
+ *     - 実機: esp_timer(I2S と同じ水晶)。now_ms × 1000 と一致する。
+ *     - Linux: 壁時計と音声デバイスのクロックは別で、デバイスの要求の歩調
+ *       (クロックのずれ・取りこぼし)に合わせて進む。now_ms とは長く回すと
+ *       数十 ppm(1 時間で ~100ms)離れ得るので、µs の予約には now_us64 から
+ *       作った時刻を渡す。時計は戻らない(合わせる向きが遅れなら追い付く
+ *       まで留まる)。
  *
  *   hostapi_tone_define(slot, wave, freq_hz, dur_ms, level) -> 0/-1  (Phase 7C, v2)
  *     slot(0..7)に短い減衰音をパラメトリックに定義する(再定義可)。
@@ -91,14 +238,98 @@
  *     エンベロープは指数減衰(dur_ms 終端で約 -30dB)。
  *     定義はアプリセッション状態: 起動時 slot 0 = 既定クリック
  *     (1000Hz/30ms/100)、slot 1..7 = 未定義。破棄で消滅。
+ *     ホストは定義時に波形を描いておき(レンダ済みキャッシュ。実機は
+ *     Kconfig MIDIBOX_TONE_CACHE_ENTRIES 定義ぶん)、発音はその再生になる。
+ *     鳴る音は変わらない。発音の直前ではなく事前に define しておくと最初の
+ *     発音も軽い。
  *   hostapi_tone_play(slot) -> 0/-1
- *     即時発音。未定義スロットは -1。
+ *     即時発音。未定義スロットは -1。呼んでから鳴るまでの遅延はほぼ一定
+ *     (Linux は SDL のオーディオバッファ 1..2 本ぶん、実機は 0..1 チャンク +
+ *     I2S DMA リングの深さ = Kconfig MIDIBOX_AUDIO_DMA_DESCS × 5.4ms、
+ *     既定 ~22-27ms)。
  *   hostapi_tone_schedule(slot, time_ms) -> 0/-1
  *     予約発音。予約の契約は hostapi_click_schedule と共通(下記)で、
  *     予約はスロットによらず全体で 1 件。パラメータは予約時にスナップショット
  *     される(発音前に tone_define し直しても発音済み予約には影響しない)。
- *   発音の重なり(前の音が鳴り終わる前の発音)は v2 ではベストエフォート
- *   (単声。実機は直列再生)。ポリフォニーとサンプル再生は将来の音源 API で扱う。
+ *   発音の重なり(前の音が鳴り終わる前の発音)はミックスして同時に鳴らす
+ *   (ホストの声数まで。実機は Kconfig MIDIBOX_TONE_VOICES、既定 8。Linux は 8)。
+ *   声が足りなければ最も減衰した音を打ち切って奪う。和は飽和するので、多数を
+ *   level 100 で重ねるなら level を下げる。同じ tick 内の複数の tone_play は
+ *   同時に鳴り始める(和音)。録音済みの音は hostapi_sample_*(下記)で鳴らす。
+ *
+ *   hostapi_tone_enqueue(slot, time_ms) -> id / -1
+ *     予約発音を 1 件追加する(置き換えない)。小節・パターンを先にまとめて
+ *     積むためのもので、アプリは毎 tick 再予約しなくてよい。戻り値は予約 id
+ *     (1 以上。アプリセッション内で一意)。未定義スロット・time_ms <= 0・
+ *     キュー満杯(HOSTAPI_TONE_QUEUE_MAX 件)は -1。パラメータは予約時に
+ *     スナップショットされる。now を過ぎた時刻は可及的速やかに発音する。
+ *     同時刻の予約は積んだ順に、重ねて鳴る(和音)。hostapi_tone_schedule の
+ *     予約とは独立(置き換えも last_fired の判定も受けない)で、MIDI Clock の
+ *     テンポ導出にも使わない。Linux はサンプル精度、実機はトーンタスクの
+ *     チャンク(5.4ms)境界で鳴り始める。
+ *   hostapi_tone_cancel(id) -> 0/-1
+ *     id 指定で未発音の予約を取り消す(発音済み・不明な id は -1)。
+ *     id == 0 は全取り消し(hostapi_tone_schedule の予約も含む。last_fired は
+ *     保つ)。アプリ破棄時、ホストは全予約を取り消す。
+ *
+ *   hostapi_sample_load(path_ptr, path_len) -> handle / -1
+ *     ミュージックルート相対の WAV(PCM 8/16/24bit、モノ/ステレオ、任意の
+ *     レート)または .raw / .pcm(ヘッダ無し 16bit LE モノ 44.1kHz)を読み、
+ *     出力レートへ変換してホストのキャッシュに置く。戻り値はハンドル
+ *     (0..HOSTAPI_SAMPLE_SLOTS-1)。同じ path の再ロードは読み直さず同じ
+ *     ハンドルを返す。path の規則は hostapi_audio_play と同じ。読めない・
+ *     未対応の形式・スロット満杯・キャッシュ容量不足(実機は Kconfig
+ *     MIDIBOX_SAMPLE_CACHE_KB、既定 1024KB。Linux も 1024KB)は -1。
+ *     デコードはこの呼び出しの中で行う(長いファイルは tick を止める。
+ *     起動時にまとめてロードすること)。キャッシュはアプリセッション状態で、
+ *     個別には解放できず、破棄で消滅する。
+ *   hostapi_sample_play(handle, level) -> 0/-1
+ *     即時発音(SD は読まない)。level 0..100(範囲外はクランプ)はマスター
+ *     音量と乗算される。不明なハンドルは -1。同時に HOSTAPI_SAMPLE_VOICES
+ *     声まで重なり、足りなければ残りが最も短い声を奪う。トーンとは別の声で
+ *     鳴り、出力ミキサで MP3・トーンと混ぜる。
+ *   hostapi_sample_schedule(handle, time_ms, level) -> id / -1
+ *     予約発音。hostapi_tone_enqueue と同じキュー・同じ契約(time_ms <= 0 と
+ *     キュー満杯は -1、同時刻は積んだ順、Linux はサンプル精度、実機は
+ *     トーンタスクのチャンク境界)。戻り値の id は hostapi_tone_cancel で
+ *     取り消せる。
+ *
+ *   hostapi_note_define(slot, attack_ms, decay_ms, sustain, release_ms) -> 0/-1
+ *     持続音(note_on / note_off)のエンベロープ slot(0..HOSTAPI_NOTE_ENVS-1)を
+ *     定義する(ADSR、区間ごとに線形)。attack / decay / release は 0..10000ms、
+ *     sustain は 0..100(% 。0 なら decay の終わりで鳴り終わる)。範囲外は
+ *     クランプ、不正な slot は -1。アプリセッション状態で、起動時は全 slot が
+ *     (5, 80, 70, 150)。後続の note_on から効く(鳴っている音は変わらない)。
+ *   hostapi_note_on(ch, slot, pitch, velocity, time_ms) -> 0 / id / -1
+ *     チャネル ch(0..HOSTAPI_NOTE_CHANNELS-1)を slot のエンベロープで
+ *     note_off まで鳴らし続ける(波形はサイン)。tone_define の長さ上限
+ *     (100ms)を超える音・ドローン用で、毎 tick 鳴らし直さなくてよい。
+ *     pitch = MIDI ノート番号 × 100 + セント(0..12799。6900 = A4 440Hz。
+ *     Hz からは 6900 + 1200 × log2(hz / 440))。velocity 1..127(0 は
+ *     note_off と同じ)。振幅はマスター音量と乗算(note_on 時点の音量)。
+ *     鳴っているチャネルへの note_on は位相を保ったままピッチを変え、今の
+ *     音量からアタックし直す(レガート。つなぎ目でクリックしない)。
+ *     time_ms == 0 は即時(0 を返す。遅延は tone_play と同じ)。time_ms > 0 は
+ *     予約で、hostapi_tone_enqueue と同じキュー・同じ契約(満杯は -1、
+ *     同時刻は積んだ順、Linux はサンプル精度、実機はチャンク境界)。戻り値の
+ *     id は hostapi_tone_cancel で取り消せる。不正な ch / slot / pitch、
+ *     負の time_ms は -1。トーン・サンプルの声とは別枠で、出力ミキサではトーンと
+ *     同じバスに混ぜる。
+ *   hostapi_note_off(ch, time_ms) -> 0 / id / -1
+ *     ch をリリースへ(今の音量から release_ms で 0 へ)。鳴っていなければ
+ *     何もしない。time_ms は note_on と同じ(0 は即時、> 0 は予約で id)。
+ *     アプリ破棄時、ホストは全チャネルを即座に止める(リリースしない)。
+ *
+ *   µs の予約(hostapi_now_us64 の時基。time_us は i64):
+ *     hostapi_tone_enqueue_us(slot, time_us) -> id / -1
+ *     hostapi_sample_schedule_us(handle, time_us, level) -> id / -1
+ *     hostapi_note_on_us(ch, slot, pitch, velocity, time_us) -> 0 / id / -1
+ *     hostapi_note_off_us(ch, time_us) -> 0 / id / -1
+ *     ms 版と同じキュー・同じ契約(time_us の 0 / 負の扱い、id、満杯、取り消しは
+ *     hostapi_tone_cancel)で、時刻だけを µs で受ける。Linux は µs をそのまま
+ *     サンプル位置へ換算し(ms 版の予約と混ぜても時刻順)、壁時計では発火
+ *     させない(音声クロックだけで決まる)。実機は ms 版と同じく
+ *     チャンク(5.4ms)境界。ms に直して u32 を超える time_us は -1。
  *
  *   hostapi_play_click()          ≡ hostapi_tone_play(0)
  *   hostapi_click_schedule(t)     ≡ hostapi_tone_schedule(0, t)
@@ -118,7 +349,7 @@
  *       アプリは毎 tick「次の拍」を再予約するだけでよく、二重発音しない。
  *     - now を過ぎた時刻(ただし last_fired より後)の予約は可及的速やかに発音。
  *     - アプリ破棄時、ホストは予約と last_fired をリセットする。
- *     - v2 では MP3 再生中の予約発音の精度は保証しない(クリックと MP3 は排他前提)。
+ *     - MP3 再生中も同じ精度で発音する(出力ミキサで混ぜる)。
  *
  * ============================== midi ==============================
  *
@@ -148,7 +379,7 @@
 /* 入力イベント。12 bytes, align 4。フィールドはリトルエンディアン(ABI 凍結) */
 typedef struct {
     uint16_t type;    /* HOSTAPI_EV_* */
-    uint16_t param;   /* type 依存の追加値。TOUCH_* では 0 */
+    uint16_t param;   /* type 依存の追加値。TOUCH_DOWN/UP では 0 */
     int16_t  x;       /* 論理画面座標(320x240 左上原点)。非タッチ系では 0 */
     int16_t  y;
     uint32_t time_ms; /* イベント発生時刻。hostapi_now_ms() と同一時基 */
@@ -158,9 +389,51 @@ enum {
     HOSTAPI_EV_NONE       = 0, /* 予約(無効値) */
     HOSTAPI_EV_TOUCH_DOWN = 1,
     HOSTAPI_EV_TOUCH_UP   = 2,
-    /* 将来: TOUCH_MOVE, KEY, ... 追加は非破壊 */
+    HOSTAPI_EV_WIDGET     = 3, /* param=widget id, x=値, y=HOSTAPI_WIDGET_EV_* */
+    HOSTAPI_EV_TOUCH_MOVE = 4, /* param=合体した移動回数(1..65535), x/y=最新位置 */
+    HOSTAPI_EV_LONG_PRESS = 5, /* param=連打番号(0=認識), x/y=現在位置 */
+    HOSTAPI_EV_SWIPE      = 6, /* param=方向|速度, x/y=移動量 dx/dy */
+    HOSTAPI_EV_DOUBLE_TAP = 7, /* param=DOWN 間隔 ms, x/y=2 回目の位置 */
+    HOSTAPI_EV_AUDIO_TRACK = 8, /* param=enqueue の id, x=残りのキュー曲数 */
+    /* 将来: KEY, ... 追加は非破壊 */
 };
 
+/* hostapi_gesture_enable の mask */
+enum {
+    HOSTAPI_GESTURE_LONG_PRESS = 1 << 0,
+    HOSTAPI_GESTURE_SWIPE      = 1 << 1,
+    HOSTAPI_GESTURE_DOUBLE_TAP = 1 << 2,
+};
+#define HOSTAPI_GESTURE_ALL \
+    (HOSTAPI_GESTURE_LONG_PRESS | HOSTAPI_GESTURE_SWIPE | HOSTAPI_GESTURE_DOUBLE_TAP)
+
+/* HOSTAPI_EV_SWIPE の param: bit0-1=方向、bit2-15=速度(4 px/s 単位、飽和) */
+enum {
+    HOSTAPI_SWIPE_RIGHT = 0,
+    HOSTAPI_SWIPE_LEFT  = 1,
+    HOSTAPI_SWIPE_DOWN  = 2,
+    HOSTAPI_SWIPE_UP    = 3,
+};
+#define HOSTAPI_SWIPE_PARAM(dir, speed_px_s) \
+    ((uint16_t)(((dir) & 3) | (((speed_px_s) / 4 > 16383 ? 16383 : (speed_px_s) / 4) << 2)))
+#define HOSTAPI_SWIPE_DIR(param) ((param) & 3)
+#define HOSTAPI_SWIPE_SPEED(param) (((param) >> 2) * 4) /* px/s */
+
+/* hostapi_widget_create の kind */
+enum {
+    HOSTAPI_WIDGET_BUTTON = 1,
+    HOSTAPI_WIDGET_TOGGLE = 2,
+    HOSTAPI_WIDGET_SLIDER = 3,
+};
+
+/* HOSTAPI_EV_WIDGET の y(何が起きたか) */
+enum {
+    HOSTAPI_WIDGET_EV_ACTIVATED = 1, /* BUTTON が押された */
+    HOSTAPI_WIDGET_EV_CHANGED   = 2, /* TOGGLE / SLIDER の値が変わった */
+};
+#define HOSTAPI_WIDGET_SLOTS 16
+#define HOSTAPI_WIDGET_SLIDER_MAX 100
+
 /* hostapi_audio_ctrl のコマンド */
 enum {
     HOSTAPI_AUDIO_CMD_PAUSE  = 1,
@@ -183,31 +456,89 @@ enum {
     /* 将来: NOISE, SQUARE, ... 追加は非破壊 */
 };
 #define HOSTAPI_TONE_SLOTS 8
+#define HOSTAPI_TONE_QUEUE_MAX 64 /* hostapi_tone_enqueue の未発音予約の上限 */
+#define HOSTAPI_SAMPLE_SLOTS 32   /* hostapi_sample_load でキャッシュできる数 */
+#define HOSTAPI_SAMPLE_VOICES 8   /* hostapi_sample_play の同時発音数 */
+#define HOSTAPI_NOTE_CHANNELS 8   /* hostapi_note_on のチャネル数 */
+#define HOSTAPI_NOTE_ENVS 4       /* hostapi_note_define のエンベロープ slot 数 */
+#define HOSTAPI_NOTE_PITCH_MAX 12799 /* MIDI 127 + 99 セント */
+#define HOSTAPI_NOTE_ENV_MAX_MS 10000
+#define HOSTAPI_AUDIO_QUEUE_MAX 8  /* hostapi_audio_enqueue で積める曲数 */
+#define HOSTAPI_AUDIO_LEVEL_BANDS 16 /* hostapi_audio_get_levels の帯域数 */
+
+/* hostapi_audio_get_levels の出力。28 bytes, align 4、リトルエンディアン */
+typedef struct {
+    uint32_t seq;      /* 更新番号(~46ms ごとに 1 増える。同じなら前回と同じ窓) */
+    uint16_t peak[2];  /* L/R の最大振幅 0..32767(直近の更新間隔) */
+    uint16_t rms[2];   /* L/R の RMS 0..32767(同上) */
+    uint8_t band[HOSTAPI_AUDIO_LEVEL_BANDS]; /* 低域から高域へ 0..255(0 = -60dBFS 以下) */
+} hostapi_audio_levels_t;
+
+/* hostapi_audio_get_clock の出力。32 bytes, align 8、リトルエンディアン */
+typedef struct {
+    int64_t now_us;       /* 呼び出し時点の hostapi_now_us64 */
+    uint64_t frames;      /* 出力へ描いたフレーム数(描画位置) */
+    int64_t frames_us;    /* 次に描くフレームの時刻(hostapi_now_us64 の時基) */
+    uint32_t rate;        /* 出力レート(44100) */
+    uint32_t latency_us;  /* 描いてから DAC から出るまで(見込み) */
+} hostapi_audio_clock_t;
+
+/* hostapi_draw_lines / hostapi_draw_points の slot 数と 1 slot の最大点数 */
+#define HOSTAPI_LINE_SLOTS 4
+#define HOSTAPI_LINE_MAX_POINTS 1024
 
-/* v1 シンボル一覧(グループ: gfx / input / audio / fs / misc)。
+/* v1 シンボル一覧(グループ: gfx / widget / input / audio / fs / misc)。
  * v0 の 4 関数(draw_text, fill_rect, play_click, now_ms)はシグネチャ・
  * 挙動とも v0 から不変。 */
-#define HOSTAPI_NATIVE_SYMBOLS(X)         \
-    /* gfx */                             \
-    X(hostapi_draw_text, "(ii*~)")        \
-    X(hostapi_fill_rect, "(iiiii)")       \
-    /* input */                           \
-    X(hostapi_poll_event, "(*~)i")        \
-    /* audio */                           \
-    X(hostapi_audio_play, "(*~)i")        \
-    X(hostapi_audio_ctrl, "(i)i")         \
-    X(hostapi_audio_set_volume, "(i)")    \
-    X(hostapi_audio_get_state, "()i")     \
-    /* fs */                              \
-    X(hostapi_fs_list, "(i*~)i")          \
-    /* misc / tone */                     \
-    X(hostapi_play_click, "()")           \
-    X(hostapi_now_ms, "()i")              \
-    X(hostapi_click_schedule, "(i)i")     \
-    X(hostapi_tone_define, "(iiiii)i")    \
-    X(hostapi_tone_play, "(i)i")          \
-    X(hostapi_tone_schedule, "(ii)i")     \
-    /* midi (Phase 8b) */                 \
+#define HOSTAPI_NATIVE_SYMBOLS(X)           \
+    /* gfx */                               \
+    X(hostapi_draw_text, "(ii*~)")          \
+    X(hostapi_fill_rect, "(iiiii)")         \
+    X(hostapi_draw_lines, "(i*~i)i")        \
+    X(hostapi_draw_points, "(i*~i)i")       \
+    /* widget */                            \
+    X(hostapi_widget_create, "(iiiiii*~)i") \
+    X(hostapi_widget_set_value, "(ii)i")    \
+    X(hostapi_widget_get_value, "(i)i")     \
+    X(hostapi_widget_delete, "(i)i")        \
+    /* input */                             \
+    X(hostapi_poll_event, "(*~)i")          \
+    X(hostapi_gesture_enable, "(i)i")       \
+    /* audio */                             \
+    X(hostapi_audio_play, "(*~)i")          \
+    X(hostapi_audio_ctrl, "(i)i")           \
+    X(hostapi_audio_set_volume, "(i)")      \
+    X(hostapi_audio_get_state, "()i")       \
+    X(hostapi_audio_enqueue, "(*~)i")       \
+    X(hostapi_audio_get_position_ms, "()i") \
+    X(hostapi_audio_get_duration_ms, "()i") \
+    X(hostapi_audio_seek_ms, "(i)i")        \
+    X(hostapi_audio_get_levels, "(*~)i")    \
+    X(hostapi_audio_play_at, "(*~i)i")      \
+    X(hostapi_audio_get_clock, "(*~)i")     \
+    /* fs */                                \
+    X(hostapi_fs_list, "(i*~)i")            \
+    /* misc / tone */                       \
+    X(hostapi_play_click, "()")             \
+    X(hostapi_now_ms, "()i")                \
+    X(hostapi_now_us64, "(*~)i")            \
+    X(hostapi_click_schedule, "(i)i")       \
+    X(hostapi_tone_define, "(iiiii)i")      \
+    X(hostapi_tone_play, "(i)i")            \
+    X(hostapi_tone_schedule, "(ii)i")       \
+    X(hostapi_tone_enqueue, "(ii)i")        \
+    X(hostapi_tone_cancel, "(i)i")          \
+    X(hostapi_sample_load, "(*~)i")         \
+    X(hostapi_sample_play, "(ii)i")         \
+    X(hostapi_sample_schedule, "(iii)i")    \
+    X(hostapi_note_define, "(iiiii)i")      \
+    X(hostapi_note_on, "(iiiii)i")          \
+    X(hostapi_note_off, "(ii)i")            \
+    X(hostapi_tone_enqueue_us, "(iI)i")     \
+    X(hostapi_sample_schedule_us, "(iIi)i") \
+    X(hostapi_note_on_us, "(iiiiI)i")       \
+    X(hostapi_note_off_us, "(iI)i")         \
+    /* midi (Phase 8b) */                   \
     X(hostapi_midi_send, "(*~)i")
 
 /* NativeSymbol 配列の初期化子を生成するヘルパ */
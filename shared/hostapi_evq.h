@@ -0,0 +1,248 @@
+/*
+ * 入力イベントキュー(実機 ESP32 ホストと Linux ホストで共有)。
+ *
+ * hostapi_defs.h の input 契約(深さ固定・満杯は最古を捨てる・孤児 UP の抑止・
+ * TOUCH_MOVE / widget CHANGED の合体・MOVE で DOWN/UP を追い出さない)を
+ * 1 か所で実装する、単一生産者/単一消費者(SPSC)のロックフリーリング。
+ *
+ *   生産者: 入力を積む側 1 スレッド(実機 LVGL タスク、Linux 入力処理)。
+ *           ウェイトフリー(ループなし。CAS は高々 1 回ずつ)。
+ *   消費者: hostapi_poll_event を呼ぶ wasm アプリスレッド 1 本。
+ *           ロックフリー(再試行するのは生産者が進んだときだけで、生産者が
+ *           途中で止まっていても待たない)。
+ *
+ * 方式:
+ *   - head / tail は単調増加の u32(添字は & mask)。tail は生産者だけが、
+ *     head は消費者が進める。ただし満杯時は生産者が head を CAS で 1 進めて
+ *     最古を捨てる(消費者と競合したら消費者が取った = 満杯でなくなったので
+ *     そのまま積む)。
+ *   - スロットは中身を 2 面持ち、ver 語(版数 | 取り出し済み | 有効な面)で
+ *     どちらが有効かを示す。末尾の合体は有効でない面へ書いてから ver を CAS で
+ *     次の版へ進める。公開済みの面は書き換えないので、消費者はいつでも
+ *     一貫した面を読める。
+ *   - 消費者は ver を読み、その面を読んでから ver を CAS で取り出し済みにし、
+ *     head を CAS で進める。ver の CAS が失敗したら(読んでいる間に合体された)
+ *     読み直し、head の CAS が失敗したら(生産者に捨てられた)読んだ内容を
+ *     破棄して次へ。生産者の合体は取り出し済みのスロットへは CAS が通らず、
+ *     新しいイベントとして積む。
+ *   - スロットの語は atomic(relaxed)で読み書きし、順序は ver の
+ *     acquire / release とフェンスで付ける(seqlock と同じ読み方)。
+ *
+ * GCC/Clang の __atomic 組み込みを使うので C / C++ の両方からそのまま使える
+ * (実機 xtensa-esp32s3 gcc、Linux gcc)。
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "hostapi_defs.h"
+
+/* 既定の深さ(2 のべき乗)。ホストごとにビルド設定で上書きできる
+ * (Linux: CMake の MIDIBOX_EVENT_QUEUE_DEPTH、実機: Kconfig) */
+#ifndef HOSTAPI_EVQ_DEPTH
+#define HOSTAPI_EVQ_DEPTH 16
+#endif
+
+typedef struct {
+    uint32_t ver;      /* 版数 << 2 | 取り出し済み(bit1) | 有効な面(bit0) */
+    uint32_t w[2][3];  /* hostapi_event_t(12 バイト)を語単位で 2 面 */
+} hostapi_evq_slot_t;
+
+#define HOSTAPI_EVQ_VER_TAKEN 2u
+#define HOSTAPI_EVQ_VER_SIDE 1u
+
+/* 次の版(取り出し済みは落とし、面は side) */
+static inline uint32_t hostapi_evq_next_ver(uint32_t ver, uint32_t side)
+{
+    return ((ver >> 2) + 1) << 2 | side;
+}
+
+typedef struct {
+    hostapi_evq_slot_t* slots;
+    uint32_t mask;          /* 深さ - 1(深さは 2 のべき乗) */
+    uint32_t head;          /* 消費者が進める(満杯時のみ生産者も CAS) */
+    uint32_t tail;          /* 生産者のみ書く */
+
+    /* 生産者のみ触る状態 */
+    bool down_delivered;    /* DOWN を配送済みか(孤児 UP の抑止) */
+    bool touch_down;        /* 配送済み DOWN に対応する UP がまだ(MOVE はこの間だけ) */
+
+    /* 統計(生産者が書き、誰でも relaxed で読める) */
+    uint32_t dropped;       /* 満杯で捨てたイベント数(最古の追い出し + 積めなかった MOVE) */
+    uint32_t coalesced;     /* 末尾への合体回数 */
+    uint32_t high_water;    /* 積んだ直後の最大滞留数 */
+} hostapi_evq_t;
+
+/* 静的初期化用(hostapi_evq_init と同じ状態。slots はゼロ初期化済みであること) */
+#define HOSTAPI_EVQ_INITIALIZER(slots, depth) \
+    { (slots), (uint32_t)(depth) - 1u, 0, 0, false, false, 0, 0, 0 }
+
+/* hostapi_evq_push の結果 */
+typedef enum {
+    HOSTAPI_EVQ_PUSHED = 0,     /* 積んだ */
+    HOSTAPI_EVQ_COALESCED,      /* 末尾のイベントに合体した */
+    HOSTAPI_EVQ_DROPPED_OLDEST, /* 満杯だったので最古を捨てて積んだ */
+    HOSTAPI_EVQ_DROPPED_NEW,    /* 満杯で末尾も MOVE でないので新しい MOVE を捨てた */
+    HOSTAPI_EVQ_REJECTED,       /* 契約上配送しない(孤児 UP、タッチ外の MOVE) */
+} hostapi_evq_result_t;
+
+/* depth は 2 のべき乗(2 以上)。slots は depth 要素 */
+static inline void hostapi_evq_init(hostapi_evq_t* q, hostapi_evq_slot_t* slots,
+                                    uint32_t depth)
+{
+    memset(q, 0, sizeof(*q));
+    memset(slots, 0, sizeof(*slots) * depth);
+    q->slots = slots;
+    q->mask = depth - 1;
+}
+
+/* 空にして状態・統計を初期化する。生産者・消費者とも止まっている時に呼ぶこと
+ * (アプリ起動・破棄時) */
+static inline void hostapi_evq_reset(hostapi_evq_t* q)
+{
+    hostapi_evq_init(q, q->slots, q->mask + 1);
+}
+
+/* 面 side へ書く。消費者がまだ読んでいるかもしれない面なので、先に
+ * release フェンスで直前の ver の更新より後ろに順序付ける */
+static inline void hostapi_evq_store_side(hostapi_evq_slot_t* s, uint32_t side,
+                                          const hostapi_event_t* ev)
+{
+    uint32_t w[3];
+    memcpy(w, ev, sizeof(w));
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    __atomic_store_n(&s->w[side][0], w[0], __ATOMIC_RELAXED);
+    __atomic_store_n(&s->w[side][1], w[1], __ATOMIC_RELAXED);
+    __atomic_store_n(&s->w[side][2], w[2], __ATOMIC_RELAXED);
+}
+
+static inline void hostapi_evq_load_side(const hostapi_evq_slot_t* s, uint32_t side,
+                                         hostapi_event_t* ev)
+{
+    uint32_t w[3];
+    w[0] = __atomic_load_n(&s->w[side][0], __ATOMIC_RELAXED);
+    w[1] = __atomic_load_n(&s->w[side][1], __ATOMIC_RELAXED);
+    w[2] = __atomic_load_n(&s->w[side][2], __ATOMIC_RELAXED);
+    memcpy(ev, w, sizeof(w));
+}
+
+/* 末尾(tail-1)が未消費で合体可能なら、もう一方の面へ書いて版を進める
+ * (生産者側)。消費者が先に取り出し済みにしていたら合体しない */
+static inline bool hostapi_evq_try_coalesce(hostapi_evq_t* q, uint32_t t,
+                                            const hostapi_event_t* ev)
+{
+    if (t == __atomic_load_n(&q->head, __ATOMIC_ACQUIRE)) return false; /* 空 */
+
+    hostapi_evq_slot_t* s = &q->slots[(t - 1) & q->mask];
+    uint32_t ver = __atomic_load_n(&s->ver, __ATOMIC_ACQUIRE);
+    if (ver & HOSTAPI_EVQ_VER_TAKEN) return false;
+
+    hostapi_event_t last; /* 中身を書くのは生産者だけなのでそのまま読める */
+    hostapi_evq_load_side(s, ver & HOSTAPI_EVQ_VER_SIDE, &last);
+    if (ev->type == HOSTAPI_EV_TOUCH_MOVE && last.type == HOSTAPI_EV_TOUCH_MOVE) {
+        last.x = ev->x;
+        last.y = ev->y;
+        last.time_ms = ev->time_ms;
+        if (last.param < UINT16_MAX) last.param++;
+    } else if (ev->type == HOSTAPI_EV_WIDGET && ev->y == HOSTAPI_WIDGET_EV_CHANGED &&
+               last.type == ev->type && last.param == ev->param && last.y == ev->y) {
+        last.x = ev->x;
+        last.time_ms = ev->time_ms;
+    } else {
+        return false;
+    }
+    const uint32_t side = (ver & HOSTAPI_EVQ_VER_SIDE) ^ 1u;
+    hostapi_evq_store_side(s, side, &last);
+    /* 失敗 = 消費者が取り出し済みにした: 合体せず新規に積む */
+    return __atomic_compare_exchange_n(&s->ver, &ver, hostapi_evq_next_ver(ver, side), false,
+                                       __ATOMIC_RELEASE, __ATOMIC_RELAXED);
+}
+
+/* イベントを積む(生産者側)。input 契約の配送規則をここで適用する */
+static inline hostapi_evq_result_t hostapi_evq_push(hostapi_evq_t* q, uint16_t type,
+                                                    uint16_t param, int16_t x, int16_t y,
+                                                    uint32_t time_ms)
+{
+    /* アプリ起動タップの UP がアプリに漏れないよう、DOWN 未配送の UP は捨てる */
+    if (type == HOSTAPI_EV_TOUCH_UP && !q->down_delivered) return HOSTAPI_EVQ_REJECTED;
+    if (type == HOSTAPI_EV_TOUCH_MOVE && !q->touch_down) return HOSTAPI_EVQ_REJECTED;
+    if (type == HOSTAPI_EV_TOUCH_DOWN) q->down_delivered = q->touch_down = true;
+    if (type == HOSTAPI_EV_TOUCH_UP) q->touch_down = false;
+
+    hostapi_event_t ev;
+    ev.type = type;
+    ev.param = (type == HOSTAPI_EV_TOUCH_MOVE) ? 1 : param;
+    ev.x = x;
+    ev.y = y;
+    ev.time_ms = time_ms;
+
+    const uint32_t t = q->tail;
+    if (hostapi_evq_try_coalesce(q, t, &ev)) {
+        __atomic_store_n(&q->coalesced, q->coalesced + 1, __ATOMIC_RELAXED);
+        return HOSTAPI_EVQ_COALESCED;
+    }
+
+    hostapi_evq_result_t result = HOSTAPI_EVQ_PUSHED;
+    uint32_t h = __atomic_load_n(&q->head, __ATOMIC_ACQUIRE);
+    if (t - h > q->mask) { /* 満杯 */
+        if (type == HOSTAPI_EV_TOUCH_MOVE) { /* MOVE のために古い DOWN/UP は捨てない */
+            __atomic_store_n(&q->dropped, q->dropped + 1, __ATOMIC_RELAXED);
+            return HOSTAPI_EVQ_DROPPED_NEW;
+        }
+        /* 最古を捨てる。CAS 失敗 = 消費者が取った = もう満杯ではない */
+        if (__atomic_compare_exchange_n(&q->head, &h, h + 1, false,
+                                        __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+            __atomic_store_n(&q->dropped, q->dropped + 1, __ATOMIC_RELAXED);
+            result = HOSTAPI_EVQ_DROPPED_OLDEST;
+        }
+    }
+
+    hostapi_evq_slot_t* s = &q->slots[t & q->mask];
+    const uint32_t ver = __atomic_load_n(&s->ver, __ATOMIC_RELAXED);
+    hostapi_evq_store_side(s, 0, &ev);
+    __atomic_store_n(&s->ver, hostapi_evq_next_ver(ver, 0), __ATOMIC_RELEASE);
+    __atomic_store_n(&q->tail, t + 1, __ATOMIC_RELEASE);
+
+    const uint32_t depth = t + 1 - __atomic_load_n(&q->head, __ATOMIC_RELAXED);
+    if (depth <= q->mask + 1 && depth > q->high_water) {
+        __atomic_store_n(&q->high_water, depth, __ATOMIC_RELAXED);
+    }
+    return result;
+}
+
+/* 1 件取り出す(消費者側)。空なら false */
+static inline bool hostapi_evq_pop(hostapi_evq_t* q, hostapi_event_t* out)
+{
+    for (;;) {
+        uint32_t h = __atomic_load_n(&q->head, __ATOMIC_ACQUIRE);
+        const uint32_t t = __atomic_load_n(&q->tail, __ATOMIC_ACQUIRE);
+        if (h == t) return false;
+
+        hostapi_evq_slot_t* s = &q->slots[h & q->mask];
+        uint32_t ver = __atomic_load_n(&s->ver, __ATOMIC_ACQUIRE);
+        if (ver & HOSTAPI_EVQ_VER_TAKEN) continue; /* 古い h(生産者が捨てて再利用中) */
+        hostapi_event_t ev;
+        hostapi_evq_load_side(s, ver & HOSTAPI_EVQ_VER_SIDE, &ev);
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (!__atomic_compare_exchange_n(&s->ver, &ver, ver | HOSTAPI_EVQ_VER_TAKEN, false,
+                                         __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+            continue; /* 読んでいる間に合体された(または再利用された): 読み直す */
+        }
+        if (__atomic_compare_exchange_n(&q->head, &h, h + 1, false, __ATOMIC_ACQ_REL,
+                                        __ATOMIC_RELAXED)) {
+            *out = ev;
+            return true;
+        }
+        /* 読んでいる間に生産者が最古として捨てた: 読んだ内容は無効 */
+    }
+}
+
+/* 滞留数(目安。並行中は瞬間値) */
+static inline uint32_t hostapi_evq_count(const hostapi_evq_t* q)
+{
+    const uint32_t t = __atomic_load_n(&q->tail, __ATOMIC_ACQUIRE);
+    const uint32_t h = __atomic_load_n(&q->head, __ATOMIC_ACQUIRE);
+    return t - h;
+}
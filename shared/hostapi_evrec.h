@@ -0,0 +1,55 @@
+/*
+ * 入力イベント記録ファイル(実機 ESP32 ホストと Linux ホストで共有)。
+ *
+ * アプリに配送したイベント列(hostapi_event_t)を、time_ms をアプリ起動
+ * からの相対時刻に直して保存する。Linux ホストの --replay で同じ時刻に
+ * 再注入し、操作を伴う計測を人手なしで繰り返せるようにする。
+ *
+ * 形式(リトルエンディアン):
+ *   ヘッダ 16 バイト: magic "MBEVREC1"(8) / record_size u32(=12) / reserved u32(=0)
+ *   以降 hostapi_event_t(12 バイト)の並び。time_ms は起動からの相対 ms で
+ *   単調非減少。件数はファイル長から求める(途中で電源断しても読める)。
+ *
+ * 記録するのは契約の配送規則(孤児 UP・タッチ外 MOVE の破棄)を通った後の
+ * イベントで、キュー内の合体・満杯時の破棄より前。再生側は同じ規則の
+ * キューに積み直すので、合体・破棄も同じように起きる。
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "hostapi_defs.h"
+
+#define HOSTAPI_EVREC_MAGIC "MBEVREC1"
+#define HOSTAPI_EVREC_HEADER_SIZE 16
+
+static inline bool hostapi_evrec_write_header(FILE* f)
+{
+    uint8_t h[HOSTAPI_EVREC_HEADER_SIZE] = {0};
+    memcpy(h, HOSTAPI_EVREC_MAGIC, 8);
+    h[8] = (uint8_t)sizeof(hostapi_event_t);
+    return fwrite(h, 1, sizeof(h), f) == sizeof(h);
+}
+
+/* 先頭のヘッダを検証して読み飛ばす */
+static inline bool hostapi_evrec_read_header(FILE* f)
+{
+    uint8_t h[HOSTAPI_EVREC_HEADER_SIZE];
+    if (fread(h, 1, sizeof(h), f) != sizeof(h)) return false;
+    return memcmp(h, HOSTAPI_EVREC_MAGIC, 8) == 0 && h[8] == sizeof(hostapi_event_t) &&
+           h[9] == 0 && h[10] == 0 && h[11] == 0;
+}
+
+/* 両ホストともリトルエンディアンなので構造体をそのまま書く */
+static inline bool hostapi_evrec_write(FILE* f, const hostapi_event_t* ev)
+{
+    return fwrite(ev, sizeof(*ev), 1, f) == 1;
+}
+
+static inline bool hostapi_evrec_read(FILE* f, hostapi_event_t* ev)
+{
+    return fread(ev, sizeof(*ev), 1, f) == 1;
+}
@@ -0,0 +1,116 @@
+/*
+ * int16 PCM の Q15 ゲイン段(実機 ESP32 ホストと Linux ホストで共有)。
+ *
+ * 出力ミキサ(hostapi_mix.h)が MP3 の音量(MUSIC ゲイン)を掛けるのに使う。
+ * 旧 write_fn はデコード結果を 1 サンプルずつ float にして乗算・lround・
+ * クランプしていた。ここではブロック(ミキサの 1 チャンク)ごとに:
+ *
+ *   - ゲインが変わらなければ定数倍。1.0 はコピーだけ、それ以外は
+ *     (x * g + 2^14) >> 15(四捨五入。切り捨ての -0.5 LSB の直流を乗せない)を
+ *     SIMD で 8 サンプルずつ(NEON / x86 SSE2。どちらも無いビルドはスカラ)。
+ *     SIMD とスカラの出力はビット一致
+ *   - ゲインが変わったブロックは、前のゲインから新しいゲインへフレームごとに
+ *     線形に動かす(段差で鳴るジッパーノイズを 1 ブロックに均す)。ブロックの
+ *     最後のフレームでちょうど新しいゲインになる
+ *
+ * ゲインは 0..HOSTAPI_GAIN_UNITY(Q15、1.0 = 32768)。|出力| <= |入力| なので
+ * 飽和は要らない。状態(今のゲイン)は呼び出し側のスレッドだけが触る。
+ */
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#define HOSTAPI_GAIN_NEON 1
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define HOSTAPI_GAIN_SSE2 1
+#endif
+
+#define HOSTAPI_GAIN_UNITY 32768
+
+typedef struct {
+    int32_t cur;  /* 今のゲイン(Q15) */
+} hostapi_gain_t;
+
+static inline void hostapi_gain_init(hostapi_gain_t* g, int32_t q15)
+{
+    g->cur = q15;
+}
+
+static inline const char* hostapi_gain_kernel_name(void)
+{
+#if HOSTAPI_GAIN_NEON
+    return "q15-neon";
+#elif HOSTAPI_GAIN_SSE2
+    return "q15-sse2";
+#else
+    return "q15";
+#endif
+}
+
+static inline int16_t hostapi_gain_mul(int16_t x, int32_t g)
+{
+    return (int16_t)((x * g + (1 << 14)) >> 15);
+}
+
+/* out[i] = in[i] × g(n サンプル、g < HOSTAPI_GAIN_UNITY)。スカラ版 */
+static inline void hostapi_gain_const_scalar(const int16_t* in, int16_t* out, int n, int32_t g)
+{
+    for (int i = 0; i < n; i++) out[i] = hostapi_gain_mul(in[i], g);
+}
+
+/* 同上。使える SIMD で 8 サンプルずつ、端数はスカラ */
+static inline void hostapi_gain_const(const int16_t* in, int16_t* out, int n, int32_t g)
+{
+    int i = 0;
+#if HOSTAPI_GAIN_NEON
+    /* vqrdmulh = (2 * x * g + 2^15) >> 16(g < 32768 なので飽和しない) */
+    const int16x8_t vg = vdupq_n_s16((int16_t)g);
+    for (; i + 8 <= n; i += 8) vst1q_s16(out + i, vqrdmulhq_s16(vld1q_s16(in + i), vg));
+#elif HOSTAPI_GAIN_SSE2
+    /* 32bit 積を組み立てて丸め、int16 へ詰め直す(|結果| <= |x| なので飽和しない) */
+    const __m128i vg = _mm_set1_epi16((int16_t)g);
+    const __m128i half = _mm_set1_epi32(1 << 14);
+    for (; i + 8 <= n; i += 8) {
+        const __m128i x = _mm_loadu_si128((const __m128i*)(in + i));
+        const __m128i hi = _mm_mulhi_epi16(x, vg);
+        const __m128i lo = _mm_mullo_epi16(x, vg);
+        const __m128i p0 = _mm_srai_epi32(_mm_add_epi32(_mm_unpacklo_epi16(lo, hi), half), 15);
+        const __m128i p1 = _mm_srai_epi32(_mm_add_epi32(_mm_unpackhi_epi16(lo, hi), half), 15);
+        _mm_storeu_si128((__m128i*)(out + i), _mm_packs_epi32(p0, p1));
+    }
+#endif
+    hostapi_gain_const_scalar(in + i, out + i, n - i, g);
+}
+
+/* in(frames フレーム × channels、interleaved)に今のゲインから target への
+ * ゲインを掛けて out へ書く(in == out 可)。以後の今のゲインは target */
+static inline void hostapi_gain_process(hostapi_gain_t* g, int32_t target, const int16_t* in,
+                                        int16_t* out, int frames, int channels)
+{
+    const int n = frames * channels;
+    if (g->cur == target || frames <= 0) {
+        g->cur = target;
+        if (target >= HOSTAPI_GAIN_UNITY) {
+            if (out != in) memcpy(out, in, (size_t)n * sizeof(int16_t));
+        } else {
+            hostapi_gain_const(in, out, n, target);
+        }
+        return;
+    }
+    /* ランプ: フレーム k のゲイン = cur + (target - cur) × (k + 1) / frames(Q16 で歩く) */
+    int64_t acc = (int64_t)g->cur << 16;
+    const int64_t step = ((int64_t)(target - g->cur) << 16) / frames;
+    for (int k = 0; k < frames; k++) {
+        acc += step;
+        const int32_t gk = k == frames - 1 ? target : (int32_t)(acc >> 16);
+        for (int c = 0; c < channels; c++) {
+            const int i = k * channels + c;
+            out[i] = hostapi_gain_mul(in[i], gk);
+        }
+    }
+    g->cur = target;
+}
@@ -0,0 +1,171 @@
+/*
+ * ジェスチャ認識(実機 ESP32 ホストと Linux ホストで共有)。
+ *
+ * hostapi_defs.h の input 契約にある LONG_PRESS / SWIPE / DOUBLE_TAP を、
+ * タッチ列(DOWN / MOVE / UP)から認識する状態機械。時刻は µs で受け取り、
+ * 長押しの連打は予定時刻(µs)で打刻する。ホストは入力を積む側(生産者)
+ * から呼ぶ。
+ *
+ *   hostapi_gesture_touch()   タッチ 1 件を渡す。その時刻までの長押し連打も
+ *                             先に出す(発生順を保つ)
+ *   hostapi_gesture_timer()   押下中に定期的に呼び、期限が来た長押し連打を
+ *                             出す(遅れて呼んでも打刻は予定時刻)
+ *   hostapi_gesture_deadline() 次の期限(無ければ INT64_MAX)。呼び出し側の
+ *                             待ち時間計算用
+ *
+ * 認識したジェスチャは emit コールバックで渡す(time_us は発生時刻)。
+ * 有効化されていない種類は認識しない。
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "hostapi_defs.h"
+
+/* 判定しきい値(論理画面 px / µs) */
+#define HOSTAPI_GESTURE_SLOP_PX 12              /* これ以内の移動はタップ・長押し扱い */
+#define HOSTAPI_GESTURE_LONG_PRESS_US 500000    /* 長押し認識(= 最初の連打) */
+#define HOSTAPI_GESTURE_REPEAT_1_US 400000      /* 押下 1.5 秒まで */
+#define HOSTAPI_GESTURE_REPEAT_2_US 200000      /* 押下 3 秒まで */
+#define HOSTAPI_GESTURE_REPEAT_3_US 100000      /* 以降 */
+#define HOSTAPI_GESTURE_TAP_MAX_US 400000       /* タップの最長押下時間 */
+#define HOSTAPI_GESTURE_DOUBLE_GAP_US 300000    /* 1 回目の UP から 2 回目の DOWN まで */
+#define HOSTAPI_GESTURE_DOUBLE_DIST_PX 40       /* 2 回のタップ位置の最大距離 */
+#define HOSTAPI_GESTURE_SWIPE_MIN_PX 40         /* 主軸方向の最小移動量 */
+#define HOSTAPI_GESTURE_SWIPE_MAX_US 600000     /* スワイプの最長押下時間 */
+
+typedef void (*hostapi_gesture_emit_fn)(void* ctx, uint16_t type, uint16_t param,
+                                        int16_t x, int16_t y, int64_t time_us);
+
+typedef struct {
+    uint32_t enabled;        /* HOSTAPI_GESTURE_* のビット和 */
+
+    bool down;
+    int16_t x0, y0;          /* DOWN 位置 */
+    int16_t x, y;            /* 最新位置 */
+    int64_t down_us;
+    bool moved;              /* DOWN 位置から SLOP を超えて動いた */
+
+    /* 長押し */
+    bool long_armed;         /* 連打の予定あり */
+    bool long_fired;         /* このタッチで長押しを認識した */
+    uint16_t repeat;         /* 次に出す連打番号(0=認識) */
+    int64_t next_repeat_us;
+
+    /* ダブルタップ: 直前のタップ */
+    bool tap_valid;
+    int16_t tap_x, tap_y;
+    int64_t tap_down_us, tap_up_us;
+} hostapi_gesture_t;
+
+static inline void hostapi_gesture_reset(hostapi_gesture_t* g, uint32_t enabled)
+{
+    memset(g, 0, sizeof(*g));
+    g->enabled = enabled;
+}
+
+static inline int32_t hostapi_gesture_abs(int32_t v)
+{
+    return v < 0 ? -v : v;
+}
+
+static inline int64_t hostapi_gesture_deadline(const hostapi_gesture_t* g)
+{
+    return g->long_armed ? g->next_repeat_us : INT64_MAX;
+}
+
+static inline void hostapi_gesture_timer(hostapi_gesture_t* g, int64_t now_us,
+                                         hostapi_gesture_emit_fn emit, void* ctx)
+{
+    while (g->long_armed && now_us >= g->next_repeat_us) {
+        const int64_t at = g->next_repeat_us;
+        emit(ctx, HOSTAPI_EV_LONG_PRESS, g->repeat, g->x, g->y, at);
+        g->long_fired = true;
+        if (g->repeat < UINT16_MAX) g->repeat++;
+        /* メトロノームの BPM ボタンと同じ加速: 押下からの経過で間隔を詰める */
+        const int64_t held = at - g->down_us;
+        g->next_repeat_us = at + (held < 1500000 ? HOSTAPI_GESTURE_REPEAT_1_US
+                                  : held < 3000000 ? HOSTAPI_GESTURE_REPEAT_2_US
+                                                   : HOSTAPI_GESTURE_REPEAT_3_US);
+    }
+}
+
+/* type は HOSTAPI_EV_TOUCH_DOWN / TOUCH_MOVE / TOUCH_UP */
+static inline void hostapi_gesture_touch(hostapi_gesture_t* g, uint16_t type, int16_t x,
+                                         int16_t y, int64_t time_us,
+                                         hostapi_gesture_emit_fn emit, void* ctx)
+{
+    if (!g->enabled) return;
+    hostapi_gesture_timer(g, time_us, emit, ctx);
+
+    if (type == HOSTAPI_EV_TOUCH_DOWN) {
+        g->down = true;
+        g->x0 = g->x = x;
+        g->y0 = g->y = y;
+        g->down_us = time_us;
+        g->moved = false;
+        g->long_fired = false;
+        g->long_armed = (g->enabled & HOSTAPI_GESTURE_LONG_PRESS) != 0;
+        g->repeat = 0;
+        g->next_repeat_us = time_us + HOSTAPI_GESTURE_LONG_PRESS_US;
+        /* 間が空きすぎた・離れた前回タップはダブルタップの 1 回目にしない */
+        if (g->tap_valid &&
+            (time_us - g->tap_up_us > HOSTAPI_GESTURE_DOUBLE_GAP_US ||
+             hostapi_gesture_abs(x - g->tap_x) > HOSTAPI_GESTURE_DOUBLE_DIST_PX ||
+             hostapi_gesture_abs(y - g->tap_y) > HOSTAPI_GESTURE_DOUBLE_DIST_PX)) {
+            g->tap_valid = false;
+        }
+        return;
+    }
+    if (!g->down) return;
+
+    g->x = x;
+    g->y = y;
+    if (hostapi_gesture_abs(x - g->x0) > HOSTAPI_GESTURE_SLOP_PX ||
+        hostapi_gesture_abs(y - g->y0) > HOSTAPI_GESTURE_SLOP_PX) {
+        g->moved = true;
+        g->long_armed = false; /* 指がずれたら長押し(連打)をやめる */
+    }
+    if (type != HOSTAPI_EV_TOUCH_UP) return;
+
+    g->down = false;
+    g->long_armed = false;
+    const int64_t dur = time_us - g->down_us;
+    const int32_t dx = x - g->x0;
+    const int32_t dy = y - g->y0;
+
+    if ((g->enabled & HOSTAPI_GESTURE_SWIPE) && !g->long_fired &&
+        dur <= HOSTAPI_GESTURE_SWIPE_MAX_US) {
+        const bool horiz = hostapi_gesture_abs(dx) >= hostapi_gesture_abs(dy);
+        const int32_t dist = horiz ? hostapi_gesture_abs(dx) : hostapi_gesture_abs(dy);
+        if (dist >= HOSTAPI_GESTURE_SWIPE_MIN_PX) {
+            const uint16_t dir = horiz ? (dx > 0 ? HOSTAPI_SWIPE_RIGHT : HOSTAPI_SWIPE_LEFT)
+                                       : (dy > 0 ? HOSTAPI_SWIPE_DOWN : HOSTAPI_SWIPE_UP);
+            int64_t speed = dur > 0 ? (int64_t)dist * 1000000 / dur : INT32_MAX;
+            emit(ctx, HOSTAPI_EV_SWIPE, HOSTAPI_SWIPE_PARAM(dir, speed), (int16_t)dx,
+                 (int16_t)dy, time_us);
+            g->tap_valid = false;
+            return;
+        }
+    }
+
+    const bool is_tap = !g->moved && !g->long_fired && dur <= HOSTAPI_GESTURE_TAP_MAX_US;
+    if (!is_tap) {
+        g->tap_valid = false;
+        return;
+    }
+    if ((g->enabled & HOSTAPI_GESTURE_DOUBLE_TAP) && g->tap_valid) {
+        int64_t interval_ms = (g->down_us - g->tap_down_us) / 1000;
+        if (interval_ms > UINT16_MAX) interval_ms = UINT16_MAX;
+        emit(ctx, HOSTAPI_EV_DOUBLE_TAP, (uint16_t)interval_ms, x, y, time_us);
+        g->tap_valid = false; /* 3 回目は新しい 1 回目から数える */
+        return;
+    }
+    g->tap_valid = true;
+    g->tap_x = x;
+    g->tap_y = y;
+    g->tap_down_us = g->down_us;
+    g->tap_up_us = time_us;
+}
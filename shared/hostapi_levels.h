@@ -0,0 +1,208 @@
+/*
+ * 出力のレベルメータと帯域解析(実機 ESP32 ホストと Linux ホストで共有)。
+ *
+ * hostapi_audio_get_levels のため、出力ミキサが描いた最終出力(44.1kHz
+ * ステレオ、リミッタ後)からチャネルごとのピーク・RMS と、FFT による
+ * HOSTAPI_AUDIO_LEVEL_BANDS 本の帯域の強さを作る。アプリはサンプルを受け
+ * 取れない(境界越えは 1 回数 us かかる)ので、メータやスペクトラムバーは
+ * tick ごとに 1 回このスナップショットを読むだけにする。
+ *
+ *   hostapi_levels_push()  描く側(Linux: SDL オーディオコールバック、実機:
+ *                          トーンタスク)が出力を渡す。ピーク・二乗和と直近
+ *                          HOSTAPI_LEVELS_FFT フレームのモノラル(L+R)/2 を持ち、
+ *                          HOSTAPI_LEVELS_HOP フレームごとにスナップショットを
+ *                          公開する。FFT はしない(描画の歩調を乱さない)
+ *   hostapi_levels_read()  読む側(wasm スレッド)。スナップショットを写し、
+ *                          新しければ FFT で帯域を求める(1 窓につき 1 回)
+ *   hostapi_levels_fft_run()  FFT と帯域の集計だけ(ベンチ用に分けてある)
+ *
+ * スナップショットは seqlock: 書く側は seq を奇数にして語を書き、偶数に
+ * 戻す。読む側は seq が偶数で前後一致したときだけ採る(書く側は待たない。
+ * 読み損ねたら前回の結果を返す)。語は __atomic(relaxed)で読み書きする。
+ *
+ * FFT は N = HOSTAPI_LEVELS_FFT 点の実数 FFT を N/2 点の複素 FFT(基数 2、
+ * float)と分離で求める。窓はハン。帯域は 1 ビン(~43Hz)から Nyquist までを
+ * 対数で HOSTAPI_AUDIO_LEVEL_BANDS 等分し(低域は 1 ビンずつ)、帯域内の最大の
+ * パワーを dBFS にして -HOSTAPI_LEVELS_FLOOR_DB..0 を 0..255 へ写す
+ * (フルスケールのサインが 255)。
+ */
+#pragma once
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "hostapi_defs.h"
+
+#define HOSTAPI_LEVELS_FFT 1024     /* 解析窓(フレーム、2 のべき乗)。~23ms */
+#define HOSTAPI_LEVELS_HOP 2048     /* 公開の間隔(フレーム)。~46ms */
+#define HOSTAPI_LEVELS_FLOOR_DB 60  /* band 0 の dBFS(の符号反転) */
+
+/* 描く側と読む側の共有部分 */
+typedef struct {
+    /* 描く側だけ */
+    int16_t ring[HOSTAPI_LEVELS_FFT]; /* 直近のモノラル */
+    uint32_t ring_pos;
+    uint32_t acc_frames;
+    int32_t peak[2];
+    uint64_t sumsq[2];
+
+    /* スナップショット(seqlock) */
+    uint32_t seq;                          /* 奇数 = 書いている途中 */
+    uint32_t pub_level[2];                 /* チャネルごとに peak << 16 | rms */
+    uint32_t pub_pcm[HOSTAPI_LEVELS_FFT / 2]; /* 古い順、1 語に 2 サンプル */
+} hostapi_levels_t;
+
+/* 読む側(FFT の作業領域と前回の結果)。~14KB */
+typedef struct {
+    float re[HOSTAPI_LEVELS_FFT / 2];
+    float im[HOSTAPI_LEVELS_FFT / 2];
+    float tw_re[HOSTAPI_LEVELS_FFT / 2];   /* e^{-2πik/N}、k < N/2 */
+    float tw_im[HOSTAPI_LEVELS_FFT / 2];
+    uint16_t edge[HOSTAPI_AUDIO_LEVEL_BANDS + 1]; /* 帯域の境界ビン */
+    int16_t pcm[HOSTAPI_LEVELS_FFT];
+    uint32_t seq;                          /* 解析済みの公開番号 */
+    hostapi_audio_levels_t last;
+} hostapi_levels_fft_t;
+
+static inline void hostapi_levels_init(hostapi_levels_t* lv)
+{
+    memset(lv, 0, sizeof(*lv));
+}
+
+/* 出力 frames フレーム(ステレオ interleaved)を取り込む。描く側のみ */
+static inline void hostapi_levels_push(hostapi_levels_t* lv, const int16_t* pcm, int frames)
+{
+    for (int i = 0; i < frames; i++) {
+        const int32_t l = pcm[i * 2], r = pcm[i * 2 + 1];
+        const int32_t al = l < 0 ? -l : l, ar = r < 0 ? -r : r;
+        if (al > lv->peak[0]) lv->peak[0] = al;
+        if (ar > lv->peak[1]) lv->peak[1] = ar;
+        lv->sumsq[0] += (uint64_t)(l * l);
+        lv->sumsq[1] += (uint64_t)(r * r);
+        lv->ring[lv->ring_pos] = (int16_t)((l + r) >> 1);
+        lv->ring_pos = (lv->ring_pos + 1) & (HOSTAPI_LEVELS_FFT - 1);
+        if (++lv->acc_frames < HOSTAPI_LEVELS_HOP) continue;
+
+        const uint32_t s = lv->seq;
+        __atomic_store_n(&lv->seq, s + 1, __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_RELEASE);
+        for (int c = 0; c < 2; c++) {
+            const int32_t peak = lv->peak[c] > 32767 ? 32767 : lv->peak[c];
+            uint32_t rms = (uint32_t)sqrtf((float)lv->sumsq[c] / (float)lv->acc_frames);
+            if (rms > 32767) rms = 32767;
+            __atomic_store_n(&lv->pub_level[c], (uint32_t)peak << 16 | rms, __ATOMIC_RELAXED);
+            lv->peak[c] = 0;
+            lv->sumsq[c] = 0;
+        }
+        for (uint32_t k = 0; k < HOSTAPI_LEVELS_FFT / 2; k++) {
+            const uint32_t a0 = (lv->ring_pos + k * 2) & (HOSTAPI_LEVELS_FFT - 1);
+            const uint32_t a1 = (a0 + 1) & (HOSTAPI_LEVELS_FFT - 1);
+            const uint32_t w = (uint16_t)lv->ring[a0] | (uint32_t)(uint16_t)lv->ring[a1] << 16;
+            __atomic_store_n(&lv->pub_pcm[k], w, __ATOMIC_RELAXED);
+        }
+        __atomic_store_n(&lv->seq, s + 2, __ATOMIC_RELEASE);
+        lv->acc_frames = 0;
+    }
+}
+
+static inline void hostapi_levels_fft_init(hostapi_levels_fft_t* a)
+{
+    memset(a, 0, sizeof(*a));
+    const int n = HOSTAPI_LEVELS_FFT;
+    for (int k = 0; k < n / 2; k++) {
+        a->tw_re[k] = cosf(2.0f * (float)M_PI * (float)k / (float)n);
+        a->tw_im[k] = -sinf(2.0f * (float)M_PI * (float)k / (float)n);
+    }
+    /* 境界: ビン 1 から N/2 まで対数で等分。重なる低域は 1 ビンずつ押し出す */
+    const float top = (float)(n / 2);
+    for (int b = 0; b <= HOSTAPI_AUDIO_LEVEL_BANDS; b++) {
+        int e = (int)lroundf(powf(top, (float)b / HOSTAPI_AUDIO_LEVEL_BANDS));
+        if (b > 0 && e <= a->edge[b - 1]) e = a->edge[b - 1] + 1;
+        a->edge[b] = (uint16_t)e;
+    }
+    a->edge[HOSTAPI_AUDIO_LEVEL_BANDS] = (uint16_t)(n / 2);
+}
+
+/* pcm(HOSTAPI_LEVELS_FFT サンプル、古い順)の帯域を band へ */
+static inline void hostapi_levels_fft_run(hostapi_levels_fft_t* a, const int16_t* pcm,
+                                          uint8_t* band)
+{
+    const int n = HOSTAPI_LEVELS_FFT, m = n / 2;
+    /* 偶奇のサンプルを実部・虚部に詰め(ハン窓を掛けて)、ビット反転順に置く */
+    for (int i = 0, j = 0; i < m; i++) {
+        const int i0 = 2 * i, i1 = 2 * i + 1;
+        const float c0 = i0 < m ? a->tw_re[i0] : -a->tw_re[i0 - m];
+        const float c1 = i1 < m ? a->tw_re[i1] : -a->tw_re[i1 - m];
+        a->re[j] = (float)pcm[i0] * (0.5f - 0.5f * c0);
+        a->im[j] = (float)pcm[i1] * (0.5f - 0.5f * c1);
+        int bit = m >> 1;
+        for (; j & bit; bit >>= 1) j ^= bit;
+        j |= bit;
+    }
+    /* m 点の複素 FFT(DIT)。回転因子 W_m^t = tw[t × n / len] */
+    for (int len = 2; len <= m; len <<= 1) {
+        const int half = len >> 1, step = n / len;
+        for (int s = 0; s < m; s += len) {
+            for (int t = 0; t < half; t++) {
+                const float wr = a->tw_re[t * step], wi = a->tw_im[t * step];
+                const int p = s + t, q = p + half;
+                const float xr = a->re[q] * wr - a->im[q] * wi;
+                const float xi = a->re[q] * wi + a->im[q] * wr;
+                a->re[q] = a->re[p] - xr;
+                a->im[q] = a->im[p] - xi;
+                a->re[p] += xr;
+                a->im[p] += xi;
+            }
+        }
+    }
+    /* 分離: X[k] = E + W_n^k × O、E = (Z[k] + Z*[m-k]) / 2、O = (Z[k] - Z*[m-k]) / 2i */
+    const float ref = 32767.0f * (float)n / 4.0f; /* フルスケールのサインのビンの大きさ */
+    const float inv_ref2 = 1.0f / (ref * ref);
+    for (int b = 0; b < HOSTAPI_AUDIO_LEVEL_BANDS; b++) {
+        float best = 0.0f;
+        for (int k = a->edge[b]; k < a->edge[b + 1]; k++) {
+            const float zr = a->re[k], zi = a->im[k];
+            const float cr = a->re[m - k], ci = -a->im[m - k];
+            const float er = 0.5f * (zr + cr), ei = 0.5f * (zi + ci);
+            const float or_ = 0.5f * (zi - ci), oi = -0.5f * (zr - cr);
+            const float xr = er + a->tw_re[k] * or_ - a->tw_im[k] * oi;
+            const float xi = ei + a->tw_re[k] * oi + a->tw_im[k] * or_;
+            const float p = xr * xr + xi * xi;
+            if (p > best) best = p;
+        }
+        const float db = best > 0.0f ? 10.0f * log10f(best * inv_ref2) : -1000.0f;
+        const float v = (db + HOSTAPI_LEVELS_FLOOR_DB) * 255.0f / HOSTAPI_LEVELS_FLOOR_DB;
+        band[b] = (uint8_t)(v <= 0.0f ? 0 : v >= 255.0f ? 255 : lroundf(v));
+    }
+}
+
+/* 最新のスナップショットを out へ。新しい窓なら FFT する。読む側のみ */
+static inline void hostapi_levels_read(const hostapi_levels_t* lv, hostapi_levels_fft_t* a,
+                                       hostapi_audio_levels_t* out)
+{
+    for (int tries = 0; tries < 4; tries++) {
+        const uint32_t s1 = __atomic_load_n(&lv->seq, __ATOMIC_ACQUIRE);
+        if (s1 & 1) continue;
+        if (s1 == a->seq) break; /* 解析済み */
+        uint32_t level[2];
+        for (int c = 0; c < 2; c++) level[c] = __atomic_load_n(&lv->pub_level[c], __ATOMIC_RELAXED);
+        for (int k = 0; k < HOSTAPI_LEVELS_FFT / 2; k++) {
+            const uint32_t w = __atomic_load_n(&lv->pub_pcm[k], __ATOMIC_RELAXED);
+            a->pcm[k * 2] = (int16_t)(w & 0xFFFF);
+            a->pcm[k * 2 + 1] = (int16_t)(w >> 16);
+        }
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&lv->seq, __ATOMIC_RELAXED) != s1) continue; /* 書き換え中だった */
+        a->seq = s1;
+        a->last.seq = s1 / 2;
+        for (int c = 0; c < 2; c++) {
+            a->last.peak[c] = (uint16_t)(level[c] >> 16);
+            a->last.rms[c] = (uint16_t)(level[c] & 0xFFFF);
+        }
+        hostapi_levels_fft_run(a, a->pcm, a->last.band);
+        break;
+    }
+    *out = a->last;
+}
@@ -0,0 +1,188 @@
+/*
+ * 出力ミキサ(実機 ESP32 ホストと Linux ホストで共有)。
+ *
+ * MP3 デコーダの出力、トーン(hostapi_voice.h)、サンプル(hostapi_sample.h)を
+ * 44.1kHz 16bit ステレオ 1 本にまとめる最終段。クリックと MP3 を同時に鳴らす
+ * ためのもので、出力デバイスのレートは常に HOSTAPI_MIX_RATE に固定する(曲ごとの
+ * レート切り替えをしない。MP3 は hostapi_resamp.h で 44.1kHz へ揃える)。
+ *
+ *   hostapi_mix_render  音楽(44.1kHz ステレオ、無ければ NULL)、トーンの全声、
+ *                       サンプルの全声をソースごとのゲインで加算し、リミッタを
+ *                       通して int16 へ
+ *   hostapi_mix_set_notes  ノートエンジン(hostapi_note.h)を付ける。ノートは
+ *                       トーンと同じバス(HOSTAPI_MIX_TONE のゲイン)で混ぜる
+ *
+ * 音楽のゲイン(マスター音量)は hostapi_gain.h の Q15 ゲイン段で掛ける。変わった
+ * ときは render の 1 チャンク(HOSTAPI_MIX_CHUNK フレーム)かけて新しい値へ動かす。
+ *
+ * リミッタは HOSTAPI_MIX_LIM_BLOCK フレームごとのピークで決める: 閾値を
+ * 超えるブロックはそのブロックから即座に下げ(アタック 0、オーバーシュート
+ * なし)、戻りは 1 ブロックごとに残りの 1/2^HOSTAPI_MIX_RELEASE_SHIFT ずつ
+ * (時定数 ~90ms)。閾値以下の入力はゲイン 1 で素通り(ビット一致)。
+ *
+ * 状態は出力を描く側(Linux: SDL オーディオコールバック、実機: トーンタスク)
+ * だけが触る。ソースのゲインだけは hostapi_mix_set_gain で他スレッドから
+ * 変えてよい(語単位の atomic)。
+ */
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+
+#include "hostapi_gain.h"
+#include "hostapi_note.h"
+#include "hostapi_resamp.h"
+#include "hostapi_sample.h"
+#include "hostapi_voice.h"
+
+#define HOSTAPI_MIX_RATE 44100        /* 出力レート(固定) */
+#define HOSTAPI_MIX_UNITY 32768       /* ゲイン 1.0(Q15) */
+#define HOSTAPI_MIX_LIMIT 30000       /* リミッタ閾値(~-0.8dBFS) */
+#define HOSTAPI_MIX_LIM_BLOCK 16      /* リミッタのピーク検出単位(フレーム) */
+#define HOSTAPI_MIX_RELEASE_SHIFT 8   /* 16 フレーム x 256 ≒ 93ms */
+#define HOSTAPI_MIX_CHUNK 64          /* render の積算バッファ(フレーム) */
+
+enum {
+    HOSTAPI_MIX_MUSIC = 0,  /* MP3 */
+    HOSTAPI_MIX_TONE = 1,   /* hostapi_tone_* / クリック / hostapi_note_* */
+    HOSTAPI_MIX_SAMPLE = 2, /* hostapi_sample_* */
+    HOSTAPI_MIX_SOURCES
+};
+
+typedef struct {
+    int32_t gain[HOSTAPI_MIX_SOURCES]; /* Q15。hostapi_mix_set_gain で変える */
+    int32_t lim_gain;   /* リミッタの現在ゲイン(Q15) */
+    uint32_t limited;   /* リミッタが下げたブロック数(診断用) */
+    hostapi_notes_t* notes; /* NULL 可 */
+    hostapi_gain_t music_gain; /* 音楽に今掛けているゲイン(描く側だけが触る) */
+} hostapi_mix_t;
+
+static inline void hostapi_mix_init(hostapi_mix_t* m)
+{
+    for (int i = 0; i < HOSTAPI_MIX_SOURCES; i++) m->gain[i] = HOSTAPI_MIX_UNITY;
+    m->lim_gain = HOSTAPI_MIX_UNITY;
+    m->limited = 0;
+    m->notes = NULL;
+    hostapi_gain_init(&m->music_gain, HOSTAPI_MIX_UNITY);
+}
+
+static inline void hostapi_mix_set_notes(hostapi_mix_t* m, hostapi_notes_t* notes)
+{
+    m->notes = notes;
+}
+
+/* ノートが鳴っている(描画ループの無音判定用) */
+static inline bool hostapi_mix_notes_active(const hostapi_mix_t* m)
+{
+    return m->notes && m->notes->active > 0;
+}
+
+/* ソースのゲインを 0..100(%)で設定する。描画中の他スレッドから呼んでよい */
+static inline void hostapi_mix_set_gain(hostapi_mix_t* m, int src, int percent)
+{
+    if (percent < 0) percent = 0;
+    if (percent > 100) percent = 100;
+    __atomic_store_n(&m->gain[src], percent * HOSTAPI_MIX_UNITY / 100, __ATOMIC_RELAXED);
+}
+
+static inline int32_t hostapi_mix_apply(int32_t x, int32_t gain)
+{
+    return gain == HOSTAPI_MIX_UNITY ? x : (int32_t)(((int64_t)x * gain) >> 15);
+}
+
+static inline int16_t hostapi_mix_sat(int32_t x)
+{
+    if (x > 32767) return 32767;
+    if (x < -32768) return -32768;
+    return (int16_t)x;
+}
+
+/* l/r(n フレーム、n は HOSTAPI_MIX_LIM_BLOCK の倍数でなくてよい)にリミッタを
+ * かけて out(ステレオ)へ書く */
+static inline void hostapi_mix_limit(hostapi_mix_t* m, const int32_t* l, const int32_t* r,
+                                     int16_t* out, int n)
+{
+    for (int b = 0; b < n; b += HOSTAPI_MIX_LIM_BLOCK) {
+        const int e = b + HOSTAPI_MIX_LIM_BLOCK < n ? b + HOSTAPI_MIX_LIM_BLOCK : n;
+        int32_t peak = 0;
+        for (int i = b; i < e; i++) {
+            const int32_t al = l[i] < 0 ? -l[i] : l[i];
+            const int32_t ar = r[i] < 0 ? -r[i] : r[i];
+            if (al > peak) peak = al;
+            if (ar > peak) peak = ar;
+        }
+        int32_t g = m->lim_gain;
+        if (g < HOSTAPI_MIX_UNITY) g += (HOSTAPI_MIX_UNITY - g + (1 << HOSTAPI_MIX_RELEASE_SHIFT) - 1) >>
+                                        HOSTAPI_MIX_RELEASE_SHIFT;
+        if ((int64_t)peak * g > (int64_t)HOSTAPI_MIX_LIMIT * HOSTAPI_MIX_UNITY) {
+            g = (int32_t)((int64_t)HOSTAPI_MIX_LIMIT * HOSTAPI_MIX_UNITY / peak);
+            m->limited++;
+        }
+        m->lim_gain = g;
+        for (int i = b; i < e; i++) {
+            out[i * 2] = hostapi_mix_sat(hostapi_mix_apply(l[i], g));
+            out[i * 2 + 1] = hostapi_mix_sat(hostapi_mix_apply(r[i], g));
+        }
+    }
+}
+
+/* music: 44.1kHz ステレオ frames フレーム(NULL なら無音)。vs: トーンの全声、
+ * sp: サンプルの全声(どちらも NULL 可)。out(16bit ステレオ interleaved)を
+ * 上書きする */
+static inline void hostapi_mix_render(hostapi_mix_t* m, const int16_t* music,
+                                      hostapi_voices_t* vs, hostapi_splayer_t* sp,
+                                      int16_t* out, int frames)
+{
+    int32_t tone[HOSTAPI_MIX_CHUNK];
+    int32_t sl[HOSTAPI_MIX_CHUNK];
+    int32_t sr[HOSTAPI_MIX_CHUNK];
+    int32_t l[HOSTAPI_MIX_CHUNK];
+    int32_t r[HOSTAPI_MIX_CHUNK];
+    int16_t mus[HOSTAPI_MIX_CHUNK * 2];
+    const int32_t mg = __atomic_load_n(&m->gain[HOSTAPI_MIX_MUSIC], __ATOMIC_RELAXED);
+    const int32_t tg = __atomic_load_n(&m->gain[HOSTAPI_MIX_TONE], __ATOMIC_RELAXED);
+    const int32_t sg = __atomic_load_n(&m->gain[HOSTAPI_MIX_SAMPLE], __ATOMIC_RELAXED);
+    while (frames > 0) {
+        const int n = frames < HOSTAPI_MIX_CHUNK ? frames : HOSTAPI_MIX_CHUNK;
+        const bool voices = vs && vs->active > 0;
+        const bool notes = hostapi_mix_notes_active(m);
+        const bool tones = voices || notes;
+        const bool samples = sp && sp->active > 0;
+        if (music) {
+            hostapi_gain_process(&m->music_gain, mg, music, mus, n, 2);
+        } else {
+            m->music_gain.cur = mg; /* 鳴っていない間の変更はランプしない */
+        }
+        if (!music && !tones && !samples && m->lim_gain == HOSTAPI_MIX_UNITY) {
+            memset(out, 0, (size_t)n * 2 * sizeof(int16_t));
+        } else {
+            if (tones) {
+                memset(tone, 0, (size_t)n * sizeof(int32_t));
+                if (voices) hostapi_voices_accum(vs, tone, n);
+                if (notes) hostapi_notes_accum(m->notes, tone, n);
+            }
+            if (samples) {
+                memset(sl, 0, (size_t)n * sizeof(int32_t));
+                memset(sr, 0, (size_t)n * sizeof(int32_t));
+                hostapi_splayer_accum(sp, sl, sr, n);
+            }
+            for (int i = 0; i < n; i++) {
+                const int32_t t = tones ? hostapi_mix_apply(tone[i], tg) : 0;
+                l[i] = t;
+                r[i] = t;
+                if (music) {
+                    l[i] += mus[i * 2];
+                    r[i] += mus[i * 2 + 1];
+                }
+                if (samples) {
+                    l[i] += hostapi_mix_apply(sl[i], sg);
+                    r[i] += hostapi_mix_apply(sr[i], sg);
+                }
+            }
+            hostapi_mix_limit(m, l, r, out, n);
+            if (music) music += n * 2;
+        }
+        out += n * 2;
+        frames -= n;
+    }
+}
@@ -0,0 +1,295 @@
+/*
+ * MP3 のフレーム位置索引(実機 ESP32 ホストと Linux ホストで共有)。
+ *
+ * hostapi_audio_seek_ms / get_duration_ms のため、曲のフレームヘッダを先頭
+ * から辿って「stride フレームごとのファイル位置」を持つ。シークは
+ * 目標時刻 → フレーム番号 → entry[フレーム / stride] の O(1)(stride が一定
+ * なので探索も要らない)で、ファイルを先頭から読み直さない。
+ *
+ *   hostapi_mp3idx_begin()       走査を始める(空にする)
+ *   hostapi_mp3idx_step()        FILE から最大 n フレーム進める。バックグラウンド
+ *                                のスレッド / タスクが小分けに呼ぶ
+ *   hostapi_mp3idx_lookup()      ms → 目標以前で最も近い索引フレームの
+ *                                ファイル位置と時刻
+ *   hostapi_mp3idx_duration_ms() 曲の長さ
+ *   hostapi_mp3idx_build_file()  上をまとめたもの。曲の隣のサイドカー
+ *                                (<曲>.mbidx)が曲のサイズ・更新時刻と一致すれば
+ *                                読むだけ、無ければ走査して書き出す
+ *
+ * 索引は最大 HOSTAPI_MP3IDX_ENTRIES 件。溢れたら 1 つおきに間引いて stride を
+ * 倍にする(長い曲ほど粗い: 44.1kHz・1152 サンプル/フレームなら 107 秒までは
+ * 毎フレーム、7 分で 4 フレーム ≒ 104ms 刻み)。VBR も全ヘッダを読むので正確。
+ * 対象は MPEG-1/2/2.5 Layer III(free format は非対応)。先頭の ID3v2 は読み
+ * 飛ばし、末尾の ID3v1("TAG")か EOF で終わる。
+ *
+ * サイドカーの形式(リトルエンディアン。両ホストとも構造体をそのまま書く):
+ *   hostapi_mp3idx_file_t(magic "MBIX" / version / 曲のサイズ・更新時刻 /
+ *   rate / spf / frames / stride / count)の後に entry(u32)× count。
+ *
+ * 状態は走査する 1 スレッドだけが書く。読む側への公開(完了してから使わせる)
+ * は呼び出し側の責任。
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#define HOSTAPI_MP3IDX_ENTRIES 4096  /* 2 のべき乗(間引きで半分にする) */
+#define HOSTAPI_MP3IDX_SYNC_LIMIT 65536 /* 最初のフレームを探す範囲(ID3v2 の後) */
+#define HOSTAPI_MP3IDX_SUFFIX ".mbidx"
+#define HOSTAPI_MP3IDX_VERSION 1
+
+typedef struct {
+    uint32_t len;   /* フレーム長(バイト、パディング込み) */
+    uint32_t rate;  /* Hz */
+    uint32_t spf;   /* 1 フレームのサンプル数(1152 / 576) */
+} hostapi_mp3_frame_t;
+
+typedef struct {
+    uint32_t entry[HOSTAPI_MP3IDX_ENTRIES]; /* フレーム k × stride の先頭のファイル位置 */
+    uint32_t count;
+    uint32_t stride;    /* 2 のべき乗 */
+    uint32_t frames;    /* 見つけたフレーム数 */
+    uint32_t rate;      /* 最初のフレームのもの */
+    uint32_t spf;
+    uint32_t pos;       /* 次のフレームヘッダの位置 */
+    uint32_t sync_from; /* 最初のフレームを探し始めた位置 */
+    uint8_t id;         /* 最初のフレームの版・層・レート(以後の誤同期を弾く) */
+    bool started;
+    bool complete;
+} hostapi_mp3idx_t;
+
+typedef struct {
+    char magic[4];      /* "MBIX" */
+    uint32_t version;
+    uint32_t file_size; /* 曲の同一性(変わっていたら作り直す) */
+    uint32_t file_mtime;
+    uint32_t rate;
+    uint32_t spf;
+    uint32_t frames;
+    uint32_t stride;
+    uint32_t count;
+} hostapi_mp3idx_file_t;
+
+/* 4 バイトのフレームヘッダを読む。Layer III 以外・予約値は false */
+static inline bool hostapi_mp3_parse_header(const uint8_t h[4], hostapi_mp3_frame_t* f)
+{
+    static const uint16_t kKbps1[15] = {0, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192,
+                                        224, 256, 320};
+    static const uint16_t kKbps2[15] = {0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128,
+                                        144, 160};
+    static const uint16_t kRate[3] = {44100, 48000, 32000};
+    if (h[0] != 0xFF || (h[1] & 0xE0) != 0xE0) return false;
+    const int ver = (h[1] >> 3) & 3; /* 3 = MPEG-1、2 = MPEG-2、0 = MPEG-2.5 */
+    const int layer = (h[1] >> 1) & 3;
+    const int kbps_idx = h[2] >> 4;
+    const int rate_idx = (h[2] >> 2) & 3;
+    if (ver == 1 || layer != 1 || kbps_idx == 0 || kbps_idx == 15 || rate_idx == 3) return false;
+    f->rate = (uint32_t)kRate[rate_idx] >> (ver == 3 ? 0 : ver == 2 ? 1 : 2);
+    f->spf = ver == 3 ? 1152 : 576;
+    const uint32_t kbps = ver == 3 ? kKbps1[kbps_idx] : kKbps2[kbps_idx];
+    f->len = (ver == 3 ? 144000u : 72000u) * kbps / f->rate + ((h[2] >> 1) & 1);
+    return true;
+}
+
+/* 版・層・レートの組(同じ曲のフレームなら一致する) */
+static inline uint8_t hostapi_mp3_frame_id(const uint8_t h[4])
+{
+    return (uint8_t)(((h[1] >> 1) & 0x0F) << 2 | ((h[2] >> 2) & 3));
+}
+
+static inline void hostapi_mp3idx_begin(hostapi_mp3idx_t* x)
+{
+    x->count = 0;
+    x->stride = 1;
+    x->frames = 0;
+    x->rate = 0;
+    x->spf = 0;
+    x->pos = 0;
+    x->sync_from = 0;
+    x->id = 0;
+    x->started = false;
+    x->complete = false;
+}
+
+/* フレーム x->frames の位置を(stride の倍数なら)記録する。満杯なら間引く */
+static inline void hostapi_mp3idx_add(hostapi_mp3idx_t* x, uint32_t pos)
+{
+    if (x->frames % x->stride != 0) return;
+    if (x->count == HOSTAPI_MP3IDX_ENTRIES) {
+        for (uint32_t i = 0; i < x->count / 2; i++) x->entry[i] = x->entry[i * 2];
+        x->count /= 2;
+        x->stride *= 2;
+        if (x->frames % x->stride != 0) return;
+    }
+    x->entry[x->count++] = pos;
+}
+
+static inline bool hostapi_mp3idx_read_at(FILE* f, uint32_t pos, uint8_t* buf, size_t n)
+{
+    return fseek(f, (long)pos, SEEK_SET) == 0 && fread(buf, 1, n, f) == n;
+}
+
+/* 最大 max_frames フレーム(同期を探す 1 バイトも 1 と数える)進める。
+ * 1 = 続きがある、0 = 完了、-1 = MP3 のフレームが見つからない */
+static inline int hostapi_mp3idx_step(hostapi_mp3idx_t* x, FILE* f, int max_frames)
+{
+    if (x->complete) return 0;
+    if (!x->started) {
+        uint8_t id3[10];
+        x->pos = 0;
+        if (hostapi_mp3idx_read_at(f, 0, id3, sizeof(id3)) && memcmp(id3, "ID3", 3) == 0) {
+            /* サイズは 7bit × 4 の syncsafe。フッタ付きなら +10 */
+            x->pos = 10u + ((uint32_t)(id3[6] & 0x7F) << 21 | (uint32_t)(id3[7] & 0x7F) << 14 |
+                            (uint32_t)(id3[8] & 0x7F) << 7 | (uint32_t)(id3[9] & 0x7F)) +
+                     ((id3[5] & 0x10) ? 10u : 0u);
+        }
+        x->sync_from = x->pos;
+        x->started = true;
+    }
+    for (int n = 0; n < max_frames; n++) {
+        uint8_t h[4];
+        hostapi_mp3_frame_t fr;
+        if (!hostapi_mp3idx_read_at(f, x->pos, h, sizeof(h)) || memcmp(h, "TAG", 3) == 0) {
+            if (x->frames == 0) return -1;
+            x->complete = true;
+            return 0;
+        }
+        bool ok = hostapi_mp3_parse_header(h, &fr);
+        if (ok && x->frames == 0) {
+            /* 最初のフレームは次のヘッダも同じ組で続くことを確かめる(誤同期よけ) */
+            uint8_t h2[4];
+            hostapi_mp3_frame_t fr2;
+            ok = hostapi_mp3idx_read_at(f, x->pos + fr.len, h2, sizeof(h2)) &&
+                 hostapi_mp3_parse_header(h2, &fr2) &&
+                 hostapi_mp3_frame_id(h2) == hostapi_mp3_frame_id(h);
+            if (ok) {
+                x->id = hostapi_mp3_frame_id(h);
+                x->rate = fr.rate;
+                x->spf = fr.spf;
+            }
+        } else if (ok) {
+            ok = hostapi_mp3_frame_id(h) == x->id;
+        }
+        if (!ok) {
+            /* 同期が外れた: 1 バイトずつ次の同期語を探す */
+            if (x->frames == 0 && x->pos - x->sync_from >= HOSTAPI_MP3IDX_SYNC_LIMIT) return -1;
+            x->pos++;
+            continue;
+        }
+        hostapi_mp3idx_add(x, x->pos);
+        x->frames++;
+        x->pos += fr.len;
+    }
+    return 1;
+}
+
+static inline int32_t hostapi_mp3idx_duration_ms(const hostapi_mp3idx_t* x)
+{
+    if (!x->complete || x->rate == 0) return -1;
+    return (int32_t)((uint64_t)x->frames * x->spf * 1000 / x->rate);
+}
+
+/* ms 以前で最も近い索引フレームのファイル位置を *offset に入れ、その時刻を
+ * 返す(曲の長さを超える ms は最後の索引フレーム)。未完成なら -1 */
+static inline int32_t hostapi_mp3idx_lookup(const hostapi_mp3idx_t* x, uint32_t ms,
+                                            uint32_t* offset)
+{
+    if (!x->complete || x->count == 0) return -1;
+    uint64_t frame = (uint64_t)ms * x->rate / (1000u * x->spf);
+    if (frame >= x->frames) frame = x->frames - 1;
+    uint32_t k = (uint32_t)(frame / x->stride);
+    if (k >= x->count) k = x->count - 1;
+    *offset = x->entry[k];
+    return (int32_t)((uint64_t)k * x->stride * x->spf * 1000 / x->rate);
+}
+
+static inline bool hostapi_mp3idx_save(const hostapi_mp3idx_t* x, FILE* f, uint32_t file_size,
+                                       uint32_t file_mtime)
+{
+    hostapi_mp3idx_file_t h;
+    memcpy(h.magic, "MBIX", 4);
+    h.version = HOSTAPI_MP3IDX_VERSION;
+    h.file_size = file_size;
+    h.file_mtime = file_mtime;
+    h.rate = x->rate;
+    h.spf = x->spf;
+    h.frames = x->frames;
+    h.stride = x->stride;
+    h.count = x->count;
+    return fwrite(&h, sizeof(h), 1, f) == 1 &&
+           fwrite(x->entry, sizeof(uint32_t), x->count, f) == x->count;
+}
+
+/* サイドカーを読む。曲のサイズ・更新時刻が違う・壊れていれば false */
+static inline bool hostapi_mp3idx_load(hostapi_mp3idx_t* x, FILE* f, uint32_t file_size,
+                                       uint32_t file_mtime)
+{
+    hostapi_mp3idx_file_t h;
+    if (fread(&h, sizeof(h), 1, f) != 1 || memcmp(h.magic, "MBIX", 4) != 0 ||
+        h.version != HOSTAPI_MP3IDX_VERSION || h.file_size != file_size ||
+        h.file_mtime != file_mtime || h.rate == 0 || h.spf == 0 || h.stride == 0 ||
+        h.count == 0 || h.count > HOSTAPI_MP3IDX_ENTRIES ||
+        (h.frames + h.stride - 1) / h.stride != h.count) {
+        return false;
+    }
+    hostapi_mp3idx_begin(x);
+    if (fread(x->entry, sizeof(uint32_t), h.count, f) != h.count) return false;
+    x->rate = h.rate;
+    x->spf = h.spf;
+    x->frames = h.frames;
+    x->stride = h.stride;
+    x->count = h.count;
+    x->started = true;
+    x->complete = true;
+    return true;
+}
+
+/* path の索引を作る。サイドカーがあれば読むだけ、無ければ frames_per_step
+ * フレームずつ走査し、合間に keep_going(ctx)(NULL 可)を呼ぶ(false で
+ * 打ち切り。曲が変わった等。呼び出し側はここで他へ CPU を譲る)。
+ * 作れたらサイドカーを書く(書けなくても索引は使える)。
+ * 1 = 完成、0 = 打ち切り、-1 = 開けない・MP3 ではない */
+static inline int hostapi_mp3idx_build_file(hostapi_mp3idx_t* x, const char* path,
+                                            int frames_per_step, bool (*keep_going)(void*),
+                                            void* ctx)
+{
+    struct stat st;
+    if (stat(path, &st) != 0) return -1;
+    const uint32_t size = (uint32_t)st.st_size;
+    const uint32_t mtime = (uint32_t)st.st_mtime;
+    char side[160];
+    if ((size_t)snprintf(side, sizeof(side), "%s%s", path, HOSTAPI_MP3IDX_SUFFIX) >=
+        sizeof(side)) {
+        side[0] = '\0';
+    }
+    if (side[0]) {
+        FILE* sf = fopen(side, "rb");
+        if (sf) {
+            const bool ok = hostapi_mp3idx_load(x, sf, size, mtime);
+            fclose(sf);
+            if (ok) return 1;
+        }
+    }
+    FILE* f = fopen(path, "rb");
+    if (!f) return -1;
+    hostapi_mp3idx_begin(x);
+    int r;
+    while ((r = hostapi_mp3idx_step(x, f, frames_per_step)) > 0) {
+        if (keep_going && !keep_going(ctx)) break;
+    }
+    fclose(f);
+    if (r != 0) return r < 0 ? -1 : 0;
+    if (side[0]) {
+        FILE* sf = fopen(side, "wb");
+        if (sf) {
+            const bool ok = hostapi_mp3idx_save(x, sf, size, mtime);
+            fclose(sf);
+            if (!ok) remove(side);
+        }
+    }
+    return 1;
+}
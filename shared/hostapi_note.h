@@ -0,0 +1,228 @@
+/*
+ * 持続音のノートエンジン(実機 ESP32 ホストと Linux ホストで共有)。
+ *
+ * hostapi_note_on / hostapi_note_off のチャネル(HOSTAPI_NOTE_CHANNELS 本)を
+ * ADSR エンベロープ付きのサインで鳴らす。トーン(hostapi_voice.h)は長さ
+ * 固定の減衰音で、持続音を作るにはアプリが毎 tick 鳴らし直すしかなかった。
+ * ここでは note_on から note_off(+ リリース)まで描画側が鳴らし続けるので、
+ * 境界越えは 1 音につき on / off の 2 回で済む。
+ *
+ *   hostapi_notes_init()    全チャネル無音、エンベロープを既定値に
+ *   hostapi_notes_reset()   同上(アプリセッションの開始・破棄)
+ *   hostapi_notes_define()  エンベロープ slot を定義する(ms と sustain %)
+ *   hostapi_notes_on()      チャネルを発音する。鳴っているチャネルは位相を
+ *                           保ったままピッチを変え、今のエンベロープ値から
+ *                           アタックし直す(つなぎ目でクリックしない)
+ *   hostapi_notes_off()     リリースへ(今の値から 0 まで release_ms で)
+ *   hostapi_notes_accum()   int32 の積算バッファへ加算する(出力ミキサが
+ *                           トーンと同じバスに混ぜる)
+ *
+ * 発振は回転ベクトル(float)で、サンプルごとの libm 呼び出しは無い。長く
+ * 鳴らすと丸めで振幅がずれるので、積算の区切りごとにベクトルの長さを 1 に
+ * 戻す。エンベロープは区間ごとの線形(A: 今の値 → 1、D: 1 → sustain、
+ * S: 保持、R: 今の値 → 0)。sustain 0 なら D の終わりで鳴り終わる。
+ * 振幅 = HOSTAPI_VOICE_FULL_SCALE × velocity/127 × マスター音量(note_on 時)。
+ *
+ * 状態はレンダリングする側(Linux: SDL オーディオコールバック、実機: トーン
+ * タスク)だけが触る前提で、排他は呼び出し側の責任。
+ */
+#pragma once
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "hostapi_defs.h"
+#include "hostapi_voice.h"
+
+enum {
+    HOSTAPI_NOTE_IDLE = 0,
+    HOSTAPI_NOTE_ATTACK,
+    HOSTAPI_NOTE_DECAY,
+    HOSTAPI_NOTE_SUSTAIN,
+    HOSTAPI_NOTE_RELEASE,
+};
+
+typedef struct {
+    uint16_t attack_ms;
+    uint16_t decay_ms;
+    uint8_t sustain;   /* 0..100(%) */
+    uint16_t release_ms;
+} hostapi_note_env_t;
+
+typedef struct {
+    float c, s;        /* 位相(回転ベクトル。出力は s) */
+    float cw, sw;      /* 1 サンプルぶんの回転 */
+    float amp;         /* 振幅(velocity と音量を焼き込む) */
+    float env;         /* エンベロープの今の値 0..1 */
+    float step;        /* 1 サンプルあたりの env の変化 */
+    int32_t left;      /* 今の区間の残りフレーム */
+    int stage;         /* HOSTAPI_NOTE_* */
+    float sustain;     /* note_on 時のエンベロープ(定義し直しても鳴っている音は変えない) */
+    int32_t decay;
+    int32_t release;
+} hostapi_note_ch_t;
+
+typedef struct {
+    hostapi_note_ch_t ch[HOSTAPI_NOTE_CHANNELS];
+    hostapi_note_env_t env[HOSTAPI_NOTE_ENVS];
+    int rate;
+    int active;        /* 鳴っているチャネル数 */
+} hostapi_notes_t;
+
+/* アプリ起動時のエンベロープ(全 slot) */
+static const hostapi_note_env_t kHostapiNoteEnvDefault = {5, 80, 70, 150};
+
+static inline void hostapi_notes_reset(hostapi_notes_t* n)
+{
+    memset(n->ch, 0, sizeof(n->ch));
+    for (int i = 0; i < HOSTAPI_NOTE_ENVS; i++) n->env[i] = kHostapiNoteEnvDefault;
+    n->active = 0;
+}
+
+static inline void hostapi_notes_init(hostapi_notes_t* n, int rate)
+{
+    n->rate = rate;
+    hostapi_notes_reset(n);
+}
+
+/* 範囲はアプリ向けの API(hostapi_note_define)で丸めてある前提 */
+static inline void hostapi_notes_define(hostapi_notes_t* n, int slot,
+                                        const hostapi_note_env_t* env)
+{
+    if (slot < 0 || slot >= HOSTAPI_NOTE_ENVS) return;
+    n->env[slot] = *env;
+}
+
+/* pitch(MIDI ノート番号 × 100 + セント)→ Hz */
+static inline float hostapi_notes_hz(int32_t pitch)
+{
+    return 440.0f * powf(2.0f, (float)(pitch - 6900) / 1200.0f);
+}
+
+static inline int32_t hostapi_notes_frames(const hostapi_notes_t* n, uint32_t ms)
+{
+    return (int32_t)((int64_t)n->rate * ms / 1000);
+}
+
+/* 区間を始める。長さ 0 の区間は飛ばす */
+static inline void hostapi_notes_enter(hostapi_notes_t* n, hostapi_note_ch_t* c, int stage)
+{
+    for (;;) {
+        c->stage = stage;
+        switch (stage) {
+        case HOSTAPI_NOTE_ATTACK:
+        case HOSTAPI_NOTE_DECAY: {
+            const float target = stage == HOSTAPI_NOTE_ATTACK ? 1.0f : c->sustain;
+            const int32_t len = stage == HOSTAPI_NOTE_ATTACK ? c->left : c->decay;
+            if (len > 0) {
+                c->left = len;
+                c->step = (target - c->env) / (float)len;
+                return;
+            }
+            c->env = target;
+            stage++;
+            break;
+        }
+        case HOSTAPI_NOTE_SUSTAIN:
+            if (c->sustain <= 0.0f) {
+                stage = HOSTAPI_NOTE_IDLE;
+                break;
+            }
+            c->env = c->sustain;
+            c->step = 0.0f;
+            c->left = INT32_MAX;
+            return;
+        case HOSTAPI_NOTE_RELEASE:
+            if (c->release > 0 && c->env > 0.0f) {
+                c->left = c->release;
+                c->step = -c->env / (float)c->release;
+                return;
+            }
+            stage = HOSTAPI_NOTE_IDLE;
+            break;
+        default:
+            c->stage = HOSTAPI_NOTE_IDLE;
+            c->env = 0.0f;
+            n->active--;
+            return;
+        }
+    }
+}
+
+/* ch を発音する。velocity 1..127、volume 0..100 */
+static inline void hostapi_notes_on(hostapi_notes_t* n, int ch, int env_slot, int32_t pitch,
+                                    int velocity, int volume)
+{
+    if (ch < 0 || ch >= HOSTAPI_NOTE_CHANNELS) return;
+    if (env_slot < 0 || env_slot >= HOSTAPI_NOTE_ENVS) env_slot = 0;
+    hostapi_note_ch_t* c = &n->ch[ch];
+    const hostapi_note_env_t* e = &n->env[env_slot];
+    const float w = 2.0f * (float)M_PI * hostapi_notes_hz(pitch) / (float)n->rate;
+    c->cw = cosf(w);
+    c->sw = sinf(w);
+    const float amp = HOSTAPI_VOICE_FULL_SCALE * (float)velocity / 127.0f * (float)volume / 100.0f;
+    if (c->stage == HOSTAPI_NOTE_IDLE) {
+        c->c = 1.0f;
+        c->s = 0.0f;
+        c->env = 0.0f;
+        n->active++;
+    } else if (amp > 0.0f) {
+        /* 鳴らし直し: 出力 env × amp が続くよう env を換算する(velocity が
+         * 下がると 1 を超え、アタックで 1 へ下りる) */
+        c->env = c->env * c->amp / amp;
+    }
+    c->amp = amp;
+    c->sustain = (float)e->sustain / 100.0f;
+    c->decay = hostapi_notes_frames(n, e->decay_ms);
+    c->release = hostapi_notes_frames(n, e->release_ms);
+    c->left = hostapi_notes_frames(n, e->attack_ms);
+    hostapi_notes_enter(n, c, HOSTAPI_NOTE_ATTACK);
+}
+
+/* ch をリリースへ。鳴っていない・リリース中なら何もしない */
+static inline void hostapi_notes_off(hostapi_notes_t* n, int ch)
+{
+    if (ch < 0 || ch >= HOSTAPI_NOTE_CHANNELS) return;
+    hostapi_note_ch_t* c = &n->ch[ch];
+    if (c->stage == HOSTAPI_NOTE_IDLE || c->stage == HOSTAPI_NOTE_RELEASE) return;
+    hostapi_notes_enter(n, c, HOSTAPI_NOTE_RELEASE);
+}
+
+/* 全チャネルを acc(モノラル int32、frames フレーム)に加算する */
+static inline void hostapi_notes_accum(hostapi_notes_t* n, int32_t* acc, int frames)
+{
+    for (int i = 0; i < HOSTAPI_NOTE_CHANNELS && n->active > 0; i++) {
+        hostapi_note_ch_t* c = &n->ch[i];
+        int done = 0;
+        while (c->stage != HOSTAPI_NOTE_IDLE && done < frames) {
+            const int k = c->left < frames - done ? (int)c->left : frames - done;
+            float cc = c->c, ss = c->s, env = c->env;
+            const float cw = c->cw, sw = c->sw, step = c->step, amp = c->amp;
+            for (int j = 0; j < k; j++) {
+                acc[done + j] += (int32_t)(ss * env * amp);
+                const float nc = cc * cw - ss * sw;
+                ss = ss * cw + cc * sw;
+                cc = nc;
+                env += step;
+            }
+            c->c = cc;
+            c->s = ss;
+            c->env = env;
+            done += k;
+            if (c->left != INT32_MAX) c->left -= k;
+            if (c->left == 0) {
+                /* 区間の終わりは目標値に揃える(線形の丸めを持ち越さない) */
+                if (c->stage == HOSTAPI_NOTE_ATTACK) c->env = 1.0f;
+                else if (c->stage == HOSTAPI_NOTE_DECAY) c->env = c->sustain;
+                else if (c->stage == HOSTAPI_NOTE_RELEASE) c->env = 0.0f;
+                hostapi_notes_enter(n, c, c->stage + 1);
+            }
+        }
+        /* 回転ベクトルの長さを 1 に戻す(1 次の近似で十分) */
+        const float g = 1.5f - 0.5f * (c->c * c->c + c->s * c->s);
+        c->c *= g;
+        c->s *= g;
+    }
+}
@@ -0,0 +1,275 @@
+/*
+ * トーンの発振器+エンベロープのカーネル(実機 ESP32 ホストと Linux ホストで共有)。
+ *
+ * 1 声 = 再帰振動子(回転行列)の減衰サイン。hostapi_voice.h のミキサから
+ * ブロック単位(n フレーム)で呼ばれ、int32 の積算バッファへ加算する。
+ *
+ *   HOSTAPI_OSC_FLOAT     float の回転+乗算減衰。参照実装(従来の出力と一致)
+ *   HOSTAPI_OSC_Q31       Q31 固定小数点のスカラ版。乗算は 32x32 の上位 32bit
+ *                         だけを使う(ESP32-S3 は MULSH 1 命令)
+ *   HOSTAPI_OSC_Q31_SIMD  Q31 を 4 レーン(連続 4 サンプル)で回す。各レーンは
+ *                         位相を w ずつずらした振動子で、4w ずつ回転させる。
+ *                         NEON(vqdmulhq_s32)/ x86 SSE4.1(実行時判定)。
+ *                         どちらも無いビルドでは Q31 スカラにフォールバック
+ *
+ * Q31 の状態: s/c は振幅 2^30 の Q31(回転の和が溢れない余裕を 1bit 取る)、
+ * 係数 cw/sw/decay は Q31、amp は int16 振幅 << 17。出力は
+ * (amp * s) >> 47 = 振幅 × sin で、float 版との差は ±1〜2 LSB。
+ */
+#pragma once
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#define HOSTAPI_OSC_NEON 1
+#elif (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#include <smmintrin.h>
+#define HOSTAPI_OSC_SSE41 1
+#endif
+
+enum {
+    HOSTAPI_OSC_FLOAT = 0,
+    HOSTAPI_OSC_Q31 = 1,
+    HOSTAPI_OSC_Q31_SIMD = 2,
+};
+
+typedef struct {
+    int32_t remaining;  /* 残りフレーム(0=idle) */
+    /* float(参照) */
+    float s, c;         /* sin/cos の回転状態 */
+    float cw, sw;       /* 回転係数 */
+    float decay, amp;
+    /* Q31。s/c/amp は「次に出すサンプル」の値(float 版は回してから出す) */
+    int32_t qs, qc, qamp;
+    int32_t qcw, qsw, qdecay;
+    int32_t qcw4, qsw4, qdecay4; /* 4 サンプルぶん(SIMD) */
+} hostapi_voice_t;
+
+static inline int32_t hostapi_osc_q31(double x) /* [-1, 1) → Q31(1.0 は飽和) */
+{
+    const double v = x * 2147483648.0;
+    if (v >= 2147483647.0) return INT32_MAX;
+    if (v <= -2147483648.0) return INT32_MIN;
+    return (int32_t)lrint(v);
+}
+
+/* 1 声の発振を初期化する。amp は int16 振幅、total はフレーム数 */
+static inline void hostapi_osc_start(hostapi_voice_t* v, double w, float amp, int32_t total)
+{
+    v->remaining = total;
+    v->s = 0.0f;
+    v->c = 1.0f;
+    v->cw = cosf((float)w);
+    v->sw = sinf((float)w);
+    v->decay = expf(-3.5f / (float)total); /* 終端で ~-30dB */
+    v->amp = amp;
+
+    /* 最初のサンプルは float 版と同じく sin(w)・amp*decay */
+    const double decay = exp(-3.5 / (double)total);
+    v->qs = (int32_t)lrint(sin(w) * 1073741824.0);
+    v->qc = (int32_t)lrint(cos(w) * 1073741824.0);
+    v->qamp = (int32_t)lrint((double)amp * decay * 131072.0);
+    v->qcw = hostapi_osc_q31(cos(w));
+    v->qsw = hostapi_osc_q31(sin(w));
+    v->qdecay = hostapi_osc_q31(decay);
+    v->qcw4 = hostapi_osc_q31(cos(4.0 * w));
+    v->qsw4 = hostapi_osc_q31(sin(4.0 * w));
+    v->qdecay4 = hostapi_osc_q31(decay * decay * decay * decay);
+}
+
+/* ---- float(参照実装) ---- */
+static inline void hostapi_osc_mix_float(hostapi_voice_t* v, int32_t* acc, int n)
+{
+    float s = v->s, c = v->c, amp = v->amp;
+    const float cw = v->cw, sw = v->sw, decay = v->decay;
+    for (int i = 0; i < n; i++) {
+        const float s2 = s * cw + c * sw;
+        c = c * cw - s * sw;
+        s = s2;
+        amp *= decay;
+        acc[i] += (int32_t)(amp * s);
+    }
+    v->s = s;
+    v->c = c;
+    v->amp = amp;
+}
+
+/* ---- Q31 スカラ ---- */
+static inline int32_t hostapi_osc_mulhi(int32_t a, int32_t b) /* (a*b) >> 32 */
+{
+    return (int32_t)(((int64_t)a * b) >> 32);
+}
+
+/* 1 サンプル出して状態を 1 サンプル進める */
+static inline int32_t hostapi_osc_q31_step(int32_t* s, int32_t* c, int32_t* amp,
+                                           int32_t cw, int32_t sw, int32_t decay)
+{
+    const int32_t out = hostapi_osc_mulhi(*amp, *s) >> 15;
+    const int32_t s2 = (hostapi_osc_mulhi(*s, cw) + hostapi_osc_mulhi(*c, sw)) * 2;
+    *c = (hostapi_osc_mulhi(*c, cw) - hostapi_osc_mulhi(*s, sw)) * 2;
+    *s = s2;
+    *amp = hostapi_osc_mulhi(*amp, decay) * 2;
+    return out;
+}
+
+static inline void hostapi_osc_mix_q31(hostapi_voice_t* v, int32_t* acc, int n)
+{
+    int32_t s = v->qs, c = v->qc, amp = v->qamp;
+    const int32_t cw = v->qcw, sw = v->qsw, decay = v->qdecay;
+    for (int i = 0; i < n; i++) acc[i] += hostapi_osc_q31_step(&s, &c, &amp, cw, sw, decay);
+    v->qs = s;
+    v->qc = c;
+    v->qamp = amp;
+}
+
+/* ---- Q31 4 レーン ---- */
+#if HOSTAPI_OSC_NEON || HOSTAPI_OSC_SSE41
+#define HOSTAPI_OSC_HAVE_SIMD 1
+
+/* レーン k に「k サンプル先」の状態を作る(スカラで 3 回回す) */
+static inline void hostapi_osc_lanes(const hostapi_voice_t* v, int32_t ls[4], int32_t lc[4],
+                                     int32_t la[4])
+{
+    int32_t s = v->qs, c = v->qc, amp = v->qamp;
+    for (int k = 0; k < 4; k++) {
+        ls[k] = s;
+        lc[k] = c;
+        la[k] = amp;
+        hostapi_osc_q31_step(&s, &c, &amp, v->qcw, v->qsw, v->qdecay);
+    }
+}
+
+#if HOSTAPI_OSC_NEON
+static inline void hostapi_osc_mix_q31_simd(hostapi_voice_t* v, int32_t* acc, int n)
+{
+    const int blocks = n / 4;
+    if (blocks > 0) {
+        int32_t ls[4], lc[4], la[4];
+        hostapi_osc_lanes(v, ls, lc, la);
+        int32x4_t s = vld1q_s32(ls), c = vld1q_s32(lc), amp = vld1q_s32(la);
+        const int32x4_t cw = vdupq_n_s32(v->qcw4), sw = vdupq_n_s32(v->qsw4);
+        const int32x4_t decay = vdupq_n_s32(v->qdecay4);
+        for (int b = 0; b < blocks; b++) {
+            /* vqdmulhq = (a*b) >> 31(スカラの mulhi*2 より 1bit 精しい) */
+            const int32x4_t out = vshrq_n_s32(vqdmulhq_s32(amp, s), 16);
+            vst1q_s32(acc + b * 4, vaddq_s32(vld1q_s32(acc + b * 4), out));
+            const int32x4_t s2 = vaddq_s32(vqdmulhq_s32(s, cw), vqdmulhq_s32(c, sw));
+            c = vsubq_s32(vqdmulhq_s32(c, cw), vqdmulhq_s32(s, sw));
+            s = s2;
+            amp = vqdmulhq_s32(amp, decay);
+        }
+        v->qs = vgetq_lane_s32(s, 0);
+        v->qc = vgetq_lane_s32(c, 0);
+        v->qamp = vgetq_lane_s32(amp, 0);
+    }
+    hostapi_osc_mix_q31(v, acc + blocks * 4, n - blocks * 4);
+}
+#else
+/* SSE4.1 の _mm_mul_epi32(符号付き 32x32→64、偶数レーン)で 4 レーンの mulhi */
+__attribute__((target("sse4.1"))) static inline __m128i hostapi_osc_mulhi4(__m128i a, __m128i b)
+{
+    const __m128i even = _mm_srli_epi64(_mm_mul_epi32(a, b), 32);
+    const __m128i odd = _mm_mul_epi32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+    return _mm_blend_epi16(even, odd, 0xCC);
+}
+
+__attribute__((target("sse4.1"))) static inline void
+hostapi_osc_mix_q31_sse41(hostapi_voice_t* v, int32_t* acc, int blocks)
+{
+    int32_t ls[4], lc[4], la[4];
+    hostapi_osc_lanes(v, ls, lc, la);
+    __m128i s = _mm_loadu_si128((const __m128i*)ls);
+    __m128i c = _mm_loadu_si128((const __m128i*)lc);
+    __m128i amp = _mm_loadu_si128((const __m128i*)la);
+    const __m128i cw = _mm_set1_epi32(v->qcw4), sw = _mm_set1_epi32(v->qsw4);
+    const __m128i decay = _mm_set1_epi32(v->qdecay4);
+    for (int b = 0; b < blocks; b++) {
+        __m128i* dst = (__m128i*)(acc + b * 4);
+        const __m128i out = _mm_srai_epi32(hostapi_osc_mulhi4(amp, s), 15);
+        _mm_storeu_si128(dst, _mm_add_epi32(_mm_loadu_si128(dst), out));
+        const __m128i s2 = _mm_slli_epi32(
+            _mm_add_epi32(hostapi_osc_mulhi4(s, cw), hostapi_osc_mulhi4(c, sw)), 1);
+        c = _mm_slli_epi32(_mm_sub_epi32(hostapi_osc_mulhi4(c, cw), hostapi_osc_mulhi4(s, sw)),
+                           1);
+        s = s2;
+        amp = _mm_slli_epi32(hostapi_osc_mulhi4(amp, decay), 1);
+    }
+    v->qs = _mm_cvtsi128_si32(s);
+    v->qc = _mm_cvtsi128_si32(c);
+    v->qamp = _mm_cvtsi128_si32(amp);
+}
+
+static inline bool hostapi_osc_simd_supported(void)
+{
+    return __builtin_cpu_supports("sse4.1");
+}
+
+static inline void hostapi_osc_mix_q31_simd(hostapi_voice_t* v, int32_t* acc, int n)
+{
+    const int blocks = n / 4;
+    if (blocks > 0) hostapi_osc_mix_q31_sse41(v, acc, blocks);
+    hostapi_osc_mix_q31(v, acc + blocks * 4, n - blocks * 4);
+}
+#endif
+
+#if HOSTAPI_OSC_NEON
+static inline bool hostapi_osc_simd_supported(void)
+{
+    return true;
+}
+#endif
+
+#else
+#define HOSTAPI_OSC_HAVE_SIMD 0
+
+static inline bool hostapi_osc_simd_supported(void)
+{
+    return false;
+}
+
+static inline void hostapi_osc_mix_q31_simd(hostapi_voice_t* v, int32_t* acc, int n)
+{
+    hostapi_osc_mix_q31(v, acc, n);
+}
+#endif
+
+/* 使えるカーネルのうち最速のもの(実機は Q31 スカラ) */
+static inline int hostapi_osc_best(void)
+{
+    return hostapi_osc_simd_supported() ? HOSTAPI_OSC_Q31_SIMD : HOSTAPI_OSC_Q31;
+}
+
+static inline const char* hostapi_osc_name(int kernel)
+{
+    switch (kernel) {
+    case HOSTAPI_OSC_FLOAT: return "float";
+    case HOSTAPI_OSC_Q31: return "q31";
+#if HOSTAPI_OSC_NEON
+    case HOSTAPI_OSC_Q31_SIMD: return "q31-neon";
+#elif HOSTAPI_OSC_SSE41
+    case HOSTAPI_OSC_Q31_SIMD: return "q31-sse4.1";
+#endif
+    default: return "q31-simd(n/a)";
+    }
+}
+
+static inline void hostapi_osc_mix(int kernel, hostapi_voice_t* v, int32_t* acc, int n)
+{
+    if (kernel == HOSTAPI_OSC_FLOAT) {
+        hostapi_osc_mix_float(v, acc, n);
+    } else if (kernel == HOSTAPI_OSC_Q31_SIMD) {
+        hostapi_osc_mix_q31_simd(v, acc, n);
+    } else {
+        hostapi_osc_mix_q31(v, acc, n);
+    }
+    v->remaining -= n;
+}
+
+/* 現在の振幅(int16 単位。声を奪うときの比較用) */
+static inline float hostapi_osc_amp(int kernel, const hostapi_voice_t* v)
+{
+    return kernel == HOSTAPI_OSC_FLOAT ? v->amp : (float)v->qamp * (1.0f / 131072.0f);
+}
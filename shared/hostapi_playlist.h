@@ -0,0 +1,131 @@
+/*
+ * 再生キュー(hostapi_audio_enqueue)の帳簿(実機 ESP32 ホストと Linux ホストで共有)。
+ *
+ * アプリは曲の終わりを 100ms tick の get_state(FINISHED)で知って次の
+ * audio_play を呼ぶしかなく、曲間に最大 100ms の無音とファイルを開いて
+ * デコーダを立ち上げる時間が挟まっていた。キューに積んでおけば、ホストは
+ * 先頭の曲を今の曲が終わる前に開いておき(プリロード)、終わった瞬間に
+ * デコーダ側で切り替える。切り替えた事実はアプリへ HOSTAPI_EV_AUDIO_TRACK で
+ * 届ける。
+ *
+ * ここに置くのは曲の並び(ルート相対パスと id)と、切り替えイベントの小さな
+ * リングだけ。ファイルを開く・デコーダへ渡すのはホスト固有:
+ *
+ *   hostapi_playlist_push()     末尾に積んで id を返す(満杯なら -1)
+ *   hostapi_playlist_head()     次に鳴らす曲(無ければ NULL)
+ *   hostapi_playlist_started()  先頭の曲が鳴り始めた: 取り除いて
+ *                               HOSTAPI_EV_AUDIO_TRACK を記録する
+ *   hostapi_playlist_drop()     先頭の曲を捨てる(開けなかった曲を飛ばす)
+ *   hostapi_playlist_clear()    並びを空にする(audio_play / STOP / リセット)。
+ *                               id は続き番号のまま
+ *   hostapi_playlist_take_event()  記録したイベントを 1 件取り出す
+ *                               (hostapi_poll_event が入力イベントより先に返す)
+ *
+ * イベントは入力キュー(hostapi_evq.h、生産者は入力スレッド 1 本)には積まず、
+ * ここに持って poll 時に合流させる。状態は wasm アプリのスレッド(Linux は
+ * main ループ)だけが触るので排他は要らない。
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "hostapi_defs.h"
+
+#define HOSTAPI_PLAYLIST_PATH_MAX 64 /* audio_play の path と同じ上限 */
+#define HOSTAPI_PLAYLIST_EVENTS 4    /* 取り出されていない切り替えイベント(溢れたら最古を捨てる) */
+
+typedef struct {
+    char path[HOSTAPI_PLAYLIST_PATH_MAX + 1]; /* NUL 終端 */
+    uint16_t id;
+} hostapi_playlist_item_t;
+
+typedef struct {
+    hostapi_playlist_item_t item[HOSTAPI_AUDIO_QUEUE_MAX];
+    int head;                   /* 先頭の添字 */
+    int count;
+    uint16_t next_id;           /* 1..65535(0 は使わない) */
+    bool preloaded;             /* 先頭の曲をホストが開いてデコーダへ渡してある */
+    hostapi_event_t ev[HOSTAPI_PLAYLIST_EVENTS];
+    int ev_head;
+    int ev_count;
+} hostapi_playlist_t;
+
+static inline void hostapi_playlist_init(hostapi_playlist_t* pl)
+{
+    memset(pl, 0, sizeof(*pl));
+    pl->next_id = 1;
+}
+
+static inline void hostapi_playlist_clear(hostapi_playlist_t* pl)
+{
+    pl->head = 0;
+    pl->count = 0;
+    pl->preloaded = false;
+}
+
+/* アプリセッションの境界: 並びも未配送のイベントも捨てる(id は続き番号) */
+static inline void hostapi_playlist_reset(hostapi_playlist_t* pl)
+{
+    hostapi_playlist_clear(pl);
+    pl->ev_head = 0;
+    pl->ev_count = 0;
+}
+
+/* path(ルート相対、検証済み)を末尾に積む。id(1..65535)/ 満杯なら -1 */
+static inline int32_t hostapi_playlist_push(hostapi_playlist_t* pl, const char* path,
+                                            uint32_t len)
+{
+    if (pl->count >= HOSTAPI_AUDIO_QUEUE_MAX || len > HOSTAPI_PLAYLIST_PATH_MAX) return -1;
+    hostapi_playlist_item_t* it = &pl->item[(pl->head + pl->count) % HOSTAPI_AUDIO_QUEUE_MAX];
+    memcpy(it->path, path, len);
+    it->path[len] = '\0';
+    it->id = pl->next_id;
+    pl->next_id = (uint16_t)(pl->next_id == 0xFFFF ? 1 : pl->next_id + 1);
+    pl->count++;
+    return it->id;
+}
+
+static inline const hostapi_playlist_item_t* hostapi_playlist_head(const hostapi_playlist_t* pl)
+{
+    return pl->count > 0 ? &pl->item[pl->head] : NULL;
+}
+
+static inline void hostapi_playlist_drop(hostapi_playlist_t* pl)
+{
+    if (pl->count == 0) return;
+    pl->head = (pl->head + 1) % HOSTAPI_AUDIO_QUEUE_MAX;
+    pl->count--;
+    pl->preloaded = false;
+}
+
+/* 先頭の曲が time_ms に鳴り始めた。取り除いてイベントを記録する
+ * (param=id、x=まだ並んでいる曲数) */
+static inline void hostapi_playlist_started(hostapi_playlist_t* pl, uint32_t time_ms)
+{
+    const hostapi_playlist_item_t* it = hostapi_playlist_head(pl);
+    if (!it) return;
+    const uint16_t id = it->id;
+    hostapi_playlist_drop(pl);
+    if (pl->ev_count == HOSTAPI_PLAYLIST_EVENTS) {
+        pl->ev_head = (pl->ev_head + 1) % HOSTAPI_PLAYLIST_EVENTS;
+        pl->ev_count--;
+    }
+    hostapi_event_t* ev = &pl->ev[(pl->ev_head + pl->ev_count) % HOSTAPI_PLAYLIST_EVENTS];
+    ev->type = HOSTAPI_EV_AUDIO_TRACK;
+    ev->param = id;
+    ev->x = (int16_t)pl->count;
+    ev->y = 0;
+    ev->time_ms = time_ms;
+    pl->ev_count++;
+}
+
+static inline bool hostapi_playlist_take_event(hostapi_playlist_t* pl, hostapi_event_t* out)
+{
+    if (pl->ev_count == 0) return false;
+    *out = pl->ev[pl->ev_head];
+    pl->ev_head = (pl->ev_head + 1) % HOSTAPI_PLAYLIST_EVENTS;
+    pl->ev_count--;
+    return true;
+}
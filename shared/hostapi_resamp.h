@@ -0,0 +1,58 @@
+/*
+ * 固定比の線形補間リサンプラ(実機 ESP32 ホストと Linux ホストで共有)。
+ *
+ * MP3 のデコード出力(hostapi_mix.h)とサンプルのロード(hostapi_sample.h)を
+ * 出力レートへ揃える。モノラル入力はステレオへ複製して出す。入力を任意の
+ * 長さで分けて渡しても出力は同じ(ストリーム状態を持つ)。出力は入力より
+ * 1 フレーム遅れる(先頭は prev = 0 との補間)。
+ */
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+
+typedef struct {
+    uint32_t step;      /* 出力 1 フレームあたりの入力フレーム(Q16) */
+    uint32_t pos;       /* 次の出力位置(Q16)。0 が prev、1.0 が in[0] */
+    int channels;       /* 入力チャンネル数(1/2) */
+    int16_t prev[2];    /* 前回の入力の最終フレーム */
+} hostapi_resamp_t;
+
+static inline void hostapi_resamp_init(hostapi_resamp_t* r, uint32_t in_rate, uint32_t out_rate,
+                                       int channels)
+{
+    memset(r, 0, sizeof(*r));
+    r->step = (uint32_t)(((uint64_t)in_rate << 16) / out_rate);
+    r->channels = channels == 1 ? 1 : 2;
+}
+
+/* in(in_frames フレーム、channels ch interleaved)から out(ステレオ)へ最大
+ * out_cap フレーム書き、書いたフレーム数を返す。*in_used は消費した入力
+ * フレーム数。呼び出し側は入力が尽きるまで(*in_used の分進めて)繰り返す */
+static inline int hostapi_resamp_process(hostapi_resamp_t* r, const int16_t* in, int in_frames,
+                                         int* in_used, int16_t* out, int out_cap)
+{
+    const int ch = r->channels;
+    int n = 0;
+    while (n < out_cap) {
+        const int idx = (int)(r->pos >> 16);
+        if (idx >= in_frames) break;
+        const int32_t frac = (int32_t)((r->pos & 0xFFFF) >> 1); /* Q15 */
+        for (int c = 0; c < ch; c++) {
+            const int32_t left = idx ? in[(idx - 1) * ch + c] : r->prev[c];
+            const int32_t right = in[idx * ch + c];
+            out[n * 2 + c] = (int16_t)(left + (((right - left) * frac) >> 15));
+        }
+        if (ch == 1) out[n * 2 + 1] = out[n * 2];
+        r->pos += r->step;
+        n++;
+    }
+    int used = (int)(r->pos >> 16);
+    if (used > in_frames) used = in_frames;
+    if (used > 0) {
+        for (int c = 0; c < ch; c++) r->prev[c] = in[(used - 1) * ch + c];
+        r->pos -= (uint32_t)used << 16;
+    }
+    *in_used = used;
+    return n;
+}
@@ -0,0 +1,323 @@
+/*
+ * サンプル(ワンショット PCM)のキャッシュと再生(実機 ESP32 ホストと Linux
+ * ホストで共有)。
+ *
+ * hostapi_sample_load で WAV / raw PCM を一度だけデコードし、出力レートの
+ * int16 でキャッシュに置く。発音はキャッシュを読むだけで SD には触らない。
+ *
+ *   hostapi_sample_cache_*  固定サイズのアリーナ(実機は PSRAM)に詰めて置く。
+ *                           個別には解放せず、アプリ破棄時に丸ごと巻き戻す
+ *   hostapi_sample_decode   FILE* から読んでデコード・リサンプルし、キャッシュ
+ *                           に追加する
+ *   hostapi_splayer_*       発音中のサンプル(最大 HOSTAPI_SAMPLE_VOICES)を
+ *                           ステレオの積算バッファへ足す(出力ミキサが呼ぶ)
+ *
+ * 対応形式: RIFF/WAVE の PCM(WAVE_FORMAT_PCM と EXTENSIBLE の PCM)8/16/24bit、
+ * モノ/ステレオ、任意のレート。ヘッダ無し(呼び出し側が raw を指定)は 16bit LE
+ * モノ HOSTAPI_SAMPLE_RAW_RATE。モノはモノのまま置く(メモリ半分)。
+ *
+ * スレッド: デコードは API を呼ぶスレッド、発音は出力を描く側。デコード中の
+ * データはアリーナの未使用域に書くので描く側からは見えず、スロットは count の
+ * release store で公開する。巻き戻し(reset)だけは呼び出し側が描く側と排他する。
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "hostapi_defs.h"
+#include "hostapi_resamp.h"
+
+#define HOSTAPI_SAMPLE_KEY_MAX 64       /* キー(ミュージックルート相対パス)の最大長 */
+#define HOSTAPI_SAMPLE_RAW_RATE 44100   /* ヘッダ無し PCM のレート */
+#define HOSTAPI_SAMPLE_DECODE_FRAMES 128 /* デコードの読み込み単位(スタック ~1.8KB) */
+
+typedef struct {
+    char key[HOSTAPI_SAMPLE_KEY_MAX + 1];
+    const int16_t* pcm; /* 出力レート、channels ch interleaved */
+    uint32_t frames;
+    uint8_t channels;   /* 1/2 */
+} hostapi_sample_t;
+
+typedef struct {
+    uint8_t* arena;
+    uint32_t cap;
+    uint32_t used;
+    hostapi_sample_t s[HOSTAPI_SAMPLE_SLOTS];
+    int count;          /* 公開済みスロット数(描く側は hostapi_sample_get で読む) */
+} hostapi_sample_cache_t;
+
+static inline void hostapi_sample_cache_init(hostapi_sample_cache_t* c, void* arena, uint32_t cap)
+{
+    memset(c, 0, sizeof(*c));
+    c->arena = (uint8_t*)arena;
+    c->cap = arena ? cap : 0;
+}
+
+/* 全サンプルを捨てる(アリーナは巻き戻すだけ)。描く側と排他して呼ぶ */
+static inline void hostapi_sample_cache_reset(hostapi_sample_cache_t* c)
+{
+    __atomic_store_n(&c->count, 0, __ATOMIC_RELEASE);
+    c->used = 0;
+}
+
+/* key(NUL 終端なし)のハンドル。無ければ -1。ロードするスレッドから呼ぶ */
+static inline int hostapi_sample_cache_find(const hostapi_sample_cache_t* c, const char* key,
+                                            uint32_t key_len)
+{
+    for (int i = 0; i < c->count; i++) {
+        if (strlen(c->s[i].key) == key_len && memcmp(c->s[i].key, key, key_len) == 0) return i;
+    }
+    return -1;
+}
+
+/* ハンドルを解決する(不正なら NULL)。どのスレッドからでもよい */
+static inline const hostapi_sample_t* hostapi_sample_get(const hostapi_sample_cache_t* c,
+                                                         int handle)
+{
+    if (handle < 0 || handle >= __atomic_load_n(&c->count, __ATOMIC_ACQUIRE)) return NULL;
+    return &c->s[handle];
+}
+
+/* ---- デコード ---- */
+
+typedef struct {
+    uint32_t rate;
+    uint16_t channels;
+    uint16_t bits;
+    uint32_t data_bytes;
+} hostapi_wav_fmt_t;
+
+static inline uint16_t hostapi_sample_le16(const uint8_t* p)
+{
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static inline uint32_t hostapi_sample_le32(const uint8_t* p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) |
+           ((uint32_t)p[3] << 24);
+}
+
+/* f(先頭)を RIFF/WAVE として読み、data チャンクの先頭に位置付ける。
+ * fmt より後ろの未知のチャンク(LIST など)は読み飛ばす。未対応なら false */
+static inline bool hostapi_wav_open(FILE* f, hostapi_wav_fmt_t* fmt)
+{
+    uint8_t h[40]; /* WAVE_FORMAT_EXTENSIBLE の fmt 本体まで */
+    if (fread(h, 1, 12, f) != 12) return false;
+    if (memcmp(h, "RIFF", 4) != 0 || memcmp(h + 8, "WAVE", 4) != 0) return false;
+    bool have_fmt = false;
+    for (;;) {
+        if (fread(h, 1, 8, f) != 8) return false;
+        const uint32_t size = hostapi_sample_le32(h + 4);
+        const uint32_t skip = size + (size & 1); /* チャンクは 2 バイト境界 */
+        if (memcmp(h, "data", 4) == 0) {
+            if (!have_fmt) return false;
+            fmt->data_bytes = size;
+            return true;
+        }
+        if (memcmp(h, "fmt ", 4) != 0) {
+            if (fseek(f, (long)skip, SEEK_CUR) != 0) return false;
+            continue;
+        }
+        if (size < 16) return false;
+        const uint32_t n = size < sizeof(h) ? size : (uint32_t)sizeof(h);
+        if (fread(h, 1, n, f) != n) return false;
+        if (skip > n && fseek(f, (long)(skip - n), SEEK_CUR) != 0) return false;
+        uint16_t tag = hostapi_sample_le16(h);
+        if (tag == 0xFFFE && n >= 26) tag = hostapi_sample_le16(h + 24); /* SubFormat */
+        fmt->channels = hostapi_sample_le16(h + 2);
+        fmt->rate = hostapi_sample_le32(h + 4);
+        fmt->bits = hostapi_sample_le16(h + 14);
+        if (tag != 1) return false;
+        if (fmt->channels < 1 || fmt->channels > 2) return false;
+        if (fmt->bits != 8 && fmt->bits != 16 && fmt->bits != 24) return false;
+        if (fmt->rate < 1000 || fmt->rate > 192000) return false;
+        have_fmt = true;
+    }
+}
+
+/* n 個の PCM 値(bits は 8 = unsigned、16/24 = signed LE)を int16 へ */
+static inline void hostapi_sample_to_s16(const uint8_t* in, int16_t* out, int n, int bits)
+{
+    for (int i = 0; i < n; i++) {
+        if (bits == 8) {
+            out[i] = (int16_t)((in[i] - 128) * 256);
+        } else if (bits == 16) {
+            out[i] = (int16_t)hostapi_sample_le16(in + i * 2);
+        } else {
+            out[i] = (int16_t)hostapi_sample_le16(in + i * 3 + 1); /* 上位 16bit */
+        }
+    }
+}
+
+/* f(先頭位置)をデコードし、out_rate へリサンプルしてキャッシュに追加する。
+ * key が既にあればそのハンドルを返す(f は読まない)。raw はヘッダ無し PCM。
+ * 形式が未対応・スロット満杯・アリーナ不足は -1(キャッシュは変わらない) */
+static inline int hostapi_sample_decode(hostapi_sample_cache_t* c, const char* key,
+                                        uint32_t key_len, FILE* f, bool raw, uint32_t out_rate)
+{
+    const int found = hostapi_sample_cache_find(c, key, key_len);
+    if (found >= 0) return found;
+    if (key_len > HOSTAPI_SAMPLE_KEY_MAX || c->count >= HOSTAPI_SAMPLE_SLOTS) return -1;
+
+    hostapi_wav_fmt_t fmt;
+    if (raw) {
+        if (fseek(f, 0, SEEK_END) != 0) return -1;
+        const long size = ftell(f);
+        if (size < 0 || fseek(f, 0, SEEK_SET) != 0) return -1;
+        fmt.rate = HOSTAPI_SAMPLE_RAW_RATE;
+        fmt.channels = 1;
+        fmt.bits = 16;
+        fmt.data_bytes = (uint32_t)size;
+    } else if (!hostapi_wav_open(f, &fmt)) {
+        return -1;
+    }
+    const int ch = fmt.channels;
+    const uint32_t frame_bytes = (uint32_t)ch * fmt.bits / 8;
+    const uint32_t in_frames = fmt.data_bytes / frame_bytes;
+    if (in_frames == 0) return -1;
+
+    /* 出力フレーム数の上限はリサンプラの刻み(切り捨て)から見積もる */
+    hostapi_resamp_t r;
+    hostapi_resamp_init(&r, fmt.rate, out_rate, ch);
+    const bool copy = fmt.rate == out_rate; /* 1:1 は 1 フレーム遅れも無しで写す */
+    const uint64_t max_frames = copy ? in_frames : ((uint64_t)in_frames << 16) / r.step + 2;
+    const uint32_t base = (c->used + 3u) & ~3u;
+    if (base > c->cap || max_frames * (uint64_t)ch * 2 > c->cap - base) return -1;
+    int16_t* dst = (int16_t*)(void*)(c->arena + base);
+
+    uint8_t buf[HOSTAPI_SAMPLE_DECODE_FRAMES * 2 * 3];
+    int16_t pcm[HOSTAPI_SAMPLE_DECODE_FRAMES * 2];
+    int16_t st[HOSTAPI_SAMPLE_DECODE_FRAMES * 2];
+    uint32_t n = 0; /* 書いた出力フレーム */
+    uint32_t left = in_frames;
+    while (left > 0) {
+        const uint32_t want = left < HOSTAPI_SAMPLE_DECODE_FRAMES ? left
+                                                                   : HOSTAPI_SAMPLE_DECODE_FRAMES;
+        const int got = (int)fread(buf, frame_bytes, want, f);
+        if (got <= 0) break; /* 短いファイルは読めた所まで */
+        left -= (uint32_t)got;
+        hostapi_sample_to_s16(buf, pcm, got * ch, fmt.bits);
+        if (copy) {
+            memcpy(dst + n * ch, pcm, (size_t)got * ch * sizeof(int16_t));
+            n += (uint32_t)got;
+            continue;
+        }
+        const int16_t* in = pcm;
+        int in_left = got;
+        while (in_left > 0 && n < max_frames) {
+            const uint64_t room = max_frames - n;
+            const int cap = room < HOSTAPI_SAMPLE_DECODE_FRAMES ? (int)room
+                                                                : HOSTAPI_SAMPLE_DECODE_FRAMES;
+            int used;
+            const int k = hostapi_resamp_process(&r, in, in_left, &used, st, cap);
+            for (int i = 0; i < k; i++) {
+                dst[(n + i) * ch] = st[i * 2];
+                if (ch == 2) dst[(n + i) * 2 + 1] = st[i * 2 + 1];
+            }
+            n += (uint32_t)k;
+            in += used * ch;
+            in_left -= used;
+        }
+    }
+    if (n == 0) return -1;
+
+    hostapi_sample_t* s = &c->s[c->count];
+    memcpy(s->key, key, key_len);
+    s->key[key_len] = '\0';
+    s->pcm = dst;
+    s->frames = n;
+    s->channels = (uint8_t)ch;
+    c->used = base + n * (uint32_t)ch * 2;
+    const int handle = c->count;
+    __atomic_store_n(&c->count, handle + 1, __ATOMIC_RELEASE);
+    return handle;
+}
+
+/* ---- 再生 ---- */
+
+typedef struct {
+    const int16_t* pcm; /* NULL = 空き */
+    uint32_t frames;
+    uint32_t pos;
+    uint8_t channels;
+    int32_t gain;       /* Q15(level x マスター音量を発音時に焼き込む) */
+} hostapi_svoice_t;
+
+typedef struct {
+    hostapi_svoice_t v[HOSTAPI_SAMPLE_VOICES];
+    int active;
+    uint32_t stolen;    /* 奪った回数(診断用) */
+} hostapi_splayer_t;
+
+static inline void hostapi_splayer_reset(hostapi_splayer_t* p)
+{
+    memset(p, 0, sizeof(*p));
+}
+
+/* s を level(0..100)x volume(0..100)で頭から鳴らす。空きが無ければ残りが
+ * 最も短い声を奪い true を返す */
+static inline bool hostapi_splayer_start(hostapi_splayer_t* p, const hostapi_sample_t* s,
+                                         int level, int volume)
+{
+    hostapi_svoice_t* v = NULL;
+    uint32_t least = UINT32_MAX;
+    for (int i = 0; i < HOSTAPI_SAMPLE_VOICES; i++) {
+        hostapi_svoice_t* c = &p->v[i];
+        if (!c->pcm) {
+            v = c;
+            break;
+        }
+        if (c->frames - c->pos < least) {
+            least = c->frames - c->pos;
+            v = c;
+        }
+    }
+    const bool stolen = v->pcm != NULL;
+    if (stolen) {
+        p->stolen++;
+    } else {
+        p->active++;
+    }
+    v->pcm = s->pcm;
+    v->frames = s->frames;
+    v->pos = 0;
+    v->channels = s->channels;
+    v->gain = level * volume * 32768 / 10000;
+    return stolen;
+}
+
+/* 発音中の全声を l/r(n フレーム)へ足す(クリア・飽和はしない)。
+ * 鳴り終わった声は空きに戻す */
+static inline void hostapi_splayer_accum(hostapi_splayer_t* p, int32_t* l, int32_t* r, int n)
+{
+    for (int i = 0; i < HOSTAPI_SAMPLE_VOICES && p->active > 0; i++) {
+        hostapi_svoice_t* v = &p->v[i];
+        if (!v->pcm) continue;
+        const uint32_t rest = v->frames - v->pos;
+        const int k = rest < (uint32_t)n ? (int)rest : n;
+        const int32_t g = v->gain;
+        if (v->channels == 1) {
+            const int16_t* src = v->pcm + v->pos;
+            for (int j = 0; j < k; j++) {
+                const int32_t x = (src[j] * g) >> 15;
+                l[j] += x;
+                r[j] += x;
+            }
+        } else {
+            const int16_t* src = v->pcm + v->pos * 2;
+            for (int j = 0; j < k; j++) {
+                l[j] += (src[j * 2] * g) >> 15;
+                r[j] += (src[j * 2 + 1] * g) >> 15;
+            }
+        }
+        v->pos += (uint32_t)k;
+        if (v->pos >= v->frames) {
+            v->pcm = NULL;
+            p->active--;
+        }
+    }
+}
@@ -0,0 +1,82 @@
+/*
+ * 常時ストリーミングの描画ループ(実機 ESP32 ホストの I2S 出力。Linux では
+ * bench の DMA リング模擬が同じコードを回す)。
+ *
+ * 出力デバイスのリングを無音も含めて切れ目なく埋め続ける push 型の最終段。
+ * 1 ステップ = 1 チャンク(実機は DMA ディスクリプタ 1 本):
+ *
+ *   1. poll   依頼を取り込む(発音開始・停止など。ブロックしない)
+ *   2. music  音楽を 1 チャンク取り出す(無ければ false)
+ *   3. 描画   鳴っているものがあれば hostapi_mix_render、無ければゼロ
+ *   4. write  シンクへ書く。リングが空くまでブロックし、これが歩調になる
+ *
+ * リングが常に満ちているのでアンダーフローが起きず、鳴り終わりのゼロ埋めも
+ * 要らない。発音はチャンク境界で始まり、依頼から鳴るまでは「次の poll まで
+ * (0..1 チャンク)+ リングの深さ」でほぼ一定になる(深さを浅くすれば短い)。
+ *
+ * 状態は描画ループを回す 1 スレッドだけが触る(ミキサ・声と同じ)。
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "hostapi_mix.h"
+
+typedef struct {
+    void* ctx;
+    void (*poll)(void* ctx);
+    bool (*music)(void* ctx, int16_t* out, int frames);        /* NULL 可 */
+    bool (*write)(void* ctx, const int16_t* pcm, int frames);  /* 失敗なら false */
+} hostapi_stream_io_t;
+
+typedef struct {
+    hostapi_stream_io_t io;
+    hostapi_mix_t* mix;
+    hostapi_voices_t* voices;
+    hostapi_splayer_t* splayer;  /* NULL 可 */
+    int16_t* out;                /* frames × 2(ステレオ) */
+    int16_t* music_buf;          /* 同上。io.music が NULL なら NULL 可 */
+    int frames;
+    bool silent;                 /* out が既にゼロ(無音が続く間は描き直さない) */
+    uint32_t chunks;             /* 以下は診断用 */
+    uint32_t silent_chunks;
+    uint32_t write_errors;
+} hostapi_stream_t;
+
+static inline void hostapi_stream_init(hostapi_stream_t* s, const hostapi_stream_io_t* io,
+                                       hostapi_mix_t* mix, hostapi_voices_t* voices,
+                                       hostapi_splayer_t* splayer, int16_t* out,
+                                       int16_t* music_buf, int frames)
+{
+    memset(s, 0, sizeof(*s));
+    s->io = *io;
+    s->mix = mix;
+    s->voices = voices;
+    s->splayer = splayer;
+    s->out = out;
+    s->music_buf = music_buf;
+    s->frames = frames;
+}
+
+/* 1 チャンク進める。鳴っているものがあれば true */
+static inline bool hostapi_stream_step(hostapi_stream_t* s)
+{
+    s->io.poll(s->io.ctx);
+    const bool music = s->io.music && s->io.music(s->io.ctx, s->music_buf, s->frames);
+    const bool sounding = music || s->voices->active > 0 || hostapi_mix_notes_active(s->mix) ||
+                          (s->splayer && s->splayer->active > 0);
+    if (sounding || s->mix->lim_gain != HOSTAPI_MIX_UNITY) { /* リミッタの戻りも描く */
+        hostapi_mix_render(s->mix, music ? s->music_buf : NULL, s->voices, s->splayer, s->out,
+                           s->frames);
+        s->silent = false;
+    } else {
+        if (!s->silent) memset(s->out, 0, (size_t)s->frames * 2 * sizeof(int16_t));
+        s->silent = true;
+        s->silent_chunks++;
+    }
+    if (!s->io.write(s->io.ctx, s->out, s->frames)) s->write_errors++;
+    s->chunks++;
+    return sounding;
+}
@@ -0,0 +1,136 @@
+/*
+ * レンダ済みトーンのキャッシュ(実機 ESP32 ホストと Linux ホストで共有)。
+ *
+ * メトロノームのクリックのように同じトーン定義を何千回も鳴らす用途向け。
+ * 定義(freq_hz / dur_ms / level)ごとに 1 回だけ、声と同じ発振カーネルで
+ * 音量 100 の減衰サインをモノラル int16 に描いておく。発音はその PCM を
+ * マスター音量倍して積算するだけになる(hostapi_voice.h が使う)。
+ *
+ * 領域は呼び出し側の静的配列(entries × HOSTAPI_TCACHE_ENTRY_FRAMES(rate))。
+ * 1 枠は dur_ms の上限(100ms)ぶんの固定長なので、入れ替えても断片化しない。
+ * 空きが無ければ再生中でない最も古く使った枠を上書きし、それも無ければ
+ * キャッシュせずに発振で鳴らす(bypass)。カーネルを変えたら
+ * hostapi_tcache_clear で全枠を捨てる。
+ *
+ * 排他は hostapi_voice.h と同じく呼び出し側の責任(レンダリングする側だけが
+ * 触る)。
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "hostapi_osc.h"
+
+#define HOSTAPI_TCACHE_MAX_ENTRIES 8   /* 枠数の上限(= HOSTAPI_TONE_SLOTS) */
+#define HOSTAPI_TCACHE_MAX_MS 100      /* hostapi_tone_define の dur_ms 上限 */
+#define HOSTAPI_TCACHE_ENTRY_FRAMES(rate) ((rate) * HOSTAPI_TCACHE_MAX_MS / 1000)
+#define HOSTAPI_TCACHE_RENDER_CHUNK 128
+
+typedef struct {
+    uint16_t freq_hz;
+    uint16_t dur_ms;
+    uint8_t level;
+    int32_t frames;     /* 描いたフレーム数。0 は空き */
+    uint32_t last_use;  /* 最後に引いた通し番号(入れ替え用) */
+    int users;          /* この枠を再生中の声数(> 0 の間は上書きしない) */
+} hostapi_tcache_entry_t;
+
+typedef struct {
+    int16_t* pcm;       /* entries × entry_frames(呼び出し側の静的領域) */
+    int entries;        /* 使う枠数(0..HOSTAPI_TCACHE_MAX_ENTRIES) */
+    int rate;           /* 描いたレート(違うレートの発音はキャッシュしない) */
+    int32_t entry_frames;
+    uint32_t clock;
+    hostapi_tcache_entry_t e[HOSTAPI_TCACHE_MAX_ENTRIES];
+    uint32_t hits;      /* 以下は診断用 */
+    uint32_t renders;
+    uint32_t bypass;
+} hostapi_tcache_t;
+
+static inline void hostapi_tcache_init(hostapi_tcache_t* c, int16_t* pcm, int entries, int rate)
+{
+    memset(c, 0, sizeof(*c));
+    if (entries < 0) entries = 0;
+    if (entries > HOSTAPI_TCACHE_MAX_ENTRIES) entries = HOSTAPI_TCACHE_MAX_ENTRIES;
+    c->pcm = pcm;
+    c->entries = pcm ? entries : 0;
+    c->rate = rate;
+    c->entry_frames = HOSTAPI_TCACHE_ENTRY_FRAMES(rate);
+}
+
+/* 全枠を捨てる(再生中の声が無いときに呼ぶ) */
+static inline void hostapi_tcache_clear(hostapi_tcache_t* c)
+{
+    for (int i = 0; i < c->entries; i++) {
+        c->e[i].frames = 0;
+        c->e[i].users = 0;
+    }
+}
+
+static inline const int16_t* hostapi_tcache_pcm(const hostapi_tcache_t* c, int entry)
+{
+    return c->pcm + (size_t)entry * (size_t)c->entry_frames;
+}
+
+/* 1 声ぶんを dst(モノラル int16、total フレーム)へ描く。声の発音と同じ
+ * 初期状態・同じ積算ブロック長で回すので、音量 100 なら発振で鳴らした音と揃う */
+static inline void hostapi_tcache_render(int kernel, int16_t* dst, double w, float amp,
+                                         int32_t total)
+{
+    hostapi_voice_t v;
+    int32_t acc[HOSTAPI_TCACHE_RENDER_CHUNK];
+    hostapi_osc_start(&v, w, amp, total);
+    while (v.remaining > 0) {
+        const int n = v.remaining < HOSTAPI_TCACHE_RENDER_CHUNK ? (int)v.remaining
+                                                                : HOSTAPI_TCACHE_RENDER_CHUNK;
+        memset(acc, 0, sizeof(acc));
+        hostapi_osc_mix(kernel, &v, acc, n);
+        for (int i = 0; i < n; i++) {
+            int32_t a = acc[i];
+            if (a > 32767) a = 32767;
+            else if (a < -32768) a = -32768;
+            dst[i] = (int16_t)a;
+        }
+        dst += n;
+    }
+}
+
+/* 定義に対応する枠を返す。無ければ描いて入れる(w / amp / total は声の発音と
+ * 同じ値を渡す)。入らなければ -1 */
+static inline int hostapi_tcache_get(hostapi_tcache_t* c, int kernel, int rate,
+                                     uint16_t freq_hz, uint16_t dur_ms, uint8_t level,
+                                     double w, float amp, int32_t total)
+{
+    int victim = -1;
+    for (int i = 0; i < c->entries; i++) {
+        hostapi_tcache_entry_t* e = &c->e[i];
+        if (e->frames > 0 && e->freq_hz == freq_hz && e->dur_ms == dur_ms &&
+            e->level == level) {
+            e->last_use = ++c->clock;
+            c->hits++;
+            return i;
+        }
+        /* 空き枠を優先、無ければ再生中でない最も古い枠 */
+        if (e->users > 0) continue;
+        if (victim < 0 || (c->e[victim].frames > 0 &&
+                           (e->frames == 0 || e->last_use < c->e[victim].last_use))) {
+            victim = i;
+        }
+    }
+    if (victim < 0 || rate != c->rate || total > c->entry_frames) {
+        c->bypass++;
+        return -1;
+    }
+    hostapi_tcache_entry_t* e = &c->e[victim];
+    hostapi_tcache_render(kernel, c->pcm + (size_t)victim * (size_t)c->entry_frames, w, amp,
+                          total);
+    e->freq_hz = freq_hz;
+    e->dur_ms = dur_ms;
+    e->level = level;
+    e->frames = total;
+    e->last_use = ++c->clock;
+    c->renders++;
+    return victim;
+}
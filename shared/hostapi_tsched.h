@@ -0,0 +1,318 @@
+/*
+ * トーン予約キュー(実機 ESP32 ホストと Linux ホストで共有)。
+ *
+ * hostapi_tone_enqueue の予約(複数)と、hostapi_tone_schedule /
+ * hostapi_click_schedule の予約(全体で 1 件、置き換え型。以下 legacy)を
+ * 時刻順の最小ヒープ 1 本で持つ。同時刻は積んだ順に発火する。各エントリは
+ * 予約時点のトーン定義をスナップショットで持つ。hostapi_sample_schedule の
+ * 予約も同じヒープに積む(sample >= 0。トーン定義の代わりにサンプルの
+ * ハンドルと level を持つ)。hostapi_note_on / note_off の予約も同じヒープに
+ * 積む(note != 0。pitch は freq_hz、velocity は level に入れる)。
+ * 時刻は µs(int64_t time_us)で持ち、ヒープもその順に並べる。ms の予約は
+ * ×1000 して入れ、µs の予約(hostapi_tone_enqueue_us 等)は aclock = 1 で
+ * 同じヒープに積む(hostapi_tsched_set_time_us)。
+ *
+ *   hostapi_tsched_push()          1 件積む(満杯なら false)
+ *   hostapi_tsched_push_sample()   サンプルの予約を 1 件積む(id は enqueue と共通)
+ *   hostapi_tsched_tone_entry() / sample_entry()
+ *                                  エントリだけ作る(時刻は hostapi_tsched_set_time_us)
+ *   hostapi_tsched_note_entry()    ノートの on / off のエントリを作る(予約は
+ *                                  時刻と id を入れて hostapi_tsched_insert)
+ *   hostapi_tsched_time_us() / time_ms()
+ *                                  発音時刻(ms は hostapi_now_ms 時基の u32)
+ *   hostapi_tsched_top()           最も早い 1 件(空なら NULL)
+ *   hostapi_tsched_pop()           最も早い 1 件を取り出す
+ *   hostapi_tsched_remove_id()     id 指定で取り消す(enqueue の予約)
+ *   hostapi_tsched_remove_seq()    seq 指定で取り除く(別スレッドの写しと揃える)
+ *   hostapi_tsched_find_legacy()   legacy 予約の位置(無ければ -1)
+ *
+ * legacy 予約は容量の 1 枠を常に確保しておき、enqueue の予約が
+ * HOSTAPI_TONE_QUEUE_MAX 件あっても置き換えられる。
+ * ここには排他が無い。1 本のヒープを触るのは常に 1 スレッドになるよう
+ * 呼び出し側で持ち主を決める:
+ *   Linux: 本体はオーディオコールバックの専有。wasm スレッドは写しを持って
+ *          同じ操作列を先に適用し、hostapi_acmd.h のチャネルで本体へ送る
+ *          (キューを出た通知で写しを揃える。hostapi_tsched_remove_seq)
+ *   実機:  portMUX の下で wasm スレッドと esp_timer タスクが触る
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "hostapi_defs.h"
+
+#define HOSTAPI_TSCHED_CAP (HOSTAPI_TONE_QUEUE_MAX + 1) /* + legacy 予約 1 枠 */
+
+typedef struct {
+    int64_t time_us;   /* 発音時刻(µs。ms の予約は hostapi_now_ms × 1000) */
+    uint32_t seq;      /* 積んだ順(同時刻の順序付け) */
+    int32_t id;        /* enqueue の予約 id(1..)。legacy 予約は 0 */
+    uint16_t freq_hz;  /* 予約時のトーン定義 */
+    uint16_t dur_ms;
+    uint8_t level;
+    int16_t sample;    /* サンプルのハンドル。トーンは -1 */
+    uint8_t note;      /* HOSTAPI_TSCHED_NOTE_*(0 はトーン / サンプル) */
+    uint8_t note_ch;   /* ノートのチャネル */
+    uint8_t note_env;  /* ノートのエンベロープ slot */
+    uint8_t aclock;    /* µs の予約(hostapi_now_us64 時基。音声クロックだけで発火する) */
+} hostapi_tsched_entry_t;
+
+enum { HOSTAPI_TSCHED_NOTE_ON = 1, HOSTAPI_TSCHED_NOTE_OFF = 2 };
+
+typedef struct {
+    hostapi_tsched_entry_t e[HOSTAPI_TSCHED_CAP];
+    int count;
+    int queued;        /* enqueue の予約数(legacy を除く) */
+    uint32_t seq;
+    int32_t next_id;
+} hostapi_tsched_t;
+
+static inline void hostapi_tsched_clear(hostapi_tsched_t* q)
+{
+    q->count = 0;
+    q->queued = 0;
+}
+
+/* 全消去して id も 1 から振り直す(アプリ起動・破棄時) */
+static inline void hostapi_tsched_reset(hostapi_tsched_t* q)
+{
+    hostapi_tsched_clear(q);
+    q->seq = 0;
+    q->next_id = 1;
+}
+
+static inline bool hostapi_tsched_before(const hostapi_tsched_entry_t* a,
+                                         const hostapi_tsched_entry_t* b)
+{
+    if (a->time_us != b->time_us) return a->time_us < b->time_us;
+    return (int32_t)(a->seq - b->seq) < 0;
+}
+
+static inline void hostapi_tsched_swap(hostapi_tsched_t* q, int i, int j)
+{
+    const hostapi_tsched_entry_t t = q->e[i];
+    q->e[i] = q->e[j];
+    q->e[j] = t;
+}
+
+static inline void hostapi_tsched_sift_up(hostapi_tsched_t* q, int i)
+{
+    while (i > 0) {
+        const int p = (i - 1) / 2;
+        if (!hostapi_tsched_before(&q->e[i], &q->e[p])) break;
+        hostapi_tsched_swap(q, i, p);
+        i = p;
+    }
+}
+
+static inline void hostapi_tsched_sift_down(hostapi_tsched_t* q, int i)
+{
+    for (;;) {
+        const int l = i * 2 + 1;
+        const int r = l + 1;
+        int m = i;
+        if (l < q->count && hostapi_tsched_before(&q->e[l], &q->e[m])) m = l;
+        if (r < q->count && hostapi_tsched_before(&q->e[r], &q->e[m])) m = r;
+        if (m == i) break;
+        hostapi_tsched_swap(q, i, m);
+        i = m;
+    }
+}
+
+/* i 番目を取り除いてヒープを直す */
+static inline hostapi_tsched_entry_t hostapi_tsched_remove_at(hostapi_tsched_t* q, int i)
+{
+    const hostapi_tsched_entry_t out = q->e[i];
+    if (out.id != 0) q->queued--;
+    q->count--;
+    if (i != q->count) {
+        q->e[i] = q->e[q->count];
+        hostapi_tsched_sift_down(q, i);
+        hostapi_tsched_sift_up(q, i);
+    }
+    return out;
+}
+
+static inline bool hostapi_tsched_insert(hostapi_tsched_t* q, const hostapi_tsched_entry_t* src)
+{
+    if (src->id != 0 && q->queued >= HOSTAPI_TONE_QUEUE_MAX) return false;
+    if (q->count >= HOSTAPI_TSCHED_CAP) return false;
+    hostapi_tsched_entry_t* e = &q->e[q->count];
+    *e = *src;
+    e->seq = q->seq++;
+    if (e->id != 0) q->queued++;
+    hostapi_tsched_sift_up(q, q->count++);
+    return true;
+}
+
+/* トーン / サンプルのエントリ(時刻と id は 0。予約は入れてから
+ * hostapi_tsched_insert) */
+static inline hostapi_tsched_entry_t hostapi_tsched_tone_entry(uint16_t freq_hz, uint16_t dur_ms,
+                                                               uint8_t level)
+{
+    hostapi_tsched_entry_t e;
+    e.time_us = 0;
+    e.seq = 0;
+    e.id = 0;
+    e.freq_hz = freq_hz;
+    e.dur_ms = dur_ms;
+    e.level = level;
+    e.sample = -1;
+    e.note = 0;
+    e.note_ch = 0;
+    e.note_env = 0;
+    e.aclock = 0;
+    return e;
+}
+
+static inline hostapi_tsched_entry_t hostapi_tsched_sample_entry(int16_t sample, uint8_t level)
+{
+    hostapi_tsched_entry_t e = hostapi_tsched_tone_entry(0, 0, level);
+    e.sample = sample;
+    return e;
+}
+
+/* id は 0 なら legacy 予約、それ以外は hostapi_tsched_next_id() の値 */
+static inline bool hostapi_tsched_push(hostapi_tsched_t* q, uint32_t time_ms, int32_t id,
+                                       uint16_t freq_hz, uint16_t dur_ms, uint8_t level)
+{
+    hostapi_tsched_entry_t e = hostapi_tsched_tone_entry(freq_hz, dur_ms, level);
+    e.time_us = (int64_t)time_ms * 1000;
+    e.id = id;
+    return hostapi_tsched_insert(q, &e);
+}
+
+/* サンプルの予約。id は hostapi_tsched_next_id() の値(legacy 枠は使わない) */
+static inline bool hostapi_tsched_push_sample(hostapi_tsched_t* q, uint32_t time_ms, int32_t id,
+                                              int16_t sample, uint8_t level)
+{
+    hostapi_tsched_entry_t e = hostapi_tsched_sample_entry(sample, level);
+    e.time_us = (int64_t)time_ms * 1000;
+    e.id = id;
+    return hostapi_tsched_insert(q, &e);
+}
+
+/* ノートの on / off(op = HOSTAPI_TSCHED_NOTE_*)。即時なら時刻 / id は 0 の
+ * まま、予約なら入れてから積む(id は hostapi_tsched_next_id() の値) */
+static inline hostapi_tsched_entry_t hostapi_tsched_note_entry(uint8_t op, int ch, int env,
+                                                               int32_t pitch, int velocity)
+{
+    hostapi_tsched_entry_t e;
+    e.time_us = 0;
+    e.seq = 0;
+    e.id = 0;
+    e.freq_hz = (uint16_t)pitch;
+    e.dur_ms = 0;
+    e.level = (uint8_t)velocity;
+    e.sample = -1;
+    e.note = op;
+    e.note_ch = (uint8_t)ch;
+    e.note_env = (uint8_t)env;
+    e.aclock = 0;
+    return e;
+}
+
+/* 予約の時刻を µs で入れる。aclock は µs の API(hostapi_now_us64 時基)から
+ * 来たもの。time_us <= 0 は false */
+static inline bool hostapi_tsched_set_time_us(hostapi_tsched_entry_t* e, int64_t time_us,
+                                              bool aclock)
+{
+    if (time_us <= 0) return false;
+    e->time_us = time_us;
+    e->aclock = aclock;
+    return true;
+}
+
+static inline int64_t hostapi_tsched_time_us(const hostapi_tsched_entry_t* e)
+{
+    return e->time_us;
+}
+
+/* hostapi_now_ms 時基の ms(legacy 予約・発火済み時刻・キャプチャ用) */
+static inline uint32_t hostapi_tsched_time_ms(const hostapi_tsched_entry_t* e)
+{
+    return (uint32_t)(e->time_us / 1000);
+}
+
+/* enqueue の予約 id を払い出す(1..INT32_MAX を巡回。ゼロ初期化のままでも 1 から) */
+static inline int32_t hostapi_tsched_next_id(hostapi_tsched_t* q)
+{
+    const int32_t id = q->next_id > 0 ? q->next_id : 1;
+    q->next_id = (id == INT32_MAX) ? 1 : id + 1;
+    return id;
+}
+
+static inline const hostapi_tsched_entry_t* hostapi_tsched_top(const hostapi_tsched_t* q)
+{
+    return q->count > 0 ? &q->e[0] : (const hostapi_tsched_entry_t*)0;
+}
+
+static inline hostapi_tsched_entry_t hostapi_tsched_pop(hostapi_tsched_t* q)
+{
+    return hostapi_tsched_remove_at(q, 0);
+}
+
+static inline bool hostapi_tsched_remove_id(hostapi_tsched_t* q, int32_t id)
+{
+    for (int i = 0; i < q->count; i++) {
+        if (q->e[i].id == id) {
+            hostapi_tsched_remove_at(q, i);
+            return true;
+        }
+    }
+    return false;
+}
+
+/* seq は積んだ順で一意なので、同じ操作列を適用した写し同士で同じ予約を指せる */
+static inline bool hostapi_tsched_remove_seq(hostapi_tsched_t* q, uint32_t seq)
+{
+    for (int i = 0; i < q->count; i++) {
+        if (q->e[i].seq == seq) {
+            hostapi_tsched_remove_at(q, i);
+            return true;
+        }
+    }
+    return false;
+}
+
+static inline int hostapi_tsched_find_legacy(const hostapi_tsched_t* q)
+{
+    for (int i = 0; i < q->count; i++) {
+        if (q->e[i].id == 0) return i;
+    }
+    return -1;
+}
+
+/* legacy 予約を t に置き換える(hostapi_tone_schedule の契約)。
+ * t <= *last_fired なら何もせず false(冪等な再予約)。置き換える legacy 予約が
+ * 期限到来済みで未発火なら(タイマ/コールバックより先に再予約が来た)、
+ * 破棄せず *old に取り出し、発音済み扱いにして *has_old = true を返す。
+ * 呼び出し側はそれを直ちに発音する。 */
+static inline bool hostapi_tsched_set_legacy(hostapi_tsched_t* q, uint32_t t, uint32_t now,
+                                             uint32_t* last_fired, uint16_t freq_hz,
+                                             uint16_t dur_ms, uint8_t level,
+                                             hostapi_tsched_entry_t* old, bool* has_old)
+{
+    *has_old = false;
+    *old = hostapi_tsched_tone_entry(0, 0, 0); /* 取り出さなかったときも未定義にしない */
+    if (t <= *last_fired) return false;
+    const int i = hostapi_tsched_find_legacy(q);
+    if (i >= 0) {
+        const hostapi_tsched_entry_t prev = hostapi_tsched_remove_at(q, i);
+        const uint32_t prev_ms = hostapi_tsched_time_ms(&prev);
+        if (prev_ms != t && prev_ms <= now && prev_ms > *last_fired) {
+            *last_fired = prev_ms;
+            *old = prev;
+            *has_old = true;
+        }
+    }
+    hostapi_tsched_push(q, t, 0, freq_hz, dur_ms, level); /* legacy 枠は常に空いている */
+    return true;
+}
+
+static inline void hostapi_tsched_cancel_legacy(hostapi_tsched_t* q)
+{
+    const int i = hostapi_tsched_find_legacy(q);
+    if (i >= 0) hostapi_tsched_remove_at(q, i);
+}
@@ -0,0 +1,237 @@
+/*
+ * トーンのポリフォニー発音エンジン(実機 ESP32 ホストと Linux ホストで共有)。
+ *
+ * hostapi_tone_* の減衰サインを最大 HOSTAPI_VOICE_MAX 声まで重ねて鳴らす。
+ * 各ボイスはテーブルを持たない再帰振動子(回転行列)で、サンプルごとの libm
+ * 呼び出しは無い。発音時にトーン固有 level とマスター音量を振幅へ焼き込む
+ * (ボイスごとのゲイン)。1 声ぶんの発振カーネル(float 参照 / Q31 / Q31 SIMD)
+ * は hostapi_osc.h。既定は使える中で最速のもの(hostapi_osc_best)。
+ *
+ *   hostapi_voices_init()    使う声数(1..HOSTAPI_VOICE_MAX)を決めて全消音
+ *   hostapi_voices_set_kernel()  発振カーネルを切り替える(全消音)
+ *   hostapi_voices_start()   1 声発音。空きが無ければ最も小さい(減衰が進んだ)
+ *                            声を奪う
+ *   hostapi_voices_render()  frames フレームを 16bit ステレオで書く(上書き)。
+ *                            各声は int32 で積算し、最後に int16 へ飽和させる
+ *   hostapi_voices_accum()   int32 の積算バッファへ加算するだけ(出力ミキサ
+ *                            hostapi_mix.h が MP3 と混ぜるときに使う)
+ *   hostapi_voices_set_cache()   レンダ済みトーンのキャッシュ(hostapi_tcache.h)
+ *                            を付ける。以後の発音はキャッシュに入る限り PCM の
+ *                            再生(音量倍して積算するだけ)になり、発振しない
+ *   hostapi_voices_prepare() 発音せずにキャッシュへ描いておく(tone_define 時)
+ *
+ * 状態はレンダリングする側(Linux: SDL オーディオコールバック、実機: トーン
+ * タスク)だけが触る前提で、排他は呼び出し側の責任。
+ */
+#pragma once
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "hostapi_osc.h"
+#include "hostapi_tcache.h"
+
+#define HOSTAPI_VOICE_MAX 16      /* 声数の上限(配列サイズ) */
+#define HOSTAPI_VOICE_DEFAULT 8   /* 既定の声数 */
+#define HOSTAPI_VOICE_FULL_SCALE 12000.0f /* level 100・音量 100 の振幅 */
+#define HOSTAPI_VOICE_CHUNK 128   /* render の積算バッファ(フレーム) */
+
+/* キャッシュ再生中の声(remaining は hostapi_voice_t 側で数える) */
+typedef struct {
+    int entry;          /* キャッシュの枠。-1 は発振 */
+    int32_t pos;        /* 次に読むフレーム */
+    int32_t gain;       /* マスター音量(Q15) */
+    float amp;          /* 発音時の振幅(奪う声の選択用) */
+} hostapi_voice_pcm_t;
+
+typedef struct {
+    hostapi_voice_t v[HOSTAPI_VOICE_MAX];
+    hostapi_voice_pcm_t p[HOSTAPI_VOICE_MAX];
+    hostapi_tcache_t* cache; /* NULL ならキャッシュ無し(常に発振) */
+    int nvoices;        /* 使う声数 */
+    int kernel;         /* HOSTAPI_OSC_* */
+    int active;         /* 発音中の声数 */
+    uint32_t stolen;    /* 奪った回数(診断用) */
+} hostapi_voices_t;
+
+/* キャッシュ再生を終えた(または奪われた)声の枠を返す */
+static inline void hostapi_voices_release(hostapi_voices_t* vs, int i)
+{
+    if (vs->p[i].entry >= 0) {
+        vs->cache->e[vs->p[i].entry].users--;
+        vs->p[i].entry = -1;
+    }
+}
+
+static inline void hostapi_voices_init(hostapi_voices_t* vs, int nvoices)
+{
+    memset(vs, 0, sizeof(*vs));
+    if (nvoices < 1) nvoices = 1;
+    if (nvoices > HOSTAPI_VOICE_MAX) nvoices = HOSTAPI_VOICE_MAX;
+    vs->nvoices = nvoices;
+    vs->kernel = hostapi_osc_best();
+    for (int i = 0; i < HOSTAPI_VOICE_MAX; i++) vs->p[i].entry = -1;
+}
+
+/* 全消音(声数と診断カウンタは保つ) */
+static inline void hostapi_voices_reset(hostapi_voices_t* vs)
+{
+    for (int i = 0; i < HOSTAPI_VOICE_MAX; i++) {
+        vs->v[i].remaining = 0;
+        hostapi_voices_release(vs, i);
+    }
+    vs->active = 0;
+}
+
+/* 使えない SIMD を指定したら Q31 スカラにする。キャッシュは描き直しになる */
+static inline void hostapi_voices_set_kernel(hostapi_voices_t* vs, int kernel)
+{
+    if (kernel == HOSTAPI_OSC_Q31_SIMD && !hostapi_osc_simd_supported()) kernel = HOSTAPI_OSC_Q31;
+    hostapi_voices_reset(vs);
+    vs->kernel = kernel;
+    if (vs->cache) hostapi_tcache_clear(vs->cache);
+}
+
+/* キャッシュを付け替える(NULL で外す)。全消音。中身はカーネルに合わせて捨てる */
+static inline void hostapi_voices_set_cache(hostapi_voices_t* vs, hostapi_tcache_t* cache)
+{
+    hostapi_voices_reset(vs);
+    vs->cache = cache;
+    if (cache) hostapi_tcache_clear(cache);
+}
+
+/* i 番の声の今の振幅(奪う声の選択用) */
+static inline float hostapi_voices_amp(const hostapi_voices_t* vs, int i)
+{
+    const hostapi_voice_pcm_t* p = &vs->p[i];
+    if (p->entry < 0) return hostapi_osc_amp(vs->kernel, &vs->v[i]);
+    /* キャッシュの包絡は exp(-3.5 t / total)。奪うときにしか呼ばれない */
+    const int32_t total = vs->cache->e[p->entry].frames;
+    return p->amp * expf(-3.5f * (float)p->pos / (float)total);
+}
+
+/* 発音と同じ w / 振幅 / 長さで、定義に対応するキャッシュの枠を引く(無ければ
+ * 描く)。キャッシュが無い・入らなければ -1 */
+static inline int hostapi_voices_lookup(hostapi_voices_t* vs, int rate, uint16_t freq_hz,
+                                        uint16_t dur_ms, uint8_t level)
+{
+    const int32_t total = (int32_t)rate * dur_ms / 1000;
+    if (!vs->cache || total <= 0) return -1;
+    const float w = 2.0f * (float)M_PI * (float)freq_hz / (float)rate;
+    return hostapi_tcache_get(vs->cache, vs->kernel, rate, freq_hz, dur_ms, level, w,
+                              HOSTAPI_VOICE_FULL_SCALE * level / 100.0f, total);
+}
+
+/* 発音せずにキャッシュへ描いておく(最初の発音で描く手間を前倒しする)。
+ * キャッシュに入ったら true */
+static inline bool hostapi_voices_prepare(hostapi_voices_t* vs, int rate, uint16_t freq_hz,
+                                          uint16_t dur_ms, uint8_t level)
+{
+    return hostapi_voices_lookup(vs, rate, freq_hz, dur_ms, level) >= 0;
+}
+
+/* 発音開始。level / volume は 0..100。声を奪ったら true */
+static inline bool hostapi_voices_start(hostapi_voices_t* vs, int rate, uint16_t freq_hz,
+                                        uint16_t dur_ms, uint8_t level, int volume)
+{
+    const int32_t total = (int32_t)rate * dur_ms / 1000;
+    if (total <= 0) return false;
+
+    /* 空きを探す。無ければ最も振幅の小さい声(指数減衰なので概ね最古)を奪う */
+    int slot = -1;
+    int quietest = 0;
+    float quietest_amp = 0.0f;
+    for (int i = 0; i < vs->nvoices; i++) {
+        if (vs->v[i].remaining == 0) {
+            slot = i;
+            break;
+        }
+        const float amp = hostapi_voices_amp(vs, i);
+        if (i == 0 || amp < quietest_amp) {
+            quietest = i;
+            quietest_amp = amp;
+        }
+    }
+    const bool steal = (slot < 0);
+    if (steal) {
+        slot = quietest;
+        hostapi_voices_release(vs, slot);
+        vs->stolen++;
+    } else {
+        vs->active++;
+    }
+
+    hostapi_voice_t* v = &vs->v[slot];
+    hostapi_voice_pcm_t* p = &vs->p[slot];
+    const float amp = HOSTAPI_VOICE_FULL_SCALE * level / 100.0f * volume / 100.0f;
+    p->entry = hostapi_voices_lookup(vs, rate, freq_hz, dur_ms, level);
+    if (p->entry >= 0) {
+        /* レンダ済み(音量 100)を音量倍して流すだけ */
+        vs->cache->e[p->entry].users++;
+        v->remaining = total;
+        p->pos = 0;
+        p->gain = volume * 32768 / 100;
+        p->amp = amp;
+        return steal;
+    }
+
+    /* w は float 版の従来出力と合わせて float で求める */
+    const float w = 2.0f * (float)M_PI * (float)freq_hz / (float)rate;
+    hostapi_osc_start(v, w, amp, total);
+    return steal;
+}
+
+/* キャッシュ再生中の声を acc へ n フレーム加算する */
+static inline void hostapi_voices_accum_pcm(hostapi_voices_t* vs, int i, int32_t* acc, int n)
+{
+    hostapi_voice_pcm_t* p = &vs->p[i];
+    const int16_t* src = hostapi_tcache_pcm(vs->cache, p->entry) + p->pos;
+    const int32_t g = p->gain;
+    if (g == 32768) {
+        for (int j = 0; j < n; j++) acc[j] += src[j];
+    } else {
+        for (int j = 0; j < n; j++) acc[j] += (src[j] * g + 16384) >> 15;
+    }
+    p->pos += n;
+    vs->v[i].remaining -= n;
+    if (vs->v[i].remaining == 0) hostapi_voices_release(vs, i);
+}
+
+/* 全声を acc(モノラル int32、n フレーム)に加算する(クリア・飽和はしない) */
+static inline void hostapi_voices_accum(hostapi_voices_t* vs, int32_t* acc, int n)
+{
+    for (int i = 0; i < vs->nvoices; i++) {
+        hostapi_voice_t* v = &vs->v[i];
+        if (v->remaining == 0) continue;
+        const int k = v->remaining < n ? v->remaining : n;
+        if (vs->p[i].entry >= 0) hostapi_voices_accum_pcm(vs, i, acc, k);
+        else hostapi_osc_mix(vs->kernel, v, acc, k);
+        if (v->remaining == 0) vs->active--;
+    }
+}
+
+/* out(16bit ステレオ interleaved)へ frames フレームを書く。無音部分も 0 で埋める */
+static inline void hostapi_voices_render(hostapi_voices_t* vs, int16_t* out, int frames)
+{
+    int32_t acc[HOSTAPI_VOICE_CHUNK];
+    while (frames > 0) {
+        const int n = frames < HOSTAPI_VOICE_CHUNK ? frames : HOSTAPI_VOICE_CHUNK;
+        if (vs->active == 0) {
+            memset(out, 0, (size_t)n * 2 * sizeof(int16_t));
+        } else {
+            memset(acc, 0, sizeof(acc));
+            hostapi_voices_accum(vs, acc, n);
+            for (int i = 0; i < n; i++) {
+                int32_t a = acc[i];
+                if (a > 32767) a = 32767;
+                else if (a < -32768) a = -32768;
+                out[i * 2] = (int16_t)a;
+                out[i * 2 + 1] = (int16_t)a;
+            }
+        }
+        out += n * 2;
+        frames -= n;
+    }
+}
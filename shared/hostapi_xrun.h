@@ -0,0 +1,125 @@
+/*
+ * 出力の取りこぼし(アンダーラン)の検出と、発音の DAC 時刻の見積もり
+ * (Linux ホストのオーディオコールバックと bench_xrun で共有)。
+ *
+ * SDL はデバイスが描き遅れを無音で埋めても知らせない。ここではコールバックの
+ * 入口の壁時計と、それまでに描いたフレーム数の時間のずれ
+ *     lag = wall_us - samples / rate
+ * を見る。デバイスが間に合っている間 lag は一定の幅(バックエンドがまとめて
+ * 呼ぶ・スケジューラの揺れ)に収まり、取りこぼすと無音のぶん増えたまま戻らない。
+ *
+ *   - 基準 base は lag の最小(小さい lag が来たらそこへ下げる)。壁時計と
+ *     デバイスのクロックのずれ(数十 ppm)に付いていくため、lag の差の
+ *     1/2^HOSTAPI_XRUN_TRACK_SHIFT(最低 1µs)ずつ上へも寄せる
+ *   - 最初の HOSTAPI_XRUN_LEARN_US は幅 allow(base からの差の最大)を学ぶだけ
+ *   - 以後、差が allow + 周期/2 を超えたら疑い、allow + 2 周期のあいだ差の
+ *     最小を見る。最小が周期/2 を超えたまま(戻らない)なら取りこぼしとして
+ *     数え、その最小を失った時間として base を上げる。戻れば(デバイスの
+ *     バッファが吸収した一時的な遅れ)数えない
+ *
+ * DAC 時刻の見積もりは base(デバイスがデータを要求した時刻の代表値)から
+ *     dac_us(sample) = sample / rate + base + out_latency_us
+ * out_latency_us(要求されてから鳴るまで。SDL からは取れない)は呼び出し側が
+ * 与える。予約の時刻との差を hostapi_xrun_lat_t に集める。
+ *
+ * 書くのはコールバック 1 スレッドだけ。カウンタを別スレッドから読むのは
+ * 目安(atomic でなく、表示用)。
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#define HOSTAPI_XRUN_LEARN_US 1000000 /* 幅を学ぶ時間 */
+#define HOSTAPI_XRUN_TRACK_SHIFT 12   /* base を上へ寄せる速さ */
+
+typedef struct {
+    uint32_t rate;
+    uint32_t period_us;       /* コールバック 1 回ぶん */
+    bool started;
+    int64_t base_us;
+    int64_t allow_us;
+    int64_t learn_until_us;
+    bool suspect;             /* 疑い中 */
+    int64_t suspect_until_us;
+    int64_t suspect_min_us;   /* 疑い中の base からの差の最小 */
+    uint32_t xruns;
+    uint64_t lost_us;         /* 失った時間の合計(推定) */
+} hostapi_xrun_t;
+
+static inline void hostapi_xrun_init(hostapi_xrun_t* x, uint32_t rate, uint32_t period_frames)
+{
+    memset(x, 0, sizeof(*x));
+    x->rate = rate;
+    x->period_us = (uint32_t)((uint64_t)period_frames * 1000000 / rate);
+}
+
+/* コールバックの入口で呼ぶ。wall_us は壁時計、samples はそれまでに描いた
+ * フレーム数。取りこぼしを確定したらその長さ(µs、推定)、無ければ 0 */
+static inline uint32_t hostapi_xrun_update(hostapi_xrun_t* x, int64_t wall_us, uint64_t samples)
+{
+    const int64_t lag = wall_us - (int64_t)(samples * 1000000 / x->rate);
+    if (!x->started) {
+        x->started = true;
+        x->base_us = lag;
+        x->learn_until_us = wall_us + HOSTAPI_XRUN_LEARN_US;
+        return 0;
+    }
+    if (lag < x->base_us) x->base_us = lag;
+    const int64_t d = lag - x->base_us;
+    /* 切り上げ(差が小さくても 1µs は寄せる。下がりすぎは上の最小で戻る) */
+    x->base_us += (d + (1 << HOSTAPI_XRUN_TRACK_SHIFT) - 1) >> HOSTAPI_XRUN_TRACK_SHIFT;
+    if (wall_us < x->learn_until_us) {
+        if (d > x->allow_us) x->allow_us = d;
+        return 0;
+    }
+    const int64_t half = x->period_us / 2;
+    if (!x->suspect) {
+        if (d <= x->allow_us + half) return 0;
+        x->suspect = true;
+        x->suspect_until_us = wall_us + x->allow_us + 2 * (int64_t)x->period_us;
+        x->suspect_min_us = d;
+        return 0;
+    }
+    if (d < x->suspect_min_us) x->suspect_min_us = d;
+    if (x->suspect_min_us <= half) { /* 戻った: デバイスのバッファが吸収した */
+        x->suspect = false;
+        return 0;
+    }
+    if (wall_us < x->suspect_until_us) return 0;
+    x->suspect = false;
+    const int64_t lost = x->suspect_min_us;
+    x->base_us += lost;
+    x->xruns++;
+    x->lost_us += (uint64_t)lost;
+    return (uint32_t)lost;
+}
+
+/* フレーム sample が DAC から出る時刻(wall_us と同じ時基、推定) */
+static inline int64_t hostapi_xrun_dac_us(const hostapi_xrun_t* x, uint64_t sample,
+                                          uint32_t out_latency_us)
+{
+    return (int64_t)(sample * 1000000 / x->rate) + x->base_us + out_latency_us;
+}
+
+/* 予約の時刻に対する DAC 時刻の遅れ(µs、負 = 早い)の集計 */
+typedef struct {
+    uint32_t count;
+    int64_t min_us;
+    int64_t max_us;
+    int64_t sum_us;
+} hostapi_xrun_lat_t;
+
+static inline void hostapi_xrun_lat_reset(hostapi_xrun_lat_t* l)
+{
+    memset(l, 0, sizeof(*l));
+}
+
+static inline void hostapi_xrun_lat_add(hostapi_xrun_lat_t* l, int64_t late_us)
+{
+    if (l->count == 0 || late_us < l->min_us) l->min_us = late_us;
+    if (l->count == 0 || late_us > l->max_us) l->max_us = late_us;
+    l->sum_us += late_us;
+    l->count++;
+}
@@ -1,10 +1,28 @@
 // Includes (kept minimal since header pulls most deps)
 #include "audio.hpp"
 #include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
+#if CONFIG_MIDIBOX_NATIVE_BENCH
+#include "esp_cpu.h"
+#endif
 #include "driver/i2s_std.h"
+#if HAVE_ESP_AUDIO_PLAYER
+#include "freertos/stream_buffer.h"
+#include "mp3dec.h"
+#endif
 #include <cstring>
 #include <cstdio>
 #include <cmath>
+#include <mutex>
+#include <strings.h>
+#include "hostapi_aclock.h"
+#include "hostapi_levels.h"
+#include "hostapi_mix.h"
+#include "hostapi_mp3idx.h"
+#include "hostapi_sample.h"
+#include "hostapi_stream.h"
+#include "hostapi_voice.h"
 
 namespace audio {
 
@@ -59,6 +77,12 @@ bool Mp3Player::init(uint32_t sample_rate_hz, uint8_t bits, bool stereo) noexcep
     return true;
 }
 
+// I2S の DMA リング。トーンタスクがディスクリプタ 1 本(kChunkFrames)ずつ
+// 常に書き続けるので、本数(Kconfig)がそのまま発音までの遅延になる
+constexpr int kChunkFrames = 240;
+constexpr int kDmaDescs = CONFIG_MIDIBOX_AUDIO_DMA_DESCS;
+static_assert(kDmaDescs >= 2 && kDmaDescs <= 8, "MIDIBOX_AUDIO_DMA_DESCS out of range");
+
 bool Mp3Player::ensure_i2s(uint32_t rate_hz, uint8_t bits, bool stereo) noexcept {
     if (tx_) {
         i2s_data_bit_width_t bw = (bits == 32) ? I2S_DATA_BIT_WIDTH_32BIT : I2S_DATA_BIT_WIDTH_16BIT;
@@ -66,7 +90,9 @@ bool Mp3Player::ensure_i2s(uint32_t rate_hz, uint8_t bits, bool stereo) noexcept
         return reconfig_rate(rate_hz, (uint32_t)bw, sm);
     }
     i2s_chan_config_t chan_cfg = I2S_CHANNEL_DEFAULT_CONFIG(I2S_NUM_0, I2S_ROLE_MASTER);
-    chan_cfg.auto_clear = true;
+    chan_cfg.dma_desc_num = kDmaDescs;
+    chan_cfg.dma_frame_num = kChunkFrames;
+    chan_cfg.auto_clear = true; // トーンタスクが止められたときだけ効く保険
     if (i2s_new_channel(&chan_cfg, &tx_, &rx_) != ESP_OK) {
         ESP_LOGE(TAG, "i2s_new_channel failed");
         return false;
@@ -104,30 +130,445 @@ bool Mp3Player::init_i2s_only(uint32_t sample_rate_hz, uint8_t bits, bool stereo
 // 二重クリック対策(Phase 7B fix): i2s_channel_write 直書きだと、クリック終端の
 // DMA アンダーフロー時に auto_clear とプリフェッチが競合し、クリック先頭が入った
 // 古いディスクリプタが 1 本再生される(実測: 全拍の ~25% で 26-27ms 後に再発音)。
-// 対策はゼロパディング書き込み(下記)で、それがブロッキングになるため専用タスク化。
+// 専用タスクが無音も含めて DMA リングを埋め続け、アンダーフロー自体を起こさない。
 bool Mp3Player::play_click() noexcept {
     return play_tone(1000, 30, 100); // v0 既定クリック
 }
 
 bool Mp3Player::play_tone(uint16_t freq_hz, uint16_t dur_ms, uint8_t level) noexcept {
     if (!tone_queue_) return false;
-    ToneMsg msg{freq_hz, dur_ms, level};
-    // 満杯(発音が密に重なった)ときは捨てる(v2 契約: 重なりはベストエフォート)
+    const ToneMsg msg = ToneMsg::make_tone(ToneMsg::Kind::kTone, freq_hz, dur_ms, level);
+    // 満杯(1 チャンクの間に声数を超える依頼が来た)ときは捨てる
+    return xQueueSend(tone_queue_, &msg, 0) == pdTRUE;
+}
+
+bool Mp3Player::play_sample(int handle, uint8_t level) noexcept {
+    if (!tone_queue_) return false;
+    const ToneMsg msg = ToneMsg::make_sample((int16_t)handle, level);
     return xQueueSend(tone_queue_, &msg, 0) == pdTRUE;
 }
 
+// 停止は取りこぼせないので、キューが空くまで少し待つ
+void Mp3Player::stop_samples() noexcept {
+    if (!tone_queue_) return;
+    const ToneMsg msg = ToneMsg::make(ToneMsg::Kind::kStopSamples);
+    if (xQueueSend(tone_queue_, &msg, pdMS_TO_TICKS(20)) != pdTRUE) {
+        ESP_LOGW(TAG, "sample: stop request dropped");
+    }
+}
+
+// トーン定義をキャッシュへ描く依頼。取りこぼしても最初の発音時に描かれる
+// だけなので待たない
+bool Mp3Player::prepare_tone(uint16_t freq_hz, uint16_t dur_ms, uint8_t level) noexcept {
+    if (!tone_queue_) return false;
+    const ToneMsg msg =
+        ToneMsg::make_tone(ToneMsg::Kind::kPrepareTone, freq_hz, dur_ms, level);
+    return xQueueSend(tone_queue_, &msg, 0) == pdTRUE;
+}
+
+// ノートの on / off はトーンと同じく満杯なら捨てる(esp_timer タスクから
+// 呼ばれるので待たない)
+bool Mp3Player::note_on(uint8_t ch, uint8_t env_slot, uint16_t pitch, uint8_t velocity) noexcept {
+    if (!tone_queue_) return false;
+    const ToneMsg msg = ToneMsg::make_note(ToneMsg::Kind::kNoteOn, ch, env_slot, pitch, velocity);
+    return xQueueSend(tone_queue_, &msg, 0) == pdTRUE;
+}
+
+bool Mp3Player::note_off(uint8_t ch) noexcept {
+    if (!tone_queue_) return false;
+    const ToneMsg msg = ToneMsg::make_note(ToneMsg::Kind::kNoteOff, ch);
+    return xQueueSend(tone_queue_, &msg, 0) == pdTRUE;
+}
+
+// 定義は後続の note_on より先に届かないと意味が無いので、キューが空くまで待つ
+bool Mp3Player::note_define(uint8_t slot, uint16_t attack_ms, uint16_t decay_ms,
+                            uint8_t sustain, uint16_t release_ms) noexcept {
+    if (!tone_queue_) return false;
+    const ToneMsg msg = ToneMsg::make_env(slot, attack_ms, decay_ms, sustain, release_ms);
+    return xQueueSend(tone_queue_, &msg, pdMS_TO_TICKS(20)) == pdTRUE;
+}
+
+void Mp3Player::reset_notes() noexcept {
+    if (!tone_queue_) return;
+    const ToneMsg msg = ToneMsg::make(ToneMsg::Kind::kNoteReset);
+    if (xQueueSend(tone_queue_, &msg, pdMS_TO_TICKS(20)) != pdTRUE) {
+        ESP_LOGW(TAG, "note: reset request dropped");
+    }
+}
+
+// 同時発音数(Kconfig)。発音依頼キューは声数(トーン + サンプル)とノートの
+// チャネル数を足した深さにして、1 チャンクの間に来た和音を取りこぼさない
+constexpr int kToneVoices = CONFIG_MIDIBOX_TONE_VOICES;
+static_assert(kToneVoices >= 1 && kToneVoices <= HOSTAPI_VOICE_MAX,
+              "MIDIBOX_TONE_VOICES out of range");
+constexpr int kToneQueueDepth = kToneVoices + HOSTAPI_SAMPLE_VOICES + HOSTAPI_NOTE_CHANNELS;
+
+// サンプルキャッシュ(Kconfig)。アリーナは最初の Sample_Load で PSRAM から
+// 確保し、以後解放しない(アプリ破棄では巻き戻すだけ)。内部 SRAM には置かない
+constexpr uint32_t kSampleCacheBytes = CONFIG_MIDIBOX_SAMPLE_CACHE_KB * 1024u;
+
+// 発振カーネル(Kconfig)。S3 の PIE は 16bit レーンの乗算しか無く、Q15 の
+// 再帰振動子は 100ms 級のトーンで振幅が持たないため、Q31 はスカラ(MULSH)
+#if CONFIG_MIDIBOX_TONE_KERNEL_FLOAT
+constexpr int kToneKernel = HOSTAPI_OSC_FLOAT;
+#else
+constexpr int kToneKernel = HOSTAPI_OSC_Q31;
+#endif
+
+// レンダ済みトーンのキャッシュ(Kconfig)。1 枠 100ms ぶん(~8.6KB)を BSS に
+// 持つ。同じ定義の発音は発振せずに PCM を音量倍して積算するだけになる
+constexpr int kToneCacheEntries = CONFIG_MIDIBOX_TONE_CACHE_ENTRIES;
+static_assert(kToneCacheEntries >= 0 && kToneCacheEntries <= HOSTAPI_TCACHE_MAX_ENTRIES,
+              "MIDIBOX_TONE_CACHE_ENTRIES out of range");
+
 // タスクスタック等は静的確保(BSS)。ヒープから取ると最大連続ブロックを
 // 分断して WASM の linear memory 確保(~20KB 連続)を壊すため(6B の教訓)。
-static uint8_t s_click_stack[4096];
+// トーンタスクは出力経路を丸ごとこのスタックで回す: hostapi_mix_render の
+// 作業域(~1.5KB)+ 声・ノートの描画 + i2s_write + ESP_LOG(vprintf で ~1KB)。
+// 大きいチャンクバッファは下の静的領域に置き、余裕は NATIVE_BENCH の
+// 最小空き(uxTaskGetStackHighWaterMark)で確かめる
+static uint8_t s_click_stack[6144];
 static StaticTask_t s_click_tcb;
-static uint8_t s_tone_queue_buf[4 * sizeof(Mp3Player::ToneMsg)];
+static uint8_t s_tone_queue_buf[kToneQueueDepth * sizeof(Mp3Player::ToneMsg)];
 static StaticQueue_t s_tone_queue_cb;
+static hostapi_voices_t s_voices; // トーンタスク専有
+static hostapi_tcache_t s_tone_cache; // 同上(描くのも引くのもトーンタスク)
+static int16_t s_tone_cache_pcm[(kToneCacheEntries ? kToneCacheEntries : 1) *
+                                HOSTAPI_TCACHE_ENTRY_FRAMES(HOSTAPI_MIX_RATE)];
+static hostapi_mix_t s_mix;       // 同上(ゲインだけは set_volume から)
+static hostapi_splayer_t s_splayer; // トーンタスク専有
+static hostapi_notes_t s_notes;     // 同上(エンベロープの定義もキュー経由)
+static hostapi_sample_cache_t s_samples; // 追加・巻き戻しは wasm スレッド、発音はトーンタスク
+static bool s_samples_ready;             // アリーナ確保を試みた(wasm スレッドのみ)
+
+#if HAVE_ESP_AUDIO_PLAYER
+// MP3 → トーンタスクの受け渡し。write_fn(audio_player タスク)が 44.1kHz
+// ステレオへリサンプルして積み、トーンタスクが DMA ディスクリプタ単位で取り出して
+// トーンと混ぜる。満杯なら write_fn がブロックするので、デコードの歩調も I2S の
+// 消費で決まる。深さ ~23ms
+constexpr int kMusicRingFrames = 1024;
+static uint8_t s_music_sb_buf[kMusicRingFrames * 4 + 1];
+static StaticStreamBuffer_t s_music_sb_cb;
+static StreamBufferHandle_t s_music_sb;
+static hostapi_resamp_t s_resamp;           // audio_player タスク専有
+static int16_t s_resamp_out[256 * 2];       // 同上
+static std::atomic<bool> s_music_live{false}; // デコード中(途中のデータは揃うまで待つ)
+static uint32_t s_music_underruns;          // デコード中に 1 チャンク揃わなかった回数(診断用)
+static std::atomic<uint32_t> s_music_tx{0}; // リングへ積んだバイト数(write_fn)
+static uint32_t s_music_rx;                 // リングから取ったバイト数(トーンタスク)
+// 曲の切り替えの継ぎ目(music_bridge_arm)。次の曲の頭を先読みでデコードして
+// おいた PCM を、前の曲の最後のバイト(s_bridge_at)の直後にトーンタスクが
+// 差し込む。その間に audio_player が次の曲を開いて頭からデコードし直し、
+// 先読みと同じぶんは write_fn で捨てる。リング(~23ms)より長い立ち上がりも
+// 無音にならない
+constexpr uint32_t kPreMs = 100;            // audio_player が次の曲の PCM を出すまでの見込み
+constexpr int kPreCapFrames = HOSTAPI_MIX_RATE * 120 / 1000;
+static int16_t* s_bridge_pcm;               // PSRAM(kPreCapFrames)。書くのは audio_player タスク
+static uint32_t s_bridge_frames;            // 同上(公開は s_bridge_armed)
+static uint32_t s_bridge_at;                // 同上
+static uint32_t s_bridge_pos;               // トーンタスク(渡す前に audio_player タスクが 0 に)
+static std::atomic<bool> s_bridge_armed{false};
+static hostapi_resamp_t s_resamp_carry;     // 先読みの続きのリサンプラ(audio_player タスク)
+static bool s_resamp_carry_pending;         // 同上
+#endif
+// 開始時刻の指定(hostapi_audio_play_at)。kGateHold の間トーンタスクは MP3 を
+// 取り出さず、write_fn は満杯で待つ(デコーダは 1 リングぶん先まで進んで
+// 止まる = プライム)。s_music_start_ms(now_ms の時基)を過ぎたチャンクから
+// 取り出す。kGateDrop はトーンタスクがリングの中身を捨て続ける(取り消し・
+// 前の曲の残りの掃除)
+enum : uint8_t { kGateNone, kGateHold, kGateDrop };
+static std::atomic<uint8_t> s_music_gate{kGateNone};
+static std::atomic<uint32_t> s_music_start_ms{0};
+static int16_t s_music_chunk[kChunkFrames * 2]; // トーンタスク専有
+static int16_t s_out_chunk[kChunkFrames * 2];   // 同上(I2S へ書く 1 チャンク)
+static hostapi_stream_t s_stream;               // 同上
+// 出力のレベル(shared/hostapi_levels.h)。トーンタスクが I2S へ書く直前の
+// チャンクから公開し、FFT は読む側(wasm スレッド)が新しい窓ごとに 1 回
+static hostapi_levels_t s_levels;               // 書くのはトーンタスクだけ
+static hostapi_levels_fft_t* s_levels_fft;      // wasm スレッド(~14KB、PSRAM)
+// 描画位置と now_us64 の対応(shared/hostapi_aclock.h)。トーンタスクがチャンクの
+// 頭(依頼を取り込む時点)で公開する。esp_timer と I2S は同じ水晶なので
+// ずれは 0
+static hostapi_aclock_t s_aclock;
+static uint64_t s_out_frames;                   // トーンタスク専有
+
+// 曲のファイル。audio_player には fopencookie で包んだ FILE を渡し、読み出しの
+// 入口(audio_player タスク)でシークを差し込む(audio_player にはシークが
+// 無く、is_mp3 で先頭へ戻すので途中から開き直すこともできない)。
+// gen は曲ごとの通し番号(索引・シーク要求がどの曲のものか)
+struct MusicSource {
+    FILE* raw;
+    FILE* fp;       // audio_player へ渡す側(閉じると raw も閉じて自分を消す)
+    uint32_t gen;
+    char path[128];
+    // 先読み(queue_next で開いたときだけ。music_predecode)。曲の頭を
+    // 44.1kHz ステレオにした PCM と、そのためにデコードした曲のフレーム数、
+    // 終えた時点のリサンプラ
+    int16_t* pre;   // PSRAM(閉じるときに解放)
+    uint32_t pre_frames;
+    uint32_t pre_src_frames;
+    hostapi_resamp_t pre_resamp;
+};
+
+static std::atomic<uint32_t> s_music_gen_next{0};
+static std::atomic<uint32_t> s_music_gen{0};        // 鳴っている曲(0 = 無し)
+static std::atomic<uint64_t> s_seek_req{0};         // gen << 32 | ファイル位置(0 = 無し)
+static std::atomic<int32_t> s_seek_ms{0};           // s_seek_req の時刻
+static std::atomic<int32_t> s_pos_base_ms{0};       // 再生位置 = base + frames / rate
+static std::atomic<uint32_t> s_pos_frames{0};       // write_fn が数える(曲のレート)
+static std::atomic<uint32_t> s_pos_rate{44100};     // clk_set_fn が設定する
+static std::atomic<uint32_t> s_seek_drop{0};        // シーク直後に捨てるフレーム
+// シーク前の位置のままデコーダに残っている PCM(入力バッファ 1 つぶん)。
+// 捨てずに鳴らすと移った瞬間に前の位置が一瞬聞こえる
+constexpr uint32_t kSeekDropMs = 60;
+
+static ssize_t music_src_read(void* cookie, char* buf, size_t n)
+{
+    auto* src = static_cast<MusicSource*>(cookie);
+    uint64_t req = s_seek_req.load();
+    if (req != 0 && (uint32_t)(req >> 32) == src->gen &&
+        fseek(src->raw, (long)(uint32_t)req, SEEK_SET) == 0) {
+        s_pos_base_ms.store(s_seek_ms.load());
+        s_pos_frames.store(0);
+        s_seek_drop.store(s_pos_rate.load() * kSeekDropMs / 1000);
+        // 読んでいる間に次のシークが来ていれば、それは次の読み出しで移る
+        s_seek_req.compare_exchange_strong(req, 0);
+    }
+    return (ssize_t)fread(buf, 1, n, src->raw);
+}
+
+// off の型は libc で違う(newlib: _off_t、glibc: off64_t)
+template <typename Off>
+static int music_src_seek(void* cookie, Off* off, int whence)
+{
+    auto* src = static_cast<MusicSource*>(cookie);
+    if (fseek(src->raw, (long)*off, whence) != 0) return -1;
+    *off = (Off)ftell(src->raw);
+    return 0;
+}
+
+static int music_src_close(void* cookie)
+{
+    auto* src = static_cast<MusicSource*>(cookie);
+    const int r = fclose(src->raw);
+    heap_caps_free(src->pre);
+    delete src;
+    return r;
+}
+
+static MusicSource* music_open(const std::string& path)
+{
+    FILE* raw = fopen(path.c_str(), "rb");
+    if (!raw) return nullptr;
+    auto* src = new (std::nothrow) MusicSource{};
+    if (!src) { fclose(raw); return nullptr; }
+    src->raw = raw;
+    uint32_t gen = s_music_gen_next.fetch_add(1) + 1;
+    if (gen == 0) gen = s_music_gen_next.fetch_add(1) + 1;
+    src->gen = gen;
+    snprintf(src->path, sizeof(src->path), "%s", path.c_str());
+    cookie_io_functions_t io{};
+    io.read = music_src_read;
+    io.seek = music_src_seek;
+    io.close = music_src_close;
+    src->fp = fopencookie(src, "rb", io);
+    if (!src->fp) { fclose(raw); delete src; return nullptr; }
+    return src;
+}
+
+#if HAVE_ESP_AUDIO_PLAYER
+// 次の曲の頭を kPreMs ぶんデコードして src->pre に置く(wasm スレッド)。
+// audio_player と同じ helix を別に 1 個立て、ID3v2 の後の最初のフレームから
+// 同じ順にデコードするので、audio_player がデコードし直す PCM と一致する。
+// デコーダ(~25KB)と作業域は毎回作って捨てる(ビットリザーバを前の曲から
+// 持ち越さないため。同じ大きさの確保と解放なので断片化は残らない)。
+// 先読みできなくても曲は鳴る(継ぎ目に無音が入り得るだけ)
+static void music_predecode(MusicSource* src)
+{
+    struct Scratch {
+        uint8_t in[MAINBUF_SIZE * 2];
+        int16_t pcm[MAX_NCHAN * MAX_NGRAN * MAX_NSAMP];
+    };
+    auto* sc = static_cast<Scratch*>(heap_caps_malloc(sizeof(Scratch), MALLOC_CAP_SPIRAM));
+    src->pre = static_cast<int16_t*>(
+        heap_caps_malloc((size_t)kPreCapFrames * 4, MALLOC_CAP_SPIRAM));
+    HMP3Decoder dec = (sc && src->pre) ? MP3InitDecoder() : nullptr;
+    if (!dec) {
+        heap_caps_free(sc);
+        heap_caps_free(src->pre);
+        src->pre = nullptr;
+        ESP_LOGW(TAG, "predecode: no memory (next track starts without it)");
+        return;
+    }
+    FILE* f = src->raw;
+    uint8_t h[10];
+    long start = 0;
+    if (fread(h, 1, sizeof(h), f) == sizeof(h) && memcmp(h, "ID3", 3) == 0) {
+        start = 10 + ((long)(h[6] & 0x7f) << 21 | (long)(h[7] & 0x7f) << 14 |
+                      (long)(h[8] & 0x7f) << 7 | (long)(h[9] & 0x7f));
+        if (h[5] & 0x10) start += 10; // フッタ
+    }
+    fseek(f, start, SEEK_SET);
+    const uint32_t want = HOSTAPI_MIX_RATE * kPreMs / 1000;
+    uint8_t* p = sc->in;
+    int left = 0;
+    bool eof = false;
+    bool rs_ready = false;
+    while (src->pre_frames < want) {
+        if (left < MAINBUF_SIZE && !eof) {
+            memmove(sc->in, p, (size_t)left);
+            p = sc->in;
+            const size_t got = fread(sc->in + left, 1, sizeof(sc->in) - (size_t)left, f);
+            eof = got == 0;
+            left += (int)got;
+        }
+        const int off = MP3FindSyncWord(p, left);
+        if (off < 0) break;
+        p += off;
+        left -= off;
+        const int err = MP3Decode(dec, &p, &left, sc->pcm, 0);
+        if (err == ERR_MP3_MAINDATA_UNDERFLOW) continue; // 頭のフレーム(出力なし)
+        if (err != ERR_MP3_NONE) break;
+        MP3FrameInfo fi;
+        MP3GetLastFrameInfo(dec, &fi);
+        if (fi.nChans < 1 || fi.samprate <= 0) break;
+        if (!rs_ready) {
+            hostapi_resamp_init(&src->pre_resamp, (uint32_t)fi.samprate, HOSTAPI_MIX_RATE,
+                                fi.nChans);
+            rs_ready = true;
+        }
+        const int in_frames = fi.outputSamps / fi.nChans;
+        int used = 0;
+        src->pre_frames += (uint32_t)hostapi_resamp_process(
+            &src->pre_resamp, sc->pcm, in_frames, &used, src->pre + src->pre_frames * 2,
+            kPreCapFrames - (int)src->pre_frames);
+        src->pre_src_frames += (uint32_t)used;
+        if (used < in_frames) break; // 入りきらない(低いレートの曲)
+    }
+    MP3FreeDecoder(dec);
+    heap_caps_free(sc);
+    fseek(f, 0, SEEK_SET); // audio_player は頭から読む
+    if (src->pre_frames == 0) {
+        heap_caps_free(src->pre);
+        src->pre = nullptr;
+        src->pre_src_frames = 0;
+    }
+}
+
+// 曲の切り替え(audio_player タスク、IDLE)。前の曲はここまでに全部リングへ
+// 積んであるので、その末尾で先読みを鳴らすようトーンタスクへ渡す。
+// audio_player は同じ曲を頭からデコードし直すので、先読みしたフレームは
+// write_fn で捨て、リサンプラは先読みの続きから回す
+static void music_bridge_arm(const MusicSource* src)
+{
+    if (!src->pre || s_bridge_armed.load()) return; // 前の継ぎ目がまだ鳴っている
+    if (!s_bridge_pcm) {
+        s_bridge_pcm = static_cast<int16_t*>(
+            heap_caps_malloc((size_t)kPreCapFrames * 4, MALLOC_CAP_SPIRAM));
+        if (!s_bridge_pcm) return;
+    }
+    memcpy(s_bridge_pcm, src->pre, (size_t)src->pre_frames * 4);
+    s_bridge_frames = src->pre_frames;
+    s_bridge_pos = 0;
+    s_bridge_at = s_music_tx.load();
+    s_seek_drop.store(src->pre_src_frames);
+    s_pos_frames.store(src->pre_src_frames);
+    s_resamp = src->pre_resamp;
+    s_resamp_carry = src->pre_resamp;
+    s_resamp_carry_pending = true;
+    s_bridge_armed.store(true);
+}
+#endif
+
+// MP3 の索引を作る低優先度タスク。曲が始まるたびに依頼(gen とパス)を受け、
+// サイドカーがあれば読み、無ければ SD を小分けに読んで作る。作っている間と
+// 別の曲のものは使わせない(s_idx_gen で公開する)
+struct IdxReq {
+    uint32_t gen;
+    char path[128];
+};
+static hostapi_mp3idx_t* s_idx;           // 書くのは索引タスクだけ(~16KB、PSRAM)
+static std::mutex s_idx_mu;
+static uint32_t s_idx_gen;                // s_idx がどの曲のものか(0 = 無し)。s_idx_mu
+static QueueHandle_t s_idx_queue;         // 深さ 1(新しい曲の依頼で上書き)
+static StaticQueue_t s_idx_queue_cb;
+static uint8_t s_idx_queue_buf[sizeof(IdxReq)];
+static uint8_t s_idx_stack[4096];
+static StaticTask_t s_idx_tcb;
+
+static bool idx_keep_going(void*)
+{
+    vTaskDelay(1); // デコードと SD を優先させる
+    return uxQueueMessagesWaiting(s_idx_queue) == 0;
+}
+
+static void idx_task(void*)
+{
+    for (;;) {
+        IdxReq req;
+        if (xQueueReceive(s_idx_queue, &req, portMAX_DELAY) != pdTRUE) continue;
+        {
+            std::lock_guard<std::mutex> lk(s_idx_mu);
+            s_idx_gen = 0;
+        }
+        const int64_t t0 = esp_timer_get_time();
+        const int r = hostapi_mp3idx_build_file(s_idx, req.path, 64, idx_keep_going, nullptr);
+        if (r > 0) {
+            std::lock_guard<std::mutex> lk(s_idx_mu);
+            s_idx_gen = req.gen;
+            ESP_LOGI(TAG, "mp3idx: %u frames, stride %u, %d ms (%lld ms)", (unsigned)s_idx->frames,
+                     (unsigned)s_idx->stride, (int)hostapi_mp3idx_duration_ms(s_idx),
+                     (long long)((esp_timer_get_time() - t0) / 1000));
+        } else if (r < 0) {
+            ESP_LOGW(TAG, "mp3idx: %s: no frame index (seek disabled)", req.path);
+        }
+    }
+}
+
+// 曲が鳴り始めた(play_file / 次の曲へ切り替えた)。位置を 0 に戻して索引を依頼する
+static void music_track_begin(const MusicSource* src)
+{
+    s_seek_req.store(0);
+    s_seek_drop.store(0);
+    s_pos_base_ms.store(0);
+    s_pos_frames.store(0);
+    s_music_gen.store(src->gen);
+    if (!s_idx_queue) {
+        void* mem = heap_caps_malloc(sizeof(*s_idx), MALLOC_CAP_SPIRAM);
+        if (!mem) mem = heap_caps_malloc(sizeof(*s_idx), MALLOC_CAP_DEFAULT);
+        s_idx = static_cast<hostapi_mp3idx_t*>(mem);
+        if (!s_idx) {
+            ESP_LOGW(TAG, "mp3idx: no memory for the frame index (seek disabled)");
+            return;
+        }
+        s_idx_queue = xQueueCreateStatic(1, sizeof(IdxReq), s_idx_queue_buf, &s_idx_queue_cb);
+        xTaskCreateStatic(idx_task, "mp3idx", sizeof(s_idx_stack), nullptr, 1, s_idx_stack,
+                          &s_idx_tcb);
+    }
+    IdxReq req{};
+    req.gen = src->gen;
+    snprintf(req.path, sizeof(req.path), "%s", src->path);
+    xQueueOverwrite(s_idx_queue, &req);
+}
 
 void Mp3Player::ensure_click_task() noexcept {
     if (click_task_) return;
-    tone_queue_ = xQueueCreateStatic(4, sizeof(ToneMsg), s_tone_queue_buf,
+    hostapi_voices_init(&s_voices, kToneVoices);
+    hostapi_voices_set_kernel(&s_voices, kToneKernel);
+    hostapi_tcache_init(&s_tone_cache, s_tone_cache_pcm, kToneCacheEntries, HOSTAPI_MIX_RATE);
+    hostapi_voices_set_cache(&s_voices, &s_tone_cache);
+    hostapi_mix_init(&s_mix);
+    hostapi_mix_set_gain(&s_mix, HOSTAPI_MIX_MUSIC, volume_.load());
+    hostapi_notes_init(&s_notes, HOSTAPI_MIX_RATE);
+    hostapi_mix_set_notes(&s_mix, &s_notes);
+    tone_queue_ = xQueueCreateStatic(kToneQueueDepth, sizeof(ToneMsg), s_tone_queue_buf,
                                      &s_tone_queue_cb);
     if (!tone_queue_) return;
+#if HAVE_ESP_AUDIO_PLAYER
+    s_music_sb = xStreamBufferCreateStatic(sizeof(s_music_sb_buf) - 1, 4, s_music_sb_buf,
+                                           &s_music_sb_cb);
+    hostapi_resamp_init(&s_resamp, HOSTAPI_MIX_RATE, HOSTAPI_MIX_RATE, 2);
+#endif
     auto fn = [](void* arg) { static_cast<Mp3Player*>(arg)->click_task_loop(); };
     click_task_ = xTaskCreateStatic(fn, "click", sizeof(s_click_stack), this, 18,
                                     s_click_stack, &s_click_tcb);
@@ -136,60 +577,190 @@ void Mp3Player::ensure_click_task() noexcept {
     }
 }
 
+#if CONFIG_MIDIBOX_NATIVE_BENCH
+// トーンタスクのスタックの最小空き(バイト)。~1 秒ごとに測り、減ったときだけ
+// 出す。実際の曲・サンプル・ノートを鳴らしている間の最悪値が残る
+static void click_stack_report() {
+    static uint32_t s_chunks;
+    static UBaseType_t s_min_free = ~(UBaseType_t)0;
+    if (++s_chunks % (HOSTAPI_MIX_RATE / kChunkFrames) != 0) return;
+    const UBaseType_t free_bytes = uxTaskGetStackHighWaterMark(nullptr);
+    if (free_bytes >= s_min_free) return;
+    s_min_free = free_bytes;
+    ESP_LOGI(TAG, "bench: click task stack %u/%u bytes never used", (unsigned)free_bytes,
+             (unsigned)sizeof(s_click_stack));
+}
+#endif
+
+// I2S への書き込みはこのタスクだけが行う(レートは 44.1kHz 固定)。
+// 描画ループ(shared/hostapi_stream.h)で DMA ディスクリプタ 1 本(240 フレーム)
+// ずつ、MP3 と全声を出力ミキサで混ぜて書き続ける。何も鳴っていなければゼロを
+// 書く。書き込みが DMA の消費でブロックするのでこれがレンダリングの歩調になり、
+// 新しい依頼はチャンク境界で発音を始める(先に鳴っている声と重なる)。
+// リングが常に満ちているのでアンダーフローもプリフェッチ再生も起きず、
+// 鳴り終わりのゼロ埋め(旧 Phase 7B fix、トーンごとに ~33ms ブロック)は要らない。
+// 依頼から鳴るまでは 0..1 チャンク + リングの深さ(kDmaDescs 本)でほぼ一定。
 void Mp3Player::click_task_loop() noexcept {
-    ToneMsg msg;
-    for (;;) {
-        if (xQueueReceive(tone_queue_, &msg, portMAX_DELAY) == pdTRUE) {
-            tone_write_now(msg);
+    hostapi_stream_io_t io{};
+    io.ctx = this;
+    io.poll = [](void* ctx) {
+        auto* self = static_cast<Mp3Player*>(ctx);
+#if CONFIG_MIDIBOX_NATIVE_BENCH
+        click_stack_report();
+#endif
+        // このチャンクの頭 = 今までに取り込んだ依頼が鳴り始める位置
+        hostapi_aclock_publish(&s_aclock, s_out_frames, esp_timer_get_time(), 0);
+        ToneMsg msg;
+        while (xQueueReceive(self->tone_queue_, &msg, 0) == pdTRUE) self->tone_start(msg);
+    };
+    io.music = [](void* ctx, int16_t* out, int frames) {
+        return static_cast<Mp3Player*>(ctx)->music_take(out, frames);
+    };
+    io.write = [](void* ctx, const int16_t* pcm, int frames) {
+        hostapi_levels_push(&s_levels, pcm, frames);
+        s_out_frames += (uint64_t)frames;
+        if (static_cast<Mp3Player*>(ctx)->i2s_write(const_cast<int16_t*>(pcm),
+                                                    (size_t)frames * 4, 100)) {
+            return true;
         }
-    }
+        vTaskDelay(pdMS_TO_TICKS(5)); // チャネル停止中に空回りしない
+        return false;
+    };
+    hostapi_stream_init(&s_stream, &io, &s_mix, &s_voices, &s_splayer, s_out_chunk,
+                        s_music_chunk, kChunkFrames);
+    for (;;) hostapi_stream_step(&s_stream);
 }
 
-// パラメトリック減衰サインをキャッシュレスで合成しながら書く (Phase 7C)。
-// 再帰振動子(回転行列)なのでサンプルごとの libm 呼び出しは無い。
-void Mp3Player::tone_write_now(const ToneMsg& msg) noexcept {
-    if (!tx_) return;
-
-    // MP3(22.05kHz 等)再生後に I2S レートが変わったままだと半分のピッチで
-    // 鳴るため、発音前に 44.1kHz へ戻す(同一設定なら reconfig は no-op)
-    if (cur_rate_ != 44100 || cur_bits_ != 16 || !cur_stereo_) {
-        if (!ensure_i2s(44100, 16, true)) return;
-    }
-
-    constexpr int kSampleRate = 44100;
-    const int total = (int)kSampleRate * msg.dur_ms / 1000;
-    const float w = 2.0f * (float)M_PI * (float)msg.freq_hz / kSampleRate;
-    const float cw = cosf(w);
-    const float sw = sinf(w);
-    // エンベロープ: dur_ms 終端で e^-3.5 ≒ -30dB(既定クリック 30ms は従来と同等)
-    const float decay = expf(-3.5f / (float)total);
-    float amp = 12000.0f * msg.level / 100.0f * volume_.load() / 100.0f;
-    float s = 0.0f, c = 1.0f; // sin/cos の回転状態
-
-    int16_t chunk[240 * 2]; // 1 DMA ディスクリプタぶん(タスクスタック上)
-    int done = 0;
-    while (done < total) {
-        int n = total - done;
-        if (n > 240) n = 240;
-        for (int i = 0; i < n; ++i) {
-            const float s2 = s * cw + c * sw;
-            c = c * cw - s * sw;
-            s = s2;
-            amp *= decay;
-            const int16_t v = (int16_t)(amp * s);
-            chunk[i * 2] = v;
-            chunk[i * 2 + 1] = v;
+// MP3 を 1 チャンク取り出す。デコード中は 1 チャンク揃うまで待ち(途中で
+// 切るとそこが無音になる)、止まった後は残りをゼロ詰めで出し切る。
+// 曲の切り替えでは前の曲の末尾の直後に先読みの PCM を挟む(music_bridge_arm)
+#if HAVE_ESP_AUDIO_PLAYER
+static size_t music_rx(void* out, size_t bytes)
+{
+    const size_t got = xStreamBufferReceive(s_music_sb, out, bytes, 0);
+    s_music_rx += (uint32_t)got;
+    return got;
+}
+
+// 先読みを out へ最大 frames。出し切ったら継ぎ目を閉じる
+static int music_bridge_take(int16_t* out, int frames)
+{
+    const uint32_t left = s_bridge_frames - s_bridge_pos;
+    const int n = left < (uint32_t)frames ? (int)left : frames;
+    memcpy(out, s_bridge_pcm + s_bridge_pos * 2, (size_t)n * 4);
+    s_bridge_pos += (uint32_t)n;
+    if (s_bridge_pos == s_bridge_frames) s_bridge_armed.store(false);
+    return n;
+}
+#endif
+
+bool Mp3Player::music_take(int16_t* out, int frames) noexcept {
+#if HAVE_ESP_AUDIO_PLAYER
+    static bool flowing = false; // 直前のチャンクに MP3 があった
+    if (!s_music_sb) return false;
+    const size_t want = (size_t)frames * 4;
+    switch (s_music_gate.load()) {
+    case kGateHold: {
+        // 予約の発音(esp_timer → キュー → 次のチャンク)と同じチャンクで開く
+        const uint32_t now = (uint32_t)(esp_timer_get_time() / 1000);
+        if ((int32_t)(now - s_music_start_ms.load()) < 0) {
+            flowing = false;
+            return false;
+        }
+        uint8_t hold = kGateHold;
+        s_music_gate.compare_exchange_strong(hold, kGateNone);
+        break;
+    }
+    case kGateDrop:
+        while (music_rx(out, want) > 0) {
+        }
+        s_bridge_armed.store(false);
+        flowing = false;
+        return false;
+    default:
+        break;
+    }
+    if (s_bridge_armed.load()) {
+        // 前の曲の残り(積み終わっているので揃っている)→ 先読み → 次の曲
+        const uint32_t left = (s_bridge_at - s_music_rx) / 4;
+        if (left < (uint32_t)frames) {
+            int n = (int)music_rx(out, (size_t)left * 4) / 4;
+            n += music_bridge_take(out + n * 2, frames - n);
+            if (n < frames) {
+                const size_t got = music_rx(out + n * 2, (size_t)(frames - n) * 4);
+                memset((uint8_t*)out + (size_t)n * 4 + got, 0, (size_t)(frames - n) * 4 - got);
+            }
+            flowing = true;
+            return true;
         }
-        i2s_write(chunk, (size_t)n * 2 * sizeof(int16_t), 100);
-        done += n;
     }
+    const size_t avail = xStreamBufferBytesAvailable(s_music_sb);
+    if (avail < want && (avail == 0 || s_music_live.load())) {
+        if (flowing && s_music_live.load()) s_music_underruns++; // デコードが間に合わない
+        flowing = false;
+        return false;
+    }
+    const size_t got = music_rx(out, want);
+    if (got < want) memset((uint8_t*)out + got, 0, want - got);
+    flowing = got > 0;
+    return flowing;
+#else
+    (void)out;
+    (void)frames;
+    return false;
+#endif
+}
 
-    // DMA リング(既定 6 ディスクリプタ × 240 フレーム)を丸ごとゼロで上書きする。
-    // アンダーフロー時に古いディスクリプタがプリフェッチ再生されても無音になる。
-    // 書き込みでブロックするが、専用タスクなので無害。
-    static const int16_t zeros[240 * 2] = {};
-    for (int i = 0; i < 6; ++i) {
-        i2s_write((void*)zeros, sizeof(zeros), 100);
+// パラメトリック減衰サイン (Phase 7C) を 1 声発音する。キャッシュ済みの
+// 定義は PCM をマスター音量倍して流すだけ、それ以外は発振(マスター音量は
+// 発音時に焼き込む)。声が足りなければ最も減衰した声を奪う。
+// I2S は 44.1kHz 固定(MP3 のレートはミキサ前段のリサンプラで吸収)なので
+// レートの戻しは要らない。
+// サンプルはキャッシュ上の PCM を指すだけ(SD は読まない)。
+// ノートは持続音のチャネルを鳴らす・リリースする(マスター音量は on 時に焼き込む)。
+void Mp3Player::tone_start(const ToneMsg& msg) noexcept {
+    using Kind = ToneMsg::Kind;
+    switch (msg.kind) {
+    case Kind::kStopSamples:
+        hostapi_splayer_reset(&s_splayer);
+        return;
+    case Kind::kPrepareTone:
+        hostapi_voices_prepare(&s_voices, HOSTAPI_MIX_RATE, msg.tone.freq_hz, msg.tone.dur_ms,
+                               msg.tone.level);
+        return;
+    case Kind::kNoteEnv: {
+        const hostapi_note_env_t env{msg.env.attack_ms, msg.env.decay_ms, msg.env.sustain,
+                                     msg.env.release_ms};
+        hostapi_notes_define(&s_notes, msg.env.slot, &env);
+        return;
+    }
+    case Kind::kNoteReset:
+        hostapi_notes_reset(&s_notes);
+        return;
+    case Kind::kNoteOff:
+        hostapi_notes_off(&s_notes, msg.note.ch);
+        return;
+    case Kind::kNoteOn:
+        if (tx_) {
+            hostapi_notes_on(&s_notes, msg.note.ch, msg.note.env_slot, msg.note.pitch,
+                             msg.note.velocity, volume_.load());
+        }
+        return;
+    case Kind::kSample: {
+        if (!tx_) return;
+        const hostapi_sample_t* smp = hostapi_sample_get(&s_samples, msg.sample.handle);
+        if (smp && hostapi_splayer_start(&s_splayer, smp, msg.sample.level, volume_.load())) {
+            ESP_LOGD(TAG, "sample: voice stolen (%u total)", (unsigned)s_splayer.stolen);
+        }
+        return;
+    }
+    case Kind::kTone:
+        if (!tx_) return;
+        if (hostapi_voices_start(&s_voices, HOSTAPI_MIX_RATE, msg.tone.freq_hz,
+                                 msg.tone.dur_ms, msg.tone.level, volume_.load())) {
+            ESP_LOGD(TAG, "tone: voice stolen (%u total)", (unsigned)s_voices.stolen);
+        }
+        return;
     }
 }
 
@@ -228,24 +799,66 @@ bool Mp3Player::i2s_write(void* data, size_t len, uint32_t timeout_ms, size_t* w
 }
 
 #if HAVE_ESP_AUDIO_PLAYER
+// デコード済み PCM(曲のレート・チャンネル数)を 44.1kHz ステレオへリサンプルして
+// トーンタスクへ渡す。音量はミキサの MUSIC ゲインで掛ける。
 esp_err_t Mp3Player::write_fn(void* audio_buffer, size_t len, size_t* bytes_written, uint32_t timeout_ms)
 {
-    if (!s_self) return ESP_FAIL;
-    int16_t* samples = static_cast<int16_t*>(audio_buffer);
-    size_t sample_count = len / sizeof(int16_t);
-    float volume_factor = (float)s_self->volume_.load() / 100.0f;
-    for (size_t i = 0; i < sample_count; ++i) {
-        int32_t v = (int32_t)std::lround((float)samples[i] * volume_factor);
-        if (v > 32767) v = 32767; else if (v < -32768) v = -32768;
-        samples[i] = (int16_t)v;
+    if (!s_self || !s_music_sb) return ESP_FAIL;
+    const int16_t* in = static_cast<const int16_t*>(audio_buffer);
+    int in_frames = (int)(len / (sizeof(int16_t) * s_resamp.channels));
+    constexpr int kOutFrames = sizeof(s_resamp_out) / 4;
+    s_music_live.store(true);
+    s_resamp_carry_pending = false; // 次の曲の最初の PCM が来た
+    if (const uint32_t drop = s_seek_drop.load()) { // シーク前の位置の残り
+        const uint32_t d = drop < (uint32_t)in_frames ? drop : (uint32_t)in_frames;
+        s_seek_drop.store(drop - d);
+        in += d * s_resamp.channels;
+        in_frames -= (int)d;
     }
-    return s_self->i2s_write(audio_buffer, len, timeout_ms, bytes_written) ? ESP_OK : ESP_FAIL;
+    s_pos_frames.fetch_add((uint32_t)in_frames);
+    while (in_frames > 0) {
+        int used = 0;
+        const int n = hostapi_resamp_process(&s_resamp, in, in_frames, &used, s_resamp_out,
+                                             kOutFrames);
+        in += used * s_resamp.channels;
+        in_frames -= used;
+        if (n == 0) continue;
+        const size_t bytes = (size_t)n * 4;
+        size_t sent = xStreamBufferSend(s_music_sb, s_resamp_out, bytes,
+                                        pdMS_TO_TICKS(timeout_ms));
+        while (sent < bytes && s_music_gate.load() == kGateHold) { // 開始時刻まで待つ
+            sent += xStreamBufferSend(s_music_sb, (const uint8_t*)s_resamp_out + sent,
+                                      bytes - sent, pdMS_TO_TICKS(timeout_ms));
+        }
+        s_music_tx.fetch_add((uint32_t)sent);
+        if (sent < bytes) { // トーンタスクが止まっている
+            if (bytes_written) *bytes_written = len - (size_t)in_frames * 2 * s_resamp.channels;
+            return ESP_FAIL;
+        }
+    }
+    if (bytes_written) *bytes_written = len;
+    return ESP_OK;
 }
 
+// 曲のフォーマット通知。I2S は 44.1kHz/16bit/ステレオのまま、リサンプラだけ
+// 設定し直す(曲ごとのクロック切り替えによるグリッチを無くす)
 esp_err_t Mp3Player::clk_set_fn(uint32_t rate, uint32_t bits_cfg, i2s_slot_mode_t ch)
 {
     if (!s_self) return ESP_FAIL;
-    return s_self->reconfig_rate(rate, bits_cfg, ch) ? ESP_OK : ESP_FAIL;
+    if (bits_cfg != I2S_DATA_BIT_WIDTH_16BIT) {
+        ESP_LOGW(TAG, "unsupported PCM width %u (16bit only)", (unsigned)bits_cfg);
+        return ESP_FAIL;
+    }
+    hostapi_resamp_init(&s_resamp, rate, HOSTAPI_MIX_RATE, ch == I2S_SLOT_MODE_STEREO ? 2 : 1);
+    // 先読みした曲の続きなら、先読みのリサンプラの位相から続ける
+    if (s_resamp_carry_pending && s_resamp_carry.step == s_resamp.step &&
+        s_resamp_carry.channels == s_resamp.channels) {
+        s_resamp = s_resamp_carry;
+    }
+    if (rate > 0) s_pos_rate.store(rate);
+    ESP_LOGI(TAG, "music: %u Hz %s -> %d Hz", (unsigned)rate,
+             ch == I2S_SLOT_MODE_STEREO ? "stereo" : "mono", HOSTAPI_MIX_RATE);
+    return ESP_OK;
 }
 #endif
 
@@ -260,7 +873,35 @@ void Mp3Player::player_callback(audio_player_cb_ctx_t* ctx)
 {
     if (!s_self) return;
     if (ctx->audio_event == AUDIO_PLAYER_CALLBACK_EVENT_IDLE) {
-        ESP_LOGI(TAG, "Playback finished");
+        // 再生キューの次の曲を開いてあれば、このタスクのままデコードを続ける。
+        // トーンタスクには残りを出し切らせず(s_music_live のまま)、前の曲の
+        // 末尾に続けて先読みを鳴らさせ、その間に次の曲の PCM を揃える
+        // (曲間に無音を挟まない)
+        MusicSource* next = s_self->next_src_.exchange(nullptr);
+        if (next) {
+            music_track_begin(next);
+            music_bridge_arm(next);
+        }
+        if (next && audio_player_play(next->fp) == ESP_OK) {
+            s_self->file_ = next->fp;
+            s_self->track_change_ms_.store((uint32_t)(esp_timer_get_time() / 1000));
+            s_self->track_changes_.fetch_add(1);
+            ESP_LOGI(TAG, "Next track (music underruns %u)", (unsigned)s_music_underruns);
+            return;
+        }
+        if (next) {
+            s_bridge_armed.store(false);
+            s_music_gen.store(0);
+            fclose(next->fp);
+        }
+    }
+    if (ctx->audio_event != AUDIO_PLAYER_CALLBACK_EVENT_PLAYING) {
+        // デコードが止まった: トーンタスクに残りを出し切らせる
+        s_music_live.store(false);
+    }
+    if (ctx->audio_event == AUDIO_PLAYER_CALLBACK_EVENT_IDLE) {
+        ESP_LOGI(TAG, "Playback finished (music underruns %u, limiter blocks %u)",
+                 (unsigned)s_music_underruns, (unsigned)s_mix.limited);
         Music_Next_Flag = true;
         s_self->finished_.store(true);
         // FILE* is closed by audio_player; do not fclose() here
@@ -272,16 +913,47 @@ void Mp3Player::player_callback(audio_player_cb_ctx_t* ctx)
 }
 #endif
 
-bool Mp3Player::play_file(const std::string& path) noexcept {
+#if HAVE_ESP_AUDIO_PLAYER
+// 開始時刻待ちを解き、待つ間に溜めた分はトーンタスクに捨てさせる。write_fn が
+// 満杯で待っていると audio_player が止まれないので、pause の前に呼ぶ。
+// 待っていたら true
+static bool music_gate_drop()
+{
+    uint8_t hold = kGateHold;
+    return s_music_gate.compare_exchange_strong(hold, kGateDrop);
+}
+
+// デコーダを止めた後、リングの残りをトーンタスクに捨てさせる(数チャンクで空く)
+static void music_drain()
+{
+    s_music_gate.store(kGateDrop);
+    for (int i = 0; i < 25 && s_music_sb && xStreamBufferBytesAvailable(s_music_sb) > 0; i++) {
+        vTaskDelay(pdMS_TO_TICKS(2));
+    }
+    s_music_gate.store(kGateNone);
+}
+#endif
+
+bool Mp3Player::play_file(const std::string& path, int64_t start_ms) noexcept {
+    clear_next();
+#if HAVE_ESP_AUDIO_PLAYER
+    const bool was_held = music_gate_drop();
+    s_bridge_armed.store(false); // 切り替えたばかりの曲の継ぎ目は要らない
+#endif
     // Pause current playback
     pause();
+#if HAVE_ESP_AUDIO_PLAYER
+    // 時刻を指定するなら、前の曲の残りを開始時刻に鳴らさない
+    if (was_held || start_ms >= 0) music_drain();
+#endif
     // Do not fclose() here; audio_player thread owns previous FILE*
     if (file_) { file_ = nullptr; }
-    file_ = fopen(path.c_str(), "rb");
-    if (!file_) {
+    MusicSource* src = music_open(path);
+    if (!src) {
         ESP_LOGE(TAG, "Failed to open MP3 file: %s", path.c_str());
         return false;
     }
+    file_ = src->fp;
     // Do not perform ID3/scanning here; lower layer handles it
     current_path_ = path;
     finished_.store(false);
@@ -289,9 +961,17 @@ bool Mp3Player::play_file(const std::string& path) noexcept {
     
 #if HAVE_ESP_AUDIO_PLAYER
     expected_event_ = AUDIO_PLAYER_CALLBACK_EVENT_PLAYING;
+    xQueueReset(event_queue_); // 続けて鳴らした曲の PLAYING が残っていれば捨てる
+    music_track_begin(src);
+    if (start_ms >= 0) {
+        s_music_start_ms.store((uint32_t)start_ms);
+        s_music_gate.store(kGateHold);
+    }
     esp_err_t ret = audio_player_play(file_);
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "audio_player_play failed: %d", (int)ret);
+        s_music_gate.store(kGateNone);
+        s_music_gen.store(0);
         fclose(file_); file_ = nullptr;
         return false;
     }
@@ -308,6 +988,7 @@ void Mp3Player::pause() noexcept {
 #if HAVE_ESP_AUDIO_PLAYER
     if (audio_player_get_state() == AUDIO_PLAYER_STATE_PLAYING) {
         expected_event_ = AUDIO_PLAYER_CALLBACK_EVENT_PAUSE;
+        xQueueReset(event_queue_);
         if (audio_player_pause() != ESP_OK) return;
         (void)xQueueReceive(event_queue_, &event_, pdMS_TO_TICKS(200));
     }
@@ -318,6 +999,7 @@ void Mp3Player::resume() noexcept {
 #if HAVE_ESP_AUDIO_PLAYER
     if (audio_player_get_state() != AUDIO_PLAYER_STATE_PLAYING) {
         expected_event_ = AUDIO_PLAYER_CALLBACK_EVENT_PLAYING;
+        xQueueReset(event_queue_);
         if (audio_player_resume() != ESP_OK) return;
         (void)xQueueReceive(event_queue_, &event_, pdMS_TO_TICKS(200));
     }
@@ -325,19 +1007,82 @@ void Mp3Player::resume() noexcept {
 }
 
 void Mp3Player::stop() noexcept {
+    clear_next();
+#if HAVE_ESP_AUDIO_PLAYER
+    const bool was_held = music_gate_drop();
+    s_bridge_armed.store(false); // 切り替えたばかりの曲の継ぎ目は要らない
+#endif
     // Best-effort stop: pause + close file
     pause();
 #if HAVE_ESP_AUDIO_PLAYER
     (void)audio_player_stop();
+    if (was_held) music_drain();
 #endif
     // FILE is closed by audio_player thread; just clear local pointer
     file_ = nullptr;
 }
 
+// 開いて頭を先読みでデコードしておく(music_predecode)。SD のディレクトリ
+// 探索と FAT チェーンの読み込みも今の曲の再生中に済ませておく
+bool Mp3Player::queue_next(const std::string& path) noexcept {
+    MusicSource* src = music_open(path);
+    if (!src) {
+        ESP_LOGE(TAG, "Failed to open next MP3 file: %s", path.c_str());
+        return false;
+    }
+#if HAVE_ESP_AUDIO_PLAYER
+    music_predecode(src);
+#endif
+    MusicSource* old = next_src_.exchange(src);
+    if (old) fclose(old->fp);
+    return true;
+}
+
+void Mp3Player::clear_next() noexcept {
+    MusicSource* old = next_src_.exchange(nullptr);
+    if (old) fclose(old->fp);
+}
+
+// 呼ぶのは wasm スレッド(状態の確認は hostapi 側)
+int32_t Mp3Player::position_ms() const noexcept {
+    if (s_music_gen.load() == 0) return -1;
+    if (start_pending()) return 0; // デコードは先に進んでいる
+    if (s_seek_req.load() != 0) return s_seek_ms.load(); // 次の読み出しで移る
+    return s_pos_base_ms.load() +
+           (int32_t)((uint64_t)s_pos_frames.load() * 1000 / s_pos_rate.load());
+}
+
+bool Mp3Player::start_pending() const noexcept {
+    return s_music_gate.load() == kGateHold;
+}
+
+int32_t Mp3Player::duration_ms() const noexcept {
+    const uint32_t gen = s_music_gen.load();
+    std::lock_guard<std::mutex> lk(s_idx_mu);
+    if (gen == 0 || s_idx_gen != gen) return -1;
+    return hostapi_mp3idx_duration_ms(s_idx);
+}
+
+int32_t Mp3Player::seek_ms(uint32_t ms) noexcept {
+    const uint32_t gen = s_music_gen.load();
+    uint32_t offset = 0;
+    int32_t at;
+    {
+        std::lock_guard<std::mutex> lk(s_idx_mu);
+        if (gen == 0 || s_idx_gen != gen) return -1;
+        at = hostapi_mp3idx_lookup(s_idx, ms, &offset);
+    }
+    if (at < 0) return -1;
+    s_seek_ms.store(at);
+    s_seek_req.store((uint64_t)gen << 32 | offset);
+    return at;
+}
+
 void Mp3Player::set_volume(uint8_t vol_0_100) noexcept {
     if (vol_0_100 > 100) vol_0_100 = 100;
     volume_.store(vol_0_100);
     Audio_Volume = vol_0_100;
+    hostapi_mix_set_gain(&s_mix, HOSTAPI_MIX_MUSIC, vol_0_100); // MP3 は即時(1 チャンクのランプ)、トーンは次の発音から
 }
 
 bool Mp3Player::is_playing() const noexcept {
@@ -355,6 +1100,152 @@ bool Mp3Player::is_paused()  const noexcept {
 #endif
 }
 
+#if CONFIG_MIDIBOX_NATIVE_BENCH
+// トーンのミックスコスト。DMA ディスクリプタ 1 本(240 フレーム = 5.4ms)を
+// 声数別に描く時間を測る。I2S には書かない(トーンタスクの s_voices も触らない)。
+extern "C" void Audio_Bench_Voices(void) {
+    constexpr int kFrames = 240;
+    constexpr int kBuffers = 16; // 100ms トーンが鳴り終わる前に収まる数
+    static int16_t buf[kFrames * 2];
+    static hostapi_voices_t voices;
+    static const int kCounts[] = {1, 2, 4, 8, 16};
+    for (const int n : kCounts) {
+        hostapi_voices_init(&voices, n);
+        hostapi_voices_set_kernel(&voices, kToneKernel);
+        int64_t t_total = 0;
+        int64_t t_max = 0;
+        int rounds = 0;
+        for (int r = 0; r < 8; r++) {
+            for (int i = 0; i < n; i++) {
+                hostapi_voices_start(&voices, 44100, (uint16_t)(200 + i * 150), 100, 100, 98);
+            }
+            for (int b = 0; b < kBuffers; b++) {
+                const int64_t t0 = esp_timer_get_time();
+                hostapi_voices_render(&voices, buf, kFrames);
+                const int64_t dt = esp_timer_get_time() - t0;
+                t_total += dt;
+                if (dt > t_max) t_max = dt;
+                rounds++;
+            }
+        }
+        const double avg = (double)t_total / rounds;
+        ESP_LOGI(TAG, "bench: voices %2d: %.1f us / %d frames (max %lld us, %.1f%% of buffer)",
+                 n, avg, kFrames, (long long)t_max, avg * 100.0 / (kFrames * 1e6 / 44100));
+    }
+
+    // 発振カーネル別のサンプルあたりサイクル数(ミキサと同じ 128 フレームのブロック)
+    static int32_t acc[HOSTAPI_VOICE_CHUNK];
+    static hostapi_voice_t v[HOSTAPI_VOICE_DEFAULT];
+    static const int kKernels[] = {HOSTAPI_OSC_FLOAT, HOSTAPI_OSC_Q31};
+    for (const int kernel : kKernels) {
+        uint32_t cycles = 0;
+        constexpr int kRounds = 64;
+        for (int r = 0; r < kRounds; r++) {
+            for (int i = 0; i < HOSTAPI_VOICE_DEFAULT; i++) {
+                const float w = 2.0f * (float)M_PI * (float)(200 + i * 150) / 44100.0f;
+                hostapi_osc_start(&v[i], w, 6000.0f, 44100);
+            }
+            memset(acc, 0, sizeof(acc));
+            const uint32_t c0 = esp_cpu_get_cycle_count();
+            for (int i = 0; i < HOSTAPI_VOICE_DEFAULT; i++) {
+                hostapi_osc_mix(kernel, &v[i], acc, HOSTAPI_VOICE_CHUNK);
+            }
+            cycles += esp_cpu_get_cycle_count() - c0;
+        }
+        ESP_LOGI(TAG, "bench: osc %-5s: %.1f cycles/sample (%d voices x %d frames)%s",
+                 hostapi_osc_name(kernel),
+                 (double)cycles / (kRounds * HOSTAPI_VOICE_DEFAULT * HOSTAPI_VOICE_CHUNK),
+                 HOSTAPI_VOICE_DEFAULT, HOSTAPI_VOICE_CHUNK,
+                 kernel == kToneKernel ? " [in use]" : "");
+    }
+
+    // レンダ済みキャッシュの効果。発音 1 回ぶんの処理(voices_start + 最初の
+    // チャンク)は依頼を受けてから I2S に書くまでの遅延に直接乗る。発振 /
+    // キャッシュ命中 / 未登録(その場で描く)で比べ、続けて声数別のチャンク
+    // あたりの描画時間を発振と比べる
+    static hostapi_tcache_t cache;
+    static int16_t pcm[2 * HOSTAPI_TCACHE_ENTRY_FRAMES(44100)]; // 強拍・弱拍の 2 枠
+    hostapi_tcache_init(&cache, pcm, 2, 44100);
+    static const char* const kPaths[] = {"osc", "hit", "miss"};
+    for (int path = 0; path < 3; path++) {
+        hostapi_voices_init(&voices, kToneVoices);
+        hostapi_voices_set_kernel(&voices, kToneKernel);
+        if (path > 0) hostapi_voices_set_cache(&voices, &cache);
+        int64_t t_total = 0;
+        int64_t t_max = 0;
+        constexpr int kTriggers = 32;
+        for (int r = 0; r < kTriggers; r++) {
+            hostapi_voices_reset(&voices);
+            if (path == 2) hostapi_tcache_clear(&cache);
+            if (path == 1) hostapi_voices_prepare(&voices, 44100, 1000, 30, 100);
+            const int64_t t0 = esp_timer_get_time();
+            hostapi_voices_start(&voices, 44100, 1000, 30, 100, 98);
+            hostapi_voices_render(&voices, buf, kFrames);
+            const int64_t dt = esp_timer_get_time() - t0;
+            t_total += dt;
+            if (dt > t_max) t_max = dt;
+        }
+        ESP_LOGI(TAG, "bench: tone cache trigger %-4s: %.1f us to first chunk (max %lld us)",
+                 kPaths[path], (double)t_total / kTriggers, (long long)t_max);
+    }
+    for (const int n : kCounts) {
+        double avg[2];
+        for (int cached = 0; cached < 2; cached++) {
+            hostapi_voices_init(&voices, n);
+            hostapi_voices_set_kernel(&voices, kToneKernel);
+            if (cached) hostapi_voices_set_cache(&voices, &cache);
+            int64_t t_total = 0;
+            int rounds = 0;
+            for (int r = 0; r < 8; r++) {
+                for (int i = 0; i < n; i++) {
+                    // キャッシュ枠に収まる 2 種類(メトロノームの強拍・弱拍)
+                    hostapi_voices_start(&voices, 44100, (uint16_t)(i % 2 ? 1000 : 1500), 100,
+                                         100, 98);
+                }
+                for (int b = 0; b < kBuffers; b++) {
+                    const int64_t t0 = esp_timer_get_time();
+                    hostapi_voices_render(&voices, buf, kFrames);
+                    t_total += esp_timer_get_time() - t0;
+                    rounds++;
+                }
+            }
+            avg[cached] = (double)t_total / rounds;
+        }
+        ESP_LOGI(TAG, "bench: tone cache voices %2d: osc %.1f us, cached %.1f us / %d frames",
+                 n, avg[0], avg[1], kFrames);
+    }
+
+    // レベルメータ(shared/hostapi_levels.h)。取り込みはトーンタスクのチャンク
+    // ごと、FFT は hostapi_audio_get_levels で新しい窓ごとに 1 回(wasm スレッド)
+    static hostapi_levels_t lv;
+    static hostapi_levels_fft_t fft;
+    static int16_t out[HOSTAPI_LEVELS_FFT * 2];
+    for (int i = 0; i < HOSTAPI_LEVELS_FFT * 2; i++) out[i] = (int16_t)(12000 * sinf(i * 0.01f));
+    hostapi_levels_init(&lv);
+    hostapi_levels_fft_init(&fft);
+    constexpr int kLevelRounds = 32;
+    uint32_t push_cycles = 0;
+    for (int r = 0; r < kLevelRounds; r++) {
+        const uint32_t c0 = esp_cpu_get_cycle_count();
+        hostapi_levels_push(&lv, out, kChunkFrames);
+        push_cycles += esp_cpu_get_cycle_count() - c0;
+    }
+    uint8_t band[HOSTAPI_AUDIO_LEVEL_BANDS];
+    int64_t t_fft = 0;
+    int64_t t_fft_max = 0;
+    for (int r = 0; r < kLevelRounds; r++) {
+        const int64_t t0 = esp_timer_get_time();
+        hostapi_levels_fft_run(&fft, out + (r % 16) * 2, band);
+        const int64_t dt = esp_timer_get_time() - t0;
+        t_fft += dt;
+        if (dt > t_fft_max) t_fft_max = dt;
+    }
+    ESP_LOGI(TAG, "bench: levels push %.1f cycles/frame | fft %d + bands %.1f us (max %lld us)",
+             (double)push_cycles / (kLevelRounds * kChunkFrames), HOSTAPI_LEVELS_FFT,
+             (double)t_fft / kLevelRounds, (long long)t_fft_max);
+}
+#endif
+
 // ---- C API wrappers ----
 
 extern "C" void Audio_Init(void) {
@@ -377,6 +1268,76 @@ extern "C" bool Play_Tone(uint16_t freq_hz, uint16_t dur_ms, uint8_t level) {
     return g_player && g_player->play_tone(freq_hz, dur_ms, level);
 }
 
+extern "C" void Tone_Prepare(uint16_t freq_hz, uint16_t dur_ms, uint8_t level) {
+    if (g_player) g_player->prepare_tone(freq_hz, dur_ms, level);
+}
+
+// 呼び出しは wasm スレッドのみ(キャッシュへの追加・巻き戻しを直列にする)。
+// デコードは呼び出し元のスタック(~2KB)で行う。
+extern "C" int Sample_Load(const char* key, uint32_t key_len, const char* full_path) {
+    if (!s_samples_ready) {
+        s_samples_ready = true;
+        void* arena = heap_caps_malloc(kSampleCacheBytes, MALLOC_CAP_SPIRAM);
+        if (!arena) {
+            ESP_LOGW(TAG, "sample: no PSRAM for %u KB cache",
+                     (unsigned)(kSampleCacheBytes / 1024));
+        }
+        hostapi_sample_cache_init(&s_samples, arena, kSampleCacheBytes);
+    }
+    const int found = hostapi_sample_cache_find(&s_samples, key, key_len);
+    if (found >= 0) return found;
+    FILE* f = fopen(full_path, "rb");
+    if (!f) return -1;
+    const size_t len = strlen(full_path);
+    const bool raw = len > 4 && (strcasecmp(full_path + len - 4, ".raw") == 0 ||
+                                 strcasecmp(full_path + len - 4, ".pcm") == 0);
+    const int64_t t0 = esp_timer_get_time();
+    const int h = hostapi_sample_decode(&s_samples, key, key_len, f, raw, HOSTAPI_MIX_RATE);
+    fclose(f);
+    if (h < 0) {
+        ESP_LOGW(TAG, "sample: %s: unsupported or cache full (%u/%u bytes)", full_path,
+                 (unsigned)s_samples.used, (unsigned)s_samples.cap);
+        return -1;
+    }
+    ESP_LOGI(TAG, "sample: %s -> %d (%u frames, %u ch, %lld us)", full_path, h,
+             (unsigned)s_samples.s[h].frames, (unsigned)s_samples.s[h].channels,
+             (long long)(esp_timer_get_time() - t0));
+    return h;
+}
+
+extern "C" bool Sample_Exists(int handle) {
+    return hostapi_sample_get(&s_samples, handle) != nullptr;
+}
+
+extern "C" bool Play_Sample(int handle, uint8_t level) {
+    return g_player && Sample_Exists(handle) && g_player->play_sample(handle, level);
+}
+
+// 停止依頼の後に巻き戻す。トーンタスクが停止を処理するまでの 1 チャンク
+// (5.4ms)は古い PCM を読み得るが、アリーナは解放しないので次のロードで
+// 上書きされても音が化けるだけ(アプリ起動はそれより十分遅い)
+extern "C" void Sample_Reset(void) {
+    if (g_player) g_player->stop_samples();
+    hostapi_sample_cache_reset(&s_samples);
+}
+
+extern "C" bool Note_On(uint8_t ch, uint8_t env_slot, uint16_t pitch, uint8_t velocity) {
+    return g_player && g_player->note_on(ch, env_slot, pitch, velocity);
+}
+
+extern "C" bool Note_Off(uint8_t ch) {
+    return g_player && g_player->note_off(ch);
+}
+
+extern "C" bool Note_Define(uint8_t slot, uint16_t attack_ms, uint16_t decay_ms, uint8_t sustain,
+                            uint16_t release_ms) {
+    return g_player && g_player->note_define(slot, attack_ms, decay_ms, sustain, release_ms);
+}
+
+extern "C" void Note_Reset(void) {
+    if (g_player) g_player->reset_notes();
+}
+
 extern "C" void Play_Music(const char* directory, const char* fileName) {
     if (!g_player) Audio_Init();
     std::string path;
@@ -407,5 +1368,47 @@ extern "C" bool Music_play_path(const char* path) {
     if (!g_player || !path) return false;
     return g_player->play_file(path);
 }
+extern "C" bool Music_play_path_at(const char* path, uint32_t start_ms) {
+    if (!g_player || !path) return false;
+    return g_player->play_file(path, start_ms);
+}
+extern "C" bool Music_start_pending(void) { return g_player && g_player->start_pending(); }
+extern "C" bool Music_queue_next(const char* path) {
+    if (!g_player || !path) return false;
+    return g_player->queue_next(path);
+}
+extern "C" void Music_clear_next(void) { if (g_player) g_player->clear_next(); }
+extern "C" uint32_t Music_track_changes(uint32_t* time_ms) {
+    if (!g_player) {
+        if (time_ms) *time_ms = 0;
+        return 0;
+    }
+    return g_player->track_changes(time_ms);
+}
+// 呼び出しは wasm スレッドのみ
+extern "C" void Audio_Get_Levels(hostapi_audio_levels_t* out) {
+    if (!s_levels_fft) {
+        void* mem = heap_caps_malloc(sizeof(*s_levels_fft), MALLOC_CAP_SPIRAM);
+        if (!mem) mem = heap_caps_malloc(sizeof(*s_levels_fft), MALLOC_CAP_DEFAULT);
+        if (!mem) {
+            memset(out, 0, sizeof(*out));
+            return;
+        }
+        s_levels_fft = static_cast<hostapi_levels_fft_t*>(mem);
+        hostapi_levels_fft_init(s_levels_fft);
+    }
+    hostapi_levels_read(&s_levels, s_levels_fft, out);
+}
+extern "C" bool Audio_Get_Clock(hostapi_audio_clock_t* out) {
+    int64_t offset_us;
+    if (!hostapi_aclock_read(&s_aclock, &out->frames, &out->frames_us, &offset_us)) return false;
+    out->rate = 44100;
+    // リングが常に満ちているので、チャンクの頭から DAC まではリングの深さ
+    out->latency_us = (uint32_t)((uint64_t)kDmaDescs * kChunkFrames * 1000000 / 44100);
+    return true;
+}
+extern "C" int32_t Music_position_ms(void) { return g_player ? g_player->position_ms() : -1; }
+extern "C" int32_t Music_duration_ms(void) { return g_player ? g_player->duration_ms() : -1; }
+extern "C" int32_t Music_seek_ms(uint32_t ms) { return g_player ? g_player->seek_ms(ms) : -1; }
 
 } // namespace audio
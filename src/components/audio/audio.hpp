@@ -16,11 +16,15 @@ extern "C" {
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/queue.h"
+#include "hostapi_defs.h"
 
-// MP3 playback using espressif/audio_player + I2S (std mode)
+// MP3 playback using espressif/audio_player + I2S (std mode, fixed 44.1kHz).
+// MP3 and tones are summed by the shared output mixer (shared/hostapi_mix.h).
 
 namespace audio {
 
+struct MusicSource; // 曲のファイル(シークを挟めるよう fopencookie で包む。audio.cpp)
+
 class Mp3Player {
 public:
     struct Pins {
@@ -47,17 +51,95 @@ public:
 
     // パラメトリックな減衰サイン(Phase 7C tone API)の発音を専用タスクに依頼する。
     // 呼び出し側(wasm スレッド / esp_timer コールバック)はブロックしない。
-    // level 0..100 はトーン固有ゲイン(マスター音量と乗算)。
+    // level 0..100 はトーン固有ゲイン(マスター音量と乗算)。鳴っている音とは
+    // 重ねて鳴る(最大 CONFIG_MIDIBOX_TONE_VOICES 声)。MP3 再生中も混ぜて鳴る。
     bool play_tone(uint16_t freq_hz, uint16_t dur_ms, uint8_t level) noexcept;
 
+    // キャッシュ済みサンプル(hostapi_sample_load)の発音を専用タスクに依頼する。
+    // ブロックしない。level 0..100 はマスター音量と乗算。
+    bool play_sample(int handle, uint8_t level) noexcept;
+    // 発音中のサンプルを全て止める(キャッシュを巻き戻す前に呼ぶ)
+    void stop_samples() noexcept;
+    // トーン定義をレンダ済みキャッシュへ描くよう依頼する(ブロックしない)。
+    // 描くのはトーンタスク(キャッシュの持ち主)
+    bool prepare_tone(uint16_t freq_hz, uint16_t dur_ms, uint8_t level) noexcept;
+
+    // 持続音(shared/hostapi_note.h)。発音・エンベロープともトーンタスクが持つ。
+    // pitch は MIDI ノート番号 × 100 + セント、velocity 1..127
+    bool note_on(uint8_t ch, uint8_t env_slot, uint16_t pitch, uint8_t velocity) noexcept;
+    bool note_off(uint8_t ch) noexcept;
+    // エンベロープ slot の定義(後続の note_on から使われる)。取りこぼさない
+    bool note_define(uint8_t slot, uint16_t attack_ms, uint16_t decay_ms, uint8_t sustain,
+                     uint16_t release_ms) noexcept;
+    // 全チャネルを無音にしてエンベロープを既定値へ(アプリセッションの境界)
+    void reset_notes() noexcept;
+
+    // トーンタスクへの依頼(発音依頼キューの 1 件)。kind ごとに union の 1 つだけを
+    // 使う。作るのは下の組み立て関数
     struct ToneMsg {
-        uint16_t freq_hz;
-        uint16_t dur_ms;
-        uint8_t level;
+        enum class Kind : uint8_t {
+            kTone,        // トーンを 1 声
+            kPrepareTone, // トーンをキャッシュへ描くだけ
+            kSample,      // サンプルを 1 声
+            kStopSamples, // 全サンプル停止
+            kNoteOn,
+            kNoteOff,
+            kNoteEnv,     // エンベロープ slot の定義
+            kNoteReset,
+        };
+        struct Tone { uint16_t freq_hz; uint16_t dur_ms; uint8_t level; };
+        struct Sample { int16_t handle; uint8_t level; };
+        struct Note { uint8_t ch; uint8_t env_slot; uint16_t pitch; uint8_t velocity; };
+        struct Env {
+            uint8_t slot;
+            uint16_t attack_ms, decay_ms;
+            uint8_t sustain;
+            uint16_t release_ms;
+        };
+
+        Kind kind;
+        union {
+            Tone tone;     // kTone / kPrepareTone
+            Sample sample; // kSample
+            Note note;     // kNoteOn / kNoteOff(ch のみ)
+            Env env;       // kNoteEnv
+        };
+
+        static ToneMsg make(Kind kind) noexcept {
+            ToneMsg m{};
+            m.kind = kind;
+            return m;
+        }
+        static ToneMsg make_tone(Kind kind, uint16_t freq_hz, uint16_t dur_ms,
+                                 uint8_t level) noexcept {
+            ToneMsg m = make(kind);
+            m.tone = Tone{freq_hz, dur_ms, level};
+            return m;
+        }
+        static ToneMsg make_sample(int16_t handle, uint8_t level) noexcept {
+            ToneMsg m = make(Kind::kSample);
+            m.sample = Sample{handle, level};
+            return m;
+        }
+        static ToneMsg make_note(Kind kind, uint8_t ch, uint8_t env_slot = 0, uint16_t pitch = 0,
+                                 uint8_t velocity = 0) noexcept {
+            ToneMsg m = make(kind);
+            m.note = Note{ch, env_slot, pitch, velocity};
+            return m;
+        }
+        static ToneMsg make_env(uint8_t slot, uint16_t attack_ms, uint16_t decay_ms,
+                                uint8_t sustain, uint16_t release_ms) noexcept {
+            ToneMsg m = make(Kind::kNoteEnv);
+            m.env = Env{slot, attack_ms, decay_ms, sustain, release_ms};
+            return m;
+        }
     };
 
     // Start playback of a file via audio_player when available (fallback stubs otherwise)
-    bool play_file(const std::string& path) noexcept;
+    // start_ms >= 0: 曲の先頭を now_ms の時基でその時刻に出す(hostapi_audio_play_at)。
+    // すぐデコードを始め、その時刻のチャンクまでトーンタスクが取り出さずに待つ
+    bool play_file(const std::string& path, int64_t start_ms = -1) noexcept;
+    bool start_pending() const noexcept; // start_ms の曲がまだ鳴り始めていない
     void pause() noexcept;
     void resume() noexcept;
     void stop() noexcept;
@@ -69,13 +151,35 @@ public:
     bool is_paused() const noexcept;
     bool finished_flag() const noexcept { return finished_.load(); }
 
-private:
+    // 再生キュー(hostapi_audio_enqueue)の次の曲を開き、頭 ~100ms を別の
+    // デコーダで先読みしておく。今の曲が終わると player_callback が続けて
+    // デコードし、立ち上がるまでの間は先読みの PCM が埋める(曲間に無音を
+    // 挟まない)。開けなければ false。渡せるのは 1 曲だけで、play_file / stop で閉じる
+    bool queue_next(const std::string& path) noexcept;
+    void clear_next() noexcept;
+    // 次の曲へ切り替えた回数と最後に切り替えた時刻(now_ms と同じ時基)
+    uint32_t track_changes(uint32_t* time_ms) const noexcept {
+        const uint32_t n = track_changes_.load();
+        if (time_ms) *time_ms = track_change_ms_.load();
+        return n;
+    }
+
+    // 再生位置・シーク(shared/hostapi_mp3idx.h の索引を使う)。索引は曲が
+    // 始まるたびに低優先度タスクが作る(サイドカーがあれば読むだけ)。
+    // 位置はシーク先の時刻 + デコードしたフレーム数。シークは索引の
+    // フレーム境界へ丸めた実際の ms を返し、audio_player タスクが次に
+    // ファイルを読むところで移る。索引が無い・未完成なら -1
+    int32_t position_ms() const noexcept;
+    int32_t duration_ms() const noexcept;
+    int32_t seek_ms(uint32_t ms) noexcept;
+
     bool ensure_i2s(uint32_t rate_hz, uint8_t bits, bool stereo) noexcept;
     bool reconfig_rate(uint32_t rate_hz, uint32_t bits_cfg, i2s_slot_mode_t ch) noexcept;
     bool i2s_write(void* data, size_t len, uint32_t timeout_ms, size_t* written = nullptr) noexcept;
     void ensure_click_task() noexcept;
     void click_task_loop() noexcept;
-    void tone_write_now(const ToneMsg& msg) noexcept;
+    bool music_take(int16_t* out, int frames) noexcept;
+    void tone_start(const ToneMsg& msg) noexcept;
 #if HAVE_ESP_AUDIO_PLAYER
     static esp_err_t write_fn(void* audio_buffer, size_t len, size_t* bytes_written, uint32_t timeout_ms);
     static esp_err_t clk_set_fn(uint32_t rate, uint32_t bits_cfg, i2s_slot_mode_t ch);
@@ -90,6 +194,9 @@ private:
     std::string current_path_;
     std::atomic<bool> finished_{false};
     std::atomic<uint8_t> volume_{98}; // default near max
+    std::atomic<MusicSource*> next_src_{nullptr};  // 開いておいた次の曲
+    std::atomic<uint32_t> track_changes_{0};       // audio_player タスクだけが進める
+    std::atomic<uint32_t> track_change_ms_{0};
 
     // Current i2s format
     uint32_t cur_rate_ = 44100;
@@ -99,7 +206,8 @@ private:
     // audio_player synchronization
     static Mp3Player* s_self; // for static callbacks
     QueueHandle_t event_queue_ = nullptr;
-    // トーン発音タスク(Phase 7B fix: DMA プリフェッチ再生対策 / 7C: パラメトリック化)
+    // トーン発音タスク(Phase 7B fix: DMA プリフェッチ再生対策 / 7C: パラメトリック化)。
+    // 無音も含めて I2S へ書き続ける(shared/hostapi_stream.h)
     QueueHandle_t tone_queue_ = nullptr;
     TaskHandle_t click_task_ = nullptr;
 #if HAVE_ESP_AUDIO_PLAYER
@@ -115,6 +223,18 @@ extern "C" {
     void Audio_Click_Init(void);   // I2S のみ初期化(クリック音用)
     void Play_Click(void);         // クリック音を再生
     bool Play_Tone(uint16_t freq_hz, uint16_t dur_ms, uint8_t level); // 減衰サイン (7C)
+    void Tone_Prepare(uint16_t freq_hz, uint16_t dur_ms, uint8_t level); // レンダ済みへ描く
+    // サンプル(shared/hostapi_sample.h)。キャッシュは PSRAM のアリーナ
+    int  Sample_Load(const char* key, uint32_t key_len, const char* full_path); // ハンドル / -1
+    bool Sample_Exists(int handle);
+    bool Play_Sample(int handle, uint8_t level);
+    void Sample_Reset(void);       // 全サンプルを止めてキャッシュを空にする
+    // 持続音(shared/hostapi_note.h)
+    bool Note_On(uint8_t ch, uint8_t env_slot, uint16_t pitch, uint8_t velocity);
+    bool Note_Off(uint8_t ch);
+    bool Note_Define(uint8_t slot, uint16_t attack_ms, uint16_t decay_ms, uint8_t sustain,
+                     uint16_t release_ms);
+    void Note_Reset(void);         // 全チャネル無音、エンベロープを既定値へ
     void Play_Music(const char* directory, const char* fileName);
     void Music_resume(void);
     void Music_pause(void);
@@ -123,9 +243,27 @@ extern "C" {
     bool Music_is_paused(void);
     bool Music_finished(void);              // 自然終了フラグ(play_file で自動クリア)
     bool Music_play_path(const char* path); // フルパス指定の再生(wasm ホスト API 用)
+    bool Music_play_path_at(const char* path, uint32_t start_ms); // 時刻指定(now_ms の時基)
+    bool Music_start_pending(void);         // play_path_at の曲がまだ鳴り始めていない
+    // 再生キュー: 次の曲を開いておき、今の曲の終わりで無音を挟まずに続ける
+    bool Music_queue_next(const char* path);
+    void Music_clear_next(void);
+    uint32_t Music_track_changes(uint32_t* time_ms); // 切り替えた回数と最後の時刻
+    // 出力のレベル(shared/hostapi_levels.h)。最新のスナップショットを写す
+    void Audio_Get_Levels(hostapi_audio_levels_t* out);
+    // 描画位置(shared/hostapi_aclock.h)。frames / frames_us / rate / latency_us を
+    // 埋める。描画ループが回る前は false
+    bool Audio_Get_Clock(hostapi_audio_clock_t* out);
+    // 再生位置・曲の長さ・シーク(ms。使えなければ -1)
+    int32_t Music_position_ms(void);
+    int32_t Music_duration_ms(void);
+    int32_t Music_seek_ms(uint32_t ms);
     void Volume_adjustment(uint8_t Vol);
     extern uint8_t Audio_Volume;      // 0..100
     extern bool    Music_Next_Flag;   // Set true when file finished
+#if CONFIG_MIDIBOX_NATIVE_BENCH
+    void Audio_Bench_Voices(void);    // トーンのミックスコスト計測(起動時ベンチ)
+#endif
 }
 
 } // namespace audio
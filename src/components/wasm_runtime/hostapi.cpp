@@ -5,6 +5,11 @@
 // スロット数は固定で、あふれたら警告ログを出して無視する(PoC 割り切り)。
 #include "hostapi.hpp"
 #include "hostapi_defs.h"
+#include "hostapi_evq.h"
+#include "hostapi_evrec.h"
+#include "hostapi_gesture.h"
+#include "hostapi_playlist.h"
+#include "hostapi_tsched.h"
 
 #include "wasm_export.h"
 #include "lvgl.h"
@@ -16,7 +21,9 @@
 #include "freertos/FreeRTOS.h"
 
 #include <atomic>
+#include <cstdlib>
 #include <cstring>
+#include <mutex>
 #include <dirent.h>
 
 static const char* TAG = "WASM/API";
@@ -26,7 +33,9 @@ namespace {
 constexpr int kMaxTextSlots = 16;
 constexpr int kMaxRectSlots = 16;
 constexpr uint32_t kMaxTextLen = 63;
-constexpr int kEventQueueDepth = 16;
+constexpr int kEventQueueDepth = CONFIG_MIDIBOX_EVENT_QUEUE_DEPTH;
+static_assert(kEventQueueDepth >= 2 && (kEventQueueDepth & (kEventQueueDepth - 1)) == 0,
+              "MIDIBOX_EVENT_QUEUE_DEPTH must be a power of two");
 
 struct TextSlot {
     lv_obj_t* label = nullptr;
@@ -36,73 +45,244 @@ struct RectSlot {
     lv_obj_t* rect = nullptr;
     int32_t x = 0, y = 0;
 };
+// 折れ線/点列スロット。1 slot = 1 オブジェクトで、LV_EVENT_DRAW_MAIN の中で
+// 点列をまとめて描く(lv_line は lv_point_precise_t 配列を要求し点あたり 8 バイト
+// 食うため、アプリの int16 点列をそのまま LVGL ヒープに保持して使う)。
+struct LineSlot {
+    lv_obj_t* obj = nullptr;
+    int16_t* pts = nullptr; // x, y 交互(lv_malloc)
+    uint32_t n = 0;
+    uint32_t cap = 0;       // pts の確保済み点数
+    bool points = false;    // true=点列、false=折れ線
+    uint32_t rgb888 = 0;
+};
+
+// ネイティブ部品 (hostapi_defs.h の widget)。押下色は LVGL の PRESSED 状態
+// スタイルで描くので、押下フィードバックは LVGL タスクの次フレームに出る。
+// 配色は Linux ホスト (hosts/linux/hostapi_sdl.c) と共通。
+constexpr uint32_t kWidgetColorBg = 0x2a3340;
+constexpr uint32_t kWidgetColorPressed = 0x4a6a90;
+constexpr uint32_t kWidgetColorOn = 0x2f7d4f;
+constexpr uint32_t kWidgetColorFill = 0x3a7bd5;
+
+struct WidgetSlot {
+    lv_obj_t* obj = nullptr;  // 本体(クリック可)。label / fill はその子
+    lv_obj_t* fill = nullptr; // SLIDER の値バー
+    int kind = 0;             // HOSTAPI_WIDGET_*(0=未使用)
+    int32_t x = 0, y = 0, w = 0, h = 0;
+    int value = 0;            // LVGL タスクと wasm スレッドの双方から lvgl_port_lock 下で触る
+};
 
 lv_obj_t* s_screen = nullptr;
 TextSlot s_texts[kMaxTextSlots];
 RectSlot s_rects[kMaxRectSlots];
+LineSlot s_lines[HOSTAPI_LINE_SLOTS];
+WidgetSlot s_widgets[HOSTAPI_WIDGET_SLOTS];
 
-// ---- 入力イベントキュー (Phase 6A) ----
-// 生産者は LVGL タスク(スクリーンの event cb)、消費者は wasm アプリスレッド
-// (poll_event)。臨界区間は短い(最大 16 レコードの memcpy)ので spinlock。
-hostapi_event_t s_evq[kEventQueueDepth];
-int s_evq_head = 0;
-int s_evq_count = 0;
-bool s_down_delivered = false; // DOWN を配送済みか(孤児 UP の抑止)
-portMUX_TYPE s_evq_mux = portMUX_INITIALIZER_UNLOCKED;
+// スクリーン削除前後に呼ぶ(オブジェクトはスクリーンと一緒に消える。点列バッファ
+// だけ返却する)。lvgl_port_lock 下で呼ぶこと
+void line_slots_reset()
+{
+    for (auto& l : s_lines) {
+        if (l.pts) lv_free(l.pts);
+        l = LineSlot{};
+    }
+}
 
+// ---- 入力イベントキュー (Phase 6A) ----
+// 生産者は LVGL タスク(スクリーン / 部品の event cb)、消費者は wasm アプリ
+// スレッド(poll_event)。shared/hostapi_evq.h のロックフリー SPSC リングで、
+// 生産者はウェイトフリー(LVGL タスクが割り込み禁止区間で待たない)。
+hostapi_evq_slot_t s_evq_slots[kEventQueueDepth];
+hostapi_evq_t s_evq = HOSTAPI_EVQ_INITIALIZER(s_evq_slots, kEventQueueDepth);
+hostapi_gesture_t s_gesture; // ジェスチャ認識器(LVGL タスク専有)
+
+// 生産者・消費者とも止まっている時に呼ぶ(lvgl_port_lock 中 + アプリ非実行)。
 void event_queue_reset()
 {
-    portENTER_CRITICAL(&s_evq_mux);
-    s_evq_head = 0;
-    s_evq_count = 0;
-    s_down_delivered = false;
-    portEXIT_CRITICAL(&s_evq_mux);
+    if (s_evq.dropped || s_evq.coalesced) {
+        ESP_LOGI(TAG, "event queue: dropped %u, coalesced %u, high water %u/%d",
+                 (unsigned)s_evq.dropped, (unsigned)s_evq.coalesced,
+                 (unsigned)s_evq.high_water, kEventQueueDepth);
+    }
+    hostapi_evq_reset(&s_evq);
+    hostapi_gesture_reset(&s_gesture, 0); // ジェスチャはアプリごとに既定で無効
 }
 
-void push_event(uint16_t type, int16_t x, int16_t y)
+#if CONFIG_MIDIBOX_EVENT_RECORD
+// ---- 入力イベント記録(shared/hostapi_evrec.h) ----
+// LVGL タスクで配送したイベントを RAM に貯め、アプリ破棄時に SD へ書く
+// (入力経路で SD を待たない)。Linux ホストの --replay で再生できる。
+constexpr int kEvRecMax = 4096; // 48KB。超えた分は捨てる
+constexpr const char* kEvRecPath = "/sdcard/evrec.mbev";
+hostapi_event_t* s_evrec = nullptr; // 追記は生産者(LVGL タスク)のみ
+int s_evrec_count = 0;
+uint32_t s_evrec_base_ms = 0;
+
+// lvgl_port_lock 中に呼ぶ
+void evrec_start()
 {
-    const uint32_t now = (uint32_t)(esp_timer_get_time() / 1000);
-    bool dropped = false;
-
-    portENTER_CRITICAL(&s_evq_mux);
-    // アプリ起動タップの UP がアプリに漏れないよう、DOWN 未配送の UP は捨てる
-    if (type == HOSTAPI_EV_TOUCH_UP && !s_down_delivered) {
-        portEXIT_CRITICAL(&s_evq_mux);
-        return;
-    }
-    if (type == HOSTAPI_EV_TOUCH_DOWN) s_down_delivered = true;
+    free(s_evrec);
+    s_evrec = static_cast<hostapi_event_t*>(malloc(sizeof(hostapi_event_t) * kEvRecMax));
+    if (!s_evrec) ESP_LOGW(TAG, "evrec: no memory, not recording");
+    s_evrec_count = 0;
+    s_evrec_base_ms = (uint32_t)(esp_timer_get_time() / 1000);
+}
 
-    if (s_evq_count == kEventQueueDepth) { // 満杯: 最古を捨てる
-        s_evq_head = (s_evq_head + 1) % kEventQueueDepth;
-        s_evq_count--;
-        dropped = true;
-    }
-    hostapi_event_t& ev = s_evq[(s_evq_head + s_evq_count) % kEventQueueDepth];
+void evrec_add(uint16_t type, uint16_t param, int16_t x, int16_t y, uint32_t time_ms)
+{
+    if (!s_evrec || s_evrec_count >= kEvRecMax) return;
+    hostapi_event_t& ev = s_evrec[s_evrec_count++];
     ev.type = type;
-    ev.param = 0;
+    ev.param = param;
     ev.x = x;
     ev.y = y;
-    ev.time_ms = now;
-    s_evq_count++;
-    portEXIT_CRITICAL(&s_evq_mux);
+    ev.time_ms = time_ms - s_evrec_base_ms;
+}
+
+// lvgl_port_lock 中に記録を切り離し、書き込みはロック外で行う
+void evrec_save(hostapi_event_t* recs, int count)
+{
+    if (!recs) return;
+    FILE* f = fopen(kEvRecPath, "wb");
+    bool ok = f && hostapi_evrec_write_header(f);
+    for (int i = 0; ok && i < count; ++i) ok = hostapi_evrec_write(f, &recs[i]);
+    if (f) fclose(f);
+    free(recs);
+    if (ok) {
+        ESP_LOGI(TAG, "evrec: %d events -> %s%s", count, kEvRecPath,
+                 count >= kEvRecMax ? " (truncated)" : "");
+    } else {
+        ESP_LOGW(TAG, "evrec: cannot write %s", kEvRecPath);
+    }
+}
+#endif
+
+void push_event_at(uint16_t type, uint16_t param, int16_t x, int16_t y, uint32_t time_ms)
+{
+    const hostapi_evq_result_t r = hostapi_evq_push(&s_evq, type, param, x, y, time_ms);
+    if (r == HOSTAPI_EVQ_DROPPED_OLDEST) {
+        ESP_LOGW(TAG, "event queue full, dropped oldest");
+    }
+#if CONFIG_MIDIBOX_EVENT_RECORD
+    if (r != HOSTAPI_EVQ_REJECTED) evrec_add(type, param, x, y, time_ms);
+#endif
+}
 
-    if (dropped) ESP_LOGW(TAG, "event queue full, dropped oldest");
+void push_event(uint16_t type, uint16_t param, int16_t x, int16_t y)
+{
+    push_event_at(type, param, x, y, (uint32_t)(esp_timer_get_time() / 1000));
 }
 
-// アプリスクリーンの PRESSED/RELEASED(LVGL タスクから)
+// ---- ジェスチャ(shared/hostapi_gesture.h) ----
+// 認識器は LVGL タスク(生産者)だけが触る。長押し連打の期限は別タイマーを
+// 立てず(キューの生産者が 2 つになる)、押下中の入力読み取りごとに来る
+// PRESSING で評価する。積むのは読み取り周期ぶん遅れ得るが、time_ms は予定時刻。
+
+void gesture_emit(void* ctx, uint16_t type, uint16_t param, int16_t x, int16_t y,
+                  int64_t time_us)
+{
+    (void)ctx;
+    push_event_at(type, param, x, y, (uint32_t)(time_us / 1000));
+}
+
+// アプリスクリーンの PRESSED/PRESSING/RELEASED(LVGL タスクから)。
+// PRESSING は押下中の入力読み取りごとに来るので、位置が変わったときだけ MOVE にする
 void screen_input_event_cb(lv_event_t* e)
 {
+    static lv_point_t s_last;
     lv_indev_t* indev = lv_event_get_indev(e);
     if (!indev) return;
     lv_point_t p;
     lv_indev_get_point(indev, &p);
+    const int64_t now_us = esp_timer_get_time();
+    const auto x = (int16_t)p.x;
+    const auto y = (int16_t)p.y;
+
+    // 期限の来た長押し連打を先に積み、キュー内を時刻順に保つ
+    hostapi_gesture_timer(&s_gesture, now_us, gesture_emit, nullptr);
 
+    uint16_t type;
     const lv_event_code_t code = lv_event_get_code(e);
     if (code == LV_EVENT_PRESSED) {
-        push_event(HOSTAPI_EV_TOUCH_DOWN, (int16_t)p.x, (int16_t)p.y);
+        s_last = p;
+        type = HOSTAPI_EV_TOUCH_DOWN;
+    } else if (code == LV_EVENT_PRESSING) {
+        if (p.x == s_last.x && p.y == s_last.y) return;
+        s_last = p;
+        type = HOSTAPI_EV_TOUCH_MOVE;
     } else if (code == LV_EVENT_RELEASED) {
-        push_event(HOSTAPI_EV_TOUCH_UP, (int16_t)p.x, (int16_t)p.y);
+        type = HOSTAPI_EV_TOUCH_UP;
+    } else {
+        return;
     }
+    push_event_at(type, 0, x, y, (uint32_t)(now_us / 1000));
+    hostapi_gesture_touch(&s_gesture, type, x, y, now_us, gesture_emit, nullptr);
+}
+
+// ---- widget ----
+// 部品はクリック可能な子オブジェクトなので、部品上のタッチはスクリーンの
+// event cb に届かない(= TOUCH_DOWN/UP を配送しない契約をそのまま満たす)。
+
+// value を見た目(TOGGLE の CHECKED 状態 / SLIDER の値バー)へ反映する
+void widget_apply_value(WidgetSlot& w)
+{
+    if (w.kind == HOSTAPI_WIDGET_TOGGLE) {
+        if (w.value) lv_obj_add_state(w.obj, LV_STATE_CHECKED);
+        else lv_obj_remove_state(w.obj, LV_STATE_CHECKED);
+    } else if (w.kind == HOSTAPI_WIDGET_SLIDER) {
+        if (w.h > w.w) {
+            const int32_t fh = w.h * w.value / HOSTAPI_WIDGET_SLIDER_MAX;
+            lv_obj_set_pos(w.fill, 0, w.h - fh);
+            lv_obj_set_size(w.fill, w.w, fh);
+        } else {
+            lv_obj_set_pos(w.fill, 0, 0);
+            lv_obj_set_size(w.fill, w.w * w.value / HOSTAPI_WIDGET_SLIDER_MAX, w.h);
+        }
+    }
+}
+
+// 部品の event cb(LVGL タスクから。lvgl_port_lock 保持中)
+void widget_event_cb(lv_event_t* e)
+{
+    const int id = (int)(intptr_t)lv_event_get_user_data(e);
+    WidgetSlot& w = s_widgets[id];
+    const lv_event_code_t code = lv_event_get_code(e);
+
+    if (code == LV_EVENT_CLICKED) { // 部品内で離した(外に出たら PRESS_LOST で来ない)
+        if (w.kind == HOSTAPI_WIDGET_BUTTON) {
+            push_event(HOSTAPI_EV_WIDGET, (uint16_t)id, 0, HOSTAPI_WIDGET_EV_ACTIVATED);
+        } else if (w.kind == HOSTAPI_WIDGET_TOGGLE) {
+            w.value = !w.value;
+            widget_apply_value(w);
+            push_event(HOSTAPI_EV_WIDGET, (uint16_t)id, (int16_t)w.value,
+                       HOSTAPI_WIDGET_EV_CHANGED);
+        }
+    } else if ((code == LV_EVENT_PRESSED || code == LV_EVENT_PRESSING) &&
+               w.kind == HOSTAPI_WIDGET_SLIDER) {
+        lv_indev_t* indev = lv_event_get_indev(e);
+        if (!indev) return;
+        lv_point_t p;
+        lv_indev_get_point(indev, &p);
+        int v;
+        if (w.h > w.w) {
+            v = (w.y + w.h - 1 - p.y) * HOSTAPI_WIDGET_SLIDER_MAX / (w.h > 1 ? w.h - 1 : 1);
+        } else {
+            v = (p.x - w.x) * HOSTAPI_WIDGET_SLIDER_MAX / (w.w > 1 ? w.w - 1 : 1);
+        }
+        if (v < 0) v = 0;
+        if (v > HOSTAPI_WIDGET_SLIDER_MAX) v = HOSTAPI_WIDGET_SLIDER_MAX;
+        if (v != w.value) {
+            w.value = v;
+            widget_apply_value(w);
+            push_event(HOSTAPI_EV_WIDGET, (uint16_t)id, (int16_t)v, HOSTAPI_WIDGET_EV_CHANGED);
+        }
+    }
+}
+
+void widget_slots_reset()
+{
+    for (auto& w : s_widgets) w = WidgetSlot{};
 }
 
 // ---- native implementations (wasm import "env") ----
@@ -183,13 +363,243 @@ void native_hostapi_fill_rect(wasm_exec_env_t exec_env, int32_t x, int32_t y,
     lvgl_port_unlock();
 }
 
+// ---- 折れ線/点列 ----
+// オブジェクトの領域は点列の外接矩形(+1px)。無効化は旧・新の外接矩形だけで済み、
+// 描画は点の絶対座標で行う(アプリスクリーンは原点 (0,0))。
+void line_draw_cb(lv_event_t* e)
+{
+    const LineSlot* l = static_cast<const LineSlot*>(lv_event_get_user_data(e));
+    lv_layer_t* layer = lv_event_get_layer(e);
+    if (l->n == 0) return;
+
+    if (l->points) {
+        lv_draw_rect_dsc_t dsc;
+        lv_draw_rect_dsc_init(&dsc);
+        dsc.bg_color = lv_color_hex(l->rgb888);
+        dsc.bg_opa = LV_OPA_COVER;
+        for (uint32_t i = 0; i < l->n; i++) {
+            const lv_area_t a = {l->pts[i * 2], l->pts[i * 2 + 1],
+                                 l->pts[i * 2], l->pts[i * 2 + 1]};
+            lv_draw_rect(layer, &dsc, &a);
+        }
+    } else {
+        lv_draw_line_dsc_t dsc;
+        lv_draw_line_dsc_init(&dsc);
+        dsc.color = lv_color_hex(l->rgb888);
+        dsc.width = 1;
+        dsc.opa = LV_OPA_COVER;
+        for (uint32_t i = 1; i < l->n; i++) {
+            dsc.p1.x = l->pts[(i - 1) * 2];
+            dsc.p1.y = l->pts[(i - 1) * 2 + 1];
+            dsc.p2.x = l->pts[i * 2];
+            dsc.p2.y = l->pts[i * 2 + 1];
+            lv_draw_line(layer, &dsc);
+        }
+    }
+}
+
+// draw_lines / draw_points 共通。pts は WAMR 境界検証済みだがアラインメントの
+// 保証はない(xtensa は非整列ロードで落ちる)ので memcpy で取り込む。
+int32_t line_slot_set(int32_t slot, const char* pts, uint32_t len, uint32_t rgb888,
+                      bool points)
+{
+    if (slot < 0 || slot >= HOSTAPI_LINE_SLOTS) return -1;
+    if (len % 4 != 0) return -1;
+    uint32_t n = len / 4;
+    if (n > HOSTAPI_LINE_MAX_POINTS) {
+        ESP_LOGW(TAG, "%s: %u points truncated to %d",
+                 points ? "draw_points" : "draw_lines", (unsigned)n,
+                 HOSTAPI_LINE_MAX_POINTS);
+        n = HOSTAPI_LINE_MAX_POINTS;
+    }
+
+    lvgl_port_lock(0);
+    if (!s_screen) {
+        lvgl_port_unlock();
+        return 0;
+    }
+    LineSlot& l = s_lines[slot];
+    if (n > l.cap) {
+        int16_t* p = static_cast<int16_t*>(lv_realloc(l.pts, n * 4));
+        if (!p) {
+            lvgl_port_unlock();
+            ESP_LOGW(TAG, "draw_lines: out of LVGL memory (%u points)", (unsigned)n);
+            return -1;
+        }
+        l.pts = p;
+        l.cap = n;
+    }
+    if (n > 0) memcpy(l.pts, pts, n * 4);
+    l.n = n;
+    l.points = points;
+    l.rgb888 = rgb888;
+
+    if (!l.obj) {
+        l.obj = lv_obj_create(s_screen);
+        lv_obj_remove_style_all(l.obj);
+        lv_obj_remove_flag(l.obj, LV_OBJ_FLAG_CLICKABLE);
+        lv_obj_add_event_cb(l.obj, line_draw_cb, LV_EVENT_DRAW_MAIN, &l);
+    }
+    if (n == 0) {
+        lv_obj_add_flag(l.obj, LV_OBJ_FLAG_HIDDEN);
+    } else {
+        int32_t x0 = l.pts[0], x1 = l.pts[0], y0 = l.pts[1], y1 = l.pts[1];
+        for (uint32_t i = 1; i < n; i++) {
+            const int32_t x = l.pts[i * 2], y = l.pts[i * 2 + 1];
+            if (x < x0) x0 = x;
+            if (x > x1) x1 = x;
+            if (y < y0) y0 = y;
+            if (y > y1) y1 = y;
+        }
+        lv_obj_remove_flag(l.obj, LV_OBJ_FLAG_HIDDEN);
+        lv_obj_invalidate(l.obj); // 旧領域
+        lv_obj_set_pos(l.obj, x0 - 1, y0 - 1);
+        lv_obj_set_size(l.obj, x1 - x0 + 3, y1 - y0 + 3);
+        lv_obj_invalidate(l.obj); // 新領域(外接矩形が同じでも中身は変わる)
+    }
+    lvgl_port_unlock();
+    return 0;
+}
+
+int32_t native_hostapi_draw_lines(wasm_exec_env_t exec_env, int32_t slot,
+                                  const char* pts, uint32_t len, uint32_t rgb888)
+{
+    (void)exec_env;
+    return line_slot_set(slot, pts, len, rgb888, false);
+}
+
+int32_t native_hostapi_draw_points(wasm_exec_env_t exec_env, int32_t slot,
+                                   const char* pts, uint32_t len, uint32_t rgb888)
+{
+    (void)exec_env;
+    return line_slot_set(slot, pts, len, rgb888, true);
+}
+
+int32_t native_hostapi_widget_create(wasm_exec_env_t exec_env, int32_t id, int32_t kind,
+                                     int32_t x, int32_t y, int32_t w, int32_t h,
+                                     const char* label, uint32_t len)
+{
+    (void)exec_env;
+    if (id < 0 || id >= HOSTAPI_WIDGET_SLOTS) return -1;
+    if (kind < HOSTAPI_WIDGET_BUTTON || kind > HOSTAPI_WIDGET_SLIDER) return -1;
+    if (w <= 0 || h <= 0) return -1;
+
+    char buf[kMaxTextLen + 1];
+    if (len > kMaxTextLen) len = kMaxTextLen;
+    memcpy(buf, label, len);
+    buf[len] = '\0';
+
+    lvgl_port_lock(0);
+    if (!s_screen) {
+        lvgl_port_unlock();
+        return 0;
+    }
+    WidgetSlot& ws = s_widgets[id];
+    if (ws.obj) lv_obj_delete(ws.obj); // 置き換えは作り直し(値も 0 に戻る)
+    ws = WidgetSlot{};
+    ws.kind = kind;
+    ws.x = x; ws.y = y; ws.w = w; ws.h = h;
+
+    ws.obj = lv_obj_create(s_screen);
+    lv_obj_remove_style_all(ws.obj);
+    lv_obj_set_pos(ws.obj, x, y);
+    lv_obj_set_size(ws.obj, w, h);
+    lv_obj_remove_flag(ws.obj, LV_OBJ_FLAG_SCROLLABLE);
+    lv_obj_remove_flag(ws.obj, LV_OBJ_FLAG_SCROLL_CHAIN); // ドラッグでスクリーンを動かさない
+    if (kind != HOSTAPI_WIDGET_SLIDER) {
+        // 部品外へ滑ったら PRESS_LOST にする(外で離しても CLICKED にしない)
+        lv_obj_remove_flag(ws.obj, LV_OBJ_FLAG_PRESS_LOCK);
+    }
+    lv_obj_set_style_bg_opa(ws.obj, LV_OPA_COVER, 0);
+    lv_obj_set_style_bg_color(ws.obj, lv_color_hex(kWidgetColorBg), 0);
+    lv_obj_set_style_bg_color(ws.obj, lv_color_hex(kWidgetColorOn), LV_STATE_CHECKED);
+    lv_obj_set_style_bg_color(ws.obj, lv_color_hex(kWidgetColorPressed), LV_STATE_PRESSED);
+
+    if (kind == HOSTAPI_WIDGET_SLIDER) {
+        ws.fill = lv_obj_create(ws.obj);
+        lv_obj_remove_style_all(ws.fill);
+        lv_obj_remove_flag(ws.fill, LV_OBJ_FLAG_CLICKABLE);
+        lv_obj_set_style_bg_opa(ws.fill, LV_OPA_COVER, 0);
+        lv_obj_set_style_bg_color(ws.fill, lv_color_hex(kWidgetColorFill), 0);
+    }
+    if (len > 0) {
+        lv_obj_t* lbl = lv_label_create(ws.obj);
+        lv_obj_set_style_text_color(lbl, lv_color_white(), 0);
+        lv_label_set_text(lbl, buf);
+        lv_obj_center(lbl);
+    }
+    widget_apply_value(ws);
+
+    void* user = (void*)(intptr_t)id;
+    lv_obj_add_event_cb(ws.obj, widget_event_cb, LV_EVENT_CLICKED, user);
+    if (kind == HOSTAPI_WIDGET_SLIDER) {
+        lv_obj_add_event_cb(ws.obj, widget_event_cb, LV_EVENT_PRESSED, user);
+        lv_obj_add_event_cb(ws.obj, widget_event_cb, LV_EVENT_PRESSING, user);
+    }
+    lvgl_port_unlock();
+    return 0;
+}
+
+int32_t native_hostapi_widget_set_value(wasm_exec_env_t exec_env, int32_t id, int32_t value)
+{
+    (void)exec_env;
+    if (id < 0 || id >= HOSTAPI_WIDGET_SLOTS) return -1;
+
+    int32_t ret = 0;
+    lvgl_port_lock(0);
+    WidgetSlot& ws = s_widgets[id];
+    if (ws.kind == HOSTAPI_WIDGET_TOGGLE) {
+        ws.value = value ? 1 : 0;
+    } else if (ws.kind == HOSTAPI_WIDGET_SLIDER) {
+        if (value < 0) value = 0;
+        if (value > HOSTAPI_WIDGET_SLIDER_MAX) value = HOSTAPI_WIDGET_SLIDER_MAX;
+        ws.value = value;
+    } else {
+        ret = -1;
+    }
+    if (ret == 0) widget_apply_value(ws);
+    lvgl_port_unlock();
+    return ret;
+}
+
+int32_t native_hostapi_widget_get_value(wasm_exec_env_t exec_env, int32_t id)
+{
+    (void)exec_env;
+    if (id < 0 || id >= HOSTAPI_WIDGET_SLOTS) return -1;
+
+    lvgl_port_lock(0);
+    const WidgetSlot& ws = s_widgets[id];
+    const bool has_value = ws.kind == HOSTAPI_WIDGET_TOGGLE || ws.kind == HOSTAPI_WIDGET_SLIDER;
+    const int32_t v = has_value ? ws.value : -1;
+    lvgl_port_unlock();
+    return v;
+}
+
+int32_t native_hostapi_widget_delete(wasm_exec_env_t exec_env, int32_t id)
+{
+    (void)exec_env;
+    if (id < 0 || id >= HOSTAPI_WIDGET_SLOTS) return -1;
+
+    lvgl_port_lock(0);
+    WidgetSlot& ws = s_widgets[id];
+    if (ws.obj) lv_obj_delete(ws.obj);
+    ws = WidgetSlot{};
+    lvgl_port_unlock();
+    return 0;
+}
+
 // ---- トーン予約発音 (Phase 7A/7C) ----
 // 方式(a): esp_timer ワンショット(systimer, µs 分解能、タスクディスパッチ)。
 // 発音自体は audio の専用タスクに依頼するため、どのコンテキストからも軽い。
+// 予約は shared/hostapi_tsched.h の時刻順キュー(tone_schedule の 1 件 +
+// tone_enqueue の複数)で、タイマは常に先頭の時刻に 1 本だけアームする。
 esp_timer_handle_t s_click_timer = nullptr;
-uint32_t s_click_pending = 0;    // 予約時刻(0=なし)
-uint32_t s_click_last_fired = 0;
+hostapi_tsched_t s_tsched;         // s_click_mux 下で参照
+uint32_t s_click_last_fired = 0;   // tone_schedule の最後に発音した予約時刻
 portMUX_TYPE s_click_mux = portMUX_INITIALIZER_UNLOCKED;
+// 先頭時刻の読み取りからタイマの再アームまでを直列化する(wasm スレッドの
+// 予約と esp_timer タスクの発火が交互に stop/start して遅い方の時刻が残るのを防ぐ)
+std::mutex s_click_arm_mutex;
 
 // トーンパレット (Phase 7C)。アプリセッション状態(reset で初期化)。
 struct ToneDef {
@@ -199,7 +609,6 @@ struct ToneDef {
     uint8_t level;
 };
 ToneDef s_tones[HOSTAPI_TONE_SLOTS];
-ToneDef s_pending_tone; // 予約時のスナップショット(s_click_mux 下で参照)
 
 constexpr ToneDef kDefaultClick = {true, 1000, 30, 100};
 
@@ -236,26 +645,55 @@ void click_record_fire()
     }
 }
 
-// esp_timer タスク上で実行される。発火対象は「期限が来ている予約」のみ
-// (置き換え直後に旧期限の発火が走った場合、新予約が未来なら何もしない)。
-void click_timer_cb(void*)
+// タイマを予約キュー先頭の時刻にアームし直す(空なら止める)
+void click_timer_rearm()
 {
-    const uint32_t now = (uint32_t)(esp_timer_get_time() / 1000);
-    uint32_t t = 0;
-    ToneDef tone{};
+    std::lock_guard<std::mutex> lk(s_click_arm_mutex);
     portENTER_CRITICAL(&s_click_mux);
-    if (s_click_pending != 0 && s_click_pending <= now + 1) {
-        t = s_click_pending;
-        tone = s_pending_tone;
-        s_click_pending = 0;
-        s_click_last_fired = t;
-    }
+    const hostapi_tsched_entry_t* top = hostapi_tsched_top(&s_tsched);
+    const bool armed = top != nullptr;
+    const int64_t t_us = armed ? hostapi_tsched_time_us(top) : 0;
     portEXIT_CRITICAL(&s_click_mux);
-    if (t != 0) {
+    esp_timer_stop(s_click_timer); // 未アームなら INVALID_STATE(無視)
+    if (!armed) return;
+    int64_t delta_us = t_us - esp_timer_get_time();
+    if (delta_us < 0) delta_us = 0; // 過ぎた予約は可及的速やかに
+    esp_timer_start_once(s_click_timer, (uint64_t)delta_us);
+}
+
+// esp_timer タスク上で実行される。発火対象は「期限が来ている予約」のみで、
+// 同時刻(和音)や近接した予約はまとめて発音し、次の先頭に再アームする。
+// ms の予約は 1ms 手前から期限とみなす(ms 精度なので)。µs の予約(aclock)は
+// 時刻どおりにしか発火させない
+void click_timer_cb(void*)
+{
+    for (;;) {
+        const int64_t now_us = esp_timer_get_time();
+        hostapi_tsched_entry_t e;
+        bool due = false;
+        portENTER_CRITICAL(&s_click_mux);
+        const hostapi_tsched_entry_t* top = hostapi_tsched_top(&s_tsched);
+        if (top && hostapi_tsched_time_us(top) <= now_us + (top->aclock ? 0 : 1000)) {
+            e = hostapi_tsched_pop(&s_tsched);
+            if (e.id == 0) s_click_last_fired = hostapi_tsched_time_ms(&e);
+            due = true;
+        }
+        portEXIT_CRITICAL(&s_click_mux);
+        if (!due) break;
         click_record_fire();
-        audio::Play_Tone(tone.freq_hz, tone.dur_ms, tone.level);
-        midi::Midi_NotifyBeatFired(t); // Phase 8b: 24ppqn クロックの位相再同期
+        if (e.note == HOSTAPI_TSCHED_NOTE_ON) {
+            audio::Note_On(e.note_ch, e.note_env, e.freq_hz, e.level);
+        } else if (e.note == HOSTAPI_TSCHED_NOTE_OFF) {
+            audio::Note_Off(e.note_ch);
+        } else if (e.sample >= 0) {
+            audio::Play_Sample(e.sample, e.level);
+        } else {
+            audio::Play_Tone(e.freq_hz, e.dur_ms, e.level);
+        }
+        // Phase 8b: 24ppqn クロックの位相再同期(tone_schedule の予約のみ)
+        if (e.id == 0) midi::Midi_NotifyBeatFired(hostapi_tsched_time_ms(&e));
     }
+    click_timer_rearm();
 }
 
 void click_timer_ensure()
@@ -296,53 +734,154 @@ int32_t tone_schedule_impl(int32_t slot, int32_t time_ms)
 
     if (t == 0) { // キャンセル(slot によらず有効)
         portENTER_CRITICAL(&s_click_mux);
-        s_click_pending = 0;
+        hostapi_tsched_cancel_legacy(&s_tsched);
         portEXIT_CRITICAL(&s_click_mux);
-        esp_timer_stop(s_click_timer); // 未アームなら INVALID_STATE(無視)
+        click_timer_rearm();
         return 0;
     }
 
     ToneDef tone;
     if (!tone_lookup(slot, &tone)) return -1;
 
+    // 置き換え(トーンは予約時スナップショット)。t <= last_fired は冪等な
+    // 再予約として無視。置き換えガード: 期限到来済みの未発火予約(タイマ発火
+    // より先に wasm 側の置き換えが来たケース)は破棄せず、発音扱いにしてから
+    // 置き換える
     const uint32_t now_pre = (uint32_t)(esp_timer_get_time() / 1000);
-    bool fire_old = false;
-    ToneDef old_tone{};
+    hostapi_tsched_entry_t old;
+    bool fire_old;
     portENTER_CRITICAL(&s_click_mux);
-    if (t <= s_click_last_fired) { // 冪等な再予約: 無視
-        portEXIT_CRITICAL(&s_click_mux);
-        return 0;
-    }
-    // 置き換えガード: 期限到来済みの未発火予約(タイマ発火より先に wasm 側の
-    // 置き換えが来たケース)は破棄せず、ここで発音扱いにしてから置き換える
-    if (s_click_pending != 0 && s_click_pending != t &&
-        s_click_pending <= now_pre && s_click_pending > s_click_last_fired) {
-        s_click_last_fired = s_click_pending;
-        old_tone = s_pending_tone;
-        fire_old = true;
-    }
-    s_click_pending = t; // 置き換え(トーンは予約時スナップショット)
-    s_pending_tone = tone;
+    const bool scheduled =
+        hostapi_tsched_set_legacy(&s_tsched, t, now_pre, &s_click_last_fired, tone.freq_hz,
+                                  tone.dur_ms, tone.level, &old, &fire_old);
     const uint32_t last_fired_snapshot = s_click_last_fired;
     portEXIT_CRITICAL(&s_click_mux);
+    if (!scheduled) return 0;
     // Phase 8b: 新しい予約(t)が確定した時点でテンポを staging する。
     // fire_old で旧予約を発音扱いにする場合は、その通知より先に行う
     // (旧拍の発音通知が picks up できるよう、先に最新テンポを渡しておく)。
     midi::Midi_NotifyBeatScheduled(t);
     if (fire_old) {
         click_record_fire();
-        audio::Play_Tone(old_tone.freq_hz, old_tone.dur_ms, old_tone.level);
+        audio::Play_Tone(old.freq_hz, old.dur_ms, old.level);
         midi::Midi_NotifyBeatFired(last_fired_snapshot);
     }
-
-    const uint32_t now = (uint32_t)(esp_timer_get_time() / 1000);
-    int64_t delta_us = ((int64_t)t - (int64_t)now) * 1000;
-    if (delta_us < 0) delta_us = 0; // 過ぎた予約は可及的速やかに
-    esp_timer_stop(s_click_timer);
-    esp_timer_start_once(s_click_timer, (uint64_t)delta_us);
+    click_timer_rearm();
     return 0;
 }
 
+// 時刻を入れたエントリに id を振って積む。先頭が変わったときだけ再アームする
+int32_t tsched_enqueue(hostapi_tsched_entry_t e)
+{
+    if (!s_click_timer) return -1;
+    int32_t id = -1;
+    bool new_top = false;
+    portENTER_CRITICAL(&s_click_mux);
+    e.id = hostapi_tsched_next_id(&s_tsched);
+    if (hostapi_tsched_insert(&s_tsched, &e)) {
+        id = e.id;
+        new_top = hostapi_tsched_top(&s_tsched)->id == id;
+    }
+    portEXIT_CRITICAL(&s_click_mux);
+    if (new_top) click_timer_rearm();
+    return id;
+}
+
+// 予約を 1 件追加する(置き換えない)。時刻は µs(ms の API は × 1000、
+// aclock = µs の API。実機は now_ms と now_us64 が同じ時計なので扱いは同じ)
+int32_t tone_enqueue_impl(int32_t slot, int64_t time_us, bool aclock)
+{
+    if (!s_click_timer) return -1;
+    ToneDef tone;
+    if (!tone_lookup(slot, &tone)) return -1;
+    hostapi_tsched_entry_t e = hostapi_tsched_tone_entry(tone.freq_hz, tone.dur_ms, tone.level);
+    if (!hostapi_tsched_set_time_us(&e, time_us, aclock)) return -1;
+    return tsched_enqueue(e);
+}
+
+int32_t tone_cancel_impl(int32_t id)
+{
+    if (!s_click_timer || id < 0) return -1;
+    bool ok = true;
+    portENTER_CRITICAL(&s_click_mux);
+    if (id == 0) {
+        hostapi_tsched_clear(&s_tsched); // last_fired は保つ
+    } else {
+        ok = hostapi_tsched_remove_id(&s_tsched, id);
+    }
+    portEXIT_CRITICAL(&s_click_mux);
+    if (ok) click_timer_rearm();
+    return ok ? 0 : -1;
+}
+
+// ---- サンプル ----
+// キャッシュと発音は audio 側(shared/hostapi_sample.h)。予約は tone_enqueue と
+// 同じキュー・同じ id 空間で、発火は click_timer_cb が Play_Sample に振り分ける。
+
+uint8_t sample_level(int32_t level)
+{
+    if (level < 0) level = 0;
+    if (level > 100) level = 100;
+    return (uint8_t)level;
+}
+
+int32_t sample_schedule_impl(int32_t handle, int64_t time_us, bool aclock, int32_t level)
+{
+    if (!s_click_timer || !audio::Sample_Exists(handle)) return -1;
+    hostapi_tsched_entry_t e = hostapi_tsched_sample_entry((int16_t)handle, sample_level(level));
+    if (!hostapi_tsched_set_time_us(&e, time_us, aclock)) return -1;
+    return tsched_enqueue(e);
+}
+
+// ---- 持続音(note_on / note_off) ----
+// 発音とエンベロープは audio 側(shared/hostapi_note.h、トーンタスクが描く)。
+// 予約は tone_enqueue と同じキュー・同じ id 空間で、発火は click_timer_cb が
+// Note_On / Note_Off に振り分ける。
+
+int32_t note_schedule(hostapi_tsched_entry_t e, int64_t time_us, bool aclock)
+{
+    if (!hostapi_tsched_set_time_us(&e, time_us, aclock)) return -1;
+    return tsched_enqueue(e);
+}
+
+int32_t note_on_impl(int32_t ch, int32_t slot, int32_t pitch, int32_t velocity, int64_t time_us,
+                     bool aclock)
+{
+    if (ch < 0 || ch >= HOSTAPI_NOTE_CHANNELS || slot < 0 || slot >= HOSTAPI_NOTE_ENVS ||
+        pitch < 0 || pitch > HOSTAPI_NOTE_PITCH_MAX || time_us < 0) {
+        return -1;
+    }
+    if (velocity > 127) velocity = 127;
+    if (velocity <= 0) { // note_off と同じ
+        if (time_us == 0) return audio::Note_Off((uint8_t)ch) ? 0 : -1;
+        return note_schedule(hostapi_tsched_note_entry(HOSTAPI_TSCHED_NOTE_OFF, ch, 0, 0, 0),
+                             time_us, aclock);
+    }
+    if (time_us == 0) {
+        return audio::Note_On((uint8_t)ch, (uint8_t)slot, (uint16_t)pitch, (uint8_t)velocity)
+                   ? 0
+                   : -1;
+    }
+    return note_schedule(
+        hostapi_tsched_note_entry(HOSTAPI_TSCHED_NOTE_ON, ch, slot, pitch, velocity), time_us,
+        aclock);
+}
+
+int32_t note_off_impl(int32_t ch, int64_t time_us, bool aclock)
+{
+    if (ch < 0 || ch >= HOSTAPI_NOTE_CHANNELS || time_us < 0) return -1;
+    if (time_us == 0) return audio::Note_Off((uint8_t)ch) ? 0 : -1;
+    return note_schedule(hostapi_tsched_note_entry(HOSTAPI_TSCHED_NOTE_OFF, ch, 0, 0, 0),
+                         time_us, aclock);
+}
+
+uint16_t note_env_ms(int32_t ms)
+{
+    if (ms < 0) ms = 0;
+    if (ms > HOSTAPI_NOTE_ENV_MAX_MS) ms = HOSTAPI_NOTE_ENV_MAX_MS;
+    return (uint16_t)ms;
+}
+
 // ---- natives(v0/7A 互換は slot 0 への別名) ----
 
 void native_hostapi_play_click(wasm_exec_env_t exec_env)
@@ -375,6 +914,8 @@ int32_t native_hostapi_tone_define(wasm_exec_env_t exec_env, int32_t slot,
     portENTER_CRITICAL(&s_click_mux);
     s_tones[slot] = ToneDef{true, (uint16_t)freq_hz, (uint16_t)dur_ms, (uint8_t)level};
     portEXIT_CRITICAL(&s_click_mux);
+    // 最初の発音で描かずに済むよう、トーンタスクにレンダ済みを作らせておく
+    audio::Tone_Prepare((uint16_t)freq_hz, (uint16_t)dur_ms, (uint8_t)level);
     return 0;
 }
 
@@ -391,6 +932,83 @@ int32_t native_hostapi_tone_schedule(wasm_exec_env_t exec_env, int32_t slot,
     return tone_schedule_impl(slot, time_ms);
 }
 
+int32_t native_hostapi_tone_enqueue(wasm_exec_env_t exec_env, int32_t slot, int32_t time_ms)
+{
+    (void)exec_env;
+    return tone_enqueue_impl(slot, (int64_t)(uint32_t)time_ms * 1000, false);
+}
+
+int32_t native_hostapi_tone_enqueue_us(wasm_exec_env_t exec_env, int32_t slot, int64_t time_us)
+{
+    (void)exec_env;
+    return tone_enqueue_impl(slot, time_us, true);
+}
+
+int32_t native_hostapi_tone_cancel(wasm_exec_env_t exec_env, int32_t id)
+{
+    (void)exec_env;
+    return tone_cancel_impl(id);
+}
+
+int32_t native_hostapi_sample_play(wasm_exec_env_t exec_env, int32_t handle, int32_t level)
+{
+    (void)exec_env;
+    return audio::Play_Sample(handle, sample_level(level)) ? 0 : -1;
+}
+
+int32_t native_hostapi_sample_schedule(wasm_exec_env_t exec_env, int32_t handle,
+                                       int32_t time_ms, int32_t level)
+{
+    (void)exec_env;
+    return sample_schedule_impl(handle, (int64_t)(uint32_t)time_ms * 1000, false, level);
+}
+
+int32_t native_hostapi_sample_schedule_us(wasm_exec_env_t exec_env, int32_t handle,
+                                          int64_t time_us, int32_t level)
+{
+    (void)exec_env;
+    return sample_schedule_impl(handle, time_us, true, level);
+}
+
+int32_t native_hostapi_note_define(wasm_exec_env_t exec_env, int32_t slot, int32_t attack_ms,
+                                   int32_t decay_ms, int32_t sustain, int32_t release_ms)
+{
+    (void)exec_env;
+    if (slot < 0 || slot >= HOSTAPI_NOTE_ENVS) return -1;
+    if (sustain < 0) sustain = 0;
+    if (sustain > 100) sustain = 100;
+    return audio::Note_Define((uint8_t)slot, note_env_ms(attack_ms), note_env_ms(decay_ms),
+                              (uint8_t)sustain, note_env_ms(release_ms))
+               ? 0
+               : -1;
+}
+
+int32_t native_hostapi_note_on(wasm_exec_env_t exec_env, int32_t ch, int32_t slot,
+                               int32_t pitch, int32_t velocity, int32_t time_ms)
+{
+    (void)exec_env;
+    return note_on_impl(ch, slot, pitch, velocity, (int64_t)(uint32_t)time_ms * 1000, false);
+}
+
+int32_t native_hostapi_note_on_us(wasm_exec_env_t exec_env, int32_t ch, int32_t slot,
+                                  int32_t pitch, int32_t velocity, int64_t time_us)
+{
+    (void)exec_env;
+    return note_on_impl(ch, slot, pitch, velocity, time_us, true);
+}
+
+int32_t native_hostapi_note_off(wasm_exec_env_t exec_env, int32_t ch, int32_t time_ms)
+{
+    (void)exec_env;
+    return note_off_impl(ch, (int64_t)(uint32_t)time_ms * 1000, false);
+}
+
+int32_t native_hostapi_note_off_us(wasm_exec_env_t exec_env, int32_t ch, int64_t time_us)
+{
+    (void)exec_env;
+    return note_off_impl(ch, time_us, true);
+}
+
 // ---- MIDI (Phase 8b) ----
 // buf は WAMR 境界検証済み(シグネチャ "*~")。実装は midi:: に委譲する。
 int32_t native_hostapi_midi_send(wasm_exec_env_t exec_env, const char* bytes, uint32_t len)
@@ -405,6 +1023,16 @@ uint32_t native_hostapi_now_ms(wasm_exec_env_t exec_env)
     return (uint32_t)(esp_timer_get_time() / 1000);
 }
 
+// esp_timer は I2S と同じ水晶なので、そのまま音声クロックに揃っている
+int32_t native_hostapi_now_us64(wasm_exec_env_t exec_env, char* buf, uint32_t len)
+{
+    (void)exec_env;
+    const int64_t t = esp_timer_get_time();
+    if (!buf || len < sizeof(t)) return -1;
+    memcpy(buf, &t, sizeof(t));
+    return (int32_t)sizeof(t);
+}
+
 // ---- オーディオ API (Phase 6B) ----
 // audio::Mp3Player の薄いラッパ。状態はホスト側で宣言的に管理し、
 // 自然終了(finished フラグ)だけ get_state/ctrl 時に取り込む。
@@ -431,38 +1059,138 @@ bool audio_path_ok(const char* path, uint32_t len)
     return true;
 }
 
-int32_t native_hostapi_audio_play(wasm_exec_env_t exec_env, const char* path, uint32_t len)
+// 再生キュー(shared/hostapi_playlist.h)。先頭の曲は鳴っている間に開いて
+// audio::Music_queue_next で渡しておき、audio_player タスクが曲の終わりで
+// 続けて鳴らす。切り替えたことは切り替え回数の差分で取り込む。
+// 呼び出しスレッドは wasm のみ
+hostapi_playlist_t s_playlist = [] {
+    hostapi_playlist_t pl;
+    hostapi_playlist_init(&pl);
+    return pl;
+}();
+uint32_t s_track_seen; // 取り込み済みの audio::Music_track_changes()
+
+// 止まった後にキューに残っている曲をすぐ鳴らす(先頭を渡すのが曲の終わりに
+// 間に合わなかった。曲間に無音が挟まる)。開けない曲は飛ばす
+void playlist_start_head()
+{
+    s_playlist.preloaded = false;
+    while (const hostapi_playlist_item_t* it = hostapi_playlist_head(&s_playlist)) {
+        char full[96];
+        snprintf(full, sizeof(full), "%s/%s", kMusicRoot, it->path);
+        if (audio::Music_play_path(full)) {
+            s_audio_state.store(HOSTAPI_AUDIO_PLAYING);
+            hostapi_playlist_started(&s_playlist, (uint32_t)(esp_timer_get_time() / 1000));
+            return;
+        }
+        ESP_LOGW(TAG, "audio_enqueue: failed: %s (skipped)", full);
+        hostapi_playlist_drop(&s_playlist);
+    }
+}
+
+// 切り替えを取り込み、鳴っている間はキュー先頭を開いて渡しておく
+void playlist_sync()
+{
+    uint32_t time_ms = 0;
+    const uint32_t changes = audio::Music_track_changes(&time_ms);
+    if (changes != s_track_seen) {
+        s_track_seen = changes;
+        // 渡した 1 曲だけが切り替わり得る(clear 済みなら鳴らしたのはキュー外)
+        if (s_playlist.preloaded) hostapi_playlist_started(&s_playlist, time_ms);
+    }
+    audio_refresh_finished();
+    const int st = s_audio_state.load();
+    if (st == HOSTAPI_AUDIO_FINISHED && s_playlist.count > 0) {
+        playlist_start_head();
+        return;
+    }
+    if (st != HOSTAPI_AUDIO_PLAYING && st != HOSTAPI_AUDIO_PAUSED) return;
+    while (!s_playlist.preloaded) {
+        const hostapi_playlist_item_t* it = hostapi_playlist_head(&s_playlist);
+        if (!it) break;
+        char full[96];
+        snprintf(full, sizeof(full), "%s/%s", kMusicRoot, it->path);
+        if (audio::Music_queue_next(full)) {
+            s_playlist.preloaded = true;
+        } else {
+            ESP_LOGW(TAG, "audio_enqueue: cannot open %s (skipped)", full);
+            hostapi_playlist_drop(&s_playlist);
+        }
+    }
+}
+
+// キューを空にする(audio_play / STOP)。開いておいた曲は audio 側が閉じる
+void playlist_clear()
+{
+    audio::Music_clear_next();
+    hostapi_playlist_clear(&s_playlist);
+}
+
+// audio_play / audio_play_at(start_ms >= 0 なら曲の先頭をその時刻に出す)
+int32_t audio_start(const char* who, const char* path, uint32_t len, int64_t start_ms)
 {
-    (void)exec_env;
     char rel[65];
     if (!audio_path_ok(path, len)) {
-        ESP_LOGW(TAG, "audio_play: rejected path");
+        ESP_LOGW(TAG, "%s: rejected path", who);
         s_audio_state.store(HOSTAPI_AUDIO_ERROR);
         return -1;
     }
+    playlist_clear();
     memcpy(rel, path, len);
     rel[len] = '\0';
 
     char full[96];
     snprintf(full, sizeof(full), "%s/%s", kMusicRoot, rel);
-    if (!audio::Music_play_path(full)) {
-        ESP_LOGW(TAG, "audio_play: failed: %s", full);
+    const bool ok = start_ms >= 0 ? audio::Music_play_path_at(full, (uint32_t)start_ms)
+                                  : audio::Music_play_path(full);
+    if (!ok) {
+        ESP_LOGW(TAG, "%s: failed: %s", who, full);
         s_audio_state.store(HOSTAPI_AUDIO_ERROR);
         return -1;
     }
-    ESP_LOGI(TAG, "audio_play: %s", full);
+    ESP_LOGI(TAG, "%s: %s", who, full);
     s_audio_state.store(HOSTAPI_AUDIO_PLAYING);
     return 0;
 }
 
+int32_t native_hostapi_audio_play(wasm_exec_env_t exec_env, const char* path, uint32_t len)
+{
+    (void)exec_env;
+    return audio_start("audio_play", path, len, -1);
+}
+
+int32_t native_hostapi_audio_play_at(wasm_exec_env_t exec_env, const char* path, uint32_t len,
+                                     int32_t time_ms)
+{
+    (void)exec_env;
+    return audio_start("audio_play_at", path, len, (uint32_t)time_ms);
+}
+
+// ミュージックルート相対の WAV / raw PCM をキャッシュに読み込む。キーは
+// ルート相対パス(同じパスの再ロードは SD を読まない)
+int32_t native_hostapi_sample_load(wasm_exec_env_t exec_env, const char* path, uint32_t len)
+{
+    (void)exec_env;
+    if (!audio_path_ok(path, len)) {
+        ESP_LOGW(TAG, "sample_load: rejected path");
+        return -1;
+    }
+    char rel[65];
+    memcpy(rel, path, len);
+    rel[len] = '\0';
+    char full[96];
+    snprintf(full, sizeof(full), "%s/%s", kMusicRoot, rel);
+    return audio::Sample_Load(rel, len, full);
+}
+
 int32_t native_hostapi_audio_ctrl(wasm_exec_env_t exec_env, int32_t cmd)
 {
     (void)exec_env;
-    audio_refresh_finished();
+    playlist_sync();
     const int st = s_audio_state.load();
     switch (cmd) {
     case HOSTAPI_AUDIO_CMD_PAUSE:
-        if (st != HOSTAPI_AUDIO_PLAYING) return -1;
+        if (st != HOSTAPI_AUDIO_PLAYING || audio::Music_start_pending()) return -1;
         audio::Music_pause();
         s_audio_state.store(HOSTAPI_AUDIO_PAUSED);
         return 0;
@@ -472,6 +1200,7 @@ int32_t native_hostapi_audio_ctrl(wasm_exec_env_t exec_env, int32_t cmd)
         s_audio_state.store(HOSTAPI_AUDIO_PLAYING);
         return 0;
     case HOSTAPI_AUDIO_CMD_STOP:
+        playlist_clear();
         audio::Music_stop();
         s_audio_state.store(HOSTAPI_AUDIO_STOPPED);
         return 0;
@@ -491,10 +1220,91 @@ void native_hostapi_audio_set_volume(wasm_exec_env_t exec_env, int32_t v)
 int32_t native_hostapi_audio_get_state(wasm_exec_env_t exec_env)
 {
     (void)exec_env;
-    audio_refresh_finished();
+    playlist_sync();
     return s_audio_state.load();
 }
 
+// 鳴っていれば末尾に積み(先頭ならすぐ開いて渡す)、止まっていれば
+// audio_play と同じくすぐ鳴らす
+int32_t native_hostapi_audio_enqueue(wasm_exec_env_t exec_env, const char* path, uint32_t len)
+{
+    if (!audio_path_ok(path, len)) {
+        ESP_LOGW(TAG, "audio_enqueue: rejected path");
+        return -1;
+    }
+    playlist_sync();
+    const int st = s_audio_state.load();
+    if (st == HOSTAPI_AUDIO_PLAYING || st == HOSTAPI_AUDIO_PAUSED) {
+        const int32_t id = hostapi_playlist_push(&s_playlist, path, len);
+        if (id >= 0) playlist_sync();
+        return id;
+    }
+    if (native_hostapi_audio_play(exec_env, path, len) != 0) return -1;
+    const int32_t id = hostapi_playlist_push(&s_playlist, path, len);
+    hostapi_playlist_started(&s_playlist, (uint32_t)(esp_timer_get_time() / 1000));
+    return id;
+}
+
+// 出力のレベル。公開された最新の窓を audio 側で写す(FFT は新しい窓ごとに 1 回)
+int32_t native_hostapi_audio_get_clock(wasm_exec_env_t exec_env, char* buf, uint32_t len)
+{
+    (void)exec_env;
+    hostapi_audio_clock_t c{};
+    if (!buf || len < sizeof(c)) return -1;
+    if (!audio::Audio_Get_Clock(&c)) return -1;
+    c.now_us = esp_timer_get_time();
+    memcpy(buf, &c, sizeof(c));
+    return (int32_t)sizeof(c);
+}
+
+int32_t native_hostapi_audio_get_levels(wasm_exec_env_t exec_env, char* buf, uint32_t len)
+{
+    (void)exec_env;
+    hostapi_audio_levels_t lv;
+    if (!buf || len < sizeof(lv)) return -1;
+    audio::Audio_Get_Levels(&lv);
+    memcpy(buf, &lv, sizeof(lv));
+    return (int32_t)sizeof(lv);
+}
+
+// 位置・長さ・シークは audio 側(索引とデコード済みフレーム数)に任せ、
+// ここでは状態だけ見る
+int32_t native_hostapi_audio_get_position_ms(wasm_exec_env_t exec_env)
+{
+    (void)exec_env;
+    playlist_sync();
+    const int st = s_audio_state.load();
+    if (st != HOSTAPI_AUDIO_PLAYING && st != HOSTAPI_AUDIO_PAUSED &&
+        st != HOSTAPI_AUDIO_FINISHED) {
+        return -1;
+    }
+    return audio::Music_position_ms();
+}
+
+int32_t native_hostapi_audio_get_duration_ms(wasm_exec_env_t exec_env)
+{
+    (void)exec_env;
+    playlist_sync();
+    const int st = s_audio_state.load();
+    if (st != HOSTAPI_AUDIO_PLAYING && st != HOSTAPI_AUDIO_PAUSED &&
+        st != HOSTAPI_AUDIO_FINISHED) {
+        return -1;
+    }
+    return audio::Music_duration_ms();
+}
+
+int32_t native_hostapi_audio_seek_ms(wasm_exec_env_t exec_env, int32_t ms)
+{
+    (void)exec_env;
+    playlist_sync();
+    const int st = s_audio_state.load();
+    if (ms < 0 || (st != HOSTAPI_AUDIO_PLAYING && st != HOSTAPI_AUDIO_PAUSED) ||
+        audio::Music_start_pending()) {
+        return -1;
+    }
+    return audio::Music_seek_ms((uint32_t)ms);
+}
+
 // ---- ファイル列挙 (Phase 6C) ----
 // ミュージックルート直下の .mp3 を idx で列挙。ホスト側に状態を持たず
 // 毎回 readdir で idx 番目を探す(曲数は高々数十の想定)。
@@ -538,19 +1348,31 @@ int32_t native_hostapi_poll_event(wasm_exec_env_t exec_env, char* buf, uint32_t
     (void)exec_env;
     const uint32_t max_events = len / sizeof(hostapi_event_t);
     int32_t n = 0;
-
-    portENTER_CRITICAL(&s_evq_mux);
-    while (n < (int32_t)max_events && s_evq_count > 0) {
-        memcpy(buf + n * sizeof(hostapi_event_t), &s_evq[s_evq_head],
-               sizeof(hostapi_event_t));
-        s_evq_head = (s_evq_head + 1) % kEventQueueDepth;
-        s_evq_count--;
+    hostapi_event_t ev;
+    playlist_sync(); // 曲の切り替えを取り込む
+    while (n < (int32_t)max_events && hostapi_playlist_take_event(&s_playlist, &ev)) {
+        memcpy(buf + n * sizeof(hostapi_event_t), &ev, sizeof(hostapi_event_t));
+        n++;
+    }
+    while (n < (int32_t)max_events && hostapi_evq_pop(&s_evq, &ev)) {
+        memcpy(buf + n * sizeof(hostapi_event_t), &ev, sizeof(hostapi_event_t));
         n++;
     }
-    portEXIT_CRITICAL(&s_evq_mux);
     return n;
 }
 
+int32_t native_hostapi_gesture_enable(wasm_exec_env_t exec_env, int32_t mask)
+{
+    (void)exec_env;
+    if ((uint32_t)mask & ~(uint32_t)HOSTAPI_GESTURE_ALL) return -1;
+    // 認識器は LVGL タスクのもの。押下中に切り替えても途中のタッチは
+    // 認識させない(次の DOWN から)
+    lvgl_port_lock(0);
+    hostapi_gesture_reset(&s_gesture, (uint32_t)mask);
+    lvgl_port_unlock();
+    return 0;
+}
+
 // 登録テーブルは shared/hostapi_defs.h の X-macro から生成(Linux ホストと共通)
 NativeSymbol s_native_symbols[] = {
     HOSTAPI_NATIVE_SYMBOLS(HOSTAPI_SYMBOL_ENTRY)
@@ -569,14 +1391,20 @@ void hostapi_app_screen_create()
     }
     for (auto& t : s_texts) t = TextSlot{};
     for (auto& r : s_rects) r = RectSlot{};
+    line_slots_reset();
+    widget_slots_reset();
     s_screen = lv_obj_create(nullptr);
     lv_obj_set_style_bg_color(s_screen, lv_color_black(), 0);
     // アプリ実行中のタッチはこのスクリーンで受けてイベントキューへ流す
     lv_obj_add_event_cb(s_screen, screen_input_event_cb, LV_EVENT_PRESSED, nullptr);
+    lv_obj_add_event_cb(s_screen, screen_input_event_cb, LV_EVENT_PRESSING, nullptr);
     lv_obj_add_event_cb(s_screen, screen_input_event_cb, LV_EVENT_RELEASED, nullptr);
     lv_screen_load(s_screen);
+    event_queue_reset(); // 生産者(LVGL タスク)を止めた状態で空にする
+#if CONFIG_MIDIBOX_EVENT_RECORD
+    evrec_start();
+#endif
     lvgl_port_unlock();
-    event_queue_reset();
 }
 
 void hostapi_app_screen_destroy()
@@ -587,9 +1415,20 @@ void hostapi_app_screen_destroy()
         s_screen = nullptr;
         for (auto& t : s_texts) t = TextSlot{};
         for (auto& r : s_rects) r = RectSlot{};
+        line_slots_reset();
+        widget_slots_reset();
     }
-    lvgl_port_unlock();
     event_queue_reset();
+#if CONFIG_MIDIBOX_EVENT_RECORD
+    hostapi_event_t* recs = s_evrec;
+    const int rec_count = s_evrec_count;
+    s_evrec = nullptr;
+    s_evrec_count = 0;
+#endif
+    lvgl_port_unlock();
+#if CONFIG_MIDIBOX_EVENT_RECORD
+    evrec_save(recs, rec_count);
+#endif
 }
 
 void hostapi_audio_reset()
@@ -597,22 +1436,75 @@ void hostapi_audio_reset()
     // ライフサイクル契約: アプリ破棄時にオーディオを必ず停止する。
     // アプリ起動直前にも呼び、STOPPED 状態から開始させる。
     // 状態変数に頼らず無条件で止める(アイドル時の stop は無害)。
+    // 再生キューと未配送の切り替えイベントも捨てる
     audio::Music_stop();
     s_audio_state.store(HOSTAPI_AUDIO_STOPPED);
+    hostapi_playlist_reset(&s_playlist);
+    s_track_seen = audio::Music_track_changes(nullptr);
 
     // クリック予約・last_fired・統計もリセット (Phase 7A 契約)。
     // マスター音量は既定 98 に戻す(アプリ起動時の初期状態を一定にする)
     if (s_click_timer) esp_timer_stop(s_click_timer);
     portENTER_CRITICAL(&s_click_mux);
-    s_click_pending = 0;
+    hostapi_tsched_reset(&s_tsched);
     s_click_last_fired = 0;
     s_click_fire_count = 0;
     portEXIT_CRITICAL(&s_click_mux);
     tone_table_reset(); // トーンパレットも初期状態へ (Phase 7C 契約)
+    audio::Sample_Reset(); // サンプルキャッシュもアプリセッション状態
+    audio::Note_Reset();   // 持続音は鳴りっぱなしにしない(エンベロープも既定へ)
     audio::Volume_adjustment(98);
     midi::Midi_Reset(); // MIDI Clock 生成も必ず停止する (Phase 8b 契約)
 }
 
+#if CONFIG_MIDIBOX_NATIVE_BENCH
+// 折れ線/点列の描画コスト計測。総点数を 4 slot に分けて描き、native 呼び出し
+// (点列取り込み+外接矩形計算)と lv_refr_now(描画+SPI フラッシュ完了待ち)を
+// それぞれ測る。点列は画面幅いっぱいのノコギリ波(全面が無効化される最悪側)。
+void hostapi_bench_draw()
+{
+    int16_t* pts = static_cast<int16_t*>(malloc(HOSTAPI_LINE_MAX_POINTS * 4));
+    if (!pts) return;
+    lvgl_port_lock(0);
+    lv_obj_t* prev = lv_screen_active();
+    lvgl_port_unlock();
+    hostapi_app_screen_create();
+
+    static const int kTotals[] = {256, 1024, 4096};
+    for (const int total : kTotals) {
+        const int per_slot = total / HOSTAPI_LINE_SLOTS;
+        for (int mode = 0; mode < 2; mode++) {
+            const bool points = (mode == 1);
+            int64_t t_update = 0;
+            for (int slot = 0; slot < HOSTAPI_LINE_SLOTS; slot++) {
+                for (int i = 0; i < per_slot; i++) {
+                    pts[i * 2] = (int16_t)(i * 320 / per_slot);
+                    pts[i * 2 + 1] = (int16_t)(slot * 60 + (i * 7) % 56);
+                }
+                const int64_t t0 = esp_timer_get_time();
+                line_slot_set(slot, reinterpret_cast<const char*>(pts), per_slot * 4,
+                              0x40c0ff, points);
+                t_update += esp_timer_get_time() - t0;
+            }
+            lvgl_port_lock(0);
+            const int64_t t1 = esp_timer_get_time();
+            lv_refr_now(nullptr);
+            const int64_t t_render = esp_timer_get_time() - t1;
+            lvgl_port_unlock();
+            ESP_LOGI(TAG, "bench: draw_%s %d pts: update %lld us, render+flush %lld us",
+                     points ? "points" : "lines", total, (long long)t_update,
+                     (long long)t_render);
+        }
+    }
+    free(pts);
+
+    lvgl_port_lock(0);
+    lv_screen_load(prev);
+    lvgl_port_unlock();
+    hostapi_app_screen_destroy();
+}
+#endif
+
 bool hostapi_register_natives()
 {
     click_timer_ensure();
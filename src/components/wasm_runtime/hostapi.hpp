@@ -18,4 +18,8 @@ void hostapi_app_screen_destroy();
 // アプリ起動直前と破棄時に wasm_runtime が呼ぶ。
 void hostapi_audio_reset();
 
+// ネイティブ側の描画コスト計測(CONFIG_MIDIBOX_NATIVE_BENCH)。アプリ用スクリーンを
+// 一時的に作って計測し、元のスクリーンに戻す。アプリ非実行中に呼ぶこと。
+void hostapi_bench_draw();
+
 } // namespace wasmrt
@@ -73,6 +73,10 @@ extern "C" void app_main()
         else {
             wasmrt::launcher_run_cycle_test();
         }
+#endif
+#if CONFIG_MIDIBOX_NATIVE_BENCH
+        wasmrt::hostapi_bench_draw();
+        audio::Audio_Bench_Voices();
 #endif
         // 失敗時もメニューは出す(エラー表示付き・空リスト)
         wasmrt::launcher_show(status);